@@ -0,0 +1,389 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+import androidx.test.platform.app.InstrumentationRegistry;
+
+import org.json.JSONArray;
+import org.json.JSONObject;
+import org.junit.Before;
+import org.junit.BeforeClass;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+import java.io.BufferedInputStream;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.ServerSocket;
+import java.net.Socket;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.zip.GZIPInputStream;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+
+/**
+ * Runs the uploader against a stand-in transport, which keeps the decompressed batches in memory,
+ * and through {@link xcrash.HttpTombstoneTransport} against a local stand-in HTTP server.
+ */
+@RunWith(AndroidJUnit4.class)
+public class TombstoneUploaderTest {
+
+    private static File logDir;
+    private static int fileSeq = 0;
+
+    private static class FakeTransport implements ITombstoneTransport {
+        final List<String> batchIds = new ArrayList<String>();
+        final List<JSONObject> bodies = new ArrayList<JSONObject>();
+        boolean accept = true;
+
+        @Override
+        public boolean send(String batchId, Body body) throws IOException {
+            ByteArrayOutputStream baos = new ByteArrayOutputStream();
+            body.writeTo(baos);
+
+            bodies.add(decodeBody(baos.toByteArray()));
+            batchIds.add(batchId);
+            return accept;
+        }
+    }
+
+    //one request per connection, the response has no body
+    private static class LocalHttpServer implements Runnable {
+        final ServerSocket serverSocket;
+        final List<Map<String, String>> headers = Collections.synchronizedList(new ArrayList<Map<String, String>>());
+        final List<JSONObject> bodies = Collections.synchronizedList(new ArrayList<JSONObject>());
+        volatile int responseCode = 200;
+
+        LocalHttpServer() throws IOException {
+            serverSocket = new ServerSocket(0, 1, InetAddress.getByName("127.0.0.1"));
+            Thread thread = new Thread(this, "xcrash_test_http");
+            thread.setDaemon(true);
+            thread.start();
+        }
+
+        String getUrl() {
+            return "http://127.0.0.1:" + serverSocket.getLocalPort() + "/upload";
+        }
+
+        void close() throws IOException {
+            serverSocket.close();
+        }
+
+        @Override
+        public void run() {
+            while (!serverSocket.isClosed()) {
+                Socket socket = null;
+                try {
+                    socket = serverSocket.accept();
+                    handle(socket);
+                } catch (Exception ignored) {
+                } finally {
+                    if (socket != null) {
+                        try {
+                            socket.close();
+                        } catch (Exception ignored) {
+                        }
+                    }
+                }
+            }
+        }
+
+        private void handle(Socket socket) throws IOException {
+            InputStream in = new BufferedInputStream(socket.getInputStream());
+
+            //request line and headers
+            Map<String, String> request = new HashMap<String, String>();
+            request.put(":request", readLine(in));
+            String line;
+            while (!(line = readLine(in)).isEmpty()) {
+                int i = line.indexOf(':');
+                request.put(line.substring(0, i).trim().toLowerCase(Locale.US), line.substring(i + 1).trim());
+            }
+
+            //chunked or fixed length body
+            ByteArrayOutputStream body = new ByteArrayOutputStream();
+            if ("chunked".equalsIgnoreCase(request.get("transfer-encoding"))) {
+                int size;
+                while ((size = Integer.parseInt(readLine(in).split(";")[0].trim(), 16)) > 0) {
+                    copy(in, body, size);
+                    readLine(in);
+                }
+                //noinspection StatementWithEmptyBody
+                while (!readLine(in).isEmpty()) {
+                }
+            } else if (request.containsKey("content-length")) {
+                copy(in, body, Integer.parseInt(request.get("content-length")));
+            }
+
+            //recorded before responding, so the test sees it when upload() returns
+            bodies.add(decodeBody(body.toByteArray()));
+            headers.add(request);
+
+            OutputStream out = socket.getOutputStream();
+            out.write(("HTTP/1.1 " + responseCode + " Test\r\nContent-Length: 0\r\nConnection: close\r\n\r\n").getBytes("ISO-8859-1"));
+            out.flush();
+        }
+
+        private static String readLine(InputStream in) throws IOException {
+            StringBuilder sb = new StringBuilder();
+            int c;
+            while ((c = in.read()) != '\n') {
+                if (c == -1) {
+                    throw new EOFException();
+                }
+                if (c != '\r') {
+                    sb.append((char) c);
+                }
+            }
+            return sb.toString();
+        }
+
+        private static void copy(InputStream in, OutputStream out, int size) throws IOException {
+            byte[] buf = new byte[4096];
+            while (size > 0) {
+                int n = in.read(buf, 0, Math.min(size, buf.length));
+                if (n == -1) {
+                    throw new EOFException();
+                }
+                out.write(buf, 0, n);
+                size -= n;
+            }
+        }
+    }
+
+    @BeforeClass
+    public static void initXCrash() {
+        logDir = new File(InstrumentationRegistry.getInstrumentation().getTargetContext().getCacheDir(), "xcrash_upload_test");
+        XCrash.init(InstrumentationRegistry.getInstrumentation().getTargetContext(), new XCrash.InitParameters()
+            .setLogDir(logDir.getAbsolutePath())
+            .disableJavaCrashHandler()
+            .disableNativeCrashHandler()
+            .disableAnrCrashHandler());
+    }
+
+    @Before
+    public void cleanLogDir() {
+        deleteRecursively(logDir);
+        assertTrue(logDir.mkdirs());
+    }
+
+    @Test
+    public void dedupeInBatchAndByJournal() throws Exception {
+        FakeTransport transport = new FakeTransport();
+        TombstoneUploader uploader = new TombstoneUploader(transport, new TombstoneUploader.Parameters().setMinIntervalMs(0));
+
+        createTombstone("sigA");
+        createTombstone("sigA");
+        createTombstone("sigB");
+        assertEquals(3, uploader.upload());
+        assertEquals(0, TombstoneManager.getAllTombstones().length);
+
+        //one report for each signature, with the count of the duplicates
+        assertEquals(1, transport.bodies.size());
+        JSONObject body = transport.bodies.get(0);
+        assertEquals(transport.batchIds.get(0), body.getString("batch"));
+        Map<String, Integer> counts = getCounts(body);
+        assertEquals(2, counts.size());
+        assertEquals(2, (int) counts.get("sigA"));
+        assertEquals(1, (int) counts.get("sigB"));
+
+        //uploaded within the dedupe window, deleted without sending
+        createTombstone("sigA");
+        assertEquals(1, uploader.upload());
+        assertEquals(1, transport.bodies.size());
+        assertEquals(0, TombstoneManager.getAllTombstones().length);
+
+        //a new signature is still sent
+        createTombstone("sigC");
+        assertEquals(1, uploader.upload());
+        assertEquals(2, transport.bodies.size());
+        assertEquals(1, (int) getCounts(transport.bodies.get(1)).get("sigC"));
+    }
+
+    @Test
+    public void resendInFlightBatchWithSameId() throws Exception {
+        FakeTransport transport = new FakeTransport();
+        transport.accept = false;
+        TombstoneUploader uploader = new TombstoneUploader(transport, new TombstoneUploader.Parameters().setMinIntervalMs(0));
+
+        createTombstone("sigA");
+        createTombstone("sigB");
+        assertEquals(TombstoneUploader.SEND_FAILED, uploader.upload());
+        assertEquals(2, TombstoneManager.getAllTombstones().length);
+
+        //a new tombstone is not added to the in-flight batch
+        createTombstone("sigC");
+
+        //a new uploader (e.g. after the process was killed) resends the batch from the journal
+        transport.accept = true;
+        uploader = new TombstoneUploader(transport, new TombstoneUploader.Parameters().setMinIntervalMs(0));
+        assertEquals(2, uploader.upload());
+        assertEquals(transport.batchIds.get(0), transport.batchIds.get(1));
+        Map<String, Integer> counts = getCounts(transport.bodies.get(1));
+        assertEquals(2, counts.size());
+        assertFalse(counts.containsKey("sigC"));
+
+        //then a new batch
+        assertEquals(1, uploader.upload());
+        assertFalse(transport.batchIds.get(1).equals(transport.batchIds.get(2)));
+        assertEquals(0, TombstoneManager.getAllTombstones().length);
+    }
+
+    @Test
+    public void byteBudgetAndRateLimit() throws Exception {
+        FakeTransport transport = new FakeTransport();
+
+        //the first batch is always sent, then the budget is exhausted
+        TombstoneUploader uploader = new TombstoneUploader(transport,
+            new TombstoneUploader.Parameters().setMinIntervalMs(0).setMaxBytesPerDay(1));
+        createTombstone("sigA");
+        assertEquals(1, uploader.upload());
+        createTombstone("sigB");
+        assertEquals(TombstoneUploader.BUDGET_EXHAUSTED, uploader.upload());
+        assertEquals(1, transport.bodies.size());
+        assertEquals(1, TombstoneManager.getAllTombstones().length);
+
+        //the last upload time is in the journal
+        uploader = new TombstoneUploader(transport, new TombstoneUploader.Parameters().setMinIntervalMs(60 * 1000));
+        assertEquals(TombstoneUploader.RATE_LIMITED, uploader.upload());
+        assertEquals(1, transport.bodies.size());
+    }
+
+    @Test
+    public void postByHttpTransport() throws Exception {
+        LocalHttpServer server = new LocalHttpServer();
+        try {
+            TombstoneUploader uploader = new TombstoneUploader(new HttpTombstoneTransport(server.getUrl(), 5000, 5000),
+                new TombstoneUploader.Parameters().setMinIntervalMs(0));
+
+            createTombstone("sigA");
+            createTombstone("sigA");
+            createTombstone("sigB");
+            assertEquals(3, uploader.upload());
+            assertEquals(0, TombstoneManager.getAllTombstones().length);
+
+            //the request headers and the gzip compressed JSON body
+            assertEquals(1, server.bodies.size());
+            Map<String, String> request = server.headers.get(0);
+            assertTrue(request.get(":request").startsWith("POST /upload "));
+            assertEquals("application/json", request.get("content-type"));
+            assertEquals("gzip", request.get("content-encoding"));
+            JSONObject body = server.bodies.get(0);
+            assertEquals(request.get("x-xcrash-batch-id"), body.getString("batch"));
+            Map<String, Integer> counts = getCounts(body);
+            assertEquals(2, counts.size());
+            assertEquals(2, (int) counts.get("sigA"));
+            assertEquals(1, (int) counts.get("sigB"));
+
+            //not a 2xx response, the tombstone is kept for the next time
+            server.responseCode = 500;
+            createTombstone("sigC");
+            assertEquals(TombstoneUploader.SEND_FAILED, uploader.upload());
+            assertEquals(2, server.bodies.size());
+            assertEquals(1, TombstoneManager.getAllTombstones().length);
+
+            //resent with the same batch ID
+            server.responseCode = 200;
+            assertEquals(1, uploader.upload());
+            assertEquals(3, server.bodies.size());
+            assertEquals(server.headers.get(1).get("x-xcrash-batch-id"), server.headers.get(2).get("x-xcrash-batch-id"));
+            assertEquals(0, TombstoneManager.getAllTombstones().length);
+        } finally {
+            server.close();
+        }
+    }
+
+    private static JSONObject decodeBody(byte[] gzip) throws IOException {
+        InputStream in = new GZIPInputStream(new ByteArrayInputStream(gzip));
+        ByteArrayOutputStream json = new ByteArrayOutputStream();
+        byte[] buf = new byte[4096];
+        int n;
+        while ((n = in.read(buf)) != -1) {
+            json.write(buf, 0, n);
+        }
+        in.close();
+
+        try {
+            return new JSONObject(json.toString("UTF-8"));
+        } catch (Exception e) {
+            throw new IOException(e);
+        }
+    }
+
+    private static Map<String, Integer> getCounts(JSONObject body) throws Exception {
+        Map<String, Integer> counts = new HashMap<String, Integer>();
+        JSONArray reports = body.getJSONArray("reports");
+        for (int i = 0; i < reports.length(); i++) {
+            JSONObject report = reports.getJSONObject(i);
+            assertTrue(report.getJSONObject("tombstone").has(TombstoneParser.keyJavaStacktrace));
+            counts.put(report.getString("signature"), report.getInt("count"));
+        }
+        return counts;
+    }
+
+    private static void createTombstone(String signature) throws IOException {
+        String path = String.format("%s/%s_%020d_1.0__xcrash.test%s",
+            logDir.getAbsolutePath(), Util.logPrefix, System.currentTimeMillis() * 1000 + (fileSeq++), Util.javaLogSuffix);
+        String content = Util.sepHead + "\n"
+            + "Tombstone maker: 'xCrash test'\n"
+            + "Crash type: '" + Util.javaCrashType + "'\n"
+            + "Crash signature: '" + signature + "'\n"
+            + "\n"
+            + "java stacktrace:\n"
+            + "java.lang.RuntimeException: " + signature + "\n"
+            + "\tat xcrash.TombstoneUploaderTest.createTombstone(TombstoneUploaderTest.java:1)\n"
+            + "\n";
+
+        FileOutputStream out = new FileOutputStream(path);
+        try {
+            out.write(content.getBytes("UTF-8"));
+        } finally {
+            out.close();
+        }
+    }
+
+    private static void deleteRecursively(File file) {
+        File[] children = file.listFiles();
+        if (children != null) {
+            for (File child : children) {
+                deleteRecursively(child);
+            }
+        }
+        //noinspection ResultOfMethodCallIgnored
+        file.delete();
+    }
+}
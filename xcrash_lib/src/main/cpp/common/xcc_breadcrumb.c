@@ -0,0 +1,68 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include "xcc_breadcrumb.h"
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcc_libc_support.h"
+
+int xcc_breadcrumb_record(int log_fd, const xcc_breadcrumb_t *self, long time_zone)
+{
+    const xcc_breadcrumb_entry_t *entry;
+    uint64_t                      next, i;
+    time_t                        sec;
+    long                          msec;
+    struct tm                     tm;
+    int                           r;
+
+    if(log_fd < 0 || NULL == self) return XCC_ERRNO_INVAL;
+    if(XCC_BREADCRUMB_MAGIC != self->magic || XCC_BREADCRUMB_CAPACITY != self->capacity) return XCC_ERRNO_FORMAT;
+
+    next = __atomic_load_n(&(self->next), __ATOMIC_ACQUIRE);
+    if(0 == next) return 0;
+
+    if(0 != (r = xcc_util_write_str(log_fd, "breadcrumbs:\n"))) return r;
+
+    //from the oldest to the newest
+    for(i = (next > XCC_BREADCRUMB_CAPACITY ? next - XCC_BREADCRUMB_CAPACITY : 0); i < next; i++)
+    {
+        entry = &(self->entries[i & (XCC_BREADCRUMB_CAPACITY - 1)]);
+
+        //skip the slot which is being written or has been overwritten
+        if(i + 1 != __atomic_load_n(&(entry->seq), __ATOMIC_ACQUIRE)) continue;
+
+        sec = (time_t)(entry->time / 1000000);
+        msec = (long)(entry->time % 1000000 / 1000);
+        xcc_libc_support_memset(&tm, 0, sizeof(tm));
+        xcc_libc_support_localtime_r(&sec, time_zone, &tm);
+
+        if(0 != (r = xcc_util_write_format_safe(log_fd, "    %02d-%02d %02d:%02d:%02d.%03ld %5d  %s\n",
+                                                 tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, msec,
+                                                 entry->tid, entry->msg))) return r;
+    }
+
+    return xcc_util_write_str(log_fd, "\n");
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef XCC_BREADCRUMB_H
+#define XCC_BREADCRUMB_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XCC_BREADCRUMB_MAGIC    0x58434243 //"XCBC"
+#define XCC_BREADCRUMB_CAPACITY 64 //must be a power of 2
+#define XCC_BREADCRUMB_MSG_LEN  112
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct
+{
+    //index + 1 of the producer which has finished writing this slot, 0 means not ready
+    uint64_t     seq;
+    uint64_t     time;
+    pid_t        tid;
+    char         msg[XCC_BREADCRUMB_MSG_LEN];
+} xcc_breadcrumb_entry_t;
+
+typedef struct
+{
+    uint32_t               magic;
+    uint32_t               capacity;
+    uint64_t               next; //total number of appended entries
+    xcc_breadcrumb_entry_t entries[XCC_BREADCRUMB_CAPACITY];
+} xcc_breadcrumb_t;
+
+#pragma clang diagnostic pop
+
+int xcc_breadcrumb_record(int log_fd, const xcc_breadcrumb_t *self, long time_zone);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
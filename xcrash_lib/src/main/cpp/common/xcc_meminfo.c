@@ -24,9 +24,12 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <inttypes.h>
-#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
 #include "xcc_util.h"
 #include "xcc_libc_support.h"
 #include "xcc_meminfo.h"
@@ -38,6 +41,10 @@
 #define XCC_MEMINFO_SUM_HEAD_FMT   "%21s %8s\n"
 #define XCC_MEMINFO_SUM_DATA_FMT   "%21s %8zu\n"
 #define XCC_MEMINFO_SUM_DATA2_FMT  "%21s %8zu %21s %8zu\n"
+#define XCC_MEMINFO_BUF_SIZE       (64 * 1024)
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
 
 typedef struct
 {
@@ -141,16 +148,133 @@ enum {
     _NUM_EXCLUSIVE_HEAP = HEAP_UNKNOWN + 1
 };
 
-static void xcc_meminfo_load(FILE *fp, xcc_meminfo_t *stats, int *found_swap_pss)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    int     fd;
+    char   *buf; //XCC_MEMINFO_BUF_SIZE + 1 bytes
+    size_t  pos;
+    size_t  len;
+    int     eof;
+} xcc_meminfo_reader_t;
+#pragma clang diagnostic pop
+
+//read the file in large chunks, return lines (without '\n') in place
+static char *xcc_meminfo_reader_gets(xcc_meminfo_reader_t *self)
 {
-    char       line[1024];
-    size_t     len;
-    size_t     temp;
+    char    *line, *nl;
+    ssize_t  n;
+
+    while(1)
+    {
+        line = self->buf + self->pos;
+        if(NULL != (nl = memchr(line, '\n', self->len - self->pos)))
+        {
+            *nl = '\0';
+            self->pos = (size_t)(nl - self->buf) + 1;
+            return line;
+        }
+
+        if(self->eof)
+        {
+            if(self->pos >= self->len) return NULL;
+            self->buf[self->len] = '\0';
+            self->pos = self->len;
+            return line;
+        }
+
+        if(self->pos > 0)
+        {
+            //move the partial line to the beginning of the buffer
+            memmove(self->buf, line, self->len - self->pos);
+            self->len -= self->pos;
+            self->pos = 0;
+        }
+        else if(self->len >= XCC_MEMINFO_BUF_SIZE)
+        {
+            //line too long, return it truncated
+            self->buf[self->len] = '\0';
+            self->pos = self->len;
+            return line;
+        }
+
+        n = XCC_UTIL_TEMP_FAILURE_RETRY(read(self->fd, self->buf + self->len, XCC_MEMINFO_BUF_SIZE - self->len));
+        if(n <= 0)
+            self->eof = 1;
+        else
+            self->len += (size_t)n;
+    }
+}
+
+static int xcc_meminfo_is_hex(char c)
+{
+    return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f');
+}
+
+static size_t xcc_meminfo_parse_hex(char **p, uintptr_t *val)
+{
+    char   *s = *p;
+    size_t  n = 0;
+
+    *val = 0;
+    for(; xcc_meminfo_is_hex(*s); s++, n++)
+        *val = (*val << 4) | (uintptr_t)(*s <= '9' ? *s - '0' : *s - 'a' + 10);
+
+    *p = s;
+    return n;
+}
+
+static char *xcc_meminfo_skip_field(char *p)
+{
+    while('\0' != *p && ' ' != *p) p++;
+    while(' ' == *p) p++;
+    return p;
+}
+
+//"start-end perms offset dev inode [name]"
+static int xcc_meminfo_parse_map(char *line, uintptr_t *start, uintptr_t *end, char **name)
+{
+    char *p = line;
+    int   i;
+
+    if(0 == xcc_meminfo_parse_hex(&p, start) || '-' != *p++) return -1;
+    if(0 == xcc_meminfo_parse_hex(&p, end) || ' ' != *p) return -1;
+    while(' ' == *p) p++;
+
+    //skip perms, offset, dev and inode
+    for(i = 0; i < 4; i++)
+    {
+        if('\0' == *p) return -1;
+        p = xcc_meminfo_skip_field(p);
+    }
+
+    *name = p;
+    return 0;
+}
+
+//"Key:   1234 kB", the key has already been matched
+static size_t xcc_meminfo_parse_kb(const char *p)
+{
+    size_t val = 0;
+
+    while(' ' == *p || '\t' == *p) p++;
+    for(; '0' <= *p && *p <= '9'; p++)
+        val = val * 10 + (size_t)(*p - '0');
+
+    return val;
+}
+
+#define XCC_MEMINFO_KEY(line, key) (0 == strncmp(line, key, sizeof(key) - 1))
+#define XCC_MEMINFO_VAL(line, key) xcc_meminfo_parse_kb(line + sizeof(key) - 1)
+
+static void xcc_meminfo_load(xcc_meminfo_reader_t *reader, xcc_meminfo_t *stats, int *found_swap_pss)
+{
+    char      *line;
     
     uintptr_t  start = 0, end = 0, prev_end = 0;
     char      *name;
-    size_t     name_len, name_pos;
-    int        pos = 0;
+    size_t     name_len;
 
     size_t     pss;
     size_t     swappable_pss;
@@ -170,8 +294,8 @@ static void xcc_meminfo_load(FILE *fp, xcc_meminfo_t *stats, int *found_swap_pss
     int        done = 0;
     int        is_swappable = 0;
 
-    if(NULL == fgets(line, sizeof(line), fp)) return;
-    
+    if(NULL == (line = xcc_meminfo_reader_gets(reader))) return;
+
     while(!done)
     {
         prev_heap = which_heap;
@@ -181,22 +305,13 @@ static void xcc_meminfo_load(FILE *fp, xcc_meminfo_t *stats, int *found_swap_pss
         skip = 0;
         is_swappable = 0;
 
-        len = strlen(line);
-        if (len < 1) return;
-        line[--len] = '\0';
-        
-        if(sscanf(line, "%"SCNxPTR"-%"SCNxPTR" %*s %*x %*x:%*x %*d%n", &start, &end, &pos) != 2)
+        if(0 != xcc_meminfo_parse_map(line, &start, &end, &name))
         {
             skip = 1;
         }
         else
         {
-            name_pos = (size_t)pos;
-            
-            //get name and name length
-            while(isspace(line[name_pos]))
-                name_pos += 1;
-            name = line + name_pos;
+            //get name length
             name_len = strlen(name);
             
             //trim the end of the line if it is " (deleted)"
@@ -375,30 +490,36 @@ static void xcc_meminfo_load(FILE *fp, xcc_meminfo_t *stats, int *found_swap_pss
 
         while(1)
         {
-            if(NULL == fgets(line, sizeof(line), fp))
+            if(NULL == (line = xcc_meminfo_reader_gets(reader)))
             {
                 done = 1;
                 break;
             }
 
-            if(line[0] == 'P' && sscanf(line, "Pss: %zu kB", &temp) == 1)
-                pss = temp;
-            else if(line[0] == 'S' && sscanf(line, "Shared_Clean: %zu kB", &temp) == 1)
-                shared_clean = temp;
-            else if (line[0] == 'S' && sscanf(line, "Shared_Dirty: %zu kB", &temp) == 1)
-                shared_dirty = temp;
-            else if (line[0] == 'P' && sscanf(line, "Private_Clean: %zu kB", &temp) == 1)
-                private_clean = temp;
-            else if (line[0] == 'P' && sscanf(line, "Private_Dirty: %zu kB", &temp) == 1)
-                private_dirty = temp;
-            else if (line[0] == 'S' && sscanf(line, "Swap: %zu kB", &temp) == 1)
-                swapped_out = temp;
-            else if (line[0] == 'S' && sscanf(line, "SwapPss: %zu kB", &temp) == 1)
+            if('P' == line[0])
+            {
+                if(XCC_MEMINFO_KEY(line, "Pss:"))
+                    pss = XCC_MEMINFO_VAL(line, "Pss:");
+                else if(XCC_MEMINFO_KEY(line, "Private_Clean:"))
+                    private_clean = XCC_MEMINFO_VAL(line, "Private_Clean:");
+                else if(XCC_MEMINFO_KEY(line, "Private_Dirty:"))
+                    private_dirty = XCC_MEMINFO_VAL(line, "Private_Dirty:");
+            }
+            else if('S' == line[0])
             {
-                *found_swap_pss = 1;
-                swapped_out_pss = temp;
+                if(XCC_MEMINFO_KEY(line, "Shared_Clean:"))
+                    shared_clean = XCC_MEMINFO_VAL(line, "Shared_Clean:");
+                else if(XCC_MEMINFO_KEY(line, "Shared_Dirty:"))
+                    shared_dirty = XCC_MEMINFO_VAL(line, "Shared_Dirty:");
+                else if(XCC_MEMINFO_KEY(line, "Swap:"))
+                    swapped_out = XCC_MEMINFO_VAL(line, "Swap:");
+                else if(XCC_MEMINFO_KEY(line, "SwapPss:"))
+                {
+                    *found_swap_pss = 1;
+                    swapped_out_pss = XCC_MEMINFO_VAL(line, "SwapPss:");
+                }
             }
-            else if(sscanf(line, "%"SCNxPTR"-%"SCNxPTR" %*s %*x %*x:%*x %*d", &start, &end) == 2)
+            else if(xcc_meminfo_is_hex(line[0]))
                 break; // looks like a new mapping
         }
 
@@ -466,42 +587,11 @@ static int xcc_meminfo_record_proc_limits(int log_fd, pid_t pid)
     return xcc_util_record_sub_section_from(log_fd, path, " Process Limits (From: /proc/PID/limits)\n", 0);
 }
 
-int xcc_meminfo_record(int log_fd, pid_t pid)
+static int xcc_meminfo_record_details(int log_fd, xcc_meminfo_t *stats, xcc_meminfo_t *total, int found_swap_pss)
 {
-    char           path[64];
-    FILE          *fp = NULL;
-    xcc_meminfo_t  stats[_NUM_HEAP];
-    xcc_meminfo_t  total;
-    int            found_swap_pss = 0;
-    size_t         i;
-    int            r = 0;
-
-    xcc_libc_support_memset(stats, 0, sizeof(stats));
-    xcc_libc_support_memset(&total, 0, sizeof(total));
-
-    //load memory info from /proc/pid/smaps
-    snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
-    if(NULL == (fp = fopen(path, "r"))) return 0;
-    xcc_meminfo_load(fp, stats, &found_swap_pss);
-    fclose(fp);
-
-    for(i = 0; i < _NUM_EXCLUSIVE_HEAP; i++)
-    {
-        total.pss += (stats[i].pss + stats[i].swapped_out_pss);
-        total.swappable_pss += stats[i].swappable_pss;
-        total.private_dirty += stats[i].private_dirty;
-        total.shared_dirty += stats[i].shared_dirty;
-        total.private_clean += stats[i].private_clean;
-        total.shared_clean += stats[i].shared_clean;
-        total.swapped_out += stats[i].swapped_out;
-        total.swapped_out_pss += stats[i].swapped_out_pss;
-    }
+    size_t i;
+    int    r;
 
-    //dump
-    if(0 != (r = xcc_util_write_str(log_fd, "memory info:\n"))) return r;
-    if(0 != (r = xcc_meminfo_record_sys(log_fd))) return r;
-    if(0 != (r = xcc_meminfo_record_proc_status(log_fd, pid))) return r;
-    if(0 != (r = xcc_meminfo_record_proc_limits(log_fd, pid))) return r;
     if(0 != (r = xcc_util_write_str(log_fd, " Process Details (From: /proc/PID/smaps)\n"))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_HEAD_FMT, "", "Pss", "Pss", "Shared", "Private", "Shared", "Private", found_swap_pss ? "SwapPss" : "Swap"))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_HEAD_FMT, "", "Total", "Clean", "Dirty", "Dirty", "Clean", "Clean", "Dirty"))) return r;
@@ -524,13 +614,13 @@ int xcc_meminfo_record(int log_fd, pid_t pid)
         }
     }
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_DATA_FMT, "TOTAL",
-                                       total.pss,
-                                       total.swappable_pss,
-                                       total.shared_dirty,
-                                       total.private_dirty,
-                                       total.shared_clean,
-                                       total.private_clean,
-                                       found_swap_pss ? total.swapped_out_pss : total.swapped_out))) return r;
+                                       total->pss,
+                                       total->swappable_pss,
+                                       total->shared_dirty,
+                                       total->private_dirty,
+                                       total->shared_clean,
+                                       total->private_clean,
+                                       found_swap_pss ? total->swapped_out_pss : total->swapped_out))) return r;
     if(0 != (r = xcc_util_write_str(log_fd, "-\n Process Dalvik Details (From: /proc/PID/smaps)\n"))) return r;
     for(i = _NUM_EXCLUSIVE_HEAP; i < _NUM_HEAP; i++)
     {
@@ -548,7 +638,16 @@ int xcc_meminfo_record(int log_fd, pid_t pid)
                                                found_swap_pss ? stats[i].swapped_out_pss : stats[i].swapped_out))) return r;
         }
     }
-    if(0 != (r = xcc_util_write_str(log_fd, "-\n Process Summary (From: /proc/PID/smaps)\n"))) return r;
+    if(0 != (r = xcc_util_write_str(log_fd, "-\n"))) return r;
+
+    return 0;
+}
+
+static int xcc_meminfo_record_summary(int log_fd, xcc_meminfo_t *stats, xcc_meminfo_t *total, int found_swap_pss)
+{
+    int r;
+
+    if(0 != (r = xcc_util_write_str(log_fd, " Process Summary (From: /proc/PID/smaps)\n"))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_HEAD_FMT, "", "Pss(KB)"))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_HEAD_FMT, "", "------"))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "Java Heap:",
@@ -574,24 +673,129 @@ int xcc_meminfo_record(int log_fd, pid_t pid)
                                        stats[HEAP_UNKNOWN_MAP].private_dirty + stats[HEAP_UNKNOWN_MAP].private_clean +
                                        stats[HEAP_UNKNOWN].private_dirty + stats[HEAP_UNKNOWN].private_clean))) return r;
     if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "System:",
-                                       total.pss - total.private_dirty - total.private_clean))) return r;
+                                       total->pss - total->private_dirty - total->private_clean))) return r;
     if(found_swap_pss)
     {
         if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA2_FMT,
                                            "TOTAL:",
-                                           total.pss,
+                                           total->pss,
                                            "TOTAL SWAP PSS:",
-                                           total.swapped_out_pss))) return r;
+                                           total->swapped_out_pss))) return r;
     }
     else
     {
         if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA2_FMT,
                                            "TOTAL:",
-                                           total.pss,
+                                           total->pss,
                                            "TOTAL SWAP:",
-                                           total.swapped_out))) return r;
+                                           total->swapped_out))) return r;
     }
-    if(0 != (r = xcc_util_write_str(log_fd, "-\n\n"))) return r;
-    
+    if(0 != (r = xcc_util_write_str(log_fd, "-\n"))) return r;
+
     return 0;
 }
+
+static int xcc_meminfo_record_rollup(int log_fd, xcc_meminfo_t *total, int found_swap_pss)
+{
+    int r;
+
+    if(0 != (r = xcc_util_write_str(log_fd, " Process Summary (From: /proc/PID/smaps_rollup)\n"))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_HEAD_FMT, "", "Pss(KB)"))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_HEAD_FMT, "", "------"))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "Shared Dirty:", total->shared_dirty))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "Private Dirty:", total->private_dirty))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "Shared Clean:", total->shared_clean))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "Private Clean:", total->private_clean))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA_FMT, "System:",
+                                       total->pss - total->private_dirty - total->private_clean))) return r;
+    if(0 != (r = xcc_util_write_format(log_fd, XCC_MEMINFO_SUM_DATA2_FMT,
+                                       "TOTAL:",
+                                       total->pss,
+                                       found_swap_pss ? "TOTAL SWAP PSS:" : "TOTAL SWAP:",
+                                       found_swap_pss ? total->swapped_out_pss : total->swapped_out))) return r;
+    if(0 != (r = xcc_util_write_str(log_fd, "-\n"))) return r;
+
+    return 0;
+}
+
+static int xcc_meminfo_load_from(const char *path, xcc_meminfo_reader_t *reader, xcc_meminfo_t *stats, int *found_swap_pss)
+{
+    if((reader->fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC))) < 0) return -1;
+    reader->pos = 0;
+    reader->len = 0;
+    reader->eof = 0;
+
+    xcc_meminfo_load(reader, stats, found_swap_pss);
+
+    close(reader->fd);
+    reader->fd = -1;
+    return 0;
+}
+
+int xcc_meminfo_record(int log_fd, pid_t pid, int dump_detail)
+{
+    char                  path[64];
+    xcc_meminfo_reader_t  reader;
+    xcc_meminfo_t         stats[_NUM_HEAP];
+    xcc_meminfo_t         total;
+    int                   found_swap_pss = 0;
+    int                   from_rollup = 0;
+    size_t                i;
+    int                   r = 0;
+
+    xcc_libc_support_memset(stats, 0, sizeof(stats));
+    xcc_libc_support_memset(&total, 0, sizeof(total));
+
+    //mmap() is async-signal-safe, this function is also called from the signal handler
+    reader.buf = mmap(NULL, XCC_MEMINFO_BUF_SIZE + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(MAP_FAILED == reader.buf) return 0;
+
+    //the kernel (4.14+) has already summed up all the mappings in /proc/pid/smaps_rollup
+    if(!dump_detail)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+        if(0 == xcc_meminfo_load_from(path, &reader, stats, &found_swap_pss)) from_rollup = 1;
+    }
+
+    //load memory info from /proc/pid/smaps
+    if(!from_rollup)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+        if(0 != xcc_meminfo_load_from(path, &reader, stats, &found_swap_pss)) goto end;
+    }
+
+    for(i = 0; i < _NUM_EXCLUSIVE_HEAP; i++)
+    {
+        total.pss += (stats[i].pss + stats[i].swapped_out_pss);
+        total.swappable_pss += stats[i].swappable_pss;
+        total.private_dirty += stats[i].private_dirty;
+        total.shared_dirty += stats[i].shared_dirty;
+        total.private_clean += stats[i].private_clean;
+        total.shared_clean += stats[i].shared_clean;
+        total.swapped_out += stats[i].swapped_out;
+        total.swapped_out_pss += stats[i].swapped_out_pss;
+    }
+
+    //dump
+    if(0 != (r = xcc_util_write_str(log_fd, "memory info:\n"))) goto end;
+    if(0 != (r = xcc_meminfo_record_sys(log_fd))) goto end;
+    if(0 != (r = xcc_meminfo_record_proc_status(log_fd, pid))) goto end;
+    if(0 != (r = xcc_meminfo_record_proc_limits(log_fd, pid))) goto end;
+    if(from_rollup)
+    {
+        if(0 != (r = xcc_meminfo_record_rollup(log_fd, &total, found_swap_pss))) goto end;
+    }
+    else
+    {
+        if(dump_detail)
+            if(0 != (r = xcc_meminfo_record_details(log_fd, stats, &total, found_swap_pss))) goto end;
+        if(0 != (r = xcc_meminfo_record_summary(log_fd, stats, &total, found_swap_pss))) goto end;
+    }
+    if(0 != (r = xcc_util_write_str(log_fd, "\n"))) goto end;
+
+ end:
+    munmap(reader.buf, XCC_MEMINFO_BUF_SIZE + 1);
+    return r;
+}
+
+#pragma clang diagnostic pop
@@ -31,7 +31,7 @@
 extern "C" {
 #endif
 
-int xcc_meminfo_record(int log_fd, pid_t pid);
+int xcc_meminfo_record(int log_fd, pid_t pid, int dump_detail);
 
 #ifdef __cplusplus
 }
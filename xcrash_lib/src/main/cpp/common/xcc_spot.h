@@ -33,9 +33,24 @@
 extern "C" {
 #endif
 
+//max number of other threads crashed at the same time
+#define XCC_SPOT_OTHER_CRASHES_MAX 8
+
+//the algorithms of the ELF hash in the build-id section (same as XCrash.ELF_HASH_* in Java)
+#define XCC_SPOT_ELF_HASH_MD5  1
+#define XCC_SPOT_ELF_HASH_XXH3 2
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 
+typedef struct
+{
+    //tid is set last (keep it in the first place), 0 means the slot is not ready
+    pid_t        tid;
+    siginfo_t    siginfo;
+    ucontext_t   ucontext;
+} xcc_spot_crash_t;
+
 typedef struct
 {
     //set when crashed
@@ -52,12 +67,26 @@ typedef struct
     unsigned int logcat_system_lines;
     unsigned int logcat_events_lines;
     unsigned int logcat_main_lines;
-    int          dump_elf_hash;
+    int          dump_elf_hash; //0 (disabled) or XCC_SPOT_ELF_HASH_*
     int          dump_map;
     int          dump_fds;
     int          dump_network_info;
+    int          dump_meminfo_detail;
     int          dump_all_threads;
     unsigned int dump_all_threads_count_max;
+    unsigned int suppress_duplicates_window;
+    uintptr_t    breadcrumb_addr;
+    uintptr_t    other_crashes_addr; //the slots of the other crashed threads, read by the dumper
+    size_t       other_crashes_cnt;
+    int          stack_scan;
+    unsigned int dump_budget_ms;
+    int          dump_minicore;
+
+    //set when dumping all threads for a java crash, only the other threads are recorded
+    //to this fd which is inherited from the crashed process (-1 for native crashes)
+    int          threads_only_log_fd;
+    //set with threads_only_log_fd for an on-demand dump of a live process
+    int          threads_only_nonfatal;
 
     //set when crashed (content lengths after this struct)
     size_t       log_pathname_len;
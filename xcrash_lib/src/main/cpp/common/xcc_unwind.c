@@ -29,6 +29,7 @@
 #include "xcc_unwind_libcorkscrew.h"
 #include "xcc_unwind_libunwind.h"
 #include "xcc_unwind_clang.h"
+#include "xcc_unwind_fp.h"
 
 void xcc_unwind_init(int api_level)
 {
@@ -45,14 +46,27 @@ void xcc_unwind_init(int api_level)
     }
 }
 
-size_t xcc_unwind_get(int api_level, siginfo_t *si, ucontext_t *uc, char *buf, size_t buf_len)
+size_t xcc_unwind_get(int api_level, siginfo_t *si, ucontext_t *uc, char *buf, size_t buf_len, const char **unwinder)
 {
-    size_t buf_used;
+    size_t      buf_used;
+    const char *name;
+
+    if(NULL == unwinder) unwinder = &name;
+
+#if defined(__aarch64__) || defined(__x86_64__)
+    //frame pointer first, it's the fastest and safest one in a corrupted process
+    if(0 < (buf_used = xcc_unwind_fp_record(uc, buf, buf_len)))
+    {
+        *unwinder = "frame pointer";
+        return buf_used;
+    }
+#endif
     
 #if defined(__arm__) || defined(__i386__)
     if(api_level >= 16 && api_level <= 20)
     {
         if(0 == (buf_used = xcc_unwind_libcorkscrew_record(si, uc, buf, buf_len))) goto bottom;
+        *unwinder = "libcorkscrew";
         return buf_used;
     }
 #else
@@ -62,9 +76,11 @@ size_t xcc_unwind_get(int api_level, siginfo_t *si, ucontext_t *uc, char *buf, s
     if(api_level >= 21 && api_level <= 23)
     {
         if(0 == (buf_used = xcc_unwind_libunwind_record(uc, buf, buf_len))) goto bottom;
+        *unwinder = "libunwind";
         return buf_used;
     }
 
  bottom:
+    *unwinder = "_Unwind_Backtrace";
     return xcc_unwind_clang_record(uc, buf, buf_len);
 }
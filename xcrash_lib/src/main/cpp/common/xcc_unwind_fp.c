@@ -0,0 +1,388 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <ucontext.h>
+#include "xcc_unwind_fp.h"
+#include "xcc_util.h"
+#include "xcc_fmt.h"
+
+#define XCC_UNWIND_FP_MAX_FRAMES 64
+#define XCC_UNWIND_FP_NAMES_LEN  4096
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+
+typedef struct
+{
+    int     fd;
+    char    buf[1024];
+    size_t  buf_used;
+    size_t  buf_len;
+    int     eof;
+} xcc_unwind_fp_maps_t;
+
+typedef struct
+{
+    uintptr_t   start;
+    uintptr_t   end;
+    uintptr_t   offset;
+    char        perm[4];
+    const char *name;
+} xcc_unwind_fp_map_t;
+
+typedef struct
+{
+    uintptr_t   pc;
+    uintptr_t   rel_pc;
+    uintptr_t   map_start;
+    size_t      name_offset;
+    int         state; //0: not found, 1: in an executable map, 2: in an anonymous executable map
+} xcc_unwind_fp_frame_t;
+
+#pragma clang diagnostic pop
+
+//only used in the crash handler, which is serialized
+static xcc_unwind_fp_maps_t  xcc_unwind_fp_maps;
+static xcc_unwind_fp_frame_t xcc_unwind_fp_frames[XCC_UNWIND_FP_MAX_FRAMES];
+static char                  xcc_unwind_fp_names[XCC_UNWIND_FP_NAMES_LEN];
+
+//Walk the frame records chain {prev_fp, return_address} from the interrupted context.
+//Async-signal-safe, no lock and no memory allocation. Only the memory in [stack_low, stack_high)
+//is accessed, so it's safe to be used in a signal handler for sampling.
+//Code compiled without frame pointers (e.g. most of the ARM32 code) will only get partial results.
+//LR is NOT one of the PCs: it is the caller only if the interrupted function is a leaf function without
+//frame record, otherwise it is a stale return address in the interrupted function itself. It is saved to
+//lr_uncertain (if not NULL) when it differs from the first return address, 0 otherwise.
+size_t xcc_unwind_fp_get_pcs(ucontext_t *uc, uintptr_t stack_low, uintptr_t stack_high, uintptr_t *pcs, size_t pcs_max,
+                             uintptr_t *lr_uncertain)
+{
+    uintptr_t  pc, fp, next_fp, ret;
+    uintptr_t  lr = 0;
+    uintptr_t *record;
+    size_t     n = 0;
+
+    if(NULL != lr_uncertain) *lr_uncertain = 0;
+    if(NULL == uc || NULL == pcs || 0 == pcs_max) return 0;
+
+#if defined(__arm__)
+    pc = (uintptr_t)uc->uc_mcontext.arm_pc;
+    lr = (uintptr_t)uc->uc_mcontext.arm_lr & ~((uintptr_t)1);
+    fp = (uintptr_t)uc->uc_mcontext.arm_r7; //thumb
+#elif defined(__aarch64__)
+    pc = (uintptr_t)uc->uc_mcontext.pc;
+    lr = (uintptr_t)uc->uc_mcontext.regs[30];
+    fp = (uintptr_t)uc->uc_mcontext.regs[29];
+#elif defined(__i386__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_EIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_EBP];
+#elif defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+#endif
+
+    pcs[n++] = pc;
+    if(stack_high < stack_low + sizeof(uintptr_t) * 2) return n;
+
+    while(n < pcs_max)
+    {
+        if(fp < stack_low || fp > stack_high - sizeof(uintptr_t) * 2 || 0 != fp % sizeof(uintptr_t)) break;
+
+        record = (uintptr_t *)fp;
+        next_fp = record[0];
+        ret = record[1];
+#if defined(__arm__)
+        ret &= ~((uintptr_t)1);
+#endif
+        if(0 == ret) break;
+
+        //the interrupted function may be a leaf function without frame record
+        if(1 == n && 0 != lr && lr != ret && NULL != lr_uncertain) *lr_uncertain = lr;
+
+        pcs[n++] = ret;
+
+        //frame records must go up the stack
+        if(next_fp <= fp) break;
+        fp = next_fp;
+    }
+
+    return n;
+}
+
+static int xcc_unwind_fp_maps_open(xcc_unwind_fp_maps_t *self)
+{
+    self->buf_used = 0;
+    self->buf_len = 0;
+    self->eof = 0;
+    if(0 > (self->fd = XCC_UTIL_TEMP_FAILURE_RETRY(open("/proc/self/maps", O_RDONLY | O_CLOEXEC)))) return -1;
+    return 0;
+}
+
+static void xcc_unwind_fp_maps_close(xcc_unwind_fp_maps_t *self)
+{
+    if(self->fd >= 0)
+    {
+        close(self->fd);
+        self->fd = -1;
+    }
+}
+
+//read one line in place, no syscall per byte (the maps may have thousands of lines)
+static char *xcc_unwind_fp_maps_gets(xcc_unwind_fp_maps_t *self)
+{
+    size_t   i;
+    ssize_t  n;
+    char    *line;
+
+    while(1)
+    {
+        for(i = self->buf_used; i < self->buf_len; i++)
+        {
+            if('\n' == self->buf[i])
+            {
+                self->buf[i] = '\0';
+                line = self->buf + self->buf_used;
+                self->buf_used = i + 1;
+                return line;
+            }
+        }
+
+        if(self->eof)
+        {
+            if(self->buf_used >= self->buf_len) return NULL;
+            self->buf[self->buf_len] = '\0';
+            line = self->buf + self->buf_used;
+            self->buf_used = self->buf_len;
+            return line;
+        }
+
+        //move the remaining part to the beginning, drop the line if it's too long
+        if(0 == self->buf_used && self->buf_len >= sizeof(self->buf) - 1) self->buf_len = 0;
+        for(i = self->buf_used; i < self->buf_len; i++)
+            self->buf[i - self->buf_used] = self->buf[i];
+        self->buf_len -= self->buf_used;
+        self->buf_used = 0;
+
+        n = XCC_UTIL_TEMP_FAILURE_RETRY(read(self->fd, self->buf + self->buf_len, sizeof(self->buf) - 1 - self->buf_len));
+        if(n <= 0)
+            self->eof = 1;
+        else
+            self->buf_len += (size_t)n;
+    }
+}
+
+static const char *xcc_unwind_fp_parse_hex(const char *p, uintptr_t *value)
+{
+    uintptr_t v = 0;
+    int       cnt = 0;
+
+    for(; ; p++, cnt++)
+    {
+        if(*p >= '0' && *p <= '9')      v = (v << 4) | (uintptr_t)(*p - '0');
+        else if(*p >= 'a' && *p <= 'f') v = (v << 4) | (uintptr_t)(*p - 'a' + 10);
+        else break;
+    }
+    *value = v;
+    return (0 == cnt ? NULL : p);
+}
+
+//format: "start-end perm offset dev inode name"
+static int xcc_unwind_fp_parse_map(const char *line, xcc_unwind_fp_map_t *map)
+{
+    const char *p = line;
+    size_t      i;
+
+    if(NULL == (p = xcc_unwind_fp_parse_hex(p, &(map->start))) || '-' != *p++) return -1;
+    if(NULL == (p = xcc_unwind_fp_parse_hex(p, &(map->end))) || ' ' != *p++) return -1;
+    for(i = 0; i < 4; i++)
+    {
+        if('\0' == *p) return -1;
+        map->perm[i] = *p++;
+    }
+    if(' ' != *p++) return -1;
+    if(NULL == (p = xcc_unwind_fp_parse_hex(p, &(map->offset)))) return -1;
+
+    //skip dev and inode
+    for(i = 0; i < 2; i++)
+    {
+        while(' ' == *p) p++;
+        while('\0' != *p && ' ' != *p) p++;
+    }
+    while(' ' == *p) p++;
+    map->name = p;
+
+    return 0;
+}
+
+//find the readable stack map which contains SP
+static int xcc_unwind_fp_find_stack(uintptr_t sp, uintptr_t *stack_high)
+{
+    xcc_unwind_fp_map_t  map;
+    char                *line;
+    int                  r = -1;
+
+    if(0 != xcc_unwind_fp_maps_open(&xcc_unwind_fp_maps)) return -1;
+    while(NULL != (line = xcc_unwind_fp_maps_gets(&xcc_unwind_fp_maps)))
+    {
+        if(0 != xcc_unwind_fp_parse_map(line, &map)) continue;
+        if(sp < map.start || sp >= map.end) continue;
+
+        if('r' == map.perm[0])
+        {
+            *stack_high = map.end;
+            r = 0;
+        }
+        break;
+    }
+    xcc_unwind_fp_maps_close(&xcc_unwind_fp_maps);
+    return r;
+}
+
+//locate all PCs in the executable maps
+static void xcc_unwind_fp_locate_frames(size_t frames_num)
+{
+    xcc_unwind_fp_map_t  map;
+    char                *line;
+    size_t               i, j, name_len, names_used = 0, name_offset = 0;
+    int                  name_saved, name_ok;
+
+    if(0 != xcc_unwind_fp_maps_open(&xcc_unwind_fp_maps)) return;
+    while(NULL != (line = xcc_unwind_fp_maps_gets(&xcc_unwind_fp_maps)))
+    {
+        if(0 != xcc_unwind_fp_parse_map(line, &map)) continue;
+        if('x' != map.perm[2]) continue;
+
+        name_saved = 0;
+        name_ok = 0;
+        for(i = 0; i < frames_num; i++)
+        {
+            if(xcc_unwind_fp_frames[i].pc < map.start || xcc_unwind_fp_frames[i].pc >= map.end) continue;
+
+            xcc_unwind_fp_frames[i].map_start = map.start;
+            xcc_unwind_fp_frames[i].rel_pc = xcc_unwind_fp_frames[i].pc - map.start + map.offset;
+            xcc_unwind_fp_frames[i].state = 2;
+            if('\0' == map.name[0]) continue;
+
+            //save the name only once for each map
+            if(!name_saved)
+            {
+                name_saved = 1;
+                for(name_len = 0; '\0' != map.name[name_len]; name_len++);
+                if(names_used + name_len + 1 <= sizeof(xcc_unwind_fp_names))
+                {
+                    name_offset = names_used;
+                    for(j = 0; j <= name_len; j++)
+                        xcc_unwind_fp_names[names_used + j] = map.name[j];
+                    names_used += name_len + 1;
+                    name_ok = 1;
+                }
+            }
+            if(!name_ok) continue;
+
+            xcc_unwind_fp_frames[i].name_offset = name_offset;
+            xcc_unwind_fp_frames[i].state = 1;
+        }
+    }
+    xcc_unwind_fp_maps_close(&xcc_unwind_fp_maps);
+}
+
+//Async-signal-safe frame pointer unwinding for the crashed thread, without dladdr() and heap.
+//Each frame pointer must be in the stack map which contains SP, above SP, and each PC must be in
+//an executable map. The walk stops at the first invalid frame, or after 64 steps.
+//Return 0 if it could not walk out of the crashed frame, so that the other unwinders can be tried.
+//LR is recorded as frame #01 with "[uncertain]" when it may be the caller of a leaf function.
+size_t xcc_unwind_fp_record(ucontext_t *uc, char *buf, size_t buf_len)
+{
+    uintptr_t pcs[XCC_UNWIND_FP_MAX_FRAMES];
+    uintptr_t sp, lr, stack_high = 0;
+    size_t    frames_num, i, n, len, used = 0;
+    int       has_lr;
+
+    if(NULL == uc || NULL == buf || buf_len < 2) return 0;
+
+#if defined(__arm__)
+    sp = (uintptr_t)uc->uc_mcontext.arm_sp;
+#elif defined(__aarch64__)
+    sp = (uintptr_t)uc->uc_mcontext.sp;
+#elif defined(__i386__)
+    sp = (uintptr_t)uc->uc_mcontext.gregs[REG_ESP];
+#elif defined(__x86_64__)
+    sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#endif
+
+    if(0 != xcc_unwind_fp_find_stack(sp, &stack_high)) return 0;
+    if(0 == (frames_num = xcc_unwind_fp_get_pcs(uc, sp, stack_high, pcs, XCC_UNWIND_FP_MAX_FRAMES - 1, &lr))) return 0;
+
+    //insert LR after the crashed frame
+    if(0 != (has_lr = (0 != lr)))
+    {
+        for(i = frames_num; i > 1; i--)
+            pcs[i] = pcs[i - 1];
+        pcs[1] = lr;
+        frames_num++;
+    }
+
+    for(i = 0; i < frames_num; i++)
+    {
+        xcc_unwind_fp_frames[i].pc = pcs[i];
+        xcc_unwind_fp_frames[i].rel_pc = pcs[i];
+        xcc_unwind_fp_frames[i].map_start = 0;
+        xcc_unwind_fp_frames[i].name_offset = 0;
+        xcc_unwind_fp_frames[i].state = 0;
+    }
+    xcc_unwind_fp_locate_frames(frames_num);
+
+    for(i = 0, n = 0; i < frames_num; i++)
+    {
+        //the PC of the crashed frame may be invalid, but the others must be valid (LR is only skipped)
+        if(i > 0 && 0 == xcc_unwind_fp_frames[i].state)
+        {
+            if(has_lr && 1 == i) continue;
+            break;
+        }
+
+        if(1 == xcc_unwind_fp_frames[i].state)
+            len = xcc_fmt_snprintf(buf + used, buf_len - used, "    #%02zu pc %0"XCC_UTIL_FMT_ADDR"  %s%s\n",
+                                   n, xcc_unwind_fp_frames[i].rel_pc, xcc_unwind_fp_names + xcc_unwind_fp_frames[i].name_offset,
+                                   (has_lr && 1 == i) ? " [uncertain]" : "");
+        else if(2 == xcc_unwind_fp_frames[i].state)
+            len = xcc_fmt_snprintf(buf + used, buf_len - used, "    #%02zu pc %0"XCC_UTIL_FMT_ADDR"  <anonymous:%"XCC_UTIL_FMT_ADDR">%s\n",
+                                   n, xcc_unwind_fp_frames[i].rel_pc, xcc_unwind_fp_frames[i].map_start,
+                                   (has_lr && 1 == i) ? " [uncertain]" : "");
+        else
+            len = xcc_fmt_snprintf(buf + used, buf_len - used, "    #%02zu pc %0"XCC_UTIL_FMT_ADDR"  <unknown>\n",
+                                   n, xcc_unwind_fp_frames[i].rel_pc);
+
+        //truncated?
+        if(len >= buf_len - used - 1) break;
+        used += len;
+        n++;
+    }
+
+    //the crashed frame and LR only is not a successful walk
+    return ((n < (has_lr && 2 == i ? 3 : 2)) ? 0 : used);
+}
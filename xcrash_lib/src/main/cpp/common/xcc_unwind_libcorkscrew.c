@@ -76,18 +76,28 @@ static t_free_backtrace_symbols        free_backtrace_symbols       = NULL;
 
 void xcc_unwind_libcorkscrew_init(void)
 {
-    if(NULL == (libcorkscrew = dlopen("libcorkscrew.so", RTLD_NOW))) return;
+    void                           *handle;
+    t_unwind_backtrace_signal_arch  unwind_backtrace;
+    t_acquire_my_map_info_list      acquire_map_info;
+    t_get_backtrace_symbols         get_symbols;
+
+    if(NULL == (handle = dlopen("libcorkscrew.so", RTLD_NOW))) return;
     
-    if(NULL == (unwind_backtrace_signal_arch = (t_unwind_backtrace_signal_arch)dlsym(libcorkscrew, "unwind_backtrace_signal_arch"))) goto err;
-    if(NULL == (acquire_my_map_info_list = (t_acquire_my_map_info_list)dlsym(libcorkscrew, "acquire_my_map_info_list"))) goto err;
-    release_my_map_info_list = (t_release_my_map_info_list)dlsym(libcorkscrew, "release_my_map_info_list");
-    if(NULL == (get_backtrace_symbols = (t_get_backtrace_symbols)dlsym(libcorkscrew, "get_backtrace_symbols"))) goto err;
-    free_backtrace_symbols = (t_free_backtrace_symbols)dlsym(libcorkscrew, "free_backtrace_symbols");
+    if(NULL == (unwind_backtrace = (t_unwind_backtrace_signal_arch)dlsym(handle, "unwind_backtrace_signal_arch"))) goto err;
+    if(NULL == (acquire_map_info = (t_acquire_my_map_info_list)dlsym(handle, "acquire_my_map_info_list"))) goto err;
+    if(NULL == (get_symbols = (t_get_backtrace_symbols)dlsym(handle, "get_backtrace_symbols"))) goto err;
+
+    //this may run at the same time as a crash (async warm-up), publish the handle last
+    unwind_backtrace_signal_arch = unwind_backtrace;
+    acquire_my_map_info_list = acquire_map_info;
+    release_my_map_info_list = (t_release_my_map_info_list)dlsym(handle, "release_my_map_info_list");
+    get_backtrace_symbols = get_symbols;
+    free_backtrace_symbols = (t_free_backtrace_symbols)dlsym(handle, "free_backtrace_symbols");
+    __atomic_store_n(&libcorkscrew, handle, __ATOMIC_RELEASE);
     return;
 
  err:
-    dlclose(libcorkscrew);
-    libcorkscrew = NULL;
+    dlclose(handle);
 }
 
 size_t xcc_unwind_libcorkscrew_record(siginfo_t *si, ucontext_t *uc, char *buf, size_t buf_len)
@@ -98,7 +108,7 @@ size_t xcc_unwind_libcorkscrew_record(siginfo_t *si, ucontext_t *uc, char *buf,
     backtrace_symbol_t  symbols[MAX_FRAMES];
     size_t              buf_used = 0, len;
 
-    if(NULL == libcorkscrew) return 0;
+    if(NULL == __atomic_load_n(&libcorkscrew, __ATOMIC_ACQUIRE)) return 0;
 
     //get frames
     if(NULL == (map_info = acquire_my_map_info_list())) goto end;
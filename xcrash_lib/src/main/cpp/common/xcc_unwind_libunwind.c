@@ -81,15 +81,25 @@ static t_unw_step        unw_step       = NULL;
 
 void xcc_unwind_libunwind_init(void)
 {
-    if(NULL == (libunwind = dlopen("libunwind.so", RTLD_NOW))) return;
-    if(NULL == (unw_init_local = (t_unw_init_local)dlsym(libunwind, "_U"UNW_TARGET"_init_local"))) goto err;
-    if(NULL == (unw_get_reg = (t_unw_get_reg)dlsym(libunwind, "_U"UNW_TARGET"_get_reg"))) goto err;
-    if(NULL == (unw_step = (t_unw_step)dlsym(libunwind, "_U"UNW_TARGET"_step"))) goto err;
+    void             *handle;
+    t_unw_init_local  init_local;
+    t_unw_get_reg     get_reg;
+    t_unw_step        step;
+
+    if(NULL == (handle = dlopen("libunwind.so", RTLD_NOW))) return;
+    if(NULL == (init_local = (t_unw_init_local)dlsym(handle, "_U"UNW_TARGET"_init_local"))) goto err;
+    if(NULL == (get_reg = (t_unw_get_reg)dlsym(handle, "_U"UNW_TARGET"_get_reg"))) goto err;
+    if(NULL == (step = (t_unw_step)dlsym(handle, "_U"UNW_TARGET"_step"))) goto err;
+
+    //this may run at the same time as a crash (async warm-up), publish the handle last
+    unw_init_local = init_local;
+    unw_get_reg = get_reg;
+    unw_step = step;
+    __atomic_store_n(&libunwind, handle, __ATOMIC_RELEASE);
     return;
 
  err:
-    dlclose(libunwind);
-    libunwind = NULL;
+    dlclose(handle);
 }
 
 size_t xcc_unwind_libunwind_record(ucontext_t *uc, char *buf, size_t buf_len)
@@ -100,7 +110,7 @@ size_t xcc_unwind_libunwind_record(ucontext_t *uc, char *buf, size_t buf_len)
     uintptr_t      pc;
     Dl_info        info;
 
-    if(NULL == libunwind) return 0;
+    if(NULL == __atomic_load_n(&libunwind, __ATOMIC_ACQUIRE)) return 0;
 
     if(NULL == (cursor = calloc(1, sizeof(unw_cursor_t)))) return 0;
     if(NULL == (context = calloc(1, sizeof(unw_context_t)))) return 0;
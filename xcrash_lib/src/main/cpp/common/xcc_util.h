@@ -42,6 +42,7 @@ extern "C" {
 
 #define XCC_UTIL_CRASH_TYPE_NATIVE "native"
 #define XCC_UTIL_CRASH_TYPE_ANR    "anr"
+#define XCC_UTIL_CRASH_TYPE_TRACE  "trace"
 
 #if defined(__arm__)
 #define XCC_UTIL_ABI_STRING "arm"
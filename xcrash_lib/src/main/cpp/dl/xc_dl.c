@@ -26,11 +26,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <dlfcn.h>
 #include <link.h>
 #include <elf.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/system_properties.h>
 #include <fcntl.h>
 #include "xcc_errno.h"
 #include "xcc_util.h"
@@ -40,6 +42,9 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 #pragma clang diagnostic ignored "-Wgnu-statement-expression"
+#pragma clang diagnostic ignored "-Wcast-align"
+
+typedef int (*xc_dl_iterate_phdr_t)(int (*)(struct dl_phdr_info *, size_t, void *), void *);
 
 typedef struct xc_dl_symbols
 {
@@ -54,45 +59,262 @@ typedef TAILQ_HEAD(xc_dl_symbols_queue, xc_dl_symbols,) xc_dl_symbols_queue_t;
 
 struct xc_dl
 {
-    uintptr_t              map_start;
+    char                  *pathname;
+    uintptr_t              load_bias;
+
+    //in-memory .dynsym (from PT_DYNAMIC)
+    ElfW(Sym)             *dynsym;
+    const char            *dynstr;
+    size_t                 dynstr_size;
+    const uint32_t        *sysv_hash;
+    const uint32_t        *gnu_hash;
+
+    //on-disk .symtab, only mapped during the lookup
+    int                    symtab_parsed;
     int                    fd;
     uint8_t               *data;
     size_t                 size;
-    uintptr_t              load_bias;
     xc_dl_symbols_queue_t  symbolsq;
 };
 
-static int xc_dl_find_map_start(xc_dl_t *self, const char *pathname)
+typedef struct
 {
-    FILE      *f = NULL;
-    char       line[512];
-    uintptr_t  offset;
-    int        pos;
-    char      *p;
-    int        r = XCC_ERRNO_NOTFND;
+    const char        *pathname;
+    const char        *basename;
+    uintptr_t          load_bias;
+    const ElfW(Phdr)  *phdr;
+    size_t             phnum;
+} xc_dl_iterate_arg_t;
+
+static int xc_dl_iterate_cb(struct dl_phdr_info *info, size_t size, void *data)
+{
+    xc_dl_iterate_arg_t *arg = (xc_dl_iterate_arg_t *)data;
+
+    (void)size;
+
+    if(NULL == info->dlpi_name || '\0' == info->dlpi_name[0]) return 0;
+
+    //some old devices return basename instead of full pathname
+    if(0 != strcmp(info->dlpi_name, arg->pathname) &&
+       ('/' == info->dlpi_name[0] || 0 != strcmp(info->dlpi_name, arg->basename))) return 0;
+
+    arg->load_bias = (uintptr_t)info->dlpi_addr;
+    arg->phdr      = info->dlpi_phdr;
+    arg->phnum     = (size_t)info->dlpi_phnum;
+    return 1; //found
+}
+
+static int xc_dl_get_api_level(void)
+{
+    char buf[PROP_VALUE_MAX];
+
+    if(__system_property_get("ro.build.version.sdk", buf) <= 0) return 0;
+    return atoi(buf);
+}
+
+static int xc_dl_find_by_iterate(xc_dl_t *self, const ElfW(Phdr) **phdr, size_t *phnum)
+{
+    xc_dl_iterate_phdr_t iterate;
+    xc_dl_iterate_arg_t  arg;
+    const char          *basename;
+
+    //not available on arm32 before Android 5.0, and it does not hold the linker's lock before Android 6.0
+    if(xc_dl_get_api_level() < 23) return XCC_ERRNO_NOTSPT;
+    if(NULL == (iterate = (xc_dl_iterate_phdr_t)dlsym(RTLD_DEFAULT, "dl_iterate_phdr"))) return XCC_ERRNO_NOTSPT;
+
+    basename = strrchr(self->pathname, '/');
+    memset(&arg, 0, sizeof(arg));
+    arg.pathname = self->pathname;
+    arg.basename = (NULL == basename ? self->pathname : basename + 1);
+    if(0 == iterate(xc_dl_iterate_cb, &arg)) return XCC_ERRNO_NOTFND;
+
+    self->load_bias = arg.load_bias;
+    *phdr = arg.phdr;
+    *phnum = arg.phnum;
+    return 0;
+}
+
+static int xc_dl_find_by_maps(xc_dl_t *self, const ElfW(Phdr) **phdr, size_t *phnum)
+{
+    FILE             *f = NULL;
+    char              line[512];
+    uintptr_t         map_start = 0, offset;
+    int               pos;
+    char             *p;
+    const ElfW(Ehdr) *ehdr;
+    size_t            i;
+    int               r = XCC_ERRNO_NOTFND;
 
     if(NULL == (f = fopen("/proc/self/maps", "r"))) return XCC_ERRNO_SYS;
     while(fgets(line, sizeof(line), f))
     {
-        if(2 != sscanf(line, "%"SCNxPTR"-%*"SCNxPTR" %*4s %"SCNxPTR" %*x:%*x %*d%n", &(self->map_start), &offset, &pos)) continue;
+        if(2 != sscanf(line, "%"SCNxPTR"-%*"SCNxPTR" %*4s %"SCNxPTR" %*x:%*x %*d%n", &map_start, &offset, &pos)) continue;
         if(0 != offset) continue;
         p = xcc_util_trim(line + pos);
-        if(0 != strcmp(p, pathname)) continue;
+        if(0 != strcmp(p, self->pathname)) continue;
 
         r = 0; //found
         break;
     }
-
     fclose(f);
-    return r;
+    if(0 != r) return r;
+
+    //the ELF header and program headers are mapped at the start of the first segment
+    ehdr = (const ElfW(Ehdr) *)map_start;
+    if(0 != memcmp(ehdr->e_ident, ELFMAG, SELFMAG)) return XCC_ERRNO_FORMAT;
+    *phdr = (const ElfW(Phdr) *)(map_start + ehdr->e_phoff);
+    *phnum = (size_t)ehdr->e_phnum;
+
+    //load_bias = map_start - the vaddr of the first PT_LOAD segment
+    for(i = 0; i < *phnum; i++)
+    {
+        if(PT_LOAD == (*phdr)[i].p_type)
+        {
+            self->load_bias = map_start - ((*phdr)[i].p_vaddr & ~((uintptr_t)getpagesize() - 1));
+            return 0;
+        }
+    }
+    return XCC_ERRNO_FORMAT;
+}
+
+static void xc_dl_parse_dynamic(xc_dl_t *self, const ElfW(Phdr) *phdr, size_t phnum)
+{
+    ElfW(Dyn) *dyn = NULL;
+    uintptr_t  ptr;
+    size_t     i;
+
+    for(i = 0; i < phnum; i++)
+    {
+        if(PT_DYNAMIC == phdr[i].p_type)
+        {
+            dyn = (ElfW(Dyn) *)(self->load_bias + phdr[i].p_vaddr);
+            break;
+        }
+    }
+    if(NULL == dyn) return;
+
+    for(; DT_NULL != dyn->d_tag; dyn++)
+    {
+        //bionic does not relocate the d_ptr in .dynamic, but glibc does
+        ptr = (uintptr_t)dyn->d_un.d_ptr;
+        if(ptr < self->load_bias) ptr += self->load_bias;
+
+        switch(dyn->d_tag)
+        {
+        case DT_SYMTAB:
+            self->dynsym = (ElfW(Sym) *)ptr;
+            break;
+        case DT_STRTAB:
+            self->dynstr = (const char *)ptr;
+            break;
+        case DT_STRSZ:
+            self->dynstr_size = (size_t)dyn->d_un.d_val;
+            break;
+        case DT_HASH:
+            self->sysv_hash = (const uint32_t *)ptr;
+            break;
+        case DT_GNU_HASH:
+            self->gnu_hash = (const uint32_t *)ptr;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if(NULL == self->dynstr || 0 == self->dynstr_size || (NULL == self->sysv_hash && NULL == self->gnu_hash))
+        self->dynsym = NULL;
+}
+
+static int xc_dl_dynsym_match(xc_dl_t *self, uint32_t idx, const char *symbol)
+{
+    ElfW(Sym) *sym = self->dynsym + idx;
+
+    if(SHN_UNDEF == sym->st_shndx) return 0;
+    if(sym->st_name >= self->dynstr_size) return 0;
+    return (0 == strcmp(symbol, self->dynstr + sym->st_name) ? 1 : 0);
+}
+
+static ElfW(Sym) *xc_dl_dynsym_lookup_gnu(xc_dl_t *self, const char *symbol)
+{
+    uint32_t          nbucket     = self->gnu_hash[0];
+    uint32_t          symndx      = self->gnu_hash[1];
+    uint32_t          bloom_size  = self->gnu_hash[2];
+    uint32_t          bloom_shift = self->gnu_hash[3];
+    const ElfW(Addr) *bloom       = (const ElfW(Addr) *)(self->gnu_hash + 4);
+    const uint32_t   *buckets     = (const uint32_t *)(bloom + bloom_size);
+    const uint32_t   *chains      = buckets + nbucket;
+    const size_t      bits        = sizeof(ElfW(Addr)) * 8;
+    uint32_t          h = 5381, h2, i;
+    const uint8_t    *p;
+    ElfW(Addr)        word, mask;
+
+    if(0 == nbucket || 0 == bloom_size) return NULL;
+
+    for(p = (const uint8_t *)symbol; '\0' != *p; p++)
+        h = (h << 5) + h + *p;
+
+    //bloom filter
+    word = bloom[(h / bits) % bloom_size];
+    mask = ((ElfW(Addr))1 << (h % bits)) | ((ElfW(Addr))1 << ((h >> bloom_shift) % bits));
+    if((word & mask) != mask) return NULL;
+
+    if((i = buckets[h % nbucket]) < symndx) return NULL;
+    while(1)
+    {
+        h2 = chains[i - symndx];
+        if((h | 1) == (h2 | 1) && xc_dl_dynsym_match(self, i, symbol)) return self->dynsym + i;
+        if(h2 & 1) break; //the end of the chain
+        i++;
+    }
+
+    return NULL;
+}
+
+static ElfW(Sym) *xc_dl_dynsym_lookup_sysv(xc_dl_t *self, const char *symbol)
+{
+    uint32_t        nbucket = self->sysv_hash[0];
+    uint32_t        nchain  = self->sysv_hash[1];
+    const uint32_t *buckets = self->sysv_hash + 2;
+    const uint32_t *chains  = buckets + nbucket;
+    uint32_t        h = 0, g, i;
+    const uint8_t  *p;
+
+    if(0 == nbucket) return NULL;
+
+    for(p = (const uint8_t *)symbol; '\0' != *p; p++)
+    {
+        h = (h << 4) + *p;
+        g = h & 0xf0000000;
+        h ^= g;
+        h ^= g >> 24;
+    }
+
+    for(i = buckets[h % nbucket]; 0 != i && i < nchain; i = chains[i])
+        if(xc_dl_dynsym_match(self, i, symbol)) return self->dynsym + i;
+
+    return NULL;
+}
+
+static void *xc_dl_dynsym_lookup(xc_dl_t *self, const char *symbol)
+{
+    ElfW(Sym) *sym = NULL;
+
+    if(NULL == self->dynsym) return NULL;
+
+    if(NULL != self->gnu_hash)
+        sym = xc_dl_dynsym_lookup_gnu(self, symbol);
+    else if(NULL != self->sysv_hash)
+        sym = xc_dl_dynsym_lookup_sysv(self, symbol);
+
+    return (NULL == sym ? NULL : (void *)(self->load_bias + sym->st_value));
 }
 
-static int xc_dl_file_open(xc_dl_t *self, const char *pathname)
+static int xc_dl_file_open(xc_dl_t *self)
 {
     struct stat st;
 
     //open file
-    if(0 > (self->fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
+    if(0 > (self->fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(self->pathname, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
 
     //get file size
     if(0 != fstat(self->fd, &st) || 0 == st.st_size) return XCC_ERRNO_SYS;
@@ -104,6 +326,20 @@ static int xc_dl_file_open(xc_dl_t *self, const char *pathname)
     return 0;
 }
 
+static void xc_dl_file_close(xc_dl_t *self)
+{
+    if(MAP_FAILED != self->data)
+    {
+        munmap(self->data, self->size);
+        self->data = MAP_FAILED;
+    }
+    if(self->fd >= 0)
+    {
+        close(self->fd);
+        self->fd = -1;
+    }
+}
+
 static void *xc_dl_file_get(xc_dl_t *self, uintptr_t offset, size_t size)
 {
     if(offset + size > self->size) return NULL;
@@ -126,7 +362,6 @@ static char *xc_dl_file_get_string(xc_dl_t *self, uintptr_t offset)
 static int xc_dl_parse_elf(xc_dl_t *self)
 {
     ElfW(Ehdr)      *ehdr;
-    ElfW(Phdr)      *phdr;
     ElfW(Shdr)      *shdr, *str_shdr;
     xc_dl_symbols_t *symbols;
     size_t           i, cnt = 0;
@@ -134,24 +369,13 @@ static int xc_dl_parse_elf(xc_dl_t *self)
     //get ELF header
     if(NULL == (ehdr = xc_dl_file_get(self, 0, sizeof(ElfW(Ehdr))))) return XCC_ERRNO_FORMAT;
 
-    //find load_bias in program headers
-    for(i = 0; i < ehdr->e_phnum * ehdr->e_phentsize; i += ehdr->e_phentsize)
-    {
-        if(NULL == (phdr = xc_dl_file_get(self, ehdr->e_phoff + i, sizeof(ElfW(Phdr))))) return XCC_ERRNO_FORMAT;
-
-        if((PT_LOAD == phdr->p_type) && (phdr->p_flags & PF_X) && (0 == phdr->p_offset))
-        {
-            self->load_bias = phdr->p_vaddr;
-            break;
-        }
-    }
-
     //find symbol tables in section headers
     for(i = ehdr->e_shentsize; i < ehdr->e_shnum * ehdr->e_shentsize; i += ehdr->e_shentsize)
     {
         if(NULL == (shdr = xc_dl_file_get(self, ehdr->e_shoff + i, sizeof(ElfW(Shdr))))) return XCC_ERRNO_FORMAT;
 
-        if(SHT_SYMTAB == shdr->sh_type || SHT_DYNSYM == shdr->sh_type)
+        //.dynsym has been searched in memory
+        if(SHT_SYMTAB == shdr->sh_type || (SHT_DYNSYM == shdr->sh_type && NULL == self->dynsym))
         {
             if(shdr->sh_link >= ehdr->e_shnum) continue;
             if(NULL == (str_shdr = xc_dl_file_get(self, ehdr->e_shoff + shdr->sh_link * ehdr->e_shentsize, sizeof(ElfW(Shdr))))) return XCC_ERRNO_FORMAT;
@@ -172,18 +396,65 @@ static int xc_dl_parse_elf(xc_dl_t *self)
     return 0;
 }
 
+static void *xc_dl_symtab_lookup(xc_dl_t *self, const char *symbol)
+{
+    xc_dl_symbols_t *symbols;
+    ElfW(Sym)       *sym;
+    size_t           offset, str_offset;
+    char            *str;
+    void            *addr = NULL;
+
+    //map the file only during the lookup
+    if(0 != xc_dl_file_open(self)) goto end;
+    if(!self->symtab_parsed)
+    {
+        self->symtab_parsed = 1;
+        if(0 != xc_dl_parse_elf(self)) goto end;
+    }
+
+    TAILQ_FOREACH(symbols, &(self->symbolsq), link)
+    {
+        for(offset = symbols->sym_offset; offset < symbols->sym_end; offset += symbols->sym_entry_size)
+        {
+            //read .symtab / .dynsym
+            if(NULL == (sym = xc_dl_file_get(self, offset, sizeof(ElfW(Sym))))) break;
+            if(SHN_UNDEF == sym->st_shndx) continue;
+
+            //read .strtab / .dynstr
+            str_offset = symbols->str_offset + sym->st_name;
+            if(str_offset >= symbols->str_end) continue;
+            if(NULL == (str = xc_dl_file_get_string(self, str_offset))) continue;
+
+            //compare symbol name
+            if(0 != strcmp(symbol, str)) continue;
+
+            //found
+            addr = (void *)(self->load_bias + sym->st_value);
+            goto end;
+        }
+    }
+
+ end:
+    xc_dl_file_close(self);
+    return addr;
+}
+
 xc_dl_t *xc_dl_create(const char *pathname)
 {
-    xc_dl_t *self;
+    xc_dl_t          *self;
+    const ElfW(Phdr) *phdr = NULL;
+    size_t            phnum = 0;
 
     if(NULL == (self = calloc(1, sizeof(xc_dl_t)))) return NULL;
     self->fd = -1;
     self->data = MAP_FAILED;
     TAILQ_INIT(&(self->symbolsq));
+    if(NULL == (self->pathname = strdup(pathname))) goto err;
 
-    if(0 != xc_dl_find_map_start(self, pathname)) goto err;
-    if(0 != xc_dl_file_open(self, pathname)) goto err;
-    if(0 != xc_dl_parse_elf(self)) goto err;
+    //find the loaded ELF, and its .dynsym in memory
+    if(0 != xc_dl_find_by_iterate(self, &phdr, &phnum))
+        if(0 != xc_dl_find_by_maps(self, &phdr, &phnum)) goto err;
+    xc_dl_parse_dynamic(self, phdr, phnum);
     
     return self;
 
@@ -198,15 +469,15 @@ void xc_dl_destroy(xc_dl_t **self)
     
     if(NULL == self || NULL == *self) return;
     
-    if(MAP_FAILED != (*self)->data) munmap((*self)->data, (*self)->size);
-    
-    if((*self)->fd >= 0) close((*self)->fd);
+    xc_dl_file_close(*self);
     
     TAILQ_FOREACH_SAFE(symbols, &((*self)->symbolsq), link, symbols_tmp)
     {
         TAILQ_REMOVE(&((*self)->symbolsq), symbols, link);
         free(symbols);
     }
+
+    if(NULL != (*self)->pathname) free((*self)->pathname);
     
     free(*self);
     *self = NULL;
@@ -214,33 +485,13 @@ void xc_dl_destroy(xc_dl_t **self)
 
 void *xc_dl_sym(xc_dl_t *self, const char *symbol)
 {
-    xc_dl_symbols_t *symbols;
-    ElfW(Sym)       *sym;
-    size_t           offset, str_offset;
-    char            *str;
+    void *addr;
 
-    TAILQ_FOREACH(symbols, &(self->symbolsq), link)
-    {
-        for(offset = symbols->sym_offset; offset < symbols->sym_end; offset += symbols->sym_entry_size)
-        {
-            //read .symtab / .dynsym
-            if(NULL == (sym = xc_dl_file_get(self, offset, sizeof(ElfW(Sym))))) break;
-            if(SHN_UNDEF == sym->st_shndx) continue;
-
-            //read .strtab / .dynstr
-            str_offset = symbols->str_offset + sym->st_name;
-            if(str_offset >= symbols->str_end) continue;
-            if(NULL == (str = xc_dl_file_get_string(self, str_offset))) continue;
+    //exported symbols, by the hash table in memory
+    if(NULL != (addr = xc_dl_dynsym_lookup(self, symbol))) return addr;
 
-            //compare symbol name
-            if(0 != strcmp(symbol, str)) continue;
-
-            //found
-            return (void *)(self->map_start + sym->st_value - self->load_bias);
-        }
-    }
-    
-    return NULL;
+    //internal symbols, by .symtab in the file
+    return xc_dl_symtab_lookup(self, symbol);
 }
 
 #pragma clang diagnostic pop
@@ -0,0 +1,71 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include "xcc_breadcrumb.h"
+#include "xc_breadcrumb.h"
+
+//in BSS, so the dumper can read it from the crashed process directly
+static xcc_breadcrumb_t xc_breadcrumb = {
+    .magic    = XCC_BREADCRUMB_MAGIC,
+    .capacity = XCC_BREADCRUMB_CAPACITY,
+    .next     = 0
+};
+
+//lock-free and no memory allocation, can be called from any thread
+void xc_breadcrumb_append(const char *msg)
+{
+    xcc_breadcrumb_entry_t *entry;
+    struct timespec         tp;
+    uint64_t                idx;
+    size_t                  i;
+
+    if(NULL == msg) return;
+
+    //claim a slot
+    idx = __atomic_fetch_add(&(xc_breadcrumb.next), 1, __ATOMIC_RELAXED);
+    entry = &(xc_breadcrumb.entries[idx & (XCC_BREADCRUMB_CAPACITY - 1)]);
+
+    //mark the slot as not ready before overwriting it
+    __atomic_store_n(&(entry->seq), 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if(0 != clock_gettime(CLOCK_REALTIME, &tp)) tp.tv_sec = tp.tv_nsec = 0;
+    entry->time = (uint64_t)tp.tv_sec * 1000 * 1000 + (uint64_t)tp.tv_nsec / 1000;
+    entry->tid = gettid();
+
+    //one line per entry
+    for(i = 0; i < XCC_BREADCRUMB_MSG_LEN - 1 && '\0' != msg[i]; i++)
+        entry->msg[i] = (('\n' == msg[i] || '\r' == msg[i]) ? ' ' : msg[i]);
+    entry->msg[i] = '\0';
+
+    //publish
+    __atomic_store_n(&(entry->seq), idx + 1, __ATOMIC_RELEASE);
+}
+
+xcc_breadcrumb_t *xc_breadcrumb_get(void)
+{
+    return &xc_breadcrumb;
+}
@@ -22,6 +22,7 @@
 // Created by caikelun on 2019-08-20.
 
 #include <stdint.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +38,7 @@
 #include "xcc_util.h"
 #include "xc_common.h"
 #include "xc_jni.h"
+#include "xc_placeholder.h"
 #include "xc_util.h"
 
 #pragma clang diagnostic push
@@ -77,6 +79,7 @@ int           xc_common_fd_null           = -1;
 sig_atomic_t  xc_common_native_crashed    = 0;
 sig_atomic_t  xc_common_java_crashed      = 0;
 
+static int    xc_common_warmed_up         = 0;
 static int    xc_common_crash_prepared_fd = -1;
 static int    xc_common_trace_prepared_fd = -1;
 
@@ -130,13 +133,13 @@ int xc_common_init(int         api_level,
                    const char *app_id,
                    const char *app_version,
                    const char *app_lib_dir,
-                   const char *log_dir)
+                   const char *log_dir,
+                   int         warm_up_later)
 {
     int             r = 0;
     struct timeval  tv;
     struct tm       tm;
     char            buf[256];
-    char           *kernel_version;
     char           *process_name;
 
 #define XC_COMMON_DUP_STR(v) do {                                       \
@@ -179,11 +182,7 @@ int xc_common_init(int         api_level,
     XC_COMMON_DUP_STR(app_version);
     XC_COMMON_DUP_STR(app_lib_dir);
     XC_COMMON_DUP_STR(log_dir);
-    
-    //save kernel version
-    xc_util_get_kernel_version(buf, sizeof(buf));
-    kernel_version = buf;
-    XC_COMMON_DUP_STR(kernel_version);
+    xc_common_kernel_version = "unknown"; //replaced in warm-up
 
     //save process id and process name
     xc_common_process_id = getpid();
@@ -198,12 +197,12 @@ int xc_common_init(int         api_level,
         goto err;
     }
 
-    //check or create log directory
-    if(0 != (r = xc_util_mkdirs(log_dir))) goto err;
+    //check or create log directory (it is cheap, and a crash during the warm-up needs it)
+    if(0 != (r = xc_util_mkdirs(xc_common_log_dir))) goto err;
 
-    //create prepared FD for FD exhausted case
-    xc_common_open_prepared_fd(1);
-    xc_common_open_prepared_fd(0);
+    //the others can be done later in a background thread
+    if(!warm_up_later)
+        if(0 != (r = xc_common_warm_up())) goto err;
 
     return 0;
 
@@ -218,17 +217,40 @@ int xc_common_init(int         api_level,
     XC_COMMON_FREE_STR(app_version);
     XC_COMMON_FREE_STR(app_lib_dir);
     XC_COMMON_FREE_STR(log_dir);
-    XC_COMMON_FREE_STR(kernel_version);
     XC_COMMON_FREE_STR(process_name);
     
     return r;
 }
 
+int xc_common_warm_up(void)
+{
+    char  buf[256];
+    char *kernel_version;
+
+    if(NULL == xc_common_log_dir) return XCC_ERRNO_STATE;
+
+    //only once
+    if(xc_common_warmed_up) return 0;
+    xc_common_warmed_up = 1;
+
+    //save kernel version (the crash handler reads it at any time)
+    xc_util_get_kernel_version(buf, sizeof(buf));
+    if(NULL == (kernel_version = strdup(buf))) return XCC_ERRNO_NOMEM;
+    __atomic_store_n(&xc_common_kernel_version, kernel_version, __ATOMIC_RELEASE);
+
+    //create prepared FD for FD exhausted case
+    xc_common_open_prepared_fd(1);
+    xc_common_open_prepared_fd(0);
+
+    return 0;
+}
+
 static int xc_common_open_log(int is_crash, uint64_t timestamp,
                               char *pathname, size_t pathname_len, int *from_placeholder)
 {
     int                fd = -1;
     char               buf[512];
+    char               placeholder_dir[1024];
     char               placeholder_pathname[1024];
     long               n, i;
     xcc_util_dirent_t *ent;
@@ -237,12 +259,25 @@ static int xc_common_open_log(int is_crash, uint64_t timestamp,
                      xc_common_log_dir, timestamp, xc_common_app_version, xc_common_process_name,
                      is_crash ? XC_COMMON_LOG_SUFFIX_CRASH : XC_COMMON_LOG_SUFFIX_TRACE);
 
+    //try to use the placeholder file which was opened in advance
+    if(is_crash && (fd = xc_placeholder_take(pathname)) >= 0)
+    {
+        if(NULL != from_placeholder) *from_placeholder = 1;
+        return fd;
+    }
+
+    //placeholder files are kept in a sub-directory, so we don't need to scan all the log files
+    xcc_fmt_snprintf(placeholder_dir, sizeof(placeholder_dir), "%s/"XC_COMMON_PLACEHOLDER_DIR, xc_common_log_dir);
+
     //open dir
-    if((fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(xc_common_log_dir, XC_COMMON_OPEN_DIR_FLAGS))) < 0)
+    if((fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(placeholder_dir, XC_COMMON_OPEN_DIR_FLAGS))) < 0)
     {
+        //no placeholder file
+        if(ENOENT == errno) goto create_new_file;
+        
         //try again with the prepared fd
         if(0 != xc_common_close_prepared_fd(is_crash)) goto create_new_file;
-        if((fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(xc_common_log_dir, XC_COMMON_OPEN_DIR_FLAGS))) < 0) goto create_new_file;
+        if((fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(placeholder_dir, XC_COMMON_OPEN_DIR_FLAGS))) < 0) goto create_new_file;
     }
 
     //try to rename a placeholder file and open it
@@ -258,7 +293,7 @@ static int xc_common_open_log(int is_crash, uint64_t timestamp,
                0 == memcmp(ent->d_name, XC_COMMON_PLACEHOLDER_PREFIX"_", 12) &&
                0 == memcmp(ent->d_name + 32, XC_COMMON_PLACEHOLDER_SUFFIX, 13))
             {
-                xcc_fmt_snprintf(placeholder_pathname, sizeof(placeholder_pathname), "%s/%s", xc_common_log_dir, ent->d_name);
+                xcc_fmt_snprintf(placeholder_pathname, sizeof(placeholder_pathname), "%s/%s", placeholder_dir, ent->d_name);
                 if(0 == rename(placeholder_pathname, pathname))
                 {
                     close(fd);
@@ -35,13 +35,14 @@ extern "C" {
 // log filename format:
 // tombstone_01234567890123456789_appversion__processname.native.xcrash
 // tombstone_01234567890123456789_appversion__processname.trace.xcrash
-// placeholder_01234567890123456789.clean.xcrash
+// placeholder/placeholder_01234567890123456789.clean.xcrash
 #define XC_COMMON_LOG_PREFIX           "tombstone"
 #define XC_COMMON_LOG_PREFIX_LEN       9
 #define XC_COMMON_LOG_SUFFIX_CRASH     ".native.xcrash"
 #define XC_COMMON_LOG_SUFFIX_TRACE     ".trace.xcrash"
 #define XC_COMMON_LOG_SUFFIX_TRACE_LEN 13
 #define XC_COMMON_LOG_NAME_MIN_TRACE   (9 + 1 + 20 + 1 + 2 + 13)
+#define XC_COMMON_PLACEHOLDER_DIR      "placeholder"
 #define XC_COMMON_PLACEHOLDER_PREFIX   "placeholder"
 #define XC_COMMON_PLACEHOLDER_SUFFIX   ".clean.xcrash"
 
@@ -86,7 +87,9 @@ int xc_common_init(int         api_level,
                    const char *app_id,
                    const char *app_version,
                    const char *app_lib_dir,
-                   const char *log_dir);
+                   const char *log_dir,
+                   int         warm_up_later);
+int xc_common_warm_up(void);
 
 int xc_common_open_crash_log(char *pathname, size_t pathname_len, int *from_placeholder);
 int xc_common_open_trace_log(char *pathname, size_t pathname_len, uint64_t trace_time);
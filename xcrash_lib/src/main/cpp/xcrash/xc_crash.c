@@ -53,6 +53,7 @@
 #include "xcc_b64.h"
 #include "xcc_util.h"
 #include "xc_crash.h"
+#include "xc_breadcrumb.h"
 #include "xc_trace.h"
 #include "xc_common.h"
 #include "xc_dl.h"
@@ -69,11 +70,30 @@
 #define XC_CRASH_EMERGENCY_BUF_LEN         (30 * 1024)
 #define XC_CRASH_ERR_TITLE                 "\n\nxcrash error:\n"
 
-static pthread_mutex_t  xc_crash_mutex   = PTHREAD_MUTEX_INITIALIZER;
+//crash state (the first crashed thread owns the dump)
+#define XC_CRASH_STATE_IDLE    0
+#define XC_CRASH_STATE_DUMPING 1
+#define XC_CRASH_STATE_DONE    2
+#define XC_CRASH_STATE_THREADS 3 //dumping the other threads for a java crash or an on-demand dump
+static int              xc_crash_state   = XC_CRASH_STATE_IDLE;
+static int              xc_crash_other_crashes_cnt = 0;
+static xcc_spot_crash_t xc_crash_other_crashes[XCC_SPOT_OTHER_CRASHES_MAX];
+
 static int              xc_crash_rethrow;
 static char            *xc_crash_dumper_pathname;
+static int              xc_crash_dumper_missing = 0;
 static char            *xc_crash_emergency;
 
+//the minimum interval of the on-demand dumps
+#define XC_CRASH_DUMP_THREADS_INTERVAL_MS 10000
+static uint64_t         xc_crash_dump_threads_last_ms = 0;
+
+//the thread dump in progress (XC_CRASH_STATE_THREADS), and the spot fields it replaced
+static pid_t            xc_crash_threads_tid = 0;
+static char            *xc_crash_threads_orig_whitelist = NULL;
+static size_t           xc_crash_threads_orig_whitelist_len = 0;
+static unsigned int     xc_crash_threads_orig_count_max = 0;
+
 //the log file
 static int              xc_crash_prepared_fd = -1;
 static int              xc_crash_log_fd  = -1;
@@ -101,6 +121,7 @@ static int              xc_crash_child_notifier[2];
 //info passed to the dumper process
 static xcc_spot_t       xc_crash_spot;
 static char            *xc_crash_dump_all_threads_whitelist = NULL;
+static char            *xc_crash_kernel_version = NULL;
 
 static int xc_crash_fork(int (*fn)(void *))
 {
@@ -135,6 +156,13 @@ static int xc_crash_fork(int (*fn)(void *))
 #endif
 }
 
+//the kernel version may be replaced by the warm-up thread at any time
+static void xc_crash_load_kernel_version(void)
+{
+    xc_crash_kernel_version = __atomic_load_n(&xc_common_kernel_version, __ATOMIC_ACQUIRE);
+    xc_crash_spot.kernel_version_len = strlen(xc_crash_kernel_version);
+}
+
 static int xc_crash_exec_dumper(void *arg)
 {
     (void)arg;
@@ -197,7 +225,7 @@ static int xc_crash_exec_dumper(void *arg)
         {.iov_base = &xc_crash_spot,                      .iov_len = sizeof(xcc_spot_t)},
         {.iov_base = xc_crash_log_pathname,               .iov_len = xc_crash_spot.log_pathname_len},
         {.iov_base = xc_common_os_version,                .iov_len = xc_crash_spot.os_version_len},
-        {.iov_base = xc_common_kernel_version,            .iov_len = xc_crash_spot.kernel_version_len},
+        {.iov_base = xc_crash_kernel_version,             .iov_len = xc_crash_spot.kernel_version_len},
         {.iov_base = xc_common_abi_list,                  .iov_len = xc_crash_spot.abi_list_len},
         {.iov_base = xc_common_manufacturer,              .iov_len = xc_crash_spot.manufacturer_len},
         {.iov_base = xc_common_brand,                     .iov_len = xc_crash_spot.brand_len},
@@ -222,6 +250,10 @@ static int xc_crash_exec_dumper(void *arg)
     syscall(SYS_close, pipefd[0]);
     syscall(SYS_close, pipefd[1]);
 
+    //the dumper writes to the inherited log fd when dumping threads for a java crash
+    if(xc_crash_spot.threads_only_log_fd >= 0)
+        fcntl(xc_crash_log_fd, F_SETFD, 0);
+
     //escape to the dumper process
     errno = 0;
     execl(xc_crash_dumper_pathname, XCC_UTIL_XCRASH_DUMPER_FILENAME, NULL);
@@ -391,6 +423,57 @@ static int xc_crash_check_backtrace_valid()
     return r;    
 }
 
+//restore the spot fields replaced by the thread dump (async-signal-safe, the whitelist is freed by the caller)
+static void xc_crash_dump_threads_reset(void)
+{
+    xc_crash_log_fd = -1;
+    xc_crash_spot.threads_only_log_fd = -1;
+    xc_crash_spot.threads_only_nonfatal = 0;
+    xc_crash_spot.dump_all_threads_count_max = xc_crash_threads_orig_count_max;
+    xc_crash_dump_all_threads_whitelist = xc_crash_threads_orig_whitelist;
+    xc_crash_spot.dump_all_threads_whitelist_len = xc_crash_threads_orig_whitelist_len;
+    __atomic_store_n(&xc_crash_threads_tid, 0, __ATOMIC_RELEASE);
+}
+
+static void xc_crash_other_crash_handler(siginfo_t *si, ucontext_t *uc)
+{
+    pid_t             tid = gettid();
+    int               idx;
+    xcc_spot_crash_t *crash;
+    struct timespec   ts = {.tv_sec = 0, .tv_nsec = 10 * 1000 * 1000};
+
+    //crashed again in the dumping thread
+    if(tid == __atomic_load_n(&xc_crash_tid, __ATOMIC_ACQUIRE)) _exit(1);
+
+    if(XC_CRASH_STATE_DUMPING == __atomic_load_n(&xc_crash_state, __ATOMIC_ACQUIRE))
+    {
+        //save siginfo and ucontext to a preallocated slot, the dumper will unwind from them
+        idx = __atomic_fetch_add(&xc_crash_other_crashes_cnt, 1, __ATOMIC_ACQ_REL);
+        if(idx < XCC_SPOT_OTHER_CRASHES_MAX)
+        {
+            crash = &(xc_crash_other_crashes[idx]);
+            memcpy(&(crash->siginfo), si, sizeof(siginfo_t));
+            memcpy(&(crash->ucontext), uc, sizeof(ucontext_t));
+            __atomic_store_n(&(crash->tid), tid, __ATOMIC_RELEASE);
+        }
+
+        //keep the stack of this thread until the dump is finished
+        while(XC_CRASH_STATE_DUMPING == __atomic_load_n(&xc_crash_state, __ATOMIC_ACQUIRE))
+            nanosleep(&ts, NULL);
+    }
+
+    _exit(1);
+}
+
+static int xc_crash_restore_signal_handler(void)
+{
+    //restore the original/default signal handler
+    if(xc_crash_rethrow)
+        return xcc_signal_crash_unregister();
+    else
+        return xcc_signal_crash_ignore();
+}
+
 static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
 {
     struct timespec crash_tp;
@@ -398,29 +481,39 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
     int             restore_orig_dumpable = 0;
     int             orig_dumpable = 0;
     int             dump_ok = 0;
+    int             restore_ok = 0;
+    int             state = XC_CRASH_STATE_IDLE;
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 10 * 1000 * 1000};
 
     (void)sig;
 
-    pthread_mutex_lock(&xc_crash_mutex);
-
     //only once
-    if(xc_common_native_crashed) goto exit;
-    xc_common_native_crashed = 1;
-
-    //restore the original/default signal handler
-    if(xc_crash_rethrow)
-    {
-        if(0 != xcc_signal_crash_unregister()) goto exit;
-    }
-    else
+    while(!__atomic_compare_exchange_n(&xc_crash_state, &state, XC_CRASH_STATE_DUMPING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
     {
-        if(0 != xcc_signal_crash_ignore()) goto exit;
+        if(XC_CRASH_STATE_THREADS != state)
+            xc_crash_other_crash_handler(si, (ucontext_t *)uc);
+
+        if(gettid() == __atomic_load_n(&xc_crash_threads_tid, __ATOMIC_ACQUIRE))
+        {
+            //crashed while dumping the threads in this thread, take the spot back
+            xc_crash_dump_threads_reset();
+            __atomic_store_n(&xc_crash_state, XC_CRASH_STATE_IDLE, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            //a thread dump is not a crash, wait for it and then dump this crash as usual
+            nanosleep(&ts, NULL);
+        }
+        state = XC_CRASH_STATE_IDLE;
     }
+    xc_common_native_crashed = 1;
 
     if(XC_TRACE_DUMP_ON_GOING == xc_trace_dump_status) 
     {
+        if(0 != xc_crash_restore_signal_handler()) goto exit;
         xc_trace_dump_status = XC_TRACE_DUMP_ART_CRASH;
         XCD_LOG_WARN("meet error sig(%d) while calling ART dump trace\n", sig);
+        __atomic_store_n(&xc_crash_state, XC_CRASH_STATE_IDLE, __ATOMIC_RELEASE);
         siglongjmp(jmpenv, 1);
     }
 
@@ -429,7 +522,7 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
     xc_crash_time = (uint64_t)(crash_tp.tv_sec) * 1000 * 1000 + (uint64_t)crash_tp.tv_nsec / 1000;
 
     //save crashed thread ID
-    xc_crash_tid = gettid();
+    __atomic_store_n(&xc_crash_tid, gettid(), __ATOMIC_RELEASE);
     
     //create and open log file
     if((xc_crash_log_fd = xc_common_open_crash_log(xc_crash_log_pathname, sizeof(xc_crash_log_pathname), &xc_crash_log_from_placeholder)) < 0) goto end;
@@ -481,6 +574,14 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
     memcpy(&(xc_crash_spot.siginfo), si, sizeof(siginfo_t));
     memcpy(&(xc_crash_spot.ucontext), uc, sizeof(ucontext_t));
     xc_crash_spot.log_pathname_len = strlen(xc_crash_log_pathname);
+    xc_crash_load_kernel_version();
+
+    //the dumper is not installed, don't bother to fork
+    if(xc_crash_dumper_missing)
+    {
+        xcc_util_write_format_safe(xc_crash_log_fd, XC_CRASH_ERR_TITLE"dumper is not executable, dumper=%s\n\n", xc_crash_dumper_pathname);
+        goto end;
+    }
 
     //spawn crash dumper process
     errno = 0;
@@ -539,6 +640,9 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
     dump_ok = 1;
 
  end:
+    //keep our signal handler during the dump, so that other crashed threads can be recorded
+    restore_ok = (0 == xc_crash_restore_signal_handler() ? 1 : 0);
+
     //restore dumpable
     if(restore_orig_dumpable) prctl(PR_SET_DUMPABLE, orig_dumpable);
 
@@ -563,7 +667,8 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
                                        xc_crash_spot.logcat_events_lines,
                                        xc_crash_spot.logcat_main_lines,
                                        xc_crash_spot.dump_fds,
-                                       xc_crash_spot.dump_network_info))
+                                       xc_crash_spot.dump_network_info,
+                                       xc_crash_spot.dump_meminfo_detail))
             {
                 close(xc_crash_log_fd);
                 xc_crash_log_fd = -1;
@@ -584,23 +689,24 @@ static void xc_crash_signal_handler(int sig, siginfo_t *si, void *uc)
     //JNI callback
     xc_crash_callback();
 
-    if(0 != xcc_signal_crash_queue(si)) goto exit;
+    if(!restore_ok || 0 != xcc_signal_crash_queue(si)) goto exit;
     
-    pthread_mutex_unlock(&xc_crash_mutex);
+    __atomic_store_n(&xc_crash_state, XC_CRASH_STATE_DONE, __ATOMIC_RELEASE);
     return;
 
  exit:
-    pthread_mutex_unlock(&xc_crash_mutex);
+    __atomic_store_n(&xc_crash_state, XC_CRASH_STATE_DONE, __ATOMIC_RELEASE);
     _exit(1);
 }
 
-static void xc_crash_init_dump_all_threads_whitelist(const char **whitelist, size_t whitelist_len)
+static char *xc_crash_encode_dump_all_threads_whitelist(const char **whitelist, size_t whitelist_len, size_t *whitelist_encoded_len)
 {
     size_t  i, len;
     size_t  encoded_len, total_encoded_len = 0, cur_encoded_len = 0;
     char   *total_encoded_whitelist, *tmp;
     
-    if(NULL == whitelist || 0 == whitelist_len) return;
+    *whitelist_encoded_len = 0;
+    if(NULL == whitelist || 0 == whitelist_len) return NULL;
 
     //get total encoded length
     for(i = 0; i < whitelist_len; i++)
@@ -610,12 +716,12 @@ static void xc_crash_init_dump_all_threads_whitelist(const char **whitelist, siz
         if(0 == len) continue;
         total_encoded_len += xcc_b64_encode_max_len(len);
     }
-    if(0 == total_encoded_len) return;
+    if(0 == total_encoded_len) return NULL;
     total_encoded_len += whitelist_len; //separator ('|')
     total_encoded_len += 1; //terminating null byte ('\0')
 
     //alloc encode buffer
-    if(NULL == (total_encoded_whitelist = calloc(1, total_encoded_len))) return;
+    if(NULL == (total_encoded_whitelist = calloc(1, total_encoded_len))) return NULL;
 
     //to base64 encode each whitelist item
     for(i = 0; i < whitelist_len; i++)
@@ -626,7 +732,7 @@ static void xc_crash_init_dump_all_threads_whitelist(const char **whitelist, siz
 
         if(NULL != (tmp = xcc_b64_encode((const uint8_t *)(whitelist[i]), len, &encoded_len)))
         {
-            if(cur_encoded_len + encoded_len + 1 >= total_encoded_len) return; //impossible
+            if(cur_encoded_len + encoded_len + 1 >= total_encoded_len) return NULL; //impossible
             
             memcpy(total_encoded_whitelist + cur_encoded_len, tmp, encoded_len);
             cur_encoded_len += encoded_len;
@@ -647,11 +753,11 @@ static void xc_crash_init_dump_all_threads_whitelist(const char **whitelist, siz
     if(0 == cur_encoded_len)
     {
         free(total_encoded_whitelist);
-        return;
+        return NULL;
     }
 
-    xc_crash_spot.dump_all_threads_whitelist_len = cur_encoded_len;
-    xc_crash_dump_all_threads_whitelist = total_encoded_whitelist;
+    *whitelist_encoded_len = cur_encoded_len;
+    return total_encoded_whitelist;
 }
 
 static void xc_crash_init_callback(JNIEnv *env)
@@ -684,19 +790,21 @@ int xc_crash_init(JNIEnv *env,
                   int dump_map,
                   int dump_fds,
                   int dump_network_info,
+                  int dump_meminfo_detail,
                   int dump_all_threads,
                   unsigned int dump_all_threads_count_max,
                   const char **dump_all_threads_whitelist,
-                  size_t dump_all_threads_whitelist_len)
+                  size_t dump_all_threads_whitelist_len,
+                  unsigned int suppress_duplicates_window,
+                  int stack_scan,
+                  unsigned int dump_budget_ms,
+                  int dump_minicore)
 {
     xc_crash_prepared_fd = XCC_UTIL_TEMP_FAILURE_RETRY(open("/dev/null", O_RDWR));
     xc_crash_rethrow = rethrow;
     if(NULL == (xc_crash_emergency = calloc(XC_CRASH_EMERGENCY_BUF_LEN, 1))) return XCC_ERRNO_NOMEM;
     if(NULL == (xc_crash_dumper_pathname = xc_util_strdupcat(xc_common_app_lib_dir, "/"XCC_UTIL_XCRASH_DUMPER_FILENAME))) return XCC_ERRNO_NOMEM;
 
-    //init the local unwinder for fallback mode
-    xcc_unwind_init(xc_common_api_level);
-
     //init for JNI callback
     xc_crash_init_callback(env);
 
@@ -713,10 +821,18 @@ int xc_crash_init(JNIEnv *env,
     xc_crash_spot.dump_map = dump_map;
     xc_crash_spot.dump_fds = dump_fds;
     xc_crash_spot.dump_network_info = dump_network_info;
+    xc_crash_spot.dump_meminfo_detail = dump_meminfo_detail;
     xc_crash_spot.dump_all_threads = dump_all_threads;
     xc_crash_spot.dump_all_threads_count_max = dump_all_threads_count_max;
+    xc_crash_spot.suppress_duplicates_window = suppress_duplicates_window;
+    xc_crash_spot.breadcrumb_addr = (uintptr_t)xc_breadcrumb_get();
+    xc_crash_spot.other_crashes_addr = (uintptr_t)xc_crash_other_crashes;
+    xc_crash_spot.other_crashes_cnt = XCC_SPOT_OTHER_CRASHES_MAX;
+    xc_crash_spot.stack_scan = stack_scan;
+    xc_crash_spot.dump_budget_ms = dump_budget_ms;
+    xc_crash_spot.dump_minicore = dump_minicore;
     xc_crash_spot.os_version_len = strlen(xc_common_os_version);
-    xc_crash_spot.kernel_version_len = strlen(xc_common_kernel_version);
+    xc_crash_load_kernel_version();
     xc_crash_spot.abi_list_len = strlen(xc_common_abi_list);
     xc_crash_spot.manufacturer_len = strlen(xc_common_manufacturer);
     xc_crash_spot.brand_len = strlen(xc_common_brand);
@@ -724,7 +840,10 @@ int xc_crash_init(JNIEnv *env,
     xc_crash_spot.build_fingerprint_len = strlen(xc_common_build_fingerprint);
     xc_crash_spot.app_id_len = strlen(xc_common_app_id);
     xc_crash_spot.app_version_len = strlen(xc_common_app_version);
-    xc_crash_init_dump_all_threads_whitelist(dump_all_threads_whitelist, dump_all_threads_whitelist_len);
+    xc_crash_spot.threads_only_log_fd = -1;
+    xc_crash_dump_all_threads_whitelist = xc_crash_encode_dump_all_threads_whitelist(dump_all_threads_whitelist,
+                                                                                     dump_all_threads_whitelist_len,
+                                                                                     &(xc_crash_spot.dump_all_threads_whitelist_len));
 
     //for clone and fork
 #ifndef __i386__
@@ -738,4 +857,166 @@ int xc_crash_init(JNIEnv *env,
     return xcc_signal_crash_register(xc_crash_signal_handler);
 }
 
+void xc_crash_warm_up(void)
+{
+    //init the local unwinder for fallback mode
+    xcc_unwind_init(xc_common_api_level);
+
+    //the crash handler goes to the fallback mode directly without the dumper
+    if(0 != access(xc_crash_dumper_pathname, X_OK))
+        __atomic_store_n(&xc_crash_dumper_missing, 1, __ATOMIC_RELEASE);
+}
+
+static int xc_crash_dump_threads_to_fd(int log_fd,
+                                       unsigned int dump_all_threads_count_max,
+                                       const char **dump_all_threads_whitelist,
+                                       size_t dump_all_threads_whitelist_len,
+                                       int nonfatal)
+{
+    struct timespec  tp;
+    int              restore_orig_ptracer = 0;
+    int              restore_orig_dumpable = 0;
+    int              orig_dumpable = 0;
+    int              state = XC_CRASH_STATE_IDLE;
+    int              status = 0;
+    pid_t            dumper_pid = -1;
+    int              r = 0;
+
+    if(log_fd <= STDERR_FILENO) return XCC_ERRNO_INVAL;
+    if(NULL == xc_crash_dumper_pathname || xc_crash_dumper_missing) return XCC_ERRNO_STATE;
+
+    //the spot is owned by the native crash handler while it is dumping,
+    //a native crash during the thread dump waits for it (see xc_crash_signal_handler)
+    if(!__atomic_compare_exchange_n(&xc_crash_state, &state, XC_CRASH_STATE_THREADS, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return XCC_ERRNO_STATE;
+    xc_crash_threads_orig_whitelist = xc_crash_dump_all_threads_whitelist;
+    xc_crash_threads_orig_whitelist_len = xc_crash_spot.dump_all_threads_whitelist_len;
+    xc_crash_threads_orig_count_max = xc_crash_spot.dump_all_threads_count_max;
+    __atomic_store_n(&xc_crash_threads_tid, gettid(), __ATOMIC_RELEASE);
+
+    //set dumpable and traceable
+    orig_dumpable = prctl(PR_GET_DUMPABLE);
+    if(0 != prctl(PR_SET_DUMPABLE, 1))
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+    restore_orig_dumpable = 1;
+    errno = 0;
+    if(0 == prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY))
+        restore_orig_ptracer = 1;
+    else if(EINVAL != errno)
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+
+    //only the other threads are recorded by the dumper (the calling thread is the java crashed thread,
+    //or the anchor of an on-demand dump)
+    clock_gettime(CLOCK_REALTIME, &tp);
+    xc_crash_spot.crash_time = (uint64_t)(tp.tv_sec) * 1000 * 1000 + (uint64_t)tp.tv_nsec / 1000;
+    xc_crash_spot.crash_tid = gettid();
+    memset(&(xc_crash_spot.siginfo), 0, sizeof(siginfo_t));
+    memset(&(xc_crash_spot.ucontext), 0, sizeof(ucontext_t));
+    xc_crash_spot.log_pathname_len = 0;
+    xc_crash_load_kernel_version();
+    xc_crash_spot.threads_only_log_fd = log_fd;
+    xc_crash_spot.threads_only_nonfatal = nonfatal;
+    xc_crash_spot.dump_all_threads_count_max = dump_all_threads_count_max;
+    xc_crash_dump_all_threads_whitelist = xc_crash_encode_dump_all_threads_whitelist(dump_all_threads_whitelist,
+                                                                                     dump_all_threads_whitelist_len,
+                                                                                     &(xc_crash_spot.dump_all_threads_whitelist_len));
+    xc_crash_log_fd = log_fd;
+
+    //spawn the dumper process, and wait for it
+    if(-1 == (dumper_pid = xc_crash_fork(xc_crash_exec_dumper)))
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+    if(-1 == XCC_UTIL_TEMP_FAILURE_RETRY(waitpid(dumper_pid, &status, __WALL)))
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+    if(!(WIFEXITED(status)) || 0 != WEXITSTATUS(status)) r = XCC_ERRNO_UNKNOWN;
+
+ end:
+    if(xc_crash_threads_orig_whitelist != xc_crash_dump_all_threads_whitelist && NULL != xc_crash_dump_all_threads_whitelist)
+        free(xc_crash_dump_all_threads_whitelist);
+    xc_crash_dump_threads_reset();
+
+#ifdef __i386__
+    //the notifier pipe has been closed after fork, prepare it again for the native crash handler
+    if(-1 != dumper_pid)
+        if(0 != pipe2(xc_crash_child_notifier, O_CLOEXEC)) r = XCC_ERRNO_SYS;
+#endif
+
+    if(restore_orig_dumpable) prctl(PR_SET_DUMPABLE, orig_dumpable);
+    if(restore_orig_ptracer) prctl(PR_SET_PTRACER, 0);
+
+    __atomic_store_n(&xc_crash_state, XC_CRASH_STATE_IDLE, __ATOMIC_RELEASE);
+    return r;
+}
+
+int xc_crash_dump_other_threads(int log_fd,
+                                unsigned int dump_all_threads_count_max,
+                                const char **dump_all_threads_whitelist,
+                                size_t dump_all_threads_whitelist_len)
+{
+    return xc_crash_dump_threads_to_fd(log_fd, dump_all_threads_count_max, dump_all_threads_whitelist, dump_all_threads_whitelist_len, 0);
+}
+
+int xc_crash_dump_threads(char *pathname, size_t pathname_len)
+{
+    struct timespec  tp;
+    uint64_t         now_ms, last_ms;
+    uint64_t         dump_time;
+    char             buf[1024];
+    int              fd;
+    int              r;
+
+    if(NULL == xc_crash_dumper_pathname || xc_crash_dumper_missing) return XCC_ERRNO_STATE;
+
+    //rate limit
+    if(0 != clock_gettime(CLOCK_MONOTONIC, &tp)) return XCC_ERRNO_SYS;
+    now_ms = (uint64_t)tp.tv_sec * 1000 + (uint64_t)tp.tv_nsec / 1000 / 1000;
+    last_ms = __atomic_load_n(&xc_crash_dump_threads_last_ms, __ATOMIC_ACQUIRE);
+    if(0 != last_ms && now_ms - last_ms < XC_CRASH_DUMP_THREADS_INTERVAL_MS) return XCC_ERRNO_RANGE;
+    if(!__atomic_compare_exchange_n(&xc_crash_dump_threads_last_ms, &last_ms, now_ms, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return XCC_ERRNO_RANGE;
+
+    //create and open log file
+    if(0 != clock_gettime(CLOCK_REALTIME, &tp)) return XCC_ERRNO_SYS;
+    dump_time = (uint64_t)(tp.tv_sec) * 1000 * 1000 + (uint64_t)tp.tv_nsec / 1000;
+    if((fd = xc_common_open_trace_log(pathname, pathname_len, dump_time)) < 0) return XCC_ERRNO_SYS;
+
+    //write header info
+    xcc_util_get_dump_header(buf, sizeof(buf),
+                             XCC_UTIL_CRASH_TYPE_TRACE,
+                             xc_common_time_zone,
+                             xc_common_start_time,
+                             dump_time,
+                             xc_common_app_id,
+                             xc_common_app_version,
+                             xc_common_api_level,
+                             xc_common_os_version,
+                             xc_common_kernel_version,
+                             xc_common_abi_list,
+                             xc_common_manufacturer,
+                             xc_common_brand,
+                             xc_common_model,
+                             xc_common_build_fingerprint);
+    if(0 != (r = xcc_util_write_str(fd, buf))) goto end;
+    if(0 != (r = xcc_util_write_format(fd, "pid: %d  >>> %s <<<\n\n", xc_common_process_id, xc_common_process_name))) goto end;
+
+    //all the other threads, by the dumper in non-fatal mode
+    r = xc_crash_dump_threads_to_fd(fd, 0, NULL, 0, 1);
+
+ end:
+    xc_common_close_trace_log(fd);
+    if(0 != r) unlink(pathname);
+    return r;
+}
+
 #pragma clang diagnostic pop
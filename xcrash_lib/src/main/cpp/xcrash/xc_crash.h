@@ -41,10 +41,24 @@ int xc_crash_init(JNIEnv *env,
                   int dump_map,
                   int dump_fds,
                   int dump_network_info,
+                  int dump_meminfo_detail,
                   int dump_all_threads,
                   unsigned int dump_all_threads_count_max,
                   const char **dump_all_threads_whitelist,
-                  size_t dump_all_threads_whitelist_len);
+                  size_t dump_all_threads_whitelist_len,
+                  unsigned int suppress_duplicates_window,
+                  int stack_scan,
+                  unsigned int dump_budget_ms,
+                  int dump_minicore);
+
+void xc_crash_warm_up(void);
+
+int xc_crash_dump_other_threads(int log_fd,
+                                unsigned int dump_all_threads_count_max,
+                                const char **dump_all_threads_whitelist,
+                                size_t dump_all_threads_whitelist_len);
+
+int xc_crash_dump_threads(char *pathname, size_t pathname_len);
 
 #ifdef __cplusplus
 }
@@ -47,6 +47,7 @@
 #include "xcc_version.h"
 #include "xc_fallback.h"
 #include "xc_common.h"
+#include "xc_breadcrumb.h"
 #include "xc_util.h"
 
 #pragma clang diagnostic push
@@ -192,10 +193,11 @@ static size_t xc_fallback_get_regs(char *buf, size_t len, ucontext_t *uc)
 
 static size_t xc_fallback_get_backtrace(char *buf, size_t len, siginfo_t *si, ucontext_t *uc)
 {
-    size_t used = 0;
+    size_t      used = 0;
+    const char *unwinder = "unknown";
 
     used += xcc_fmt_snprintf(buf + used, len - used, "backtrace:\n");
-    used += xcc_unwind_get(xc_common_api_level, si, uc, buf + used, len - used);
+    used += xcc_unwind_get(xc_common_api_level, si, uc, buf + used, len - used, &unwinder);
     if(used >= len - 1)
     {
         buf[len - 3] = '\n';
@@ -203,6 +205,7 @@ static size_t xc_fallback_get_backtrace(char *buf, size_t len, siginfo_t *si, uc
         used = len - 2;
     }
     used += xcc_fmt_snprintf(buf + used, len - used, "\n");
+    used += xcc_fmt_snprintf(buf + used, len - used, "unwinder:\n%s\n\n", unwinder);
     return used;
 }
 
@@ -241,7 +244,8 @@ int xc_fallback_record(int log_fd,
                        unsigned int logcat_events_lines,
                        unsigned int logcat_main_lines,
                        int dump_fds,
-                       int dump_network_info)
+                       int dump_network_info,
+                       int dump_meminfo_detail)
 {
     int r;
 
@@ -252,12 +256,13 @@ int xc_fallback_record(int log_fd,
     //If we wrote the emergency info successfully, we don't need to return it from callback again.
     emergency[0] = '\0';
     
+    if(0 != (r = xcc_breadcrumb_record(log_fd, xc_breadcrumb_get(), xc_common_time_zone))) return r;
     if(0 != (r = xcc_util_record_logcat(log_fd, xc_common_process_id, xc_common_api_level, logcat_system_lines, logcat_events_lines, logcat_main_lines))) return r;
     if(dump_fds)
         if(0 != (r = xcc_util_record_fds(log_fd, xc_common_process_id))) return r;
     if(dump_network_info)
         if(0 != (r = xcc_util_record_network_info(log_fd, xc_common_process_id, xc_common_api_level))) return r;
-    if(0 != (r = xcc_meminfo_record(log_fd, xc_common_process_id))) return r;
+    if(0 != (r = xcc_meminfo_record(log_fd, xc_common_process_id, dump_meminfo_detail))) return r;
     
     return 0;
 }
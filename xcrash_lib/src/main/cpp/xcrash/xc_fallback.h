@@ -44,7 +44,8 @@ int xc_fallback_record(int log_fd,
                        unsigned int logcat_events_lines,
                        unsigned int logcat_main_lines,
                        int dump_fds,
-                       int dump_network_info);
+                       int dump_network_info,
+                       int dump_meminfo_detail);
 
 #ifdef __cplusplus
 }
@@ -31,10 +31,16 @@
 #include <android/log.h>
 #include "xcc_errno.h"
 #include "xcc_util.h"
+#include "xcc_meminfo.h"
+#include "xcc_spot.h"
 #include "xc_jni.h"
 #include "xc_common.h"
 #include "xc_crash.h"
+#include "xc_breadcrumb.h"
 #include "xc_trace.h"
+#include "xc_watchdog.h"
+#include "xc_profiler.h"
+#include "xc_placeholder.h"
 #include "xc_util.h"
 #include "xc_test.h"
 
@@ -42,6 +48,30 @@
 #pragma clang diagnostic ignored "-Wgnu-statement-expression"
 
 static int xc_jni_inited = 0;
+static int xc_jni_crash_inited = 0;
+static int xc_jni_trace_inited = 0;
+static int xc_jni_warmed_up = 0;
+
+//everything not required by the signal handlers to record a crash
+static void xc_jni_warm_up(int preload)
+{
+    int expected = 0;
+
+    //only once
+    if(!__atomic_compare_exchange_n(&xc_jni_warmed_up, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+
+    xc_common_warm_up();
+
+    if(xc_jni_crash_inited)
+    {
+        xc_crash_warm_up();
+
+        //open a placeholder file in advance
+        xc_placeholder_prepare();
+    }
+
+    if(xc_jni_trace_inited) xc_trace_warm_up(preload);
+}
 
 static jint xc_jni_init(JNIEnv       *env,
                         jobject       thiz,
@@ -62,19 +92,27 @@ static jint xc_jni_init(JNIEnv       *env,
                         jint          crash_logcat_events_lines,
                         jint          crash_logcat_main_lines,
                         jboolean      crash_dump_elf_hash,
+                        jint          crash_elf_hash_algorithm,
                         jboolean      crash_dump_map,
                         jboolean      crash_dump_fds,
                         jboolean      crash_dump_network_info,
+                        jboolean      crash_dump_meminfo_detail,
                         jboolean      crash_dump_all_threads,
                         jint          crash_dump_all_threads_count_max,
                         jobjectArray  crash_dump_all_threads_whitelist,
+                        jint          crash_suppress_duplicates_window,
+                        jboolean      crash_stack_scan,
+                        jint          crash_dump_budget,
+                        jboolean      crash_dump_minicore,
                         jboolean      trace_enable,
                         jboolean      trace_rethrow,
                         jint          trace_logcat_system_lines,
                         jint          trace_logcat_events_lines,
                         jint          trace_logcat_main_lines,
                         jboolean      trace_dump_fds,
-                        jboolean      trace_dump_network_info)
+                        jboolean      trace_dump_network_info,
+                        jboolean      trace_dump_meminfo_detail,
+                        jboolean      warm_up_async)
 {
     int              r_crash                                = XCC_ERRNO_JNI;
     int              r_trace                                = XCC_ERRNO_JNI;
@@ -107,7 +145,8 @@ static jint xc_jni_init(JNIEnv       *env,
        !os_version || !abi_list || !manufacturer || !brand || !model || !build_fingerprint ||
        !app_id || !app_version || !app_lib_dir || !log_dir ||
        crash_logcat_system_lines < 0 || crash_logcat_events_lines < 0 || crash_logcat_main_lines < 0 ||
-       crash_dump_all_threads_count_max < 0 ||
+       crash_dump_all_threads_count_max < 0 || crash_suppress_duplicates_window < 0 || crash_dump_budget < 0 ||
+       (XCC_SPOT_ELF_HASH_MD5 != crash_elf_hash_algorithm && XCC_SPOT_ELF_HASH_XXH3 != crash_elf_hash_algorithm) ||
        trace_logcat_system_lines < 0 || trace_logcat_events_lines < 0 || trace_logcat_main_lines < 0)
         return XCC_ERRNO_INVAL;
 
@@ -133,7 +172,8 @@ static jint xc_jni_init(JNIEnv       *env,
                            c_app_id,
                            c_app_version,
                            c_app_lib_dir,
-                           c_log_dir)) goto clean;
+                           c_log_dir,
+                           warm_up_async ? 1 : 0)) goto clean;
     
     r_crash = 0;
     r_trace = 0;
@@ -165,14 +205,20 @@ static jint xc_jni_init(JNIEnv       *env,
                                 (unsigned int)crash_logcat_system_lines,
                                 (unsigned int)crash_logcat_events_lines,
                                 (unsigned int)crash_logcat_main_lines,
-                                crash_dump_elf_hash ? 1 : 0,
+                                crash_dump_elf_hash ? (int)crash_elf_hash_algorithm : 0,
                                 crash_dump_map ? 1 : 0,
                                 crash_dump_fds ? 1 : 0,
                                 crash_dump_network_info ? 1 : 0,
+                                crash_dump_meminfo_detail ? 1 : 0,
                                 crash_dump_all_threads ? 1 : 0,
                                 (unsigned int)crash_dump_all_threads_count_max,
                                 c_crash_dump_all_threads_whitelist,
-                                c_crash_dump_all_threads_whitelist_len);
+                                c_crash_dump_all_threads_whitelist_len,
+                                (unsigned int)crash_suppress_duplicates_window,
+                                crash_stack_scan ? 1 : 0,
+                                (unsigned int)crash_dump_budget,
+                                crash_dump_minicore ? 1 : 0);
+        if(0 == r_crash) xc_jni_crash_inited = 1;
     }
     
     if(trace_enable)
@@ -184,8 +230,13 @@ static jint xc_jni_init(JNIEnv       *env,
                             (unsigned int)trace_logcat_events_lines,
                             (unsigned int)trace_logcat_main_lines,
                             trace_dump_fds ? 1 : 0,
-                            trace_dump_network_info ? 1 : 0);
+                            trace_dump_network_info ? 1 : 0,
+                            trace_dump_meminfo_detail ? 1 : 0);
+        if(0 == r_trace) xc_jni_trace_inited = 1;
     }
+
+    //the others are done by nativeWarmUp() in a background thread
+    if(!warm_up_async) xc_jni_warm_up(0);
     
  clean:
     if(os_version        && c_os_version)        (*env)->ReleaseStringUTFChars(env, os_version,        c_os_version);
@@ -213,6 +264,16 @@ static jint xc_jni_init(JNIEnv       *env,
     return (0 == r_crash && 0 == r_trace) ? 0 : XCC_ERRNO_JNI;
 }
 
+static void xc_jni_warm_up_async(JNIEnv *env, jobject thiz)
+{
+    (void)env;
+    (void)thiz;
+
+    if(!xc_jni_inited) return;
+
+    xc_jni_warm_up(1);
+}
+
 static void xc_jni_notify_java_crashed(JNIEnv *env, jobject thiz)
 {
     (void)env;
@@ -221,6 +282,229 @@ static void xc_jni_notify_java_crashed(JNIEnv *env, jobject thiz)
     xc_common_java_crashed = 1;
 }
 
+static void xc_jni_append_breadcrumb(JNIEnv *env, jobject thiz, jstring msg)
+{
+    jchar  chars[XCC_BREADCRUMB_MSG_LEN];
+    char   buf[XCC_BREADCRUMB_MSG_LEN];
+    jsize  chars_len, i;
+    size_t len = 0;
+
+    (void)thiz;
+
+    if(NULL == msg) return;
+
+    //GetStringRegion() copies into our buffer without allocating memory
+    if((chars_len = (*env)->GetStringLength(env, msg)) > (jsize)XCC_BREADCRUMB_MSG_LEN)
+        chars_len = (jsize)XCC_BREADCRUMB_MSG_LEN;
+    (*env)->GetStringRegion(env, msg, 0, chars_len, chars);
+    if((*env)->ExceptionCheck(env))
+    {
+        (*env)->ExceptionClear(env);
+        return;
+    }
+
+    //UTF-16 to (modified) UTF-8, stop before the first char which can not fit in
+    for(i = 0; i < chars_len; i++)
+    {
+        jchar c = chars[i];
+        if(c > 0 && c < 0x80)
+        {
+            if(len + 1 >= sizeof(buf)) break;
+            buf[len++] = (char)c;
+        }
+        else if(c < 0x800)
+        {
+            if(len + 2 >= sizeof(buf)) break;
+            buf[len++] = (char)(0xc0 | (c >> 6));
+            buf[len++] = (char)(0x80 | (c & 0x3f));
+        }
+        else
+        {
+            if(len + 3 >= sizeof(buf)) break;
+            buf[len++] = (char)(0xe0 | (c >> 12));
+            buf[len++] = (char)(0x80 | ((c >> 6) & 0x3f));
+            buf[len++] = (char)(0x80 | (c & 0x3f));
+        }
+    }
+    buf[len] = '\0';
+
+    xc_breadcrumb_append(buf);
+}
+
+static jint xc_jni_record_logcat(JNIEnv *env, jobject thiz, jint fd, jint logcat_system_lines, jint logcat_events_lines, jint logcat_main_lines)
+{
+    (void)env;
+    (void)thiz;
+
+    if(fd < 0 || logcat_system_lines < 0 || logcat_events_lines < 0 || logcat_main_lines < 0) return XCC_ERRNO_INVAL;
+
+    return xcc_util_record_logcat((int)fd, xc_common_process_id, xc_common_api_level,
+                                  (unsigned int)logcat_system_lines, (unsigned int)logcat_events_lines, (unsigned int)logcat_main_lines);
+}
+
+static jint xc_jni_record_fds(JNIEnv *env, jobject thiz, jint fd)
+{
+    (void)env;
+    (void)thiz;
+
+    if(fd < 0) return XCC_ERRNO_INVAL;
+
+    return xcc_util_record_fds((int)fd, xc_common_process_id);
+}
+
+static jint xc_jni_record_network_info(JNIEnv *env, jobject thiz, jint fd)
+{
+    (void)env;
+    (void)thiz;
+
+    if(fd < 0) return XCC_ERRNO_INVAL;
+
+    return xcc_util_record_network_info((int)fd, xc_common_process_id, xc_common_api_level);
+}
+
+static jint xc_jni_record_meminfo(JNIEnv *env, jobject thiz, jint fd, jboolean dump_detail)
+{
+    (void)env;
+    (void)thiz;
+
+    if(fd < 0) return XCC_ERRNO_INVAL;
+
+    return xcc_meminfo_record((int)fd, xc_common_process_id, dump_detail ? 1 : 0);
+}
+
+static jint xc_jni_start_main_thread_watchdog(JNIEnv *env, jobject thiz, jint threshold_ms, jint interval_ms)
+{
+    (void)env;
+    (void)thiz;
+
+    if(threshold_ms <= 0 || interval_ms <= 0) return XCC_ERRNO_INVAL;
+
+    return xc_watchdog_start((unsigned int)threshold_ms, (unsigned int)interval_ms);
+}
+
+static void xc_jni_main_thread_stalled(JNIEnv *env, jobject thiz, jint stalled_ms)
+{
+    (void)env;
+    (void)thiz;
+
+    xc_watchdog_stalled(stalled_ms < 0 ? 0 : (unsigned int)stalled_ms);
+}
+
+static void xc_jni_main_thread_recovered(JNIEnv *env, jobject thiz)
+{
+    (void)env;
+    (void)thiz;
+
+    xc_watchdog_recovered();
+}
+
+static jint xc_jni_record_main_thread_samples(JNIEnv *env, jobject thiz, jint fd)
+{
+    (void)env;
+    (void)thiz;
+
+    if(fd < 0) return XCC_ERRNO_INVAL;
+
+    return xc_watchdog_record((int)fd);
+}
+
+static jint xc_jni_start_profiler(JNIEnv *env, jobject thiz, jint tid, jint interval_ms)
+{
+    (void)env;
+    (void)thiz;
+
+    if(tid < 0 || interval_ms <= 0) return XCC_ERRNO_INVAL;
+
+    return xc_profiler_start((pid_t)tid, (unsigned int)interval_ms);
+}
+
+static void xc_jni_stop_profiler(JNIEnv *env, jobject thiz)
+{
+    (void)env;
+    (void)thiz;
+
+    xc_profiler_stop();
+}
+
+static jint xc_jni_dump_other_threads(JNIEnv *env, jobject thiz, jint fd, jint count_max, jobjectArray whitelist)
+{
+    const char **c_whitelist = NULL;
+    size_t       c_whitelist_len = 0;
+    size_t       len, i;
+    jstring      tmp_str;
+    int          r;
+
+    (void)thiz;
+
+    if(fd < 0 || count_max < 0) return XCC_ERRNO_INVAL;
+
+    if(whitelist)
+    {
+        len = (size_t)(*env)->GetArrayLength(env, whitelist);
+        if(len > 0)
+        {
+            if(NULL != (c_whitelist = calloc(len, sizeof(char *))))
+            {
+                c_whitelist_len = len;
+                for(i = 0; i < len; i++)
+                {
+                    tmp_str = (jstring)((*env)->GetObjectArrayElement(env, whitelist, (jsize)i));
+                    c_whitelist[i] = (tmp_str ? (*env)->GetStringUTFChars(env, tmp_str, 0) : NULL);
+                }
+            }
+        }
+    }
+
+    r = xc_crash_dump_other_threads((int)fd, (unsigned int)count_max, c_whitelist, c_whitelist_len);
+
+    if(NULL != c_whitelist)
+    {
+        for(i = 0; i < c_whitelist_len; i++)
+        {
+            tmp_str = (jstring)((*env)->GetObjectArrayElement(env, whitelist, (jsize)i));
+            if(tmp_str && NULL != c_whitelist[i]) (*env)->ReleaseStringUTFChars(env, tmp_str, c_whitelist[i]);
+        }
+        free(c_whitelist);
+    }
+
+    return r;
+}
+
+static jstring xc_jni_dump_threads(JNIEnv *env, jobject thiz)
+{
+    char pathname[1024];
+
+    (void)thiz;
+
+    if(!xc_jni_crash_inited) return NULL;
+    if(0 != xc_crash_dump_threads(pathname, sizeof(pathname))) return NULL;
+
+    return (*env)->NewStringUTF(env, pathname);
+}
+
+static jint xc_jni_fill_placeholder(JNIEnv *env, jobject thiz, jstring pathname, jlong size)
+{
+    const char *c_pathname;
+    int         r;
+
+    (void)thiz;
+
+    if(NULL == pathname || size <= 0) return XCC_ERRNO_INVAL;
+    if(NULL == (c_pathname = (*env)->GetStringUTFChars(env, pathname, 0))) return XCC_ERRNO_JNI;
+    r = xc_placeholder_fill(c_pathname, (size_t)size);
+    (*env)->ReleaseStringUTFChars(env, pathname, c_pathname);
+
+    return r;
+}
+
+static void xc_jni_prepare_placeholder(JNIEnv *env, jobject thiz)
+{
+    (void)env;
+    (void)thiz;
+
+    xc_placeholder_prepare();
+}
+
 static void xc_jni_test_crash(JNIEnv *env, jobject thiz, jint run_in_new_thread)
 {
     (void)env;
@@ -250,12 +534,18 @@ static JNINativeMethod xc_jni_methods[] = {
         "I"
         "I"
         "Z"
+        "I"
+        "Z"
         "Z"
         "Z"
         "Z"
         "Z"
         "I"
         "[Ljava/lang/String;"
+        "I"
+        "Z"
+        "I"
+        "Z"
         "Z"
         "Z"
         "I"
@@ -263,10 +553,19 @@ static JNINativeMethod xc_jni_methods[] = {
         "I"
         "Z"
         "Z"
+        "Z"
+        "Z"
         ")"
         "I",
         (void *)xc_jni_init
     },
+    {
+        "nativeWarmUp",
+        "("
+        ")"
+        "V",
+        (void *)xc_jni_warm_up_async
+    },
     {
         "nativeNotifyJavaCrashed",
         "("
@@ -274,6 +573,131 @@ static JNINativeMethod xc_jni_methods[] = {
         "V",
         (void *)xc_jni_notify_java_crashed
     },
+    {
+        "nativeAppendBreadcrumb",
+        "("
+        "Ljava/lang/String;"
+        ")"
+        "V",
+        (void *)xc_jni_append_breadcrumb
+    },
+    {
+        "nativeRecordLogcat",
+        "("
+        "I"
+        "I"
+        "I"
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_record_logcat
+    },
+    {
+        "nativeRecordFds",
+        "("
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_record_fds
+    },
+    {
+        "nativeRecordNetworkInfo",
+        "("
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_record_network_info
+    },
+    {
+        "nativeRecordMemInfo",
+        "("
+        "I"
+        "Z"
+        ")"
+        "I",
+        (void *)xc_jni_record_meminfo
+    },
+    {
+        "nativeStartMainThreadWatchdog",
+        "("
+        "I"
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_start_main_thread_watchdog
+    },
+    {
+        "nativeMainThreadStalled",
+        "("
+        "I"
+        ")"
+        "V",
+        (void *)xc_jni_main_thread_stalled
+    },
+    {
+        "nativeMainThreadRecovered",
+        "("
+        ")"
+        "V",
+        (void *)xc_jni_main_thread_recovered
+    },
+    {
+        "nativeRecordMainThreadSamples",
+        "("
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_record_main_thread_samples
+    },
+    {
+        "nativeStartProfiler",
+        "("
+        "I"
+        "I"
+        ")"
+        "I",
+        (void *)xc_jni_start_profiler
+    },
+    {
+        "nativeStopProfiler",
+        "("
+        ")"
+        "V",
+        (void *)xc_jni_stop_profiler
+    },
+    {
+        "nativeDumpOtherThreads",
+        "("
+        "I"
+        "I"
+        "[Ljava/lang/String;"
+        ")"
+        "I",
+        (void *)xc_jni_dump_other_threads
+    },
+    {
+        "nativeDumpThreads",
+        "("
+        ")"
+        "Ljava/lang/String;",
+        (void *)xc_jni_dump_threads
+    },
+    {
+        "nativeFillPlaceholder",
+        "("
+        "Ljava/lang/String;"
+        "J"
+        ")"
+        "I",
+        (void *)xc_jni_fill_placeholder
+    },
+    {
+        "nativePreparePlaceholder",
+        "("
+        ")"
+        "V",
+        (void *)xc_jni_prepare_placeholder
+    },
     {
         "nativeTestCrash",
         "("
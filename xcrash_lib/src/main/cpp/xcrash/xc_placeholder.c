@@ -0,0 +1,198 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "xcc_errno.h"
+#include "xcc_fmt.h"
+#include "xcc_util.h"
+#include "xc_placeholder.h"
+#include "xc_common.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+#pragma clang diagnostic ignored "-Wcast-align"
+
+#define XC_PLACEHOLDER_OPEN_FLAGS     (O_RDWR | O_CLOEXEC)
+#define XC_PLACEHOLDER_OPEN_DIR_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#define XC_PLACEHOLDER_MODE           (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) //644
+
+//slot state, only the owner of the slot can change it: FREE and READY are owned by the prepare thread,
+//READY -> TAKEN is done by the crash handler, a taken slot is never rewritten
+#define XC_PLACEHOLDER_SLOT_FREE  0
+#define XC_PLACEHOLDER_SLOT_READY 1
+#define XC_PLACEHOLDER_SLOT_TAKEN 2
+
+#define XC_PLACEHOLDER_SLOTS_NUM  2
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    int  state;
+    int  fd;
+    char pathname[1024];
+} xc_placeholder_slot_t;
+#pragma clang diagnostic pop
+
+static xc_placeholder_slot_t xc_placeholder_slots[XC_PLACEHOLDER_SLOTS_NUM];
+static pthread_mutex_t       xc_placeholder_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//fallocate() is only available in bionic since API level 21
+static int xc_placeholder_fallocate(int fd, size_t len)
+{
+#if defined(__LP64__)
+    return (int)syscall(SYS_fallocate, fd, 0, (off_t)0, (off_t)len);
+#else
+    //64-bit offset and length are passed by register pairs (low word first)
+    return (int)syscall(SYS_fallocate, fd, 0, 0, 0, (uint32_t)len, 0);
+#endif
+}
+
+int xc_placeholder_fill(const char *pathname, size_t size)
+{
+    int fd;
+    int r = 0;
+
+    if(NULL == pathname || 0 == size) return XCC_ERRNO_INVAL;
+
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, XC_PLACEHOLDER_OPEN_FLAGS | O_CREAT, XC_PLACEHOLDER_MODE))))
+        return XCC_ERRNO_SYS;
+
+    //drop the dirty blocks, then reserve the space again in one syscall,
+    //the reserved (unwritten) blocks are read as zeros
+    if(0 != XCC_UTIL_TEMP_FAILURE_RETRY(ftruncate(fd, 0)))
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+    if(0 != XCC_UTIL_TEMP_FAILURE_RETRY(xc_placeholder_fallocate(fd, size)))
+    {
+        //maybe not supported by the filesystem, the caller should fill it with zeros
+        r = (EOPNOTSUPP == errno ? XCC_ERRNO_NOTSPT : XCC_ERRNO_SYS);
+        goto end;
+    }
+
+ end:
+    close(fd);
+    return r;
+}
+
+//open a clean placeholder file in advance, so no directory scan is needed at crash time
+void xc_placeholder_prepare(void)
+{
+    char                   dir[1024];
+    char                   buf[512];
+    long                   n, i;
+    int                    dir_fd, fd, state;
+    size_t                 j;
+    xcc_util_dirent_t     *ent;
+    xc_placeholder_slot_t *slot = NULL;
+
+    if(NULL == xc_common_log_dir) return;
+    if(xc_common_native_crashed) return;
+
+    pthread_mutex_lock(&xc_placeholder_lock);
+
+    //release the prepared one (unless it has just been taken), and find a free slot
+    for(j = 0; j < XC_PLACEHOLDER_SLOTS_NUM; j++)
+    {
+        state = XC_PLACEHOLDER_SLOT_READY;
+        if(__atomic_compare_exchange_n(&(xc_placeholder_slots[j].state), &state, XC_PLACEHOLDER_SLOT_FREE,
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            close(xc_placeholder_slots[j].fd);
+            xc_placeholder_slots[j].fd = -1;
+            state = XC_PLACEHOLDER_SLOT_FREE;
+        }
+        if(NULL == slot && XC_PLACEHOLDER_SLOT_FREE == state) slot = &(xc_placeholder_slots[j]);
+    }
+    if(NULL == slot) goto end;
+
+    xcc_fmt_snprintf(dir, sizeof(dir), "%s/"XC_COMMON_PLACEHOLDER_DIR, xc_common_log_dir);
+    if(0 > (dir_fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(dir, XC_PLACEHOLDER_OPEN_DIR_FLAGS)))) goto end;
+
+    while((n = syscall(XCC_UTIL_SYSCALL_GETDENTS, dir_fd, buf, sizeof(buf))) > 0)
+    {
+        for(i = 0; i < n; i += ent->d_reclen)
+        {
+            ent = (xcc_util_dirent_t *)(buf + i);
+
+            // placeholder_01234567890123456789.clean.xcrash
+            if(45 == strlen(ent->d_name) &&
+               0 == memcmp(ent->d_name, XC_COMMON_PLACEHOLDER_PREFIX"_", 12) &&
+               0 == memcmp(ent->d_name + 32, XC_COMMON_PLACEHOLDER_SUFFIX, 13))
+            {
+                xcc_fmt_snprintf(slot->pathname, sizeof(slot->pathname), "%s/%s", dir, ent->d_name);
+                if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(slot->pathname, XC_PLACEHOLDER_OPEN_FLAGS)))) continue;
+
+                //publish
+                slot->fd = fd;
+                __atomic_store_n(&(slot->state), XC_PLACEHOLDER_SLOT_READY, __ATOMIC_RELEASE);
+                close(dir_fd);
+                goto end;
+            }
+        }
+    }
+    close(dir_fd);
+
+ end:
+    pthread_mutex_unlock(&xc_placeholder_lock);
+}
+
+//async-signal-safe, return the fd of the placeholder file which has been renamed to pathname
+int xc_placeholder_take(const char *pathname)
+{
+    xc_placeholder_slot_t *slot = NULL;
+    size_t                 i;
+    int                    state;
+
+    for(i = 0; i < XC_PLACEHOLDER_SLOTS_NUM; i++)
+    {
+        state = XC_PLACEHOLDER_SLOT_READY;
+        if(__atomic_compare_exchange_n(&(xc_placeholder_slots[i].state), &state, XC_PLACEHOLDER_SLOT_TAKEN,
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            slot = &(xc_placeholder_slots[i]);
+            break;
+        }
+    }
+    if(NULL == slot) return -1;
+
+    //the placeholder file may have been taken by another process or removed by the file manager
+    if(0 != rename(slot->pathname, pathname))
+    {
+        close(slot->fd);
+        return -1;
+    }
+
+    return slot->fd;
+}
+
+#pragma clang diagnostic pop
@@ -0,0 +1,477 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_regs.h"
+#include "xcd_maps.h"
+#include "xcd_frames.h"
+#include "xcd_util.h"
+#include "xc_profiler.h"
+#include "xc_common.h"
+
+#define XC_PROFILER_SIGNAL             (SIGRTMAX - 4)
+#define XC_PROFILER_INTERVAL_MIN       5    //ms
+#define XC_PROFILER_SAMPLE_TIMEOUT     20   //ms
+#define XC_PROFILER_BUDGET_PERCENT     3    //max percentage of the wall time spent on sampling and unwinding
+#define XC_PROFILER_STACK_SIZE         (16 * 1024) //stack snapshot taken in the signal handler
+#define XC_PROFILER_IOVS_MAX           16
+#define XC_PROFILER_STACKS_MAX         1024 //distinct folded stacks in each flush window
+#define XC_PROFILER_STACKS_SLOTS       (XC_PROFILER_STACKS_MAX * 2)
+#define XC_PROFILER_FOLDED_LEN         2048
+#define XC_PROFILER_FLUSH_INTERVAL     10000 //ms
+#define XC_PROFILER_MAPS_RELOAD_MIN    5000  //ms
+#define XC_PROFILER_MAPS_RELOAD_MAX    16    //the ELF objects of the old maps are leaked, so limit the reloading
+#define XC_PROFILER_FILE_NAME          "native_profile.folded"
+#define XC_PROFILER_FILE_SIZE_MAX      (512 * 1024)
+
+#define XC_PROFILER_FNV_OFFSET         0xcbf29ce484222325ULL
+#define XC_PROFILER_FNV_PRIME          0x100000001b3ULL
+
+#define XC_PROFILER_STATE_IDLE         0
+#define XC_PROFILER_STATE_PENDING      1
+#define XC_PROFILER_STATE_RUNNING      2
+#define XC_PROFILER_STATE_DONE         3
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    xcd_regs_t regs;
+    uintptr_t  stack_base;
+    size_t     stack_len;
+    uint8_t    stack[XC_PROFILER_STACK_SIZE];
+} xc_profiler_sample_t;
+
+typedef struct
+{
+    uint64_t  hash;
+    char     *folded; //NULL means the slot is empty
+    size_t    count;
+} xc_profiler_stack_t;
+
+typedef struct
+{
+    uint64_t start;      //ms
+    size_t   samples;    //unwound and aggregated
+    size_t   skipped;    //not taken because of the CPU budget
+    size_t   dropped;    //the target thread did not respond in time
+    size_t   overflowed; //the stack table is full
+    uint64_t cost;       //us, signal handler + unwinding
+} xc_profiler_window_t;
+#pragma clang diagnostic pop
+
+static int                   xc_profiler_started = 0;
+static int                   xc_profiler_stopping = 0;
+static int                   xc_profiler_signal_registered = 0;
+static pthread_t             xc_profiler_thd;
+static pid_t                 xc_profiler_tid;
+static unsigned int          xc_profiler_interval;
+static size_t                xc_profiler_page_size;
+static char                  xc_profiler_pathname[1024];
+
+//written by the target thread's signal handler
+static xc_profiler_sample_t  xc_profiler_sample;
+static int                   xc_profiler_sample_state = XC_PROFILER_STATE_IDLE;
+static uint64_t              xc_profiler_sample_cost = 0; //us
+
+//only accessed by the profiler thread
+static xc_profiler_stack_t   xc_profiler_stacks[XC_PROFILER_STACKS_SLOTS];
+static size_t                xc_profiler_stacks_num = 0;
+static xc_profiler_window_t  xc_profiler_window;
+static char                  xc_profiler_folded[XC_PROFILER_FOLDED_LEN];
+
+static uint64_t xc_profiler_get_time_us(void)
+{
+    struct timespec ts;
+
+    if(0 != clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+    return (uint64_t)ts.tv_sec * 1000 * 1000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t xc_profiler_get_thread_cpu_time_us(void)
+{
+    struct timespec ts;
+
+    if(0 != clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) return 0;
+    return (uint64_t)ts.tv_sec * 1000 * 1000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void xc_profiler_sleep_ms(unsigned int ms)
+{
+    struct timespec ts = {.tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000 * 1000};
+
+    while(0 != nanosleep(&ts, &ts))
+        if(EINTR != errno) break;
+}
+
+//read our own memory without faulting, async-signal-safe
+static size_t xc_profiler_read_self(uintptr_t addr, void *dst, size_t len)
+{
+    struct iovec local_iov;
+    struct iovec remote_iovs[XC_PROFILER_IOVS_MAX];
+    size_t       iovs_num, chunk, total = 0, requested;
+    uintptr_t    cur;
+    ssize_t      n;
+
+    while(len > 0)
+    {
+        //split the remote range by pages, so that an unreadable page only truncates the result
+        cur = addr;
+        requested = 0;
+        for(iovs_num = 0; iovs_num < XC_PROFILER_IOVS_MAX && requested < len; iovs_num++)
+        {
+            chunk = xc_profiler_page_size - (cur & (xc_profiler_page_size - 1));
+            if(chunk > len - requested) chunk = len - requested;
+            remote_iovs[iovs_num].iov_base = (void *)cur;
+            remote_iovs[iovs_num].iov_len = chunk;
+            cur += chunk;
+            requested += chunk;
+        }
+        local_iov.iov_base = dst;
+        local_iov.iov_len = requested;
+
+        n = syscall(SYS_process_vm_readv, xc_common_process_id, &local_iov, 1, remote_iovs, iovs_num, 0);
+        if(n <= 0) break;
+        total += (size_t)n;
+        if((size_t)n < requested) break;
+
+        addr += requested;
+        dst = (void *)((uint8_t *)dst + requested);
+        len -= requested;
+    }
+
+    return total;
+}
+
+//the local memory backend of the unwinder: the stack snapshot first, then the live memory
+static size_t xc_profiler_read(pid_t pid, uintptr_t addr, void *dst, size_t len)
+{
+    xc_profiler_sample_t *sample = &xc_profiler_sample;
+    size_t                n;
+
+    (void)pid;
+
+    if(addr >= sample->stack_base && addr - sample->stack_base < sample->stack_len)
+    {
+        n = sample->stack_len - (addr - sample->stack_base);
+        if(n > len) n = len;
+        memcpy(dst, sample->stack + (addr - sample->stack_base), n);
+        if(n == len) return n;
+        return n + xc_profiler_read_self(addr + n, (uint8_t *)dst + n, len - n);
+    }
+
+    return xc_profiler_read_self(addr, dst, len);
+}
+
+//run on the target thread, async-signal-safe, no lock and no memory allocation
+static void xc_profiler_signal_handler(int sig, siginfo_t *si, void *uc)
+{
+    int                   errno_saved = errno;
+    int                   state = XC_PROFILER_STATE_PENDING;
+    xc_profiler_sample_t *sample = &xc_profiler_sample;
+    uint64_t              start;
+
+    (void)sig;
+
+    if(SI_TKILL != si->si_code || xc_common_process_id != si->si_pid) goto end;
+    if(!__atomic_compare_exchange_n(&xc_profiler_sample_state, &state, XC_PROFILER_STATE_RUNNING,
+                                    0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) goto end;
+
+    start = xc_profiler_get_time_us();
+    xcd_regs_load_from_ucontext(&(sample->regs), (ucontext_t *)uc);
+    sample->stack_base = xcd_regs_get_sp(&(sample->regs));
+    sample->stack_len = xc_profiler_read_self(sample->stack_base, sample->stack, sizeof(sample->stack));
+    xc_profiler_sample_cost = xc_profiler_get_time_us() - start;
+
+    __atomic_store_n(&xc_profiler_sample_state, XC_PROFILER_STATE_DONE, __ATOMIC_RELEASE);
+
+ end:
+    errno = errno_saved;
+}
+
+static int xc_profiler_take_sample(void)
+{
+    int          state;
+    unsigned int waited = 0;
+
+    __atomic_store_n(&xc_profiler_sample_state, XC_PROFILER_STATE_PENDING, __ATOMIC_RELEASE);
+
+    if(0 != syscall(SYS_tgkill, xc_common_process_id, xc_profiler_tid, XC_PROFILER_SIGNAL))
+    {
+        __atomic_store_n(&xc_profiler_sample_state, XC_PROFILER_STATE_IDLE, __ATOMIC_RELEASE);
+        return XCC_ERRNO_SYS;
+    }
+
+    //wait for the signal handler
+    while(XC_PROFILER_STATE_DONE != (state = __atomic_load_n(&xc_profiler_sample_state, __ATOMIC_ACQUIRE)))
+    {
+        if(XC_PROFILER_STATE_PENDING == state && waited >= XC_PROFILER_SAMPLE_TIMEOUT) goto abandon;
+        xc_profiler_sleep_ms(1);
+        waited++;
+    }
+
+    __atomic_store_n(&xc_profiler_sample_state, XC_PROFILER_STATE_IDLE, __ATOMIC_RELEASE);
+    return 0;
+
+ abandon:
+    //the signal handler has not started yet, it will ignore the pending signal
+    state = XC_PROFILER_STATE_PENDING;
+    if(__atomic_compare_exchange_n(&xc_profiler_sample_state, &state, XC_PROFILER_STATE_IDLE,
+                                   0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return XCC_ERRNO_STATE;
+
+    //the signal handler is running, it will finish soon
+    while(XC_PROFILER_STATE_DONE != __atomic_load_n(&xc_profiler_sample_state, __ATOMIC_ACQUIRE))
+        xc_profiler_sleep_ms(1);
+    __atomic_store_n(&xc_profiler_sample_state, XC_PROFILER_STATE_IDLE, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void xc_profiler_aggregate(const char *folded)
+{
+    const char *c;
+    uint64_t    hash = XC_PROFILER_FNV_OFFSET;
+    size_t      i;
+
+    for(c = folded; '\0' != *c; c++)
+    {
+        hash ^= (uint8_t)(*c);
+        hash *= XC_PROFILER_FNV_PRIME;
+    }
+
+    //open addressing, the table is never more than half full
+    for(i = (size_t)(hash % XC_PROFILER_STACKS_SLOTS); NULL != xc_profiler_stacks[i].folded; i = (i + 1) % XC_PROFILER_STACKS_SLOTS)
+    {
+        if(hash == xc_profiler_stacks[i].hash && 0 == strcmp(folded, xc_profiler_stacks[i].folded))
+        {
+            xc_profiler_stacks[i].count++;
+            xc_profiler_window.samples++;
+            return;
+        }
+    }
+
+    if(xc_profiler_stacks_num >= XC_PROFILER_STACKS_MAX || NULL == (xc_profiler_stacks[i].folded = strdup(folded)))
+    {
+        xc_profiler_window.overflowed++;
+        return;
+    }
+    xc_profiler_stacks[i].hash = hash;
+    xc_profiler_stacks[i].count = 1;
+    xc_profiler_stacks_num++;
+    xc_profiler_window.samples++;
+}
+
+static void xc_profiler_unwind(xcd_maps_t **maps, uint64_t now, uint64_t *maps_time, size_t *maps_reloaded)
+{
+    xcd_frames_t *frames = NULL;
+    xcd_maps_t   *new_maps = NULL;
+
+    //the pc is in a newly loaded library
+    if(NULL == xcd_maps_find_map(*maps, xcd_regs_get_pc(&(xc_profiler_sample.regs))) &&
+       now - *maps_time >= XC_PROFILER_MAPS_RELOAD_MIN && *maps_reloaded < XC_PROFILER_MAPS_RELOAD_MAX)
+    {
+        *maps_time = now;
+        (*maps_reloaded)++;
+        if(0 == xcd_maps_create(&new_maps, xc_common_process_id))
+        {
+            xcd_maps_destroy(maps);
+            *maps = new_maps;
+        }
+        else if(NULL != new_maps)
+        {
+            xcd_maps_destroy(&new_maps);
+        }
+    }
+
+    if(0 != xcd_frames_create(&frames, &(xc_profiler_sample.regs), *maps, xc_common_process_id, 0)) return;
+    if(0 < xcd_frames_get_folded(frames, xc_profiler_folded, sizeof(xc_profiler_folded)))
+        xc_profiler_aggregate(xc_profiler_folded);
+    else
+        xc_profiler_window.dropped++;
+    xcd_frames_destroy(&frames);
+}
+
+static void xc_profiler_flush(uint64_t now)
+{
+    xc_profiler_stack_t *stack;
+    xc_profiler_window_t window = xc_profiler_window;
+    char                 pathname[1024 + 8];
+    struct stat          st;
+    uint64_t             duration = now - window.start;
+    uint64_t             overhead; //0.01%
+    size_t               i;
+    int                  fd = -1;
+
+    //rotate
+    if(0 == stat(xc_profiler_pathname, &st) && st.st_size >= XC_PROFILER_FILE_SIZE_MAX)
+    {
+        snprintf(pathname, sizeof(pathname), "%s.1", xc_profiler_pathname);
+        rename(xc_profiler_pathname, pathname);
+    }
+
+    overhead = (0 == duration ? 0 : window.cost * 10 / duration);
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(xc_profiler_pathname, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)))) goto end;
+    if(0 != xcc_util_write_format(fd, "# pid: %d, tid: %d, interval: %u ms, duration: %"PRIu64" ms, "
+                                      "samples: %zu, skipped: %zu, dropped: %zu, overflowed: %zu, "
+                                      "overhead: %"PRIu64".%02"PRIu64"%% (budget: %d%%)\n",
+                                  xc_common_process_id, xc_profiler_tid, xc_profiler_interval, duration,
+                                  window.samples, window.skipped, window.dropped, window.overflowed,
+                                  overhead / 100, overhead % 100, XC_PROFILER_BUDGET_PERCENT)) goto end;
+    for(i = 0; i < XC_PROFILER_STACKS_SLOTS; i++)
+    {
+        stack = &(xc_profiler_stacks[i]);
+        if(NULL == stack->folded) continue;
+        if(0 != xcc_util_write_format(fd, "%s %zu\n", stack->folded, stack->count)) goto end;
+    }
+
+ end:
+    if(fd >= 0) close(fd);
+
+    //start a new window
+    for(i = 0; i < XC_PROFILER_STACKS_SLOTS; i++)
+    {
+        if(NULL != xc_profiler_stacks[i].folded) free(xc_profiler_stacks[i].folded);
+        xc_profiler_stacks[i].folded = NULL;
+    }
+    xc_profiler_stacks_num = 0;
+    memset(&xc_profiler_window, 0, sizeof(xc_profiler_window));
+    xc_profiler_window.start = now;
+}
+
+static void *xc_profiler_thread(void *arg)
+{
+    xcd_maps_t *maps = NULL;
+    uint64_t    maps_time, now, cpu_start;
+    size_t      maps_reloaded = 0;
+
+    (void)arg;
+
+    pthread_setname_np(pthread_self(), "xcrash_profiler");
+
+    if(0 != xcd_maps_create(&maps, xc_common_process_id))
+    {
+        if(NULL != maps) xcd_maps_destroy(&maps);
+        return NULL;
+    }
+    xcd_util_set_remote_read(xc_profiler_read);
+
+    maps_time = xc_profiler_get_time_us() / 1000;
+    memset(&xc_profiler_window, 0, sizeof(xc_profiler_window));
+    xc_profiler_window.start = maps_time;
+
+    while(!__atomic_load_n(&xc_profiler_stopping, __ATOMIC_ACQUIRE))
+    {
+        xc_profiler_sleep_ms(xc_profiler_interval);
+
+        //check if process already crashed
+        if(xc_common_native_crashed || xc_common_java_crashed) break;
+
+        now = xc_profiler_get_time_us() / 1000;
+        if(now - xc_profiler_window.start >= XC_PROFILER_FLUSH_INTERVAL) xc_profiler_flush(now);
+
+        //CPU budget
+        if(xc_profiler_window.cost * 100 > (now - xc_profiler_window.start) * 1000 * XC_PROFILER_BUDGET_PERCENT)
+        {
+            xc_profiler_window.skipped++;
+            continue;
+        }
+
+        cpu_start = xc_profiler_get_thread_cpu_time_us();
+        if(0 != xc_profiler_take_sample())
+        {
+            //the target thread has exited
+            if(0 != syscall(SYS_tgkill, xc_common_process_id, xc_profiler_tid, 0)) break;
+            xc_profiler_window.dropped++;
+            continue;
+        }
+        xc_profiler_unwind(&maps, now, &maps_time, &maps_reloaded);
+        xc_profiler_window.cost += xc_profiler_sample_cost + (xc_profiler_get_thread_cpu_time_us() - cpu_start);
+    }
+
+    xc_profiler_flush(xc_profiler_get_time_us() / 1000);
+    xcd_util_set_remote_read(NULL);
+    xcd_maps_destroy(&maps);
+    return NULL;
+}
+
+int xc_profiler_start(pid_t tid, unsigned int interval_ms)
+{
+    struct sigaction act;
+    struct sigaction oldact;
+    int              r;
+
+    if(__atomic_load_n(&xc_profiler_started, __ATOMIC_ACQUIRE)) return XCC_ERRNO_STATE;
+    if(NULL == xc_common_log_dir) return XCC_ERRNO_STATE;
+
+    //the main thread by default
+    xc_profiler_tid = (0 == tid ? xc_common_process_id : tid);
+    if(0 != syscall(SYS_tgkill, xc_common_process_id, xc_profiler_tid, 0)) return XCC_ERRNO_INVAL;
+    xc_profiler_interval = (interval_ms < XC_PROFILER_INTERVAL_MIN ? XC_PROFILER_INTERVAL_MIN : interval_ms);
+    xc_profiler_page_size = (size_t)sysconf(_SC_PAGE_SIZE);
+    snprintf(xc_profiler_pathname, sizeof(xc_profiler_pathname), "%s/"XC_PROFILER_FILE_NAME, xc_common_log_dir);
+
+    if(!xc_profiler_signal_registered)
+    {
+        //do not take over the signal from others
+        if(0 != sigaction(XC_PROFILER_SIGNAL, NULL, &oldact)) return XCC_ERRNO_SYS;
+        if((oldact.sa_flags & SA_SIGINFO) || SIG_DFL != oldact.sa_handler) return XCC_ERRNO_STATE;
+
+        memset(&act, 0, sizeof(act));
+        sigfillset(&act.sa_mask);
+        act.sa_sigaction = xc_profiler_signal_handler;
+        act.sa_flags = SA_RESTART | SA_SIGINFO | SA_ONSTACK;
+        if(0 != sigaction(XC_PROFILER_SIGNAL, &act, NULL)) return XCC_ERRNO_SYS;
+        xc_profiler_signal_registered = 1;
+    }
+
+    __atomic_store_n(&xc_profiler_stopping, 0, __ATOMIC_RELEASE);
+    if(0 != (r = pthread_create(&xc_profiler_thd, NULL, xc_profiler_thread, NULL))) return r;
+
+    __atomic_store_n(&xc_profiler_started, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void xc_profiler_stop(void)
+{
+    if(!__atomic_load_n(&xc_profiler_started, __ATOMIC_ACQUIRE)) return;
+
+    //wait for the last flush
+    __atomic_store_n(&xc_profiler_stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(xc_profiler_thd, NULL);
+
+    __atomic_store_n(&xc_profiler_started, 0, __ATOMIC_RELEASE);
+}
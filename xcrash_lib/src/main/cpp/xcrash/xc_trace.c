@@ -41,6 +41,7 @@
 #include "xcc_version.h"
 #include "xc_trace.h"
 #include "xc_common.h"
+#include "xc_watchdog.h"
 #include "xc_dl.h"
 #include "xc_jni.h"
 #include "xc_util.h"
@@ -71,6 +72,7 @@ static xcc_util_libart_runtime_dump_t   xc_trace_libart_runtime_dump = NULL;
 static xcc_util_libart_dbg_suspend_t    xc_trace_libart_dbg_suspend = NULL;
 static xcc_util_libart_dbg_resume_t     xc_trace_libart_dbg_resume = NULL;
 static int                              xc_trace_symbols_loaded = 0;
+static int                              xc_trace_preload_symbols = 0;
 static int                              xc_trace_symbols_status = XCC_ERRNO_NOTFND;
 
 //init parameters
@@ -80,6 +82,7 @@ static unsigned int                     xc_trace_logcat_events_lines;
 static unsigned int                     xc_trace_logcat_main_lines;
 static int                              xc_trace_dump_fds;
 static int                              xc_trace_dump_network_info;
+static int                              xc_trace_dump_meminfo_detail;
 
 //callback
 static jmethodID                        xc_trace_fast_cb_method = NULL;
@@ -311,6 +314,9 @@ static void *xc_trace_dumper(void *arg)
     };
     if(JNI_OK != (*xc_common_vm)->AttachCurrentThread(xc_common_vm, &env, &attach_args)) goto exit;
 
+    //load the symbols before any SIGQUIT, when warming up in background
+    if(xc_trace_preload_symbols) xc_trace_load_symbols();
+
     while(1)
     {
         //block here, waiting for sigquit
@@ -375,13 +381,16 @@ static void *xc_trace_dumper(void *arg)
     skip:
         if(0 != xcc_util_write_str(fd, "\n"XCC_UTIL_THREAD_END"\n")) goto end;
 
+        //write main thread samples before the ANR
+        if(0 != xc_watchdog_record(fd)) goto end;
+
         //write other info
         if(0 != xcc_util_record_logcat(fd, xc_common_process_id, xc_common_api_level, xc_trace_logcat_system_lines, xc_trace_logcat_events_lines, xc_trace_logcat_main_lines)) goto end;
         if(xc_trace_dump_fds)
             if(0 != xcc_util_record_fds(fd, xc_common_process_id)) goto end;
         if(xc_trace_dump_network_info)
             if(0 != xcc_util_record_network_info(fd, xc_common_process_id, xc_common_api_level)) goto end;
-        if(0 != xcc_meminfo_record(fd, xc_common_process_id)) goto end;
+        if(0 != xcc_meminfo_record(fd, xc_common_process_id, xc_trace_dump_meminfo_detail)) goto end;
 
     end:
         //close log file
@@ -445,10 +454,10 @@ int xc_trace_init(JNIEnv *env,
                   unsigned int logcat_events_lines,
                   unsigned int logcat_main_lines,
                   int dump_fds,
-                  int dump_network_info)
+                  int dump_network_info,
+                  int dump_meminfo_detail)
 {
     int r;
-    pthread_t thd;
 
     //capture SIGQUIT only for ART
     if(xc_common_api_level < 21) return 0;
@@ -463,6 +472,7 @@ int xc_trace_init(JNIEnv *env,
     xc_trace_logcat_main_lines = logcat_main_lines;
     xc_trace_dump_fds = dump_fds;
     xc_trace_dump_network_info = dump_network_info;
+    xc_trace_dump_meminfo_detail = dump_meminfo_detail;
 
     //init for JNI callback
     xc_trace_init_callback(env);
@@ -470,21 +480,36 @@ int xc_trace_init(JNIEnv *env,
     //create event FD
     if(0 > (xc_trace_notifier = eventfd(0, EFD_CLOEXEC))) return XCC_ERRNO_SYS;
 
-    //register signal handler
-    if(0 != (r = xcc_signal_trace_register(xc_trace_handler))) goto err2;
+    //register signal handler (SIGQUIT is queued in the event FD until the dumper thread starts)
+    if(0 != (r = xcc_signal_trace_register(xc_trace_handler)))
+    {
+        close(xc_trace_notifier);
+        xc_trace_notifier = -1;
+    }
+    
+    return r;
+}
+
+int xc_trace_warm_up(int preload_symbols)
+{
+    int r;
+    pthread_t thd;
+
+    if(xc_trace_notifier < 0) return 0;
+
+    xc_trace_preload_symbols = preload_symbols;
 
     //create thread for dump trace
-    if(0 != (r = pthread_create(&thd, NULL, xc_trace_dumper, NULL))) goto err1;
+    if(0 != (r = pthread_create(&thd, NULL, xc_trace_dumper, NULL)))
+    {
+        //nobody would forward SIGQUIT to ART
+        xcc_signal_trace_unregister();
+        close(xc_trace_notifier);
+        xc_trace_notifier = -1;
+        return r;
+    }
 
     return 0;
-
- err1:
-    xcc_signal_trace_unregister();
- err2:
-    close(xc_trace_notifier);
-    xc_trace_notifier = -1;
-    
-    return r;
 }
 
 #pragma clang diagnostic pop
@@ -49,7 +49,10 @@ int xc_trace_init(JNIEnv *env,
                   unsigned int logcat_events_lines,
                   unsigned int logcat_main_lines,
                   int dump_fds,
-                  int dump_network_info);
+                  int dump_network_info,
+                  int dump_meminfo_detail);
+
+int xc_trace_warm_up(int preload_symbols);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,410 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <ucontext.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcc_unwind_fp.h"
+#include "xc_watchdog.h"
+#include "xc_common.h"
+
+#define XC_WATCHDOG_SIGNAL          (SIGRTMAX - 3)
+#define XC_WATCHDOG_SAMPLES_MAX     64
+#define XC_WATCHDOG_FRAMES_MAX      32
+#define XC_WATCHDOG_INTERVAL_MIN    10   //ms
+#define XC_WATCHDOG_SAMPLE_TIMEOUT  20   //ms
+#define XC_WATCHDOG_BUDGET_PERCENT  2    //max percentage of the stall time spent on sampling the main thread
+#define XC_WATCHDOG_FOLDED_LEN      2048
+
+#define XC_WATCHDOG_STATE_IDLE      0
+#define XC_WATCHDOG_STATE_PENDING   1
+#define XC_WATCHDOG_STATE_RUNNING   2
+#define XC_WATCHDOG_STATE_DONE      3
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    uint64_t  seq; //index + 1 when the sample is completed, 0 means not ready
+    uint64_t  time;
+    size_t    frames_num;
+    uintptr_t pcs[XC_WATCHDOG_FRAMES_MAX];
+} xc_watchdog_sample_t;
+#pragma clang diagnostic pop
+
+static int                   xc_watchdog_started = 0;
+static unsigned int          xc_watchdog_threshold;
+static unsigned int          xc_watchdog_interval;
+static uintptr_t             xc_watchdog_stack_low;
+static uintptr_t             xc_watchdog_stack_high;
+
+//the watchdog thread waits here while the main looper is responsive, so it never wakes up periodically
+static int                   xc_watchdog_stalling = 0;
+static pthread_mutex_t       xc_watchdog_stall_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t        xc_watchdog_stall_cond = PTHREAD_COND_INITIALIZER;
+
+//the ring buffer of samples, written by the main thread's signal handler
+static xc_watchdog_sample_t  xc_watchdog_samples[XC_WATCHDOG_SAMPLES_MAX];
+static uint64_t              xc_watchdog_samples_next = 0;
+static xc_watchdog_sample_t *xc_watchdog_sample_target = NULL;
+static int                   xc_watchdog_sample_state = XC_WATCHDOG_STATE_IDLE;
+static uint64_t              xc_watchdog_sample_cost = 0; //us
+
+//the last stall, 0 means never stalled / still stalling
+static uint64_t              xc_watchdog_stall_start = 0; //ms
+static uint64_t              xc_watchdog_stall_end = 0; //ms
+
+static uint64_t xc_watchdog_get_time_us(void)
+{
+    struct timespec ts;
+
+    if(0 != clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+    return (uint64_t)ts.tv_sec * 1000 * 1000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void xc_watchdog_sleep_ms(unsigned int ms)
+{
+    struct timespec ts = {.tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)(ms % 1000) * 1000 * 1000};
+
+    while(0 != nanosleep(&ts, &ts))
+        if(EINTR != errno) break;
+}
+
+static int xc_watchdog_load_stack_range(void)
+{
+    FILE      *fp;
+    char       line[512];
+    uintptr_t  low, high;
+    int        r = XCC_ERRNO_NOTFND;
+
+    //the main thread's stack
+    if(NULL == (fp = fopen("/proc/self/maps", "r"))) return XCC_ERRNO_SYS;
+    while(fgets(line, sizeof(line), fp))
+    {
+        if(NULL == strstr(line, "[stack]")) continue;
+        if(2 != sscanf(line, "%"SCNxPTR"-%"SCNxPTR, &low, &high)) break;
+        xc_watchdog_stack_low = low;
+        xc_watchdog_stack_high = high;
+        r = 0;
+        break;
+    }
+    fclose(fp);
+    return r;
+}
+
+//run on the main thread, async-signal-safe, no lock and no memory allocation
+static void xc_watchdog_signal_handler(int sig, siginfo_t *si, void *uc)
+{
+    int                   errno_saved = errno;
+    int                   state = XC_WATCHDOG_STATE_PENDING;
+    xc_watchdog_sample_t *sample;
+    uint64_t              start;
+
+    (void)sig;
+
+    if(SI_TKILL != si->si_code || xc_common_process_id != si->si_pid) goto end;
+    if(!__atomic_compare_exchange_n(&xc_watchdog_sample_state, &state, XC_WATCHDOG_STATE_RUNNING,
+                                    0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) goto end;
+
+    start = xc_watchdog_get_time_us();
+    sample = __atomic_load_n(&xc_watchdog_sample_target, __ATOMIC_ACQUIRE);
+    sample->frames_num = xcc_unwind_fp_get_pcs((ucontext_t *)uc, xc_watchdog_stack_low, xc_watchdog_stack_high,
+                                               sample->pcs, XC_WATCHDOG_FRAMES_MAX, NULL);
+    xc_watchdog_sample_cost = xc_watchdog_get_time_us() - start;
+
+    __atomic_store_n(&xc_watchdog_sample_state, XC_WATCHDOG_STATE_DONE, __ATOMIC_RELEASE);
+
+ end:
+    errno = errno_saved;
+}
+
+static void xc_watchdog_take_sample(uint64_t now_ms, uint64_t *cost)
+{
+    xc_watchdog_sample_t *sample;
+    uint64_t              idx = xc_watchdog_samples_next; //only written by the watchdog thread
+    int                   state;
+    unsigned int          waited = 0;
+
+    sample = &(xc_watchdog_samples[idx % XC_WATCHDOG_SAMPLES_MAX]);
+    __atomic_store_n(&(sample->seq), 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&xc_watchdog_sample_target, sample, __ATOMIC_RELEASE);
+    __atomic_store_n(&xc_watchdog_sample_state, XC_WATCHDOG_STATE_PENDING, __ATOMIC_RELEASE);
+
+    if(0 != syscall(SYS_tgkill, xc_common_process_id, xc_common_process_id, XC_WATCHDOG_SIGNAL)) goto abandon;
+
+    //wait for the signal handler
+    while(XC_WATCHDOG_STATE_DONE != (state = __atomic_load_n(&xc_watchdog_sample_state, __ATOMIC_ACQUIRE)))
+    {
+        if(XC_WATCHDOG_STATE_PENDING == state && waited >= XC_WATCHDOG_SAMPLE_TIMEOUT) goto abandon;
+        xc_watchdog_sleep_ms(1);
+        waited++;
+    }
+
+    *cost += xc_watchdog_sample_cost;
+    sample->time = now_ms;
+    __atomic_store_n(&(sample->seq), idx + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&xc_watchdog_samples_next, idx + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&xc_watchdog_sample_state, XC_WATCHDOG_STATE_IDLE, __ATOMIC_RELEASE);
+    return;
+
+ abandon:
+    //the signal handler has not started yet, it will ignore the pending signal
+    state = XC_WATCHDOG_STATE_PENDING;
+    if(__atomic_compare_exchange_n(&xc_watchdog_sample_state, &state, XC_WATCHDOG_STATE_IDLE,
+                                   0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+
+    //the signal handler is running, it will finish soon
+    while(XC_WATCHDOG_STATE_DONE != __atomic_load_n(&xc_watchdog_sample_state, __ATOMIC_ACQUIRE))
+        xc_watchdog_sleep_ms(1);
+    __atomic_store_n(&xc_watchdog_sample_state, XC_WATCHDOG_STATE_IDLE, __ATOMIC_RELEASE);
+}
+
+//return the start time of the stall
+static uint64_t xc_watchdog_wait_stall(void)
+{
+    pthread_mutex_lock(&xc_watchdog_stall_lock);
+    while(0 == xc_watchdog_stalling)
+        pthread_cond_wait(&xc_watchdog_stall_cond, &xc_watchdog_stall_lock);
+    pthread_mutex_unlock(&xc_watchdog_stall_lock);
+
+    return __atomic_load_n(&xc_watchdog_stall_start, __ATOMIC_ACQUIRE);
+}
+
+static void *xc_watchdog_thread(void *arg)
+{
+    uint64_t start;
+    uint64_t stall_start = 0;
+    uint64_t cost = 0; //us
+    uint64_t now;
+
+    (void)arg;
+
+    pthread_detach(pthread_self());
+    pthread_setname_np(pthread_self(), "xcrash_watchdog");
+
+    while(1)
+    {
+        //check if process already crashed
+        if(xc_common_native_crashed || xc_common_java_crashed) break;
+
+        start = xc_watchdog_wait_stall();
+        now = xc_watchdog_get_time_us() / 1000;
+
+        //a new stall
+        if(start != stall_start)
+        {
+            stall_start = start;
+            cost = 0;
+        }
+
+        //CPU budget
+        if(cost * 100 <= (now - start) * 1000 * XC_WATCHDOG_BUDGET_PERCENT)
+            xc_watchdog_take_sample(now, &cost);
+
+        xc_watchdog_sleep_ms(xc_watchdog_interval);
+    }
+
+    return NULL;
+}
+
+int xc_watchdog_start(unsigned int threshold_ms, unsigned int interval_ms)
+{
+    struct sigaction act;
+    struct sigaction oldact;
+    pthread_t        thd;
+    int              r;
+
+    if(xc_watchdog_started) return XCC_ERRNO_STATE;
+    if(0 == threshold_ms) return XCC_ERRNO_INVAL;
+
+    xc_watchdog_threshold = threshold_ms;
+    xc_watchdog_interval = (interval_ms < XC_WATCHDOG_INTERVAL_MIN ? XC_WATCHDOG_INTERVAL_MIN : interval_ms);
+    if(0 != (r = xc_watchdog_load_stack_range())) return r;
+
+    //do not take over the signal from others
+    if(0 != sigaction(XC_WATCHDOG_SIGNAL, NULL, &oldact)) return XCC_ERRNO_SYS;
+    if((oldact.sa_flags & SA_SIGINFO) || SIG_DFL != oldact.sa_handler) return XCC_ERRNO_STATE;
+
+    memset(&act, 0, sizeof(act));
+    sigfillset(&act.sa_mask);
+    act.sa_sigaction = xc_watchdog_signal_handler;
+    act.sa_flags = SA_RESTART | SA_SIGINFO | SA_ONSTACK;
+    if(0 != sigaction(XC_WATCHDOG_SIGNAL, &act, NULL)) return XCC_ERRNO_SYS;
+
+    if(0 != (r = pthread_create(&thd, NULL, xc_watchdog_thread, NULL))) return r;
+
+    xc_watchdog_started = 1;
+    return 0;
+}
+
+//called when the main looper's heartbeat has not run for stalled_ms
+void xc_watchdog_stalled(unsigned int stalled_ms)
+{
+    uint64_t now = xc_watchdog_get_time_us() / 1000;
+    uint64_t start = (now > stalled_ms ? now - stalled_ms : 1);
+
+    __atomic_store_n(&xc_watchdog_stall_end, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&xc_watchdog_stall_start, start, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&xc_watchdog_stall_lock);
+    xc_watchdog_stalling = 1;
+    pthread_cond_signal(&xc_watchdog_stall_cond);
+    pthread_mutex_unlock(&xc_watchdog_stall_lock);
+}
+
+//called when the late heartbeat finally ran
+void xc_watchdog_recovered(void)
+{
+    pthread_mutex_lock(&xc_watchdog_stall_lock);
+    xc_watchdog_stalling = 0;
+    pthread_mutex_unlock(&xc_watchdog_stall_lock);
+
+    __atomic_store_n(&xc_watchdog_stall_end, xc_watchdog_get_time_us() / 1000, __ATOMIC_RELEASE);
+}
+
+static size_t xc_watchdog_get_frame_name(uintptr_t pc, char *buf, size_t buf_len)
+{
+    Dl_info     info;
+    const char *name;
+    int         len;
+
+    if(0 == dladdr((void *)pc, &info) || (uintptr_t)info.dli_fbase > pc)
+    {
+        len = snprintf(buf, buf_len, "0x%"PRIxPTR, pc);
+    }
+    else
+    {
+        if(NULL == info.dli_fname || '\0' == info.dli_fname[0])
+            name = "<anonymous>";
+        else
+            name = (NULL == (name = strrchr(info.dli_fname, '/')) ? info.dli_fname : name + 1);
+
+        if(NULL != info.dli_sname && '\0' != info.dli_sname[0])
+            len = snprintf(buf, buf_len, "%s!%s", name, info.dli_sname);
+        else
+            len = snprintf(buf, buf_len, "%s+0x%"PRIxPTR, name, pc - (uintptr_t)info.dli_fbase);
+    }
+
+    if(len < 0) return 0;
+    return ((size_t)len >= buf_len ? buf_len - 1 : (size_t)len);
+}
+
+//folded stack (from the outermost frame to the innermost frame)
+static void xc_watchdog_get_folded(xc_watchdog_sample_t *sample, char *buf, size_t buf_len)
+{
+    size_t i, used = 0;
+
+    buf[0] = '\0';
+    for(i = sample->frames_num; i > 0 && used + 2 < buf_len; i--)
+    {
+        if(used > 0) buf[used++] = ';';
+        used += xc_watchdog_get_frame_name(sample->pcs[i - 1], buf + used, buf_len - used);
+    }
+    buf[used] = '\0';
+}
+
+int xc_watchdog_record(int log_fd)
+{
+    xc_watchdog_sample_t *samples = NULL;
+    xc_watchdog_sample_t *sample;
+    char                 *folded = NULL;
+    size_t               *counts = NULL;
+    size_t                samples_cnt = 0, folded_cnt = 0, i, j, max;
+    uint64_t              stall_start, stall_end, next, idx, seq;
+    uint64_t              now = xc_watchdog_get_time_us() / 1000;
+    int                   r = 0;
+
+    if(!xc_watchdog_started) return 0;
+    if(0 == (stall_start = __atomic_load_n(&xc_watchdog_stall_start, __ATOMIC_ACQUIRE))) return 0;
+    stall_end = __atomic_load_n(&xc_watchdog_stall_end, __ATOMIC_ACQUIRE);
+
+    if(NULL == (samples = malloc(sizeof(xc_watchdog_sample_t) * XC_WATCHDOG_SAMPLES_MAX)) ||
+       NULL == (folded = malloc(XC_WATCHDOG_FOLDED_LEN * XC_WATCHDOG_SAMPLES_MAX)) ||
+       NULL == (counts = calloc(XC_WATCHDOG_SAMPLES_MAX, sizeof(size_t))))
+    {
+        r = XCC_ERRNO_NOMEM;
+        goto end;
+    }
+
+    //copy the samples of the last stall, the watchdog thread may still be writing
+    next = __atomic_load_n(&xc_watchdog_samples_next, __ATOMIC_ACQUIRE);
+    for(idx = (next > XC_WATCHDOG_SAMPLES_MAX ? next - XC_WATCHDOG_SAMPLES_MAX : 0); idx < next; idx++)
+    {
+        sample = &(xc_watchdog_samples[idx % XC_WATCHDOG_SAMPLES_MAX]);
+        if(idx + 1 != (seq = __atomic_load_n(&(sample->seq), __ATOMIC_ACQUIRE))) continue;
+        memcpy(&(samples[samples_cnt]), sample, sizeof(xc_watchdog_sample_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(seq != __atomic_load_n(&(sample->seq), __ATOMIC_RELAXED)) continue;
+        if(samples[samples_cnt].time < stall_start) continue;
+        if(samples[samples_cnt].frames_num > XC_WATCHDOG_FRAMES_MAX) continue;
+        samples_cnt++;
+    }
+    if(0 == samples_cnt) goto end;
+
+    //aggregate the same folded stacks
+    for(i = 0; i < samples_cnt; i++)
+    {
+        xc_watchdog_get_folded(&(samples[i]), folded + folded_cnt * XC_WATCHDOG_FOLDED_LEN, XC_WATCHDOG_FOLDED_LEN);
+        for(j = 0; j < folded_cnt; j++)
+            if(0 == strcmp(folded + j * XC_WATCHDOG_FOLDED_LEN, folded + folded_cnt * XC_WATCHDOG_FOLDED_LEN)) break;
+        if(j < folded_cnt)
+            counts[j]++;
+        else
+            counts[folded_cnt++] = 1;
+    }
+
+    //dump
+    if(0 != (r = xcc_util_write_format(log_fd, "main thread samples:\n    stall: %"PRIu64" ms%s, samples: %zu, interval: %u ms\n",
+                                       (0 == stall_end ? now : stall_end) - stall_start, (0 == stall_end ? " (ongoing)" : ""),
+                                       samples_cnt, xc_watchdog_interval))) goto end;
+    while(1)
+    {
+        //from the most frequent one
+        for(i = 0, max = folded_cnt; i < folded_cnt; i++)
+            if(counts[i] > 0 && (max == folded_cnt || counts[i] > counts[max])) max = i;
+        if(max == folded_cnt) break;
+
+        if(0 != (r = xcc_util_write_str(log_fd, "    "))) goto end;
+        if(0 != (r = xcc_util_write_str(log_fd, folded + max * XC_WATCHDOG_FOLDED_LEN))) goto end;
+        if(0 != (r = xcc_util_write_format(log_fd, " %zu\n", counts[max]))) goto end;
+        counts[max] = 0;
+    }
+    r = xcc_util_write_str(log_fd, "\n");
+
+ end:
+    if(NULL != samples) free(samples);
+    if(NULL != folded) free(folded);
+    if(NULL != counts) free(counts);
+    return r;
+}
@@ -28,6 +28,8 @@ typedef int make_iso_compilers_happy;
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "xcc_errno.h"
 #include "xcd_arm_exidx.h"
 #include "xcd_regs.h"
@@ -40,6 +42,46 @@ typedef int make_iso_compilers_happy;
 
 #define XCD_ARM_EXIDX_OP_FINISH 0xb0
 
+#define XCD_ARM_EXIDX_ENTRY_MAX 32 //same as libunwind
+
+//decoded unwind instructions of one .ARM.exidx entry
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    int     status;
+    uint8_t loaded;
+    uint8_t no_unwind;
+    uint8_t entry_size;
+    uint8_t entry[XCD_ARM_EXIDX_ENTRY_MAX];
+} xcd_arm_exidx_insn_t;
+#pragma clang diagnostic pop
+
+//.ARM.exidx object (one per ELF)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct xcd_arm_exidx
+{
+    xcd_memory_t              *memory;
+    pid_t                      pid;
+    size_t                     exidx_offset;
+    size_t                     exidx_size;
+
+    //number of steps, the index table is copied on the second one
+    size_t                     steps;
+
+    //local copy of the index table: {prel31 function offset, entry data} for each entry
+    uint32_t                  *table;
+    size_t                     table_count;
+
+    //decoded unwind instructions, indexed like the local table
+    xcd_arm_exidx_insn_t      *insns;
+};
+#pragma clang diagnostic pop
+
+//state of one step
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
 typedef struct
 {
     xcd_regs_t   *regs;
@@ -49,63 +91,86 @@ typedef struct
     uintptr_t     vsp;
     uintptr_t     pc;
     int           pc_set;
-    
-    size_t        exidx_offset;
-    size_t        exidx_size;
 
     size_t        entry_offset;
-    uint8_t       entry[32]; //same as libunwind
+    uint8_t       entry[XCD_ARM_EXIDX_ENTRY_MAX];
     size_t        entry_size;
     size_t        entry_idx;
 
     int           no_unwind;
     int           finished;
-} xcd_arm_exidx_t;
+} xcd_arm_exidx_state_t;
+#pragma clang diagnostic pop
 
-static void xcd_arm_exidx_init(xcd_arm_exidx_t *self, xcd_regs_t *regs, xcd_memory_t *memory,
-                               pid_t pid, size_t exidx_offset, size_t exidx_size, uintptr_t pc)
+static uint32_t xcd_arm_exidx_prel31(uint32_t offset, uint32_t data)
 {
-    self->regs = regs;
-    self->memory = memory;
-    self->pid = pid;
-    
-    self->vsp = xcd_regs_get_sp(regs);
-    self->pc = pc;
-    self->pc_set = 0;
-    
-    self->exidx_offset = exidx_offset;
-    self->exidx_size = exidx_size;
-    
-    self->entry_offset = 0;
-    self->entry_size = 0;
-    self->entry_idx = 0;
+    //sign extend the value if necessary
+    int32_t value = ((int32_t)(data) << 1) >> 1;
+    return (uint32_t)((int32_t)offset + value);
+}
 
-    self->no_unwind = 0;
-    self->finished = 0;
+static void xcd_arm_exidx_load_table(xcd_arm_exidx_t *self)
+{
+    size_t count = self->exidx_size / 8;
+
+    if(0 == count) return;
+    if(NULL == (self->table = malloc(count * 8))) return;
+
+    //copy the whole table with a single read, the prel31 offsets are resolved when probed
+    if(0 != xcd_memory_read_fully(self->memory, self->exidx_offset, self->table, count * 8))
+    {
+        XCD_LOG_WARN("ARM_EXIDX: load table FAILED, offset=%zx, size=%zx", self->exidx_offset, self->exidx_size);
+        free(self->table);
+        self->table = NULL;
+        return;
+    }
+    self->table_count = count;
+
+    //if this fails, the entries are decoded on each step
+    self->insns = calloc(count, sizeof(xcd_arm_exidx_insn_t));
 }
 
-static int xcd_arm_exidx_prel31_addr(xcd_memory_t *memory, uint32_t offset, uint32_t* addr)
+int xcd_arm_exidx_create(xcd_arm_exidx_t **self, xcd_memory_t *memory, pid_t pid, size_t exidx_offset, size_t exidx_size)
 {
-    uint32_t data;
-    if(0 != xcd_memory_read_fully(memory, offset, &data, sizeof(data))) return XCC_ERRNO_MEM;
+    if(0 == exidx_offset || 0 == exidx_size) return XCC_ERRNO_INVAL;
+
+    if(NULL == (*self = calloc(1, sizeof(xcd_arm_exidx_t)))) return XCC_ERRNO_NOMEM;
+    (*self)->memory = memory;
+    (*self)->pid = pid;
+    (*self)->exidx_offset = exidx_offset;
+    (*self)->exidx_size = exidx_size;
 
-    //sign extend the value if necessary
-    int32_t value = ((int32_t)(data) << 1) >> 1;
-    *addr = (uint32_t)((int32_t)offset + value);
-    
     return 0;
 }
 
-static int xcd_arm_exidx_entry_push(xcd_arm_exidx_t *self, uint8_t byte)
+static void xcd_arm_exidx_state_init(xcd_arm_exidx_state_t *state, xcd_arm_exidx_t *self, xcd_regs_t *regs, uintptr_t pc)
 {
-    if(self->entry_size >= 32) return XCC_ERRNO_NOSPACE;
+    state->regs = regs;
+    state->memory = self->memory;
+    state->pid = self->pid;
+    
+    state->vsp = xcd_regs_get_sp(regs);
+    state->pc = pc;
+    state->pc_set = 0;
+    
+    state->entry_offset = 0;
+    state->entry_size = 0;
+    state->entry_idx = 0;
+
+    state->no_unwind = 0;
+    state->finished = 0;
+}
+
+static int xcd_arm_exidx_entry_push(xcd_arm_exidx_state_t *self, uint8_t byte)
+{
+    if(self->entry_size >= XCD_ARM_EXIDX_ENTRY_MAX) return XCC_ERRNO_NOSPACE;
     
     self->entry[self->entry_size] = byte;
     self->entry_size++;
     return 0;
 }
 
-static int xcd_arm_exidx_entry_pop(xcd_arm_exidx_t *self, uint8_t *byte)
+static int xcd_arm_exidx_entry_pop(xcd_arm_exidx_state_t *self, uint8_t *byte)
 {
     if(self->entry_idx >= self->entry_size) return XCC_ERRNO_NOTFND;
 
@@ -114,28 +179,30 @@ static int xcd_arm_exidx_entry_pop(xcd_arm_exidx_t *self, uint8_t *byte)
     return 0;
 }
 
-static int xcd_arm_exidx_get_entry_offset(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_get_entry_idx(xcd_arm_exidx_t *self, uintptr_t pc, size_t *idx)
 {
-    if(0 == self->exidx_offset || 0 == self->exidx_size) return XCC_ERRNO_NOTFND;
-
     size_t   first = 0;
-    size_t   last = self->exidx_size / 8;
+    size_t   last = (NULL != self->table ? self->table_count : self->exidx_size / 8);
     size_t   current;
-    uint32_t addr;
-    int      r;
+    uint32_t offset, data, addr;
     
     while (first < last)
     {
         current = (first + last) / 2;
 
-        if(0 != (r = xcd_arm_exidx_prel31_addr(self->memory, self->exidx_offset + current * 8, &addr))) return r;
+        offset = (uint32_t)(self->exidx_offset + current * 8);
+        if(NULL != self->table)
+            data = self->table[current * 2];
+        else if(0 != xcd_memory_read_fully(self->memory, offset, &data, sizeof(data)))
+            return XCC_ERRNO_MEM;
+        addr = xcd_arm_exidx_prel31(offset, data);
 
-        if(self->pc == addr)
+        if(pc == addr)
         {
-            self->entry_offset = self->exidx_offset + current * 8;
+            *idx = current;
             return 0; //found
         }
-        else if(self->pc < addr)
+        else if(pc < addr)
         {
             last = current;
         }
@@ -147,22 +214,26 @@ static int xcd_arm_exidx_get_entry_offset(xcd_arm_exidx_t *self)
     
     if(last > 0)
     {
-        self->entry_offset = self->exidx_offset + (last - 1) * 8;
+        *idx = last - 1;
         return 0; //found
     }
     
     return XCC_ERRNO_NOTFND;
 }
 
-static int xcd_arm_exidx_get_entry(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_get_entry(xcd_arm_exidx_t *exidx, xcd_arm_exidx_state_t *self, size_t idx)
 {
     int r;
     
+    self->entry_offset = exidx->exidx_offset + idx * 8;
     if(self->entry_offset & 1) return XCC_ERRNO_FORMAT;
 
     //read entry value
     uint32_t data;
-    if(0 != xcd_memory_read_fully(self->memory, self->entry_offset + 4, &data, sizeof(data))) return XCC_ERRNO_MEM;
+    if(NULL != exidx->table)
+        data = exidx->table[idx * 2 + 1];
+    else if(0 != xcd_memory_read_fully(self->memory, self->entry_offset + 4, &data, sizeof(data)))
+        return XCC_ERRNO_MEM;
     
     if(1 == data)
     {
@@ -186,8 +257,7 @@ static int xcd_arm_exidx_get_entry(xcd_arm_exidx_t *self)
         //a prel31 offset of the start of the table entry
         
         //get the address of the table entry
-        int32_t signed_data = (int32_t)(data << 1) >> 1;
-        uint32_t addr = (uint32_t)((int32_t)(self->entry_offset + 4) + signed_data);
+        uint32_t addr = xcd_arm_exidx_prel31((uint32_t)(self->entry_offset + 4), data);
 
         //get the table entry
         if(0 != xcd_memory_read_fully(self->memory, addr, &data, sizeof(data))) return XCC_ERRNO_MEM;
@@ -252,7 +322,7 @@ static int xcd_arm_exidx_get_entry(xcd_arm_exidx_t *self)
     }
 }
 
-static int xcd_arm_exidx_decode_entry_10_00(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_10_00(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     int      r;
     uint16_t bytes = (uint16_t)((byte & 0xf) << 8);
@@ -294,7 +364,7 @@ static int xcd_arm_exidx_decode_entry_10_00(xcd_arm_exidx_t *self, uint8_t byte)
     }
 }
 
-static int xcd_arm_exidx_decode_entry_10_01(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_10_01(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     uint8_t bits = byte & 0xf;
 
@@ -313,7 +383,7 @@ static int xcd_arm_exidx_decode_entry_10_01(xcd_arm_exidx_t *self, uint8_t byte)
     }
 }
 
-static int xcd_arm_exidx_decode_entry_10_10(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_10_10(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     // 10100nnn: Pop r4-r[4+nnn]
     // 10101nnn: Pop r4-r[4+nnn], r14
@@ -337,14 +407,14 @@ static int xcd_arm_exidx_decode_entry_10_10(xcd_arm_exidx_t *self, uint8_t byte)
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_0000(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry_10_11_0000(xcd_arm_exidx_state_t *self)
 {
     // 10110000: Finish
     self->finished = 1;
     return XCC_ERRNO_RANGE;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_0001(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry_10_11_0001(xcd_arm_exidx_state_t *self)
 {
     int     r;
     uint8_t byte;
@@ -382,7 +452,7 @@ static int xcd_arm_exidx_decode_entry_10_11_0001(xcd_arm_exidx_t *self)
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_0010(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry_10_11_0010(xcd_arm_exidx_state_t *self)
 {
     // 10110010 uleb128: vsp = vsp + 0x204 + (uleb128 << 2)
     uint32_t result = 0;
@@ -402,7 +472,7 @@ static int xcd_arm_exidx_decode_entry_10_11_0010(xcd_arm_exidx_t *self)
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_0011(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry_10_11_0011(xcd_arm_exidx_state_t *self)
 {
     // 10110011 sssscccc: Pop VFP double precision registers D[ssss]-D[ssss+cccc] by FSTMFDX
     uint8_t byte;
@@ -415,7 +485,7 @@ static int xcd_arm_exidx_decode_entry_10_11_0011(xcd_arm_exidx_t *self)
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_1nnn(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_10_11_1nnn(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     // 10111nnn: Pop VFP double-precision registers D[8]-D[8+nnn] by FSTMFDX
     self->vsp += ((byte & 0x7) + 1) * 8 + 4;
@@ -423,7 +493,7 @@ static int xcd_arm_exidx_decode_entry_10_11_1nnn(xcd_arm_exidx_t *self, uint8_t
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_10_11_01nn(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry_10_11_01nn(xcd_arm_exidx_state_t *self)
 {
     (void)self;
     
@@ -431,7 +501,7 @@ static int xcd_arm_exidx_decode_entry_10_11_01nn(xcd_arm_exidx_t *self)
     return XCC_ERRNO_FORMAT;
 }
 
-static int xcd_arm_exidx_decode_entry_10(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_10(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     switch((byte >> 4) & 0x3)
     {
@@ -465,7 +535,7 @@ static int xcd_arm_exidx_decode_entry_10(xcd_arm_exidx_t *self, uint8_t byte)
     }
 }
 
-static int xcd_arm_exidx_decode_entry_11_000(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_11_000(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     int     r;
     uint8_t bits = byte & 0x7;
@@ -507,7 +577,7 @@ static int xcd_arm_exidx_decode_entry_11_000(xcd_arm_exidx_t *self, uint8_t byte
     }
 }
 
-static int xcd_arm_exidx_decode_entry_11_001(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_11_001(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     int     r;
     uint8_t bits = byte & 0x7;
@@ -535,14 +605,14 @@ static int xcd_arm_exidx_decode_entry_11_001(xcd_arm_exidx_t *self, uint8_t byte
     }
 }
 
-static int xcd_arm_exidx_decode_entry_11_010(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_11_010(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     // 11010nnn: Pop VFP double precision registers D[8]-D[8+nnn] by VPUSH
     self->vsp += ((byte & 0x7) + 1) * 8;
     return 0;
 }
 
-static int xcd_arm_exidx_decode_entry_11(xcd_arm_exidx_t *self, uint8_t byte)
+static int xcd_arm_exidx_decode_entry_11(xcd_arm_exidx_state_t *self, uint8_t byte)
 {
     switch ((byte >> 3) & 0x7)
     {
@@ -558,7 +628,7 @@ static int xcd_arm_exidx_decode_entry_11(xcd_arm_exidx_t *self, uint8_t byte)
     }
 }
 
-static int xcd_arm_exidx_decode_entry(xcd_arm_exidx_t *self)
+static int xcd_arm_exidx_decode_entry(xcd_arm_exidx_state_t *self)
 {
     int r = 0;
     uint8_t byte;
@@ -582,30 +652,71 @@ static int xcd_arm_exidx_decode_entry(xcd_arm_exidx_t *self)
     }
 }
 
-int xcd_arm_exidx_step(xcd_regs_t *regs, xcd_memory_t *memory, pid_t pid,
-                       size_t exidx_offset, size_t exidx_size, uintptr_t load_bias,
-                       uintptr_t pc, int *finished)
+static xcd_arm_exidx_insn_t *xcd_arm_exidx_get_insn(xcd_arm_exidx_t *self, xcd_arm_exidx_state_t *state, size_t idx)
+{
+    xcd_arm_exidx_insn_t *insn = &(self->insns[idx]);
+
+    //check cache
+    if(insn->loaded) return insn;
+
+    //read and decode the entry (the failed ones are cached too, they will fail again)
+    insn->status = xcd_arm_exidx_get_entry(self, state, idx);
+    insn->no_unwind = (uint8_t)state->no_unwind;
+    memcpy(insn->entry, state->entry, state->entry_size);
+    insn->entry_size = (uint8_t)state->entry_size;
+    insn->loaded = 1;
+    return insn;
+}
+
+int xcd_arm_exidx_step(xcd_arm_exidx_t *exidx, xcd_regs_t *regs, uintptr_t load_bias, uintptr_t pc, int *finished)
 {
-    xcd_arm_exidx_t self;
-    int             r;
+    xcd_arm_exidx_state_t  self;
+    xcd_arm_exidx_insn_t  *insn;
+    size_t                 idx;
+    int                    r;
 
     if(pc < load_bias) return XCC_ERRNO_NOTFND;
 
     pc -= load_bias;
-    xcd_arm_exidx_init(&self, regs, memory, pid, exidx_offset, exidx_size, pc);
+    xcd_arm_exidx_state_init(&self, exidx, regs, pc);
     
-    //get entry offset
-    if(0 != (r = xcd_arm_exidx_get_entry_offset(&self))) return r;
+    //copy the index table when the ELF is stepped more than once
+    exidx->steps++;
+    if(2 == exidx->steps) xcd_arm_exidx_load_table(exidx);
 
-    //get entry
-    if(0 != (r = xcd_arm_exidx_get_entry(&self)))
+    //get entry index
+    if(0 != (r = xcd_arm_exidx_get_entry_idx(exidx, pc, &idx))) return r;
+
+    //get entry (decoded unwind instructions)
+    if(NULL == exidx->insns)
     {
-        if(self.no_unwind)
+        //first step (or no local table), decode the entry without caching it
+        if(0 != (r = xcd_arm_exidx_get_entry(exidx, &self, idx)))
         {
-            *finished = 1;
-            return 0;
+            if(self.no_unwind)
+            {
+                *finished = 1;
+                return 0;
+            }
+            return r;
+        }
+    }
+    else
+    {
+        insn = xcd_arm_exidx_get_insn(exidx, &self, idx);
+        if(0 != insn->status)
+        {
+            if(insn->no_unwind)
+            {
+                *finished = 1;
+                return 0;
+            }
+            return insn->status;
         }
-        return r;
+        memcpy(self.entry, insn->entry, insn->entry_size);
+        self.entry_size = insn->entry_size;
+        self.entry_idx = 0;
+        self.no_unwind = 0;
     }
 #if XCD_ARM_EXIDX_DEBUG
     size_t i;
@@ -35,9 +35,11 @@
 extern "C" {
 #endif
 
-int xcd_arm_exidx_step(xcd_regs_t *regs, xcd_memory_t *memory, pid_t pid,
-                       size_t exidx_offset, size_t exidx_size, uintptr_t load_bias,
-                       uintptr_t pc, int *finished);
+typedef struct xcd_arm_exidx xcd_arm_exidx_t;
+
+int xcd_arm_exidx_create(xcd_arm_exidx_t **self, xcd_memory_t *memory, pid_t pid, size_t exidx_offset, size_t exidx_size);
+
+int xcd_arm_exidx_step(xcd_arm_exidx_t *self, xcd_regs_t *regs, uintptr_t load_bias, uintptr_t pc, int *finished);
 
 #ifdef __cplusplus
 }
@@ -46,6 +46,8 @@
 #include "xcc_util.h"
 #include "xcc_spot.h"
 #include "xcd_log.h"
+#include "xcd_deadline.h"
+#include "xcd_minicore.h"
 #include "xcd_process.h"
 #include "xcd_sys.h"
 #include "xcd_util.h"
@@ -97,7 +99,8 @@ static int xcd_core_read_args()
     int r;
     
     if(0 != (r = xcd_core_read_stdin((void *)&xcd_core_spot, sizeof(xcc_spot_t)))) return r;
-    if(0 != (r = xcd_core_read_stdin_extra(&xcd_core_log_pathname, xcd_core_spot.log_pathname_len))) return r;
+    if(xcd_core_spot.log_pathname_len > 0)
+        if(0 != (r = xcd_core_read_stdin_extra(&xcd_core_log_pathname, xcd_core_spot.log_pathname_len))) return r;
     if(0 != (r = xcd_core_read_stdin_extra(&xcd_core_os_version, xcd_core_spot.os_version_len))) return r;
     if(0 != (r = xcd_core_read_stdin_extra(&xcd_core_kernel_version, xcd_core_spot.kernel_version_len))) return r;
     if(0 != (r = xcd_core_read_stdin_extra(&xcd_core_abi_list, xcd_core_spot.abi_list_len))) return r;
@@ -135,7 +138,7 @@ static void xcd_core_signal_handler(int sig, siginfo_t *si, void *uc)
                                            "xcrash error debug:\n"
                                            "dumper has crashed (signal: %d, code: %d)\n",
                                            si->si_signo, si->si_code)) goto end;
-        if(0 < (len = xcc_unwind_get(xcd_core_spot.api_level, si, uc, buf, sizeof(buf))))
+        if(0 < (len = xcc_unwind_get(xcd_core_spot.api_level, si, uc, buf, sizeof(buf), NULL)))
             xcc_util_write(xcd_core_log_fd, buf, len);
 
     end:
@@ -147,6 +150,8 @@ static void xcd_core_signal_handler(int sig, siginfo_t *si, void *uc)
 
 int main(int argc, char** argv)
 {
+    char minicore_pathname[1024];
+    
     (void)argc;
     (void)argv;
     
@@ -156,8 +161,14 @@ int main(int argc, char** argv)
     //read args from stdin
     if(0 != xcd_core_read_args()) exit(1);
 
-    //open log file
-    if(0 > (xcd_core_log_fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(xcd_core_log_pathname, O_WRONLY | O_CLOEXEC)))) exit(2);
+    //the soft deadline for the optional sections (the alarm above is the hard one)
+    xcd_deadline_init(xcd_core_spot.dump_budget_ms);
+
+    //open log file (or use the inherited one when dumping threads for a java crash)
+    if(xcd_core_spot.threads_only_log_fd >= 0)
+        xcd_core_log_fd = xcd_core_spot.threads_only_log_fd;
+    else if(NULL == xcd_core_log_pathname ||
+            0 > (xcd_core_log_fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(xcd_core_log_pathname, O_WRONLY | O_CLOEXEC)))) exit(2);
 
     //register signal handler for catching self-crashing
     xcc_unwind_init(xcd_core_spot.api_level);
@@ -168,7 +179,10 @@ int main(int argc, char** argv)
                                xcd_core_spot.crash_pid,
                                xcd_core_spot.crash_tid,
                                &(xcd_core_spot.siginfo),
-                               &(xcd_core_spot.ucontext))) exit(3);
+                               &(xcd_core_spot.ucontext),
+                               xcd_core_spot.other_crashes_addr,
+                               xcd_core_spot.other_crashes_cnt,
+                               xcd_core_spot.stack_scan)) exit(3);
 
     //suspend all threads in the process
     xcd_process_suspend_threads(xcd_core_proc);
@@ -176,6 +190,21 @@ int main(int argc, char** argv)
     //load process info
     if(0 != xcd_process_load_info(xcd_core_proc)) exit(4);
 
+    //only record the other threads for a java crash
+    if(xcd_core_spot.threads_only_log_fd >= 0)
+    {
+        if(0 != xcd_process_record_threads(xcd_core_proc,
+                                           xcd_core_log_fd,
+                                           1,
+                                           xcd_core_spot.dump_all_threads_count_max,
+                                           xcd_core_dump_all_threads_whitelist,
+                                           xcd_core_spot.threads_only_nonfatal)) exit(6);
+        goto end;
+    }
+
+    //the mini-core is only written for a native crash
+    if(!xcd_core_spot.dump_minicore) xcd_deadline_exclude(XCD_DEADLINE_MINICORE);
+
     //record system info
     if(0 != xcd_sys_record(xcd_core_log_fd,
                            xcd_core_spot.time_zone,
@@ -202,11 +231,28 @@ int main(int argc, char** argv)
                                xcd_core_spot.dump_map,
                                xcd_core_spot.dump_fds,
                                xcd_core_spot.dump_network_info,
+                               xcd_core_spot.dump_meminfo_detail,
                                xcd_core_spot.dump_all_threads,
                                xcd_core_spot.dump_all_threads_count_max,
                                xcd_core_dump_all_threads_whitelist,
+                               xcd_core_spot.breadcrumb_addr,
+                               xcd_core_spot.time_zone,
+                               xcd_core_log_pathname,
+                               xcd_core_spot.crash_time,
+                               xcd_core_spot.suppress_duplicates_window,
                                xcd_core_spot.api_level)) exit(6);
 
+    //record the mini-core for unwinding offline
+    if(xcd_core_spot.dump_minicore && xcd_deadline_begin(XCD_DEADLINE_MINICORE))
+    {
+        snprintf(minicore_pathname, sizeof(minicore_pathname), "%s"XCD_MINICORE_SUFFIX, xcd_core_log_pathname);
+        xcd_process_record_minicore(xcd_core_proc, minicore_pathname);
+    }
+
+    //record the skipped and degraded sections
+    xcd_deadline_record(xcd_core_log_fd);
+
+ end:
     //resume all threads in the process
     xcd_process_resume_threads(xcd_core_proc);
 
@@ -0,0 +1,163 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "xcd_crc.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wreserved-id-macro"
+#pragma clang diagnostic ignored "-Wpadded"
+#include "7zCrc.h"
+#include "XzCrc64.h"
+#pragma clang diagnostic pop
+
+//This file replaces 7zCrc.c, 7zCrcOpt.c, XzCrc64.c and XzCrc64Opt.c of the lzma SDK (little-endian only).
+//The tables are generated at compile-time instead of by CrcGenerateTable() and Crc64GenerateTable().
+
+#define XCD_CRC_TABLES_NUM 8
+#include "xcd_crc_table.h"
+
+#define XCD_CRC32_TABLE(k) (g_CrcTable + 256 * (k))
+#define XCD_CRC64_TABLE(k) (g_Crc64Table + 256 * (k))
+
+static xcd_crc32_update_t xcd_crc32_update_impl = xcd_crc32_update_sw;
+static xcd_crc64_update_t xcd_crc64_update_impl = xcd_crc64_update_sw;
+static int                xcd_crc_inited = 0;
+
+uint32_t xcd_crc32_update_sw(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    uint32_t one, two;
+
+    for(; len > 0 && ((uintptr_t)buf & 7); len--, buf++)
+        crc = XCD_CRC32_TABLE(0)[(crc ^ *buf) & 0xFF] ^ (crc >> 8);
+
+    for(; len >= 8; len -= 8, buf += 8)
+    {
+        memcpy(&one, buf, sizeof(one));
+        memcpy(&two, buf + 4, sizeof(two));
+        one ^= crc;
+        crc = XCD_CRC32_TABLE(7)[one & 0xFF] ^
+              XCD_CRC32_TABLE(6)[(one >> 8) & 0xFF] ^
+              XCD_CRC32_TABLE(5)[(one >> 16) & 0xFF] ^
+              XCD_CRC32_TABLE(4)[one >> 24] ^
+              XCD_CRC32_TABLE(3)[two & 0xFF] ^
+              XCD_CRC32_TABLE(2)[(two >> 8) & 0xFF] ^
+              XCD_CRC32_TABLE(1)[(two >> 16) & 0xFF] ^
+              XCD_CRC32_TABLE(0)[two >> 24];
+    }
+
+    for(; len > 0; len--, buf++)
+        crc = XCD_CRC32_TABLE(0)[(crc ^ *buf) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+uint64_t xcd_crc64_update_sw(uint64_t crc, const uint8_t *buf, size_t len)
+{
+    uint64_t v;
+
+    for(; len > 0 && ((uintptr_t)buf & 7); len--, buf++)
+        crc = XCD_CRC64_TABLE(0)[(crc ^ *buf) & 0xFF] ^ (crc >> 8);
+
+    for(; len >= 8; len -= 8, buf += 8)
+    {
+        memcpy(&v, buf, sizeof(v));
+        v ^= crc;
+        crc = XCD_CRC64_TABLE(7)[v & 0xFF] ^
+              XCD_CRC64_TABLE(6)[(v >> 8) & 0xFF] ^
+              XCD_CRC64_TABLE(5)[(v >> 16) & 0xFF] ^
+              XCD_CRC64_TABLE(4)[(v >> 24) & 0xFF] ^
+              XCD_CRC64_TABLE(3)[(v >> 32) & 0xFF] ^
+              XCD_CRC64_TABLE(2)[(v >> 40) & 0xFF] ^
+              XCD_CRC64_TABLE(1)[(v >> 48) & 0xFF] ^
+              XCD_CRC64_TABLE(0)[v >> 56];
+    }
+
+    for(; len > 0; len--, buf++)
+        crc = XCD_CRC64_TABLE(0)[(crc ^ *buf) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+#if !defined(__aarch64__) && !defined(__x86_64__)
+void xcd_crc_select_hw(xcd_crc32_update_t *crc32, xcd_crc64_update_t *crc64)
+{
+    (void)crc32;
+    (void)crc64;
+}
+#endif
+
+void xcd_crc_init(void)
+{
+    xcd_crc32_update_t crc32 = xcd_crc32_update_sw;
+    xcd_crc64_update_t crc64 = xcd_crc64_update_sw;
+
+    if(__atomic_load_n(&xcd_crc_inited, __ATOMIC_ACQUIRE)) return;
+
+    xcd_crc_select_hw(&crc32, &crc64);
+    __atomic_store_n(&xcd_crc32_update_impl, crc32, __ATOMIC_RELAXED);
+    __atomic_store_n(&xcd_crc64_update_impl, crc64, __ATOMIC_RELAXED);
+    __atomic_store_n(&xcd_crc_inited, 1, __ATOMIC_RELEASE);
+}
+
+uint32_t xcd_crc32_update(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    return __atomic_load_n(&xcd_crc32_update_impl, __ATOMIC_RELAXED)(crc, buf, len);
+}
+
+uint64_t xcd_crc64_update(uint64_t crc, const uint8_t *buf, size_t len)
+{
+    return __atomic_load_n(&xcd_crc64_update_impl, __ATOMIC_RELAXED)(crc, buf, len);
+}
+
+//the lzma SDK's interface
+
+void MY_FAST_CALL CrcGenerateTable(void)
+{
+    xcd_crc_init();
+}
+
+UInt32 MY_FAST_CALL CrcUpdate(UInt32 crc, const void *data, size_t size)
+{
+    return xcd_crc32_update(crc, (const uint8_t *)data, size);
+}
+
+UInt32 MY_FAST_CALL CrcCalc(const void *data, size_t size)
+{
+    return xcd_crc32_update(CRC_INIT_VAL, (const uint8_t *)data, size) ^ CRC_INIT_VAL;
+}
+
+void MY_FAST_CALL Crc64GenerateTable(void)
+{
+    xcd_crc_init();
+}
+
+UInt64 MY_FAST_CALL Crc64Update(UInt64 crc, const void *data, size_t size)
+{
+    return xcd_crc64_update(crc, (const uint8_t *)data, size);
+}
+
+UInt64 MY_FAST_CALL Crc64Calc(const void *data, size_t size)
+{
+    return xcd_crc64_update(CRC64_INIT_VAL, (const uint8_t *)data, size) ^ CRC64_INIT_VAL;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef XCD_CRC_H
+#define XCD_CRC_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//the CRC32 and the CRC64 of xz, "crc" is the inverted value as in the lzma SDK
+typedef uint32_t (*xcd_crc32_update_t)(uint32_t crc, const uint8_t *buf, size_t len);
+typedef uint64_t (*xcd_crc64_update_t)(uint64_t crc, const uint8_t *buf, size_t len);
+
+void xcd_crc_init(void);
+
+uint32_t xcd_crc32_update(uint32_t crc, const uint8_t *buf, size_t len);
+uint64_t xcd_crc64_update(uint64_t crc, const uint8_t *buf, size_t len);
+
+//slicing-by-8 with the compile-time tables
+uint32_t xcd_crc32_update_sw(uint32_t crc, const uint8_t *buf, size_t len);
+uint64_t xcd_crc64_update_sw(uint64_t crc, const uint8_t *buf, size_t len);
+
+//replace them with the hardware-accelerated ones supported by the CPU (xcd_crc_arm64.c, xcd_crc_x86_64.c)
+void xcd_crc_select_hw(xcd_crc32_update_t *crc32, xcd_crc64_update_t *crc64);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+typedef int make_iso_compilers_happy;
+
+#ifdef __aarch64__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_acle.h>
+#include <arm_neon.h>
+#include "xcd_crc.h"
+
+//This file is compiled with "-march=armv8-a+crc+crypto" (see CMakeLists.txt),
+//its functions MUST only be called after checking the HWCAP.
+
+//CRC32 by the CRC32 instructions (the same polynomial as xz, not CRC32C).
+//CRC64 by folding the data by 512 bits (4 lanes) and then by 128 bits with PMULL, the last 128 bits and
+//the tail are finished by the tables. For each fold distance D, the constants are
+//(x^(D+63) mod P, x^(D-1) mod P), bit-reflected into 64 bits.
+static const uint64_t xcd_crc64_arm64_k[4] = {0x6ae3efbb9dd441f3, 0x081f6054a7842df4,  //D = 512
+                                              0xe05dd497ca393ae4, 0xdabe95afc7875f40}; //D = 128
+
+#define XCD_CRC_ARM64_FOLD_MIN 64
+
+static uint32_t xcd_crc32_update_arm64(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    uint64_t v;
+
+    for(; len > 0 && ((uintptr_t)buf & 7); len--, buf++)
+        crc = __crc32b(crc, *buf);
+
+    for(; len >= 8; len -= 8, buf += 8)
+    {
+        memcpy(&v, buf, sizeof(v));
+        crc = __crc32d(crc, v);
+    }
+
+    for(; len > 0; len--, buf++)
+        crc = __crc32b(crc, *buf);
+
+    return crc;
+}
+
+static uint64x2_t xcd_crc_arm64_fold(uint64x2_t x, uint64x2_t k)
+{
+    poly128_t lo = vmull_p64((poly64_t)vgetq_lane_u64(x, 0), (poly64_t)vgetq_lane_u64(k, 0));
+    poly128_t hi = vmull_p64((poly64_t)vgetq_lane_u64(x, 1), (poly64_t)vgetq_lane_u64(k, 1));
+
+    return veorq_u64(vreinterpretq_u64_p128(lo), vreinterpretq_u64_p128(hi));
+}
+
+static uint64x2_t xcd_crc_arm64_load(const uint8_t *p)
+{
+    return vreinterpretq_u64_u8(vld1q_u8(p));
+}
+
+static uint64_t xcd_crc64_update_arm64(uint64_t crc, const uint8_t *buf, size_t len)
+{
+    uint64x2_t k512 = vld1q_u64(xcd_crc64_arm64_k);
+    uint64x2_t k128 = vld1q_u64(xcd_crc64_arm64_k + 2);
+    uint64x2_t x0, x1, x2, x3;
+    uint8_t    folded[16];
+
+    if(len < XCD_CRC_ARM64_FOLD_MIN) return xcd_crc64_update_sw(crc, buf, len);
+
+    x0 = veorq_u64(xcd_crc_arm64_load(buf), vcombine_u64(vcreate_u64(crc), vcreate_u64(0)));
+    x1 = xcd_crc_arm64_load(buf + 16);
+    x2 = xcd_crc_arm64_load(buf + 32);
+    x3 = xcd_crc_arm64_load(buf + 48);
+    for(buf += 64, len -= 64; len >= 64; buf += 64, len -= 64)
+    {
+        x0 = veorq_u64(xcd_crc_arm64_fold(x0, k512), xcd_crc_arm64_load(buf));
+        x1 = veorq_u64(xcd_crc_arm64_fold(x1, k512), xcd_crc_arm64_load(buf + 16));
+        x2 = veorq_u64(xcd_crc_arm64_fold(x2, k512), xcd_crc_arm64_load(buf + 32));
+        x3 = veorq_u64(xcd_crc_arm64_fold(x3, k512), xcd_crc_arm64_load(buf + 48));
+    }
+
+    x0 = veorq_u64(xcd_crc_arm64_fold(x0, k128), x1);
+    x0 = veorq_u64(xcd_crc_arm64_fold(x0, k128), x2);
+    x0 = veorq_u64(xcd_crc_arm64_fold(x0, k128), x3);
+    for(; len >= 16; buf += 16, len -= 16)
+        x0 = veorq_u64(xcd_crc_arm64_fold(x0, k128), xcd_crc_arm64_load(buf));
+
+    vst1q_u8(folded, vreinterpretq_u8_u64(x0));
+    crc = xcd_crc64_update_sw(0, folded, sizeof(folded));
+    return xcd_crc64_update_sw(crc, buf, len);
+}
+
+void xcd_crc_select_hw(xcd_crc32_update_t *crc32, xcd_crc64_update_t *crc64)
+{
+    unsigned long hwcap = getauxval(AT_HWCAP);
+
+    if(hwcap & HWCAP_CRC32) *crc32 = xcd_crc32_update_arm64;
+    if(hwcap & HWCAP_PMULL) *crc64 = xcd_crc64_update_arm64;
+}
+
+#endif
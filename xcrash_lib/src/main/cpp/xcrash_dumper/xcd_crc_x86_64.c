@@ -0,0 +1,117 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+typedef int make_iso_compilers_happy;
+
+#ifdef __x86_64__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#include "xcd_crc.h"
+
+//Fold the data by 512 bits (4 lanes) and then by 128 bits with PCLMULQDQ, the last 128 bits and the tail
+//are finished by the tables. For each fold distance D, the constants are (x^(D+63) mod P, x^(D-1) mod P),
+//bit-reflected into 64 bits.
+static const uint64_t xcd_crc32_x86_64_k[4] = {0x653d982200000000, 0xcad38e8f00000000,  //D = 512
+                                               0x65673b4600000000, 0x9ba54c6f00000000}; //D = 128
+static const uint64_t xcd_crc64_x86_64_k[4] = {0x6ae3efbb9dd441f3, 0x081f6054a7842df4,  //D = 512
+                                               0xe05dd497ca393ae4, 0xdabe95afc7875f40}; //D = 128
+
+#define XCD_CRC_X86_64_FOLD_MIN 64
+
+__attribute__((target("pclmul")))
+static __m128i xcd_crc_x86_64_fold(__m128i x, __m128i k)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+__attribute__((target("pclmul")))
+static void xcd_crc_x86_64_fold_all(__m128i init, const uint8_t **buf, size_t *len, const uint64_t *k, uint8_t *out)
+{
+    const uint8_t *p = *buf;
+    size_t         n = *len;
+    __m128i        k512 = _mm_set_epi64x((long long)k[1], (long long)k[0]);
+    __m128i        k128 = _mm_set_epi64x((long long)k[3], (long long)k[2]);
+    __m128i        x0, x1, x2, x3;
+
+    x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(const void *)p), init);
+    x1 = _mm_loadu_si128((const __m128i *)(const void *)(p + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(const void *)(p + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(const void *)(p + 48));
+    for(p += 64, n -= 64; n >= 64; p += 64, n -= 64)
+    {
+        x0 = _mm_xor_si128(xcd_crc_x86_64_fold(x0, k512), _mm_loadu_si128((const __m128i *)(const void *)p));
+        x1 = _mm_xor_si128(xcd_crc_x86_64_fold(x1, k512), _mm_loadu_si128((const __m128i *)(const void *)(p + 16)));
+        x2 = _mm_xor_si128(xcd_crc_x86_64_fold(x2, k512), _mm_loadu_si128((const __m128i *)(const void *)(p + 32)));
+        x3 = _mm_xor_si128(xcd_crc_x86_64_fold(x3, k512), _mm_loadu_si128((const __m128i *)(const void *)(p + 48)));
+    }
+
+    x0 = _mm_xor_si128(xcd_crc_x86_64_fold(x0, k128), x1);
+    x0 = _mm_xor_si128(xcd_crc_x86_64_fold(x0, k128), x2);
+    x0 = _mm_xor_si128(xcd_crc_x86_64_fold(x0, k128), x3);
+    for(; n >= 16; p += 16, n -= 16)
+        x0 = _mm_xor_si128(xcd_crc_x86_64_fold(x0, k128), _mm_loadu_si128((const __m128i *)(const void *)p));
+
+    _mm_storeu_si128((__m128i *)(void *)out, x0);
+    *buf = p;
+    *len = n;
+}
+
+__attribute__((target("pclmul")))
+static uint32_t xcd_crc32_update_x86_64(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    uint8_t folded[16];
+
+    if(len < XCD_CRC_X86_64_FOLD_MIN) return xcd_crc32_update_sw(crc, buf, len);
+
+    xcd_crc_x86_64_fold_all(_mm_cvtsi32_si128((int)crc), &buf, &len, xcd_crc32_x86_64_k, folded);
+    crc = xcd_crc32_update_sw(0, folded, sizeof(folded));
+    return xcd_crc32_update_sw(crc, buf, len);
+}
+
+__attribute__((target("pclmul")))
+static uint64_t xcd_crc64_update_x86_64(uint64_t crc, const uint8_t *buf, size_t len)
+{
+    uint8_t folded[16];
+
+    if(len < XCD_CRC_X86_64_FOLD_MIN) return xcd_crc64_update_sw(crc, buf, len);
+
+    xcd_crc_x86_64_fold_all(_mm_cvtsi64_si128((long long)crc), &buf, &len, xcd_crc64_x86_64_k, folded);
+    crc = xcd_crc64_update_sw(0, folded, sizeof(folded));
+    return xcd_crc64_update_sw(crc, buf, len);
+}
+
+void xcd_crc_select_hw(xcd_crc32_update_t *crc32, xcd_crc64_update_t *crc64)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return;
+    if(ecx & bit_PCLMUL)
+    {
+        *crc32 = xcd_crc32_update_x86_64;
+        *crc64 = xcd_crc64_update_x86_64;
+    }
+}
+
+#endif
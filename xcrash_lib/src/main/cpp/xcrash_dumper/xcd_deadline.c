@@ -0,0 +1,168 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "xcc_util.h"
+#include "xcd_deadline.h"
+
+#define XCD_DEADLINE_DEGRADATIONS_MAX 8
+
+typedef enum
+{
+    XCD_DEADLINE_STATE_PENDING = 0,
+    XCD_DEADLINE_STATE_EXCLUDED,
+    XCD_DEADLINE_STATE_STARTED,
+    XCD_DEADLINE_STATE_SKIPPED
+} xcd_deadline_state_t;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    const char           *name;
+    unsigned int          priority; //0 is the highest
+    unsigned int          cost_ms;  //estimated
+    xcd_deadline_state_t  state;
+} xcd_deadline_item_t;
+#pragma clang diagnostic pop
+
+static xcd_deadline_item_t xcd_deadline_items[XCD_DEADLINE_SECTIONS_MAX] = {
+    {"build id",      0, 100,  XCD_DEADLINE_STATE_PENDING},
+    {"stack",         0, 300,  XCD_DEADLINE_STATE_PENDING},
+    {"memory near",   1, 100,  XCD_DEADLINE_STATE_PENDING},
+    {"other threads", 1, 2000, XCD_DEADLINE_STATE_PENDING},
+    {"memory map",    2, 100,  XCD_DEADLINE_STATE_PENDING},
+    {"breadcrumbs",   2, 50,   XCD_DEADLINE_STATE_PENDING},
+    {"logcat",        2, 2000, XCD_DEADLINE_STATE_PENDING},
+    {"open files",    3, 100,  XCD_DEADLINE_STATE_PENDING},
+    {"network info",  3, 300,  XCD_DEADLINE_STATE_PENDING},
+    {"memory info",   3, 300,  XCD_DEADLINE_STATE_PENDING},
+    {"elf hash",      4, 2000, XCD_DEADLINE_STATE_PENDING},
+    {"mini-core",     2, 500,  XCD_DEADLINE_STATE_PENDING}
+};
+
+static unsigned int  xcd_deadline_budget_ms = 0; //0 means no deadline
+static uint64_t      xcd_deadline_start_ms  = 0;
+static const char   *xcd_deadline_degradations[XCD_DEADLINE_DEGRADATIONS_MAX];
+static size_t        xcd_deadline_degradations_num = 0;
+
+static uint64_t xcd_deadline_get_time_ms(void)
+{
+    struct timespec ts;
+
+    if(0 != clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000 / 1000;
+}
+
+static uint64_t xcd_deadline_get_remaining_ms(void)
+{
+    uint64_t used = xcd_deadline_get_time_ms() - xcd_deadline_start_ms;
+
+    return used >= xcd_deadline_budget_ms ? 0 : xcd_deadline_budget_ms - used;
+}
+
+//time reserved for the pending sections with higher priority
+static uint64_t xcd_deadline_get_reserved_ms(unsigned int priority)
+{
+    uint64_t reserved = 0;
+    size_t   i;
+
+    for(i = 0; i < XCD_DEADLINE_SECTIONS_MAX; i++)
+        if(XCD_DEADLINE_STATE_PENDING == xcd_deadline_items[i].state && xcd_deadline_items[i].priority < priority)
+            reserved += xcd_deadline_items[i].cost_ms;
+
+    return reserved;
+}
+
+void xcd_deadline_init(unsigned int budget_ms)
+{
+    xcd_deadline_budget_ms = budget_ms;
+    xcd_deadline_start_ms = xcd_deadline_get_time_ms();
+}
+
+void xcd_deadline_exclude(xcd_deadline_section_t section)
+{
+    if(XCD_DEADLINE_STATE_PENDING == xcd_deadline_items[section].state)
+        xcd_deadline_items[section].state = XCD_DEADLINE_STATE_EXCLUDED;
+}
+
+//start a section if the remaining time is enough for it and all pending sections with higher priority
+int xcd_deadline_begin(xcd_deadline_section_t section)
+{
+    xcd_deadline_item_t *item = &(xcd_deadline_items[section]);
+
+    if(XCD_DEADLINE_STATE_PENDING != item->state) return XCD_DEADLINE_STATE_STARTED == item->state;
+
+    if(0 == xcd_deadline_budget_ms ||
+       xcd_deadline_get_remaining_ms() >= item->cost_ms + xcd_deadline_get_reserved_ms(item->priority))
+    {
+        item->state = XCD_DEADLINE_STATE_STARTED;
+        return 1;
+    }
+
+    item->state = XCD_DEADLINE_STATE_SKIPPED;
+    return 0;
+}
+
+//check inside a section, degrade it if the remaining time is only enough for the pending sections with higher priority
+int xcd_deadline_check(xcd_deadline_section_t section, const char *degradation)
+{
+    size_t i;
+
+    if(0 == xcd_deadline_budget_ms) return 1;
+    if(xcd_deadline_get_remaining_ms() > xcd_deadline_get_reserved_ms(xcd_deadline_items[section].priority)) return 1;
+
+    //save the degradation (only once)
+    for(i = 0; i < xcd_deadline_degradations_num; i++)
+        if(0 == strcmp(xcd_deadline_degradations[i], degradation)) return 0;
+    if(xcd_deadline_degradations_num < XCD_DEADLINE_DEGRADATIONS_MAX)
+        xcd_deadline_degradations[xcd_deadline_degradations_num++] = degradation;
+    return 0;
+}
+
+int xcd_deadline_record(int log_fd)
+{
+    size_t i;
+    int    skipped = 0;
+    int    r;
+
+    if(0 == xcd_deadline_budget_ms) return 0;
+
+    for(i = 0; i < XCD_DEADLINE_SECTIONS_MAX; i++)
+        if(XCD_DEADLINE_STATE_SKIPPED == xcd_deadline_items[i].state) skipped = 1;
+    if(!skipped && 0 == xcd_deadline_degradations_num) return 0; //everything is OK
+
+    if(0 != (r = xcc_util_write_format(log_fd, "dump budget:\n    budget: %u ms, used: %"PRIu64" ms\n",
+                                       xcd_deadline_budget_ms, xcd_deadline_get_time_ms() - xcd_deadline_start_ms))) return r;
+    for(i = 0; i < XCD_DEADLINE_SECTIONS_MAX; i++)
+        if(XCD_DEADLINE_STATE_SKIPPED == xcd_deadline_items[i].state)
+            if(0 != (r = xcc_util_write_format(log_fd, "    skipped: %s\n", xcd_deadline_items[i].name))) return r;
+    for(i = 0; i < xcd_deadline_degradations_num; i++)
+        if(0 != (r = xcc_util_write_format(log_fd, "    degraded: %s\n", xcd_deadline_degradations[i]))) return r;
+    if(0 != (r = xcc_util_write_str(log_fd, "\n"))) return r;
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef XCD_DEADLINE_H
+#define XCD_DEADLINE_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//the optional sections, the basic info, registers and backtrace of the crashed thread are always recorded
+typedef enum
+{
+    XCD_DEADLINE_BUILDID = 0,
+    XCD_DEADLINE_STACK,
+    XCD_DEADLINE_MEMORY,
+    XCD_DEADLINE_THREADS,
+    XCD_DEADLINE_MAPS,
+    XCD_DEADLINE_BREADCRUMBS,
+    XCD_DEADLINE_LOGCAT,
+    XCD_DEADLINE_FDS,
+    XCD_DEADLINE_NETWORK,
+    XCD_DEADLINE_MEMINFO,
+    XCD_DEADLINE_ELF_HASH,
+    XCD_DEADLINE_MINICORE,
+    XCD_DEADLINE_SECTIONS_MAX
+} xcd_deadline_section_t;
+
+void xcd_deadline_init(unsigned int budget_ms);
+void xcd_deadline_exclude(xcd_deadline_section_t section);
+
+int xcd_deadline_begin(xcd_deadline_section_t section);
+int xcd_deadline_check(xcd_deadline_section_t section, const char *degradation);
+
+int xcd_deadline_record(int log_fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
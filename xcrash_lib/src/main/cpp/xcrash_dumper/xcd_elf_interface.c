@@ -113,6 +113,10 @@ struct xcd_elf_interface
     //.ARM.exidx
     size_t                   arm_exidx_offset;
     size_t                   arm_exidx_size;
+#ifdef __arm__
+    xcd_arm_exidx_t         *arm_exidx;
+    int                      arm_exidx_created;
+#endif
 
     //.gnu_debugdata
     size_t                   gnu_debugdata_offset;
@@ -486,10 +490,17 @@ int xcd_elf_interface_arm_exidx_step(xcd_elf_interface_t *self, uintptr_t step_p
 {
     int r;
     
-    if(0 != self->arm_exidx_offset && 0 != self->arm_exidx_size)
+    //create .ARM.exidx object (only once)
+    if(NULL == self->arm_exidx && 0 == self->arm_exidx_created)
+    {
+        self->arm_exidx_created = 1;
+        if(0 != self->arm_exidx_offset && 0 != self->arm_exidx_size)
+            xcd_arm_exidx_create(&(self->arm_exidx), self->memory, self->pid, self->arm_exidx_offset, self->arm_exidx_size);
+    }
+
+    if(NULL != self->arm_exidx)
     {
-        r = xcd_arm_exidx_step(regs, self->memory, self->pid, self->arm_exidx_offset, self->arm_exidx_size,
-                                  self->load_bias, step_pc, finished);
+        r = xcd_arm_exidx_step(self->arm_exidx, regs, self->load_bias, step_pc, finished);
 #if XCD_ELF_INTERFACE_DEBUG
         XCD_LOG_DEBUG("ELF: step by .ARM.exidx %s, step_pc=%x, load_bias=%x, finished=%d",
                       (0 == r ? "OK" : "FAILED"), step_pc, self->load_bias, *finished);
@@ -34,14 +34,25 @@
 #include "queue.h"
 #include "xcc_errno.h"
 #include "xcc_util.h"
+#include "xcc_spot.h"
 #include "xcd_frames.h"
 #include "xcd_md5.h"
+#include "xcd_xxh3.h"
 #include "xcd_util.h"
 #include "xcd_elf.h"
+#include "xcd_deadline.h"
 #include "xcd_log.h"
 
 #define XCD_FRAMES_MAX         256
 #define XCD_FRAMES_STACK_WORDS 16
+#define XCD_FRAMES_SCAN_WORDS  1024 //budget of the stack scanning for each thread
+
+//recursion folding: repeated cycles of at most 8 frames, at least 8 frames repeated
+#define XCD_FRAMES_FOLD_PERIOD_MAX 8
+#define XCD_FRAMES_FOLD_MIN        8
+
+#define XCD_FRAMES_FNV_OFFSET  0xcbf29ce484222325ULL
+#define XCD_FRAMES_FNV_PRIME   0x100000001b3ULL
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
@@ -52,8 +63,13 @@ typedef struct xcd_frame
     uintptr_t  pc;
     uintptr_t  rel_pc;
     uintptr_t  sp;
+    xcd_elf_t *elf;      //for symbolizing, NULL if the ELF is not found
+    uintptr_t  elf_pc;   //PC in the ELF for symbolizing
     char      *func_name;
     size_t     func_offset;
+    int        scanned;
+    int        folded;   //hidden in the repeated frames
+    size_t     repeated; //number of the folded frames after this one
     TAILQ_ENTRY(xcd_frame,) link;
 } xcd_frame_t;
 #pragma clang diagnostic pop
@@ -68,9 +84,114 @@ struct xcd_frames
     xcd_maps_t        *maps;
     xcd_frame_queue_t  frames;
     size_t             frames_num;
+    int                stack_scan;
+    size_t             scan_words; //words left in the budget
+    int                symbolized;
 };
 #pragma clang diagnostic pop
 
+//Is the instruction before the return address a call?
+static int xcd_frames_is_after_call(xcd_frames_t *self, uintptr_t ret)
+{
+#if defined(__arm__)
+    uint32_t  insn;
+    uint16_t  hw[2];
+
+    if(ret & 1)
+    {
+        //thumb: BL / BLX (immediate) is 32-bit, BLX (register) is 16-bit
+        ret &= ~((uintptr_t)1);
+        if(ret < 4 || sizeof(hw) != xcd_util_ptrace_read(self->pid, ret - 4, hw, sizeof(hw))) return 0;
+        if(0xF000 == (hw[0] & 0xF800) && 0xD000 == (hw[1] & 0xD000)) return 1; //BL
+        if(0xF000 == (hw[0] & 0xF800) && 0xC000 == (hw[1] & 0xD001)) return 1; //BLX (immediate)
+        if(0x4780 == (hw[1] & 0xFF87)) return 1;
+        return 0;
+    }
+    else
+    {
+        //arm: BL, BLX (register)
+        if(ret < 4 || sizeof(insn) != xcd_util_ptrace_read(self->pid, ret - 4, &insn, sizeof(insn))) return 0;
+        if(0xF0000000 != (insn & 0xF0000000) && 0x0B000000 == (insn & 0x0F000000)) return 1;
+        if(0x012FFF30 == (insn & 0x0FFFFFF0)) return 1;
+        if(0xFA000000 == (insn & 0xFE000000)) return 1; //BLX (immediate)
+        return 0;
+    }
+#elif defined(__aarch64__)
+    uint32_t insn;
+
+    //BL, BLR (and BLRAA / BLRAB ... with pointer authentication)
+    if(0 != (ret & 3) || ret < 4 || sizeof(insn) != xcd_util_ptrace_read(self->pid, ret - 4, &insn, sizeof(insn))) return 0;
+    if(0x94000000 == (insn & 0xFC000000)) return 1;
+    if(0xD63F0000 == (insn & 0xFFFFFC1F)) return 1;
+    if(0xD63F0800 == (insn & 0xFEFFF800)) return 1;
+    return 0;
+#elif defined(__i386__) || defined(__x86_64__)
+    uint8_t code[7];
+
+    //CALL rel32, or CALL r/m (FF /2) with 0, 1 or 4 bytes displacement (with or without SIB)
+    if(ret < sizeof(code) || sizeof(code) != xcd_util_ptrace_read(self->pid, ret - sizeof(code), code, sizeof(code))) return 0;
+    if(0xE8 == code[2]) return 1;
+    if(0xFF == code[5] && 0x10 == (code[6] & 0x38) && 0xC0 == (code[6] & 0xC0)) return 1; //call reg
+    if(0xFF == code[5] && 0x10 == (code[6] & 0x38)) return 1; //call [reg]
+    if(0xFF == code[4] && 0x10 == (code[5] & 0x38)) return 1; //call [reg+disp8] / [sib]
+    if(0xFF == code[3] && 0x10 == (code[4] & 0x38)) return 1; //call [sib+disp8]
+    if(0xFF == code[1] && 0x10 == (code[2] & 0x38)) return 1; //call [reg+disp32] / [rip+disp32]
+    if(0xFF == code[0] && 0x10 == (code[1] & 0x38)) return 1; //call [sib+disp32]
+    return 0;
+#endif
+}
+
+//The last resort when both CFI and LR failed: scan the stack words upward from SP, take the
+//first word pointing to an executable map which has a valid ELF (or anonymous, e.g. JIT code),
+//right after a call instruction. Each candidate is checked with a binary search in the sorted
+//executable ranges first, before loading the ELF or reading the code.
+static int xcd_frames_scan_stack(xcd_frames_t *self, xcd_regs_t *regs)
+{
+    uintptr_t  words[64];
+    uintptr_t  sp = xcd_regs_get_sp(regs);
+    uintptr_t  addr;
+    size_t     n, i;
+    xcd_map_t *map;
+
+    if(!self->stack_scan) return XCC_ERRNO_NOTFND;
+
+    //stack must be readable and not in a device map
+    if(NULL == (map = xcd_maps_find_map(self->maps, sp)) || !(map->flags & PROT_READ) || (map->flags & XCD_MAP_PORT_DEVICE))
+        return XCC_ERRNO_NOTFND;
+
+    addr = sp;
+    while(self->scan_words > 0 && addr < map->end)
+    {
+        n = sizeof(words) / sizeof(words[0]);
+        if(n > self->scan_words) n = self->scan_words;
+        if(n > (map->end - addr) / sizeof(uintptr_t)) n = (map->end - addr) / sizeof(uintptr_t);
+        if(0 == n) break;
+        if(0 == (n = xcd_util_ptrace_read(self->pid, addr, words, n * sizeof(uintptr_t)) / sizeof(uintptr_t))) break;
+        self->scan_words -= n;
+
+        for(i = 0; i < n; i++)
+        {
+            xcd_map_t *ret_map;
+
+            if(words[i] < 4096) continue;
+            if(!xcd_maps_is_text(self->maps, words[i])) continue;
+            if(NULL == (ret_map = xcd_maps_find_map(self->maps, words[i]))) continue;
+            if(NULL != ret_map->name && '\0' != ret_map->name[0] && '[' != ret_map->name[0] &&
+               NULL == xcd_map_get_elf(ret_map, self->pid, (void *)self->maps)) continue;
+            if(!xcd_frames_is_after_call(self, words[i])) continue;
+
+            //found
+            xcd_regs_set_pc(regs, words[i]);
+            xcd_regs_set_sp(regs, addr + (i + 1) * sizeof(uintptr_t));
+            return 0;
+        }
+
+        addr += n * sizeof(uintptr_t);
+    }
+
+    return XCC_ERRNO_NOTFND;
+}
+
 static void xcd_frames_load(xcd_frames_t *self)
 {
     xcd_frame_t  *frame;
@@ -82,12 +203,14 @@ static void xcd_frames_load(xcd_frames_t *self)
     uintptr_t     cur_sp;
     uintptr_t     step_pc;
     uintptr_t     rel_pc;
+    uintptr_t     elf_pc;
     uintptr_t     pc_adjustment;
     int           stepped;
     int           in_device_map;
     int           return_address_attempt = 0;
     int           finished;
     int           sigreturn;
+    int           scanned = 0;
     uintptr_t     load_bias;
     xcd_memory_t *memory;
     xcd_regs_t    regs_copy = *(self->regs);
@@ -101,6 +224,7 @@ static void xcd_frames_load(xcd_frames_t *self)
         cur_pc = xcd_regs_get_pc(&regs_copy);
         cur_sp = xcd_regs_get_sp(&regs_copy);
         rel_pc = cur_pc;
+        elf_pc = cur_pc;
         step_pc = cur_pc;
         pc_adjustment = 0;
         in_device_map = 0;
@@ -112,7 +236,7 @@ static void xcd_frames_load(xcd_frames_t *self)
         if(NULL != (map = xcd_maps_find_map(self->maps, cur_pc)))
         {
             rel_pc = xcd_map_get_rel_pc(map, step_pc, self->pid, (void *)self->maps);
-            step_pc = rel_pc;
+            elf_pc = rel_pc;
 
             elf = xcd_map_get_elf(map, self->pid, (void *)self->maps);
             if(NULL != elf)
@@ -120,11 +244,16 @@ static void xcd_frames_load(xcd_frames_t *self)
                 load_bias = xcd_elf_get_load_bias(elf);
                 memory = xcd_elf_get_memory(elf);
             }
+            else if((map->flags & PROT_EXEC) && NULL != (elf = xcd_maps_find_jit_elf(self->maps, cur_pc)))
+            {
+                //JIT code, the in-memory symfile uses the absolute addresses
+                elf_pc = cur_pc;
+            }
 
             if(adjust_pc)
                 pc_adjustment = xcd_regs_get_adjust_pc(rel_pc, load_bias, memory);
             
-            step_pc -= pc_adjustment;
+            step_pc = elf_pc - pc_adjustment;
         }
         adjust_pc = 1;
 
@@ -135,10 +264,14 @@ static void xcd_frames_load(xcd_frames_t *self)
         frame->pc = cur_pc - pc_adjustment;
         frame->rel_pc = rel_pc - pc_adjustment;
         frame->sp = cur_sp;
+        frame->elf = elf;
+        frame->elf_pc = step_pc;
         frame->func_name = NULL;
         frame->func_offset = 0;
-        if(NULL != elf)
-            xcd_elf_get_function_info(elf, step_pc, &(frame->func_name), &(frame->func_offset));
+        frame->scanned = scanned;
+        frame->folded = 0;
+        frame->repeated = 0;
+        scanned = 0;
         TAILQ_INSERT_TAIL(&(self->frames), frame, link);
         self->frames_num++;
 
@@ -172,7 +305,7 @@ static void xcd_frames_load(xcd_frames_t *self)
 #if XCD_FRAMES_DEBUG
             XCD_LOG_DEBUG("FRAMES: step, rel_pc=%"PRIxPTR", step_pc=%"PRIxPTR", ELF=%s", rel_pc, step_pc, frame->map->name);
 #endif
-            if(0 == xcd_elf_step(elf, rel_pc, step_pc, &regs_copy, &finished, &sigreturn))
+            if(0 == xcd_elf_step(elf, elf_pc, step_pc, &regs_copy, &finished, &sigreturn))
                 stepped = 1;
             else
                 stepped = 0;
@@ -207,7 +340,11 @@ static void xcd_frames_load(xcd_frames_t *self)
                     if(frame->func_name) free(frame->func_name);
                     free(frame);
                 }
-                break;
+
+                //the last resort
+                if(0 != xcd_frames_scan_stack(self, &regs_copy)) break;
+                scanned = 1;
+                return_address_attempt = 0;
             }
             else if(in_device_map)
             {
@@ -216,8 +353,16 @@ static void xcd_frames_load(xcd_frames_t *self)
             else
             {
                 //try this secondary method
-                if(0 != xcd_regs_set_pc_from_lr(&regs_copy, self->pid)) break;
-                return_address_attempt = 1;
+                if(0 == xcd_regs_set_pc_from_lr(&regs_copy, self->pid))
+                {
+                    return_address_attempt = 1;
+                }
+                else
+                {
+                    //the last resort
+                    if(0 != xcd_frames_scan_stack(self, &regs_copy)) break;
+                    scanned = 1;
+                }
             }
         }
         else
@@ -232,7 +377,65 @@ static void xcd_frames_load(xcd_frames_t *self)
     }
 }
 
-int xcd_frames_create(xcd_frames_t **self, xcd_regs_t *regs, xcd_maps_t *maps, pid_t pid)
+static int xcd_frames_is_same(xcd_frame_t *a, xcd_frame_t *b)
+{
+    return a->map == b->map && (NULL == a->map ? a->pc == b->pc : a->rel_pc == b->rel_pc);
+}
+
+//Fold the recursion (e.g. stack overflow). For each position, find the cycle which repeats
+//the most frames right after it. Keep the first cycle, the top and bottom frames.
+static void xcd_frames_fold(xcd_frames_t *self)
+{
+    xcd_frame_t *frames[XCD_FRAMES_MAX];
+    xcd_frame_t *frame;
+    size_t       n = 0, i = 0, k, period, run, best_period, best_run;
+
+    TAILQ_FOREACH(frame, &(self->frames), link)
+        if(n < XCD_FRAMES_MAX) frames[n++] = frame;
+
+    while(i + XCD_FRAMES_FOLD_MIN < n)
+    {
+        best_period = 0;
+        best_run = 0;
+        for(period = 1; period <= XCD_FRAMES_FOLD_PERIOD_MAX && i + period < n; period++)
+        {
+            run = 0;
+            while(i + period + run < n && xcd_frames_is_same(frames[i + run], frames[i + period + run])) run++;
+            run -= run % period; //whole cycles only
+            if(run > best_run)
+            {
+                best_period = period;
+                best_run = run;
+            }
+        }
+
+        if(best_run < XCD_FRAMES_FOLD_MIN)
+        {
+            i++;
+            continue;
+        }
+
+        frames[i + best_period - 1]->repeated = best_run;
+        for(k = i + best_period; k < i + best_period + best_run; k++)
+            frames[k]->folded = 1;
+        i += best_period + best_run;
+    }
+}
+
+//The function names are looked up on first use, threads with identical stacks are never symbolized.
+void xcd_frames_symbolize(xcd_frames_t *self)
+{
+    xcd_frame_t *frame;
+
+    if(self->symbolized) return;
+    self->symbolized = 1;
+
+    TAILQ_FOREACH(frame, &(self->frames), link)
+        if(NULL != frame->elf)
+            xcd_elf_get_function_info(frame->elf, frame->elf_pc, &(frame->func_name), &(frame->func_offset));
+}
+
+int xcd_frames_create(xcd_frames_t **self, xcd_regs_t *regs, xcd_maps_t *maps, pid_t pid, int stack_scan)
 {
     if(NULL == (*self = malloc(sizeof(xcd_frames_t)))) return XCC_ERRNO_NOMEM;
     (*self)->pid = pid;
@@ -240,12 +443,30 @@ int xcd_frames_create(xcd_frames_t **self, xcd_regs_t *regs, xcd_maps_t *maps, p
     (*self)->maps = maps;
     TAILQ_INIT(&((*self)->frames));
     (*self)->frames_num = 0;
+    (*self)->stack_scan = stack_scan;
+    (*self)->scan_words = XCD_FRAMES_SCAN_WORDS;
+    (*self)->symbolized = 0;
     
     xcd_frames_load(*self);
+    xcd_frames_fold(*self);
     
     return 0;
 }
 
+void xcd_frames_destroy(xcd_frames_t **self)
+{
+    xcd_frame_t *frame, *frame_tmp;
+
+    TAILQ_FOREACH_SAFE(frame, &((*self)->frames), link, frame_tmp)
+    {
+        TAILQ_REMOVE(&((*self)->frames), frame, link);
+        if(NULL != frame->func_name) free(frame->func_name);
+        free(frame);
+    }
+    free(*self);
+    *self = NULL;
+}
+
 int xcd_frames_record_backtrace(xcd_frames_t *self, int log_fd)
 {
     xcd_frame_t *frame;
@@ -259,10 +480,14 @@ int xcd_frames_record_backtrace(xcd_frames_t *self, int log_fd)
     char         func_buf[512];
     int          r;
 
+    xcd_frames_symbolize(self);
+
     if(0 != (r = xcc_util_write_str(log_fd, "backtrace:\n"))) return r;
     
     TAILQ_FOREACH(frame, &(self->frames), link)
     {
+        if(frame->folded) continue;
+
         //name
         name = NULL;
         if(NULL == frame->map)
@@ -317,8 +542,12 @@ int xcd_frames_record_backtrace(xcd_frames_t *self, int log_fd)
             func = "";
         }
 
-        if(0 != (r = xcc_util_write_format(log_fd, "    #%02zu pc %0"XCC_UTIL_FMT_ADDR"  %s%s%s\n",
-                                           frame->num, frame->rel_pc, name, offset, func))) return r;
+        if(0 != (r = xcc_util_write_format(log_fd, "    #%02zu pc %0"XCC_UTIL_FMT_ADDR"  %s%s%s%s\n",
+                                           frame->num, frame->rel_pc, name, offset, func,
+                                           frame->scanned ? " [scanned]" : ""))) return r;
+
+        if(frame->repeated > 0)
+            if(0 != (r = xcc_util_write_format(log_fd, "    ... %zu frames repeated ...\n", frame->repeated))) return r;
     }
 
     if(0 != (r = xcc_util_write_str(log_fd, "\n"))) return r;
@@ -326,6 +555,145 @@ int xcd_frames_record_backtrace(xcd_frames_t *self, int log_fd)
     return 0;
 }
 
+static uint64_t xcd_frames_fnv1a(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t         i;
+
+    for(i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= XCD_FRAMES_FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t xcd_frames_get_signature(xcd_frames_t *self, size_t frames_max)
+{
+    xcd_frame_t *frame;
+    xcd_elf_t   *elf;
+    const char  *name;
+    uint8_t      build_id[64];
+    size_t       build_id_len;
+    uint64_t     rel_pc;
+    uint64_t     hash = XCD_FRAMES_FNV_OFFSET;
+    size_t       n = 0;
+
+    xcd_frames_symbolize(self);
+
+    TAILQ_FOREACH(frame, &(self->frames), link)
+    {
+        if(n++ >= frames_max) break;
+
+        if(NULL == frame->map || NULL == frame->map->name || '\0' == frame->map->name[0])
+        {
+            //the PC is meaningless without a named map (e.g. JIT code), keep only the frame position
+            hash = xcd_frames_fnv1a(hash, "?", 1);
+        }
+        else
+        {
+            //ELF identity: build-id, or the basename of the file
+            build_id_len = 0;
+            if(NULL != (elf = xcd_map_get_elf(frame->map, self->pid, (void *)self->maps)) &&
+               0 == xcd_elf_get_build_id(elf, build_id, sizeof(build_id), &build_id_len) && build_id_len > 0)
+            {
+                hash = xcd_frames_fnv1a(hash, build_id, build_id_len);
+            }
+            else
+            {
+                name = strrchr(frame->map->name, '/');
+                name = (NULL == name ? frame->map->name : name + 1);
+                hash = xcd_frames_fnv1a(hash, name, strlen(name));
+            }
+
+            //relative PC is stable across ASLR
+            rel_pc = (uint64_t)frame->rel_pc;
+            hash = xcd_frames_fnv1a(hash, &rel_pc, sizeof(rel_pc));
+        }
+
+        //function name without the offset
+        if(NULL != frame->func_name)
+            hash = xcd_frames_fnv1a(hash, frame->func_name, strlen(frame->func_name));
+
+        //frame separator
+        hash = xcd_frames_fnv1a(hash, "|", 1);
+    }
+
+    return (0 == n ? 0 : hash);
+}
+
+//for finding the threads with identical stacks in the same process,
+//only the raw unwound PCs are used, so it does not need the symbols
+uint64_t xcd_frames_get_stack_hash(xcd_frames_t *self)
+{
+    xcd_frame_t *frame;
+    uint64_t     hash = XCD_FRAMES_FNV_OFFSET;
+
+    TAILQ_FOREACH(frame, &(self->frames), link)
+        hash = xcd_frames_fnv1a(hash, &(frame->pc), sizeof(frame->pc));
+
+    return hash;
+}
+
+//confirm the same stack hash frame by frame
+int xcd_frames_is_same_stack(xcd_frames_t *self, xcd_frames_t *other)
+{
+    xcd_frame_t *frame, *frame_other;
+
+    if(self->frames_num != other->frames_num) return 0;
+
+    for(frame = TAILQ_FIRST(&(self->frames)), frame_other = TAILQ_FIRST(&(other->frames));
+        NULL != frame && NULL != frame_other;
+        frame = TAILQ_NEXT(frame, link), frame_other = TAILQ_NEXT(frame_other, link))
+        if(frame->map != frame_other->map || frame->rel_pc != frame_other->rel_pc) return 0;
+
+    return (NULL == frame && NULL == frame_other) ? 1 : 0;
+}
+
+//folded stack (from the outermost frame to the innermost frame), the folded recursion is skipped
+size_t xcd_frames_get_folded(xcd_frames_t *self, char *buf, size_t buf_len)
+{
+    xcd_frame_t *frame;
+    const char  *name;
+    size_t       used = 0;
+    int          len;
+
+    if(0 == buf_len) return 0;
+    buf[0] = '\0';
+
+    xcd_frames_symbolize(self);
+
+    TAILQ_FOREACH_REVERSE(frame, &(self->frames), xcd_frame_queue, link)
+    {
+        if(frame->folded) continue;
+        if(used + 2 >= buf_len) break;
+        if(used > 0) buf[used++] = ';';
+
+        if(NULL == frame->map)
+        {
+            len = snprintf(buf + used, buf_len - used, "0x%"PRIxPTR, frame->pc);
+        }
+        else
+        {
+            if(NULL == frame->map->name || '\0' == frame->map->name[0])
+                name = "<anonymous>";
+            else
+                name = (NULL == (name = strrchr(frame->map->name, '/')) ? frame->map->name : name + 1);
+
+            if(NULL != frame->func_name)
+                len = snprintf(buf + used, buf_len - used, "%s!%s", name, frame->func_name);
+            else
+                len = snprintf(buf + used, buf_len - used, "%s+0x%"PRIxPTR, name, frame->rel_pc);
+        }
+
+        if(len < 0) break;
+        used += ((size_t)len >= buf_len - used ? buf_len - used - 1 : (size_t)len);
+    }
+    buf[used] = '\0';
+
+    return used;
+}
+
 static int xcd_frames_record_buildid_line(xcd_frames_t *self, const char *name, xcd_map_t *map, int log_fd, int dump_elf_hash)
 {
     char    buf[1024];
@@ -389,8 +757,8 @@ static int xcd_frames_record_buildid_line(xcd_frames_t *self, const char *name,
         offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, ". LastModified: %s", "unknown");
     }
 
-    //append md5
-    if(dump_elf_hash)
+    //append md5 or xxh3
+    if(dump_elf_hash && xcd_deadline_check(XCD_DEADLINE_ELF_HASH, "elf hash"))
     {
         size_t name_len = strlen(name);
         if(st.st_size > 0
@@ -404,18 +772,30 @@ static int xcd_frames_record_buildid_line(xcd_frames_t *self, const char *name,
                 error_from = "MMAP";
                 goto err;
             }
-            
-            uint8_t md5[16];
-            xcd_MD5_CTX ctx;
-            xcd_MD5_Init(&ctx);
-            xcd_MD5_Update(&ctx, data, (unsigned long)st.st_size);
-            xcd_MD5_Final(md5, &ctx);
-            
-            munmap(data, (size_t)st.st_size);
-            
-            offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, "%s", ". MD5: ");
-            for(i = 0; i < sizeof(md5); i++)
-                offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, "%02hhx", md5[i]);
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+            if(XCC_SPOT_ELF_HASH_XXH3 == dump_elf_hash)
+            {
+                uint64_t xxh3;
+                int r = xcd_xxh3_tree(data, (size_t)st.st_size, &xxh3);
+                munmap(data, (size_t)st.st_size);
+                if(0 == r)
+                    offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, ". XXH3: %016"PRIx64, xxh3);
+            }
+            else
+            {
+                uint8_t md5[16];
+                xcd_MD5_CTX ctx;
+                xcd_MD5_Init(&ctx);
+                xcd_MD5_Update(&ctx, data, (unsigned long)st.st_size);
+                xcd_MD5_Final(md5, &ctx);
+
+                munmap(data, (size_t)st.st_size);
+
+                offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, "%s", ". MD5: ");
+                for(i = 0; i < sizeof(md5); i++)
+                    offset += (size_t)snprintf(buf + offset, sizeof(buf) - offset, "%02hhx", md5[i]);
+            }
         }
     }
 
@@ -520,27 +900,44 @@ static int xcd_frames_record_stack_segment(xcd_frames_t *self, int log_fd,
 
         //file, func-name, func-offset
         map = NULL;
+        elf = NULL;
+        rel_pc = 0;
         func_name = NULL;
         func_offset = 0;
         if(NULL != (map = xcd_maps_find_map(self->maps, stack_data[i])) &&
-           NULL != map->name && '\0' != map->name[0])
+           xcd_deadline_check(XCD_DEADLINE_STACK, "stack symbols"))
         {
-            line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len,
-                                         "  %s", map->name);
-
-            if(NULL != (elf = xcd_map_get_elf(map, self->pid, (void *)self->maps)))
+            if(NULL != map->name && '\0' != map->name[0])
             {
-                if(0 != map->elf_start_offset)
+                line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len,
+                                             "  %s", map->name);
+
+                if(NULL != (elf = xcd_map_get_elf(map, self->pid, (void *)self->maps)))
                 {
-                    name_embedded = xcd_elf_get_so_name(elf);
-                    if(NULL != name_embedded && strlen(name_embedded) > 0)
+                    if(0 != map->elf_start_offset)
                     {
-                        line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len, "!%s", name_embedded);
+                        name_embedded = xcd_elf_get_so_name(elf);
+                        if(NULL != name_embedded && strlen(name_embedded) > 0)
+                        {
+                            line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len, "!%s", name_embedded);
+                        }
                     }
+
+                    rel_pc = xcd_map_get_rel_pc(map, stack_data[i], self->pid, (void *)self->maps);
                 }
+            }
+
+            //JIT code
+            if(NULL == elf && (map->flags & PROT_EXEC) && NULL != (elf = xcd_maps_find_jit_elf(self->maps, stack_data[i])))
+            {
+                if(NULL == map->name || '\0' == map->name[0])
+                    line_len += (size_t)snprintf(line + line_len, sizeof(line) - line_len,
+                                                 "  <anonymous:%"XCC_UTIL_FMT_ADDR">", map->start);
+                rel_pc = stack_data[i];
+            }
 
-                rel_pc = xcd_map_get_rel_pc(map, stack_data[i], self->pid, (void *)self->maps);
-                
+            if(NULL != elf)
+            {
                 func_name = NULL;
                 func_offset = 0;
                 xcd_elf_get_function_info(elf, rel_pc, &func_name, &func_offset);
@@ -580,6 +977,8 @@ int xcd_frames_record_stack(xcd_frames_t *self, int log_fd)
 
     TAILQ_FOREACH(frame, &(self->frames), link)
     {
+        if(frame->folded) continue;
+
         if(0 == frame->sp)
         {
             if(segment_recorded)
@@ -603,6 +1002,7 @@ int xcd_frames_record_stack(xcd_frames_t *self, int log_fd)
         }
 
         next_frame = TAILQ_NEXT(frame, link);
+        while(NULL != next_frame && next_frame->folded) next_frame = TAILQ_NEXT(next_frame, link);
         if(NULL == next_frame || 0 == next_frame->sp || next_frame->sp < frame->sp)
         {
             //the last
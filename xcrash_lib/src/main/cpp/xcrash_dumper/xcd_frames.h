@@ -35,13 +35,20 @@ extern "C" {
 
 typedef struct xcd_frames xcd_frames_t;
 
-int xcd_frames_create(xcd_frames_t **self, xcd_regs_t *regs, xcd_maps_t *maps, pid_t pid);
+int xcd_frames_create(xcd_frames_t **self, xcd_regs_t *regs, xcd_maps_t *maps, pid_t pid, int stack_scan);
 void xcd_frames_destroy(xcd_frames_t **self);
 
+void xcd_frames_symbolize(xcd_frames_t *self);
+
 int xcd_frames_record_backtrace(xcd_frames_t *self, int log_fd);
 int xcd_frames_record_buildid(xcd_frames_t *self, int log_fd, int dump_elf_hash, uintptr_t fault_addr);
 int xcd_frames_record_stack(xcd_frames_t *self, int log_fd);
 
+uint64_t xcd_frames_get_signature(xcd_frames_t *self, size_t frames_max);
+uint64_t xcd_frames_get_stack_hash(xcd_frames_t *self);
+int xcd_frames_is_same_stack(xcd_frames_t *self, xcd_frames_t *other);
+size_t xcd_frames_get_folded(xcd_frames_t *self, char *buf, size_t buf_len);
+
 #ifdef __cplusplus
 }
 #endif
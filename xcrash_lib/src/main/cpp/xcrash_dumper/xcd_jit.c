@@ -0,0 +1,238 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <link.h>
+#include <elf.h>
+#include <sys/types.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_jit.h"
+#include "xcd_maps.h"
+#include "xcd_memory.h"
+#include "xcd_elf.h"
+#include "xcd_util.h"
+#include "xcd_log.h"
+
+#define XCD_JIT_DESCRIPTOR   "__jit_debug_descriptor"
+#define XCD_JIT_ENTRIES_MAX  8192
+#define XCD_JIT_SYMFILE_MAX  (1024 * 1024)
+#define XCD_JIT_TOTAL_MAX    (16 * 1024 * 1024)
+
+//the leading fields of the GDB JIT interface, same in all ART versions
+//(the dumper has the same ABI as the crashed process, so the native layout just fits)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    uint32_t  version;
+    uint32_t  action_flag;
+    uintptr_t relevant_entry;
+    uintptr_t first_entry;
+} xcd_jit_descriptor_t;
+
+typedef struct
+{
+    uintptr_t next;
+    uintptr_t prev;
+    uintptr_t symfile_addr;
+    uint64_t  symfile_size;
+} xcd_jit_code_entry_t;
+
+typedef struct
+{
+    uintptr_t  start;
+    uintptr_t  end;
+    xcd_elf_t *elf;
+} xcd_jit_symfile_t;
+
+struct xcd_jit
+{
+    pid_t              pid;
+    xcd_jit_symfile_t *symfiles; //sorted by start address
+    size_t             symfiles_num;
+    size_t             symfiles_cap;
+};
+#pragma clang diagnostic pop
+
+static uintptr_t xcd_jit_find_descriptor(void *maps_obj)
+{
+    xcd_maps_t *maps = (xcd_maps_t *)maps_obj;
+    uintptr_t   addr;
+
+    if(0 != (addr = xcd_maps_find_pc(maps, XCC_UTIL_LIBART_APEX_30, XCD_JIT_DESCRIPTOR))) return addr;
+    if(0 != (addr = xcd_maps_find_pc(maps, XCC_UTIL_LIBART_APEX_29, XCD_JIT_DESCRIPTOR))) return addr;
+    return xcd_maps_find_pc(maps, XCC_UTIL_LIBART, XCD_JIT_DESCRIPTOR);
+}
+
+//the address range of the executable sections
+static int xcd_jit_get_text_range(uint8_t *buf, size_t len, uintptr_t *start, uintptr_t *end)
+{
+    ElfW(Ehdr) ehdr;
+    ElfW(Shdr) shdr;
+    size_t     i, offset;
+
+    *start = UINTPTR_MAX;
+    *end = 0;
+
+    memcpy(&ehdr, buf, sizeof(ehdr));
+    if(ehdr.e_shentsize < sizeof(shdr) || ehdr.e_shoff > len) return XCC_ERRNO_FORMAT;
+
+    for(i = 0; i < ehdr.e_shnum; i++)
+    {
+        offset = ehdr.e_shoff + i * ehdr.e_shentsize;
+        if(offset + sizeof(shdr) > len) break;
+        memcpy(&shdr, buf + offset, sizeof(shdr));
+        if(!(shdr.sh_flags & SHF_EXECINSTR) || 0 == shdr.sh_size) continue;
+
+        if(shdr.sh_addr < *start) *start = shdr.sh_addr;
+        if(shdr.sh_addr + shdr.sh_size > *end) *end = shdr.sh_addr + shdr.sh_size;
+    }
+
+    return *start < *end ? 0 : XCC_ERRNO_NOTFND;
+}
+
+static int xcd_jit_add_symfile(xcd_jit_t *self, uintptr_t addr, size_t size)
+{
+    uint8_t           *buf = NULL;
+    xcd_memory_t      *memory = NULL;
+    xcd_elf_t         *elf = NULL;
+    xcd_jit_symfile_t *symfiles;
+    uintptr_t          start, end;
+    int                r;
+
+    //copy the whole in-memory ELF to local, in one remote read
+    if(NULL == (buf = malloc(size))) return XCC_ERRNO_NOMEM;
+    if(0 != (r = xcd_util_ptrace_read_fully(self->pid, addr, buf, size))) goto err;
+    if(0 != (r = xcd_jit_get_text_range(buf, size, &start, &end))) goto err;
+    if(0 != (r = xcd_memory_create_from_buf(&memory, buf, size))) goto err;
+    buf = NULL; //owned by memory now
+    if(!xcd_elf_is_valid(memory))
+    {
+        r = XCC_ERRNO_FORMAT;
+        goto err;
+    }
+    if(0 != (r = xcd_elf_create(&elf, self->pid, memory))) goto err;
+
+    //append
+    if(self->symfiles_num == self->symfiles_cap)
+    {
+        if(NULL == (symfiles = realloc(self->symfiles, sizeof(xcd_jit_symfile_t) * (0 == self->symfiles_cap ? 64 : self->symfiles_cap * 2))))
+        {
+            r = XCC_ERRNO_NOMEM;
+            goto err; //the ELF object is leaked here, it's fine in the dumper
+        }
+        self->symfiles = symfiles;
+        self->symfiles_cap = (0 == self->symfiles_cap ? 64 : self->symfiles_cap * 2);
+    }
+    self->symfiles[self->symfiles_num].start = start;
+    self->symfiles[self->symfiles_num].end = end;
+    self->symfiles[self->symfiles_num].elf = elf;
+    self->symfiles_num++;
+    return 0;
+
+ err:
+    if(NULL == elf && NULL != memory) xcd_memory_destroy(&memory);
+    if(NULL != buf) free(buf);
+    return r;
+}
+
+static int xcd_jit_symfile_cmp(const void *a, const void *b)
+{
+    const xcd_jit_symfile_t *sa = (const xcd_jit_symfile_t *)a;
+    const xcd_jit_symfile_t *sb = (const xcd_jit_symfile_t *)b;
+
+    if(sa->start < sb->start) return -1;
+    if(sa->start > sb->start) return 1;
+    return 0;
+}
+
+int xcd_jit_create(xcd_jit_t **self, pid_t pid, void *maps_obj)
+{
+    xcd_jit_descriptor_t desc;
+    xcd_jit_code_entry_t entry;
+    uintptr_t            desc_addr, entry_addr;
+    size_t               entries = 0, total = 0;
+
+    if(NULL == (*self = calloc(1, sizeof(xcd_jit_t)))) return XCC_ERRNO_NOMEM;
+    (*self)->pid = pid;
+
+    //no JIT descriptor is not an error, just nothing to index
+    if(0 == (desc_addr = xcd_jit_find_descriptor(maps_obj))) return 0;
+    if(0 != xcd_util_ptrace_read_fully(pid, desc_addr, &desc, sizeof(desc))) return 0;
+    if(0 == desc.version) return 0;
+
+    //walk the entries list, one remote read for each entry
+    entry_addr = desc.first_entry;
+    while(0 != entry_addr && entries++ < XCD_JIT_ENTRIES_MAX)
+    {
+        if(0 != xcd_util_ptrace_read_fully(pid, entry_addr, &entry, sizeof(entry))) break;
+        if(entry.next == entry_addr) break;
+        entry_addr = entry.next;
+
+        if(0 == entry.symfile_addr || entry.symfile_size < sizeof(ElfW(Ehdr)) || entry.symfile_size > XCD_JIT_SYMFILE_MAX) continue;
+        if(total + entry.symfile_size > XCD_JIT_TOTAL_MAX) break;
+        total += (size_t)entry.symfile_size;
+
+        xcd_jit_add_symfile(*self, entry.symfile_addr, (size_t)entry.symfile_size);
+    }
+
+    //build the index
+    if((*self)->symfiles_num > 1)
+        qsort((*self)->symfiles, (*self)->symfiles_num, sizeof(xcd_jit_symfile_t), xcd_jit_symfile_cmp);
+
+#if XCD_JIT_DEBUG
+    XCD_LOG_DEBUG("JIT: %zu entries, %zu symfiles, %zu bytes", entries, (*self)->symfiles_num, total);
+#endif
+    return 0;
+}
+
+void xcd_jit_destroy(xcd_jit_t **self)
+{
+    //the ELF objects are not freeable, same as in xcd_map
+    if(NULL != (*self)->symfiles) free((*self)->symfiles);
+    free(*self);
+    *self = NULL;
+}
+
+xcd_elf_t *xcd_jit_find_elf(xcd_jit_t *self, uintptr_t pc)
+{
+    size_t lo = 0, hi = self->symfiles_num, mid, i;
+
+    //the last symfile which starts at or before pc
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(self->symfiles[mid].start <= pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    //the ranges of the packed symfiles may overlap a little, so check a few before it
+    for(i = lo; i > 0 && i + 4 > lo; i--)
+        if(pc < self->symfiles[i - 1].end) return self->symfiles[i - 1].elf;
+
+    return NULL;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef XCD_JIT_H
+#define XCD_JIT_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "xcd_elf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xcd_jit xcd_jit_t;
+
+int xcd_jit_create(xcd_jit_t **self, pid_t pid, void *maps_obj);
+void xcd_jit_destroy(xcd_jit_t **self);
+
+xcd_elf_t *xcd_jit_find_elf(xcd_jit_t *self, uintptr_t pc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -51,6 +51,7 @@ extern "C" {
 #define XCD_FRAMES_DEBUG        0
 #define XCD_DWARF_DEBUG         0
 #define XCD_ARM_EXIDX_DEBUG     0
+#define XCD_JIT_DEBUG           0
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,7 @@
 #include "xcc_util.h"
 #include "xcd_maps.h"
 #include "xcd_map.h"
+#include "xcd_jit.h"
 #include "xcd_util.h"
 #include "xcd_log.h"
 
@@ -46,12 +47,31 @@ typedef struct xcd_maps_item
 } xcd_maps_item_t;
 typedef TAILQ_HEAD(xcd_maps_item_queue, xcd_maps_item,) xcd_maps_item_queue_t;
 
+typedef struct xcd_maps_range
+{
+    uintptr_t start;
+    uintptr_t end;
+} xcd_maps_range_t;
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 struct xcd_maps
 {
     xcd_maps_item_queue_t maps;
     pid_t                 pid;
+
+    //sorted by start address, for binary search
+    xcd_map_t           **index;
+    size_t                index_num;
+
+    //in-memory symfiles of the JIT code, indexed on first use
+    xcd_jit_t            *jit;
+    int                   jit_loaded;
+
+    //executable ranges (adjacent maps merged), sorted and built on first use
+    xcd_maps_range_t     *text;
+    size_t                text_num;
+    int                   text_loaded;
 };
 #pragma clang diagnostic pop
 
@@ -76,18 +96,33 @@ static int xcd_maps_parse_line(char *line, xcd_maps_item_t **mi)
 }
 
 int xcd_maps_create(xcd_maps_t **self, pid_t pid)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "/proc/%d/maps", pid);
+    return xcd_maps_create_from_file(self, pid, buf);
+}
+
+int xcd_maps_create_from_file(xcd_maps_t **self, pid_t pid, const char *pathname)
 {
     char             buf[512];
     FILE            *fp;
     xcd_maps_item_t *mi;
+    size_t           n = 0;
     int              r;
 
     if(NULL == (*self = malloc(sizeof(xcd_maps_t)))) return XCC_ERRNO_NOMEM;
     TAILQ_INIT(&((*self)->maps));
     (*self)->pid = pid;
+    (*self)->index = NULL;
+    (*self)->index_num = 0;
+    (*self)->jit = NULL;
+    (*self)->jit_loaded = 0;
+    (*self)->text = NULL;
+    (*self)->text_num = 0;
+    (*self)->text_loaded = 0;
 
-    snprintf(buf, sizeof(buf), "/proc/%d/maps", pid);
-    if(NULL == (fp = fopen(buf, "r"))) return XCC_ERRNO_SYS;
+    if(NULL == (fp = fopen(pathname, "r"))) return XCC_ERRNO_SYS;
 
     while(fgets(buf, sizeof(buf), fp))
     {
@@ -98,10 +133,32 @@ int xcd_maps_create(xcd_maps_t **self, pid_t pid)
         }
         
         if(NULL != mi)
+        {
             TAILQ_INSERT_TAIL(&((*self)->maps), mi, link);
+            n++;
+        }
     }
     
     fclose(fp);
+
+    //build the index (the maps file is already sorted by address),
+    //fall back to the linear search if it failed
+    if(n > 0 && NULL != ((*self)->index = malloc(n * sizeof(xcd_map_t *))))
+    {
+        TAILQ_FOREACH(mi, &((*self)->maps), link)
+        {
+            if((*self)->index_num > 0 && mi->map.start < (*self)->index[(*self)->index_num - 1]->end)
+            {
+                //unordered or overlapped
+                free((*self)->index);
+                (*self)->index = NULL;
+                (*self)->index_num = 0;
+                break;
+            }
+            (*self)->index[(*self)->index_num++] = &(mi->map);
+        }
+    }
+    
     return 0;
 }
 
@@ -114,13 +171,35 @@ void xcd_maps_destroy(xcd_maps_t **self)
         xcd_map_uninit(&(mi->map));
         free(mi);
     }
+    if(NULL != (*self)->index) free((*self)->index);
+    if(NULL != (*self)->jit) xcd_jit_destroy(&((*self)->jit));
+    if(NULL != (*self)->text) free((*self)->text);
 
+    free(*self);
     *self = NULL;
 }
 
 xcd_map_t *xcd_maps_find_map(xcd_maps_t *self, uintptr_t pc)
 {
     xcd_maps_item_t *mi;
+    size_t           lo, hi, mid;
+
+    if(NULL != self->index)
+    {
+        lo = 0;
+        hi = self->index_num;
+        while(lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            if(pc < self->index[mid]->start)
+                hi = mid;
+            else if(pc >= self->index[mid]->end)
+                lo = mid + 1;
+            else
+                return self->index[mid];
+        }
+        return NULL;
+    }
 
     TAILQ_FOREACH(mi, &(self->maps), link)
         if(pc >= mi->map.start && pc < mi->map.end)
@@ -129,6 +208,18 @@ xcd_map_t *xcd_maps_find_map(xcd_maps_t *self, uintptr_t pc)
     return NULL;
 }
 
+xcd_map_t *xcd_maps_get_next_map(xcd_maps_t *self, xcd_map_t *cur_map)
+{
+    xcd_maps_item_t *next_mi;
+
+    if(NULL == cur_map)
+        next_mi = TAILQ_FIRST(&(self->maps));
+    else
+        next_mi = TAILQ_NEXT((xcd_maps_item_t *)cur_map, link);
+
+    return (NULL == next_mi ? NULL : &(next_mi->map));
+}
+
 xcd_map_t *xcd_maps_get_prev_map(xcd_maps_t *self, xcd_map_t *cur_map)
 {
     (void)self;
@@ -139,6 +230,97 @@ xcd_map_t *xcd_maps_get_prev_map(xcd_maps_t *self, xcd_map_t *cur_map)
     return (NULL == prev_mi ? NULL : &(prev_mi->map));
 }
 
+static int xcd_maps_range_cmp(const void *a, const void *b)
+{
+    uintptr_t start_a = ((const xcd_maps_range_t *)a)->start;
+    uintptr_t start_b = ((const xcd_maps_range_t *)b)->start;
+
+    return start_a < start_b ? -1 : (start_a > start_b ? 1 : 0);
+}
+
+static void xcd_maps_load_text(xcd_maps_t *self)
+{
+    xcd_maps_item_t *mi;
+    size_t           n = 0, i, j;
+
+    TAILQ_FOREACH(mi, &(self->maps), link)
+        if((mi->map.flags & PROT_EXEC) && !(mi->map.flags & XCD_MAP_PORT_DEVICE)) n++;
+    if(0 == n || NULL == (self->text = malloc(n * sizeof(xcd_maps_range_t)))) return;
+
+    TAILQ_FOREACH(mi, &(self->maps), link)
+    {
+        if((mi->map.flags & PROT_EXEC) && !(mi->map.flags & XCD_MAP_PORT_DEVICE))
+        {
+            self->text[self->text_num].start = mi->map.start;
+            self->text[self->text_num].end = mi->map.end;
+            self->text_num++;
+        }
+    }
+
+    //the maps may be unordered if the index failed
+    if(NULL == self->index) qsort(self->text, self->text_num, sizeof(xcd_maps_range_t), xcd_maps_range_cmp);
+
+    //merge the adjacent and overlapped ranges
+    for(i = 1, j = 0; i < self->text_num; i++)
+    {
+        if(self->text[i].start <= self->text[j].end)
+        {
+            if(self->text[i].end > self->text[j].end) self->text[j].end = self->text[i].end;
+        }
+        else
+        {
+            self->text[++j] = self->text[i];
+        }
+    }
+    self->text_num = j + 1;
+}
+
+int xcd_maps_is_text(xcd_maps_t *self, uintptr_t pc)
+{
+    xcd_map_t *map;
+    size_t     lo, hi, mid;
+
+    //only once
+    if(0 == self->text_loaded)
+    {
+        self->text_loaded = 1;
+        xcd_maps_load_text(self);
+    }
+
+    if(NULL == self->text)
+    {
+        //no executable map, or no memory for the table
+        if(NULL == (map = xcd_maps_find_map(self, pc))) return 0;
+        return (map->flags & PROT_EXEC) && !(map->flags & XCD_MAP_PORT_DEVICE);
+    }
+
+    lo = 0;
+    hi = self->text_num;
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(pc < self->text[mid].start)
+            hi = mid;
+        else if(pc >= self->text[mid].end)
+            lo = mid + 1;
+        else
+            return 1;
+    }
+    return 0;
+}
+
+xcd_elf_t *xcd_maps_find_jit_elf(xcd_maps_t *self, uintptr_t pc)
+{
+    //only once
+    if(NULL == self->jit && 0 == self->jit_loaded)
+    {
+        self->jit_loaded = 1;
+        if(0 != xcd_jit_create(&(self->jit), self->pid, (void *)self)) self->jit = NULL;
+    }
+
+    return NULL == self->jit ? NULL : xcd_jit_find_elf(self->jit, pc);
+}
+
 uintptr_t xcd_maps_find_abort_msg(xcd_maps_t *self)
 {
     xcd_maps_item_t *mi;
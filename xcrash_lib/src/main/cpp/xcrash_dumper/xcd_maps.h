@@ -35,10 +35,16 @@ extern "C" {
 typedef struct xcd_maps xcd_maps_t;
 
 int xcd_maps_create(xcd_maps_t **self, pid_t pid);
+int xcd_maps_create_from_file(xcd_maps_t **self, pid_t pid, const char *pathname);
 void xcd_maps_destroy(xcd_maps_t **self);
 
 xcd_map_t *xcd_maps_find_map(xcd_maps_t *self, uintptr_t pc);
 xcd_map_t *xcd_maps_get_prev_map(xcd_maps_t *self, xcd_map_t *cur_map);
+xcd_map_t *xcd_maps_get_next_map(xcd_maps_t *self, xcd_map_t *cur_map); //the first one if cur_map is NULL
+
+int xcd_maps_is_text(xcd_maps_t *self, uintptr_t pc); //in an executable map which is not a device map
+
+xcd_elf_t *xcd_maps_find_jit_elf(xcd_maps_t *self, uintptr_t pc);
 
 uintptr_t xcd_maps_find_abort_msg(xcd_maps_t *self);
 
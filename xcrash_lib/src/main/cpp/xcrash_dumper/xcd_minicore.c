@@ -0,0 +1,199 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <sys/types.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_minicore.h"
+#include "xcd_map.h"
+#include "xcd_elf.h"
+#include "xcd_util.h"
+
+#define XCD_MINICORE_CHUNK       4096
+#define XCD_MINICORE_STACK_BELOW 256               //red zone below SP
+#define XCD_MINICORE_STACK_MAX   (64 * 1024)       //for each thread
+#define XCD_MINICORE_MEMORY_MAX  (4 * 1024 * 1024) //for all the memory records
+#define XCD_MINICORE_TNAME_MAX   64
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct xcd_minicore
+{
+    int    fd;
+    pid_t  pid;
+    size_t memory_bytes;
+};
+#pragma clang diagnostic pop
+
+static int xcd_minicore_write_record(xcd_minicore_t *self, uint32_t type, uint64_t addr, const void *data, size_t size)
+{
+    xcd_minicore_record_t record;
+    int                   r;
+
+    memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.addr = addr;
+    record.size = size;
+
+    if(0 != (r = xcc_util_write(self->fd, (const char *)&record, sizeof(record)))) return r;
+    if(size > 0)
+        if(0 != (r = xcc_util_write(self->fd, (const char *)data, size))) return r;
+
+    return 0;
+}
+
+int xcd_minicore_create(xcd_minicore_t **self, const char *pathname, pid_t pid, pid_t crash_tid)
+{
+    xcd_minicore_header_t header;
+    int                   fd;
+    int                   r;
+
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0644)))) return XCC_ERRNO_SYS;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = XCD_MINICORE_MAGIC;
+    header.version = XCD_MINICORE_VERSION;
+    header.machine = XCD_MINICORE_MACHINE;
+    header.ptr_size = (uint32_t)sizeof(uintptr_t);
+    header.regs_num = XCD_REGS_USER_NUM;
+    header.pid = (int32_t)pid;
+    header.crash_tid = (int32_t)crash_tid;
+    if(0 != (r = xcc_util_write(fd, (const char *)&header, sizeof(header))))
+    {
+        close(fd);
+        return r;
+    }
+
+    if(NULL == (*self = malloc(sizeof(xcd_minicore_t))))
+    {
+        close(fd);
+        return XCC_ERRNO_NOMEM;
+    }
+    (*self)->fd = fd;
+    (*self)->pid = pid;
+    (*self)->memory_bytes = 0;
+
+    return 0;
+}
+
+void xcd_minicore_destroy(xcd_minicore_t **self)
+{
+    close((*self)->fd);
+    free(*self);
+    *self = NULL;
+}
+
+//streamed in chunks, the reader should concatenate all the maps records
+int xcd_minicore_write_maps(xcd_minicore_t *self)
+{
+    char    buf[XCD_MINICORE_CHUNK];
+    ssize_t n;
+    int     fd;
+    int     r = 0;
+
+    snprintf(buf, sizeof(buf), "/proc/%d/maps", self->pid);
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(buf, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
+    while((n = XCC_UTIL_TEMP_FAILURE_RETRY(read(fd, buf, sizeof(buf)))) > 0)
+        if(0 != (r = xcd_minicore_write_record(self, XCD_MINICORE_RECORD_MAPS, 0, buf, (size_t)n))) break;
+    close(fd);
+
+    return r;
+}
+
+//streamed in chunks through the remote reading, stop at the first unreadable address
+int xcd_minicore_write_memory(xcd_minicore_t *self, uintptr_t addr, size_t size)
+{
+    uint8_t buf[XCD_MINICORE_CHUNK];
+    size_t  len, n;
+    int     r;
+
+    while(size > 0 && self->memory_bytes < XCD_MINICORE_MEMORY_MAX)
+    {
+        len = XCD_MINICORE_CHUNK - (addr % XCD_MINICORE_CHUNK); //page aligned
+        if(len > size) len = size;
+        if(len > XCD_MINICORE_MEMORY_MAX - self->memory_bytes) len = XCD_MINICORE_MEMORY_MAX - self->memory_bytes;
+
+        if(0 == (n = xcd_util_ptrace_read(self->pid, addr, buf, len))) break;
+        if(0 != (r = xcd_minicore_write_record(self, XCD_MINICORE_RECORD_MEMORY, addr, buf, n))) return r;
+        self->memory_bytes += n;
+        if(n < len) break;
+
+        addr += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+int xcd_minicore_write_thread(xcd_minicore_t *self, pid_t tid, const char *tname, xcd_regs_t *regs, xcd_maps_t *maps)
+{
+    uint8_t    buf[sizeof(xcd_regs_t) + XCD_MINICORE_TNAME_MAX];
+    size_t     tname_len = (NULL == tname ? 0 : strlen(tname));
+    uintptr_t  sp = xcd_regs_get_sp(regs);
+    uintptr_t  start, end;
+    xcd_map_t *map;
+    int        r;
+
+    //registers and thread name
+    if(tname_len > XCD_MINICORE_TNAME_MAX - 1) tname_len = XCD_MINICORE_TNAME_MAX - 1;
+    memcpy(buf, regs, sizeof(xcd_regs_t));
+    if(tname_len > 0) memcpy(buf + sizeof(xcd_regs_t), tname, tname_len);
+    buf[sizeof(xcd_regs_t) + tname_len] = '\0';
+    if(0 != (r = xcd_minicore_write_record(self, XCD_MINICORE_RECORD_THREAD, (uint64_t)tid, buf, sizeof(xcd_regs_t) + tname_len + 1))) return r;
+
+    //stack, from a little below SP to the top of the stack map
+    start = (sp > XCD_MINICORE_STACK_BELOW ? sp - XCD_MINICORE_STACK_BELOW : 0);
+    end = sp + XCD_MINICORE_STACK_MAX;
+    if(NULL != (map = xcd_maps_find_map(maps, sp)))
+    {
+        if(start < map->start) start = map->start;
+        if(end > map->end) end = map->end;
+    }
+    if(end <= start) return 0;
+
+    return xcd_minicore_write_memory(self, start, end - start);
+}
+
+//only for the ELFs which have been loaded for unwinding
+int xcd_minicore_write_build_ids(xcd_minicore_t *self, xcd_maps_t *maps)
+{
+    xcd_map_t *map = NULL;
+    uint8_t    build_id[64];
+    size_t     build_id_len;
+    int        r;
+
+    while(NULL != (map = xcd_maps_get_next_map(maps, map)))
+    {
+        if(NULL == map->elf) continue;
+        if(0 != xcd_elf_get_build_id(map->elf, build_id, sizeof(build_id), &build_id_len) || 0 == build_id_len) continue;
+        if(0 != (r = xcd_minicore_write_record(self, XCD_MINICORE_RECORD_BUILD_ID, (uint64_t)map->start, build_id, build_id_len))) return r;
+    }
+
+    return 0;
+}
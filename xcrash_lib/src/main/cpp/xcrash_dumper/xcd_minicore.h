@@ -0,0 +1,92 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef XCD_MINICORE_H
+#define XCD_MINICORE_H 1
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "xcd_regs.h"
+#include "xcd_maps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//A mini-core is a compact snapshot of the crashed process for unwinding offline (by xcrash_replay).
+//It has the same ABI as the crashed process: a header, then a list of records.
+#define XCD_MINICORE_SUFFIX  ".minicore"
+#define XCD_MINICORE_MAGIC   0x434d4358 //"XCMC"
+#define XCD_MINICORE_VERSION 1
+
+#if defined(__arm__)
+#define XCD_MINICORE_MACHINE EM_ARM
+#elif defined(__aarch64__)
+#define XCD_MINICORE_MACHINE EM_AARCH64
+#elif defined(__i386__)
+#define XCD_MINICORE_MACHINE EM_386
+#elif defined(__x86_64__)
+#define XCD_MINICORE_MACHINE EM_X86_64
+#endif
+
+#define XCD_MINICORE_RECORD_MAPS     1 //content of /proc/PID/maps
+#define XCD_MINICORE_RECORD_THREAD   2 //addr: TID, data: registers, then the thread name
+#define XCD_MINICORE_RECORD_MEMORY   3 //addr: start address, data: memory content
+#define XCD_MINICORE_RECORD_BUILD_ID 4 //addr: start address of the map, data: build-id
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t machine;  //e_machine of the ELF
+    uint32_t ptr_size;
+    uint32_t regs_num;
+    int32_t  pid;
+    int32_t  crash_tid;
+} xcd_minicore_header_t;
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t addr;
+    uint64_t size; //size of the data after this record header
+} xcd_minicore_record_t;
+#pragma clang diagnostic pop
+
+typedef struct xcd_minicore xcd_minicore_t;
+
+int xcd_minicore_create(xcd_minicore_t **self, const char *pathname, pid_t pid, pid_t crash_tid);
+void xcd_minicore_destroy(xcd_minicore_t **self);
+
+int xcd_minicore_write_maps(xcd_minicore_t *self);
+int xcd_minicore_write_thread(xcd_minicore_t *self, pid_t tid, const char *tname, xcd_regs_t *regs, xcd_maps_t *maps);
+int xcd_minicore_write_memory(xcd_minicore_t *self, uintptr_t addr, size_t size);
+int xcd_minicore_write_build_ids(xcd_minicore_t *self, xcd_maps_t *maps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 
 // Created by caikelun on 2019-03-07.
 
+#include <stddef.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <stdlib.h>
@@ -43,19 +44,40 @@
 #include "xcc_util.h"
 #include "xcc_b64.h"
 #include "xcc_meminfo.h"
+#include "xcc_breadcrumb.h"
 #include "xcd_log.h"
 #include "xcd_process.h"
 #include "xcd_thread.h"
 #include "xcd_maps.h"
+#include "xcd_deadline.h"
 #include "xcd_regs.h"
 #include "xcd_util.h"
 #include "xcd_sys.h"
+#include "xcd_signature.h"
+#include "xcd_minicore.h"
 
+//number of the top frames used for computing the crash signature
+#define XCD_PROCESS_SIGNATURE_FRAMES 8
+
+//memory around the fault address in the mini-core
+#define XCD_PROCESS_MINICORE_FAULT_RANGE 256
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
 typedef struct xcd_thread_info
 {
-    xcd_thread_t t;
+    xcd_thread_t             t;
+
+    //for recording the other threads
+    int                      selected;
+    int                      frames_loaded;
+    uint64_t                 stack_hash;
+    struct xcd_thread_info  *same_as; //the first thread with the identical stack
+    size_t                   identical;
+    
     TAILQ_ENTRY(xcd_thread_info,) link;
 } xcd_thread_info_t;
+#pragma clang diagnostic pop
 typedef TAILQ_HEAD(xcd_thread_info_queue, xcd_thread_info,) xcd_thread_info_queue_t;
 
 #pragma clang diagnostic push
@@ -67,9 +89,14 @@ struct xcd_process
     pid_t                    crash_tid;
     ucontext_t              *uc;
     siginfo_t               *si;
+    xcc_spot_crash_t        *other_crashes;
+    size_t                   other_crashes_cnt;
+    uintptr_t                other_crashes_addr;
     xcd_thread_info_queue_t  thds;
     size_t                   nthds;
     xcd_maps_t              *maps;
+    int                      stack_scan;
+    int                      resumed;
 };
 #pragma clang diagnostic pop
 
@@ -100,7 +127,9 @@ static int xcd_process_load_threads(xcd_process_t *self)
     return 0;
 }
 
-int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo_t *si, ucontext_t *uc)
+int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo_t *si, ucontext_t *uc,
+                       uintptr_t other_crashes_addr, size_t other_crashes_cnt,
+                       int stack_scan)
 {
     int                r;
     xcd_thread_info_t *thd;
@@ -112,8 +141,21 @@ int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo
     (*self)->si        = si;
     (*self)->uc        = uc;
     (*self)->nthds     = 0;
+    (*self)->other_crashes     = NULL;
+    (*self)->other_crashes_cnt = 0;
+    (*self)->other_crashes_addr = other_crashes_addr;
+    (*self)->stack_scan        = stack_scan;
+    (*self)->resumed           = 0;
     TAILQ_INIT(&((*self)->thds));
 
+    //the slots are read from the crashed process after the threads are suspended
+    if(0 != other_crashes_addr && other_crashes_cnt > 0)
+    {
+        if(other_crashes_cnt > XCC_SPOT_OTHER_CRASHES_MAX) other_crashes_cnt = XCC_SPOT_OTHER_CRASHES_MAX;
+        if(NULL == ((*self)->other_crashes = calloc(other_crashes_cnt, sizeof(xcc_spot_crash_t)))) return XCC_ERRNO_NOMEM;
+        (*self)->other_crashes_cnt = other_crashes_cnt;
+    }
+
     if(0 != (r = xcd_process_load_threads(*self)))
     {
         XCD_LOG_ERROR("PROCESS: load threads failed, errno=%d", r);
@@ -131,21 +173,60 @@ int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo
     return XCC_ERRNO_NOTFND;
 }
 
+static xcc_spot_crash_t *xcd_process_find_other_crash(xcd_process_t *self, pid_t tid)
+{
+    size_t i;
+
+    //the slots not filled in by the crashed threads have tid 0
+    for(i = 0; i < self->other_crashes_cnt; i++)
+        if(0 != self->other_crashes[i].tid && tid == self->other_crashes[i].tid && tid != self->crash_tid)
+            return &(self->other_crashes[i]);
+
+    return NULL;
+}
+
 size_t xcd_process_get_number_of_threads(xcd_process_t *self)
 {
     return self->nthds;
 }
 
+//the other threads crashed after the dumper was spawned, their slots are only in the crashed process
+static void xcd_process_load_other_crashes(xcd_process_t *self)
+{
+    size_t i;
+    pid_t  tid;
+
+    for(i = 0; i < self->other_crashes_cnt; i++)
+    {
+        memset(&(self->other_crashes[i]), 0, sizeof(xcc_spot_crash_t));
+
+        //tid is published last, the slots without it are not ready (or never will be)
+        if(0 != xcd_util_ptrace_read_fully(self->pid, self->other_crashes_addr + i * sizeof(xcc_spot_crash_t) + offsetof(xcc_spot_crash_t, tid),
+                                           &tid, sizeof(tid)) || 0 == tid) continue;
+        if(0 != xcd_util_ptrace_read_fully(self->pid, self->other_crashes_addr + i * sizeof(xcc_spot_crash_t),
+                                           &(self->other_crashes[i]), sizeof(xcc_spot_crash_t)) ||
+           tid != self->other_crashes[i].tid)
+            memset(&(self->other_crashes[i]), 0, sizeof(xcc_spot_crash_t));
+    }
+}
+
 void xcd_process_suspend_threads(xcd_process_t *self)
 {
     xcd_thread_info_t *thd;
     TAILQ_FOREACH(thd, &(self->thds), link)
         xcd_thread_suspend(&(thd->t));
+
+    //all the threads are stopped, the slots will not change anymore
+    xcd_process_load_other_crashes(self);
 }
 
 void xcd_process_resume_threads(xcd_process_t *self)
 {
     xcd_thread_info_t *thd;
+
+    if(self->resumed) return;
+    self->resumed = 1;
+    
     TAILQ_FOREACH(thd, &(self->thds), link)
         xcd_thread_resume(&(thd->t));
 }
@@ -154,6 +235,7 @@ int xcd_process_load_info(xcd_process_t *self)
 {
     int                r;
     xcd_thread_info_t *thd;
+    xcc_spot_crash_t  *crash;
     char               buf[256];
     
     xcc_util_get_process_name(self->pid, buf, sizeof(buf));
@@ -165,10 +247,13 @@ int xcd_process_load_info(xcd_process_t *self)
         xcd_thread_load_info(&(thd->t));
         
         //load thread regs
-        if(thd->t.tid != self->crash_tid)
-            xcd_thread_load_regs(&(thd->t));
-        else
+        //(the other crashed threads are waiting in the signal handler, unwind them from their ucontext)
+        if(thd->t.tid == self->crash_tid)
             xcd_thread_load_regs_from_ucontext(&(thd->t), self->uc);
+        else if(NULL != (crash = xcd_process_find_other_crash(self, thd->t.tid)))
+            xcd_thread_load_regs_from_ucontext(&(thd->t), &(crash->ucontext));
+        else
+            xcd_thread_load_regs(&(thd->t));
     }
 
     //load maps
@@ -178,14 +263,14 @@ int xcd_process_load_info(xcd_process_t *self)
     return 0;
 }
 
-static int xcd_process_record_signal_info(xcd_process_t *self, int log_fd)
+static int xcd_process_record_signal_info(xcd_process_t *self, int log_fd, siginfo_t *si)
 {
     //fault addr
     char addr_desc[64];
-    if(xcc_util_signal_has_si_addr(self->si))
+    if(xcc_util_signal_has_si_addr(si))
     {
-        void *addr = self->si->si_addr;
-        if(self->si->si_signo == SIGILL)
+        void *addr = si->si_addr;
+        if(si->si_signo == SIGILL)
         {
             uint32_t instruction = 0;
             xcd_util_ptrace_read(self->pid, (uintptr_t)addr, &instruction, sizeof(instruction));
@@ -203,14 +288,14 @@ static int xcd_process_record_signal_info(xcd_process_t *self, int log_fd)
 
     //from
     char sender_desc[64] = "";
-    if(xcc_util_signal_has_sender(self->si, self->pid))
+    if(xcc_util_signal_has_sender(si, self->pid))
     {
-        snprintf(sender_desc, sizeof(sender_desc), " from pid %d, uid %d", self->si->si_pid, self->si->si_uid);
+        snprintf(sender_desc, sizeof(sender_desc), " from pid %d, uid %d", si->si_pid, si->si_uid);
     }
 
     return xcc_util_write_format(log_fd, "signal %d (%s), code %d (%s%s), fault addr %s\n",
-                                 self->si->si_signo, xcc_util_get_signame(self->si),
-                                 self->si->si_code, xcc_util_get_sigcodename(self->si),
+                                 si->si_signo, xcc_util_get_signame(si),
+                                 si->si_code, xcc_util_get_sigcodename(si),
                                  sender_desc, addr_desc);
 }
 
@@ -333,6 +418,25 @@ static int xcd_process_record_abort_message(xcd_process_t *self, int log_fd, int
     return xcc_util_write_format(log_fd, "Abort message: '%s'\n", msg);
 }
 
+static int xcd_process_record_breadcrumbs(xcd_process_t *self, int log_fd, uintptr_t breadcrumb_addr, long time_zone)
+{
+    xcc_breadcrumb_t *breadcrumb;
+    int               r = 0;
+
+    if(0 == breadcrumb_addr) return 0;
+    if(NULL == (breadcrumb = malloc(sizeof(xcc_breadcrumb_t)))) return XCC_ERRNO_NOMEM;
+
+    //ignore the read and format errors, the ring buffer is optional
+    if(0 != xcd_util_ptrace_read_fully(self->pid, breadcrumb_addr, breadcrumb, sizeof(xcc_breadcrumb_t))) goto end;
+    if(XCC_BREADCRUMB_MAGIC != breadcrumb->magic || XCC_BREADCRUMB_CAPACITY != breadcrumb->capacity) goto end;
+
+    r = xcc_breadcrumb_record(log_fd, breadcrumb, time_zone);
+
+ end:
+    free(breadcrumb);
+    return r;
+}
+
 static regex_t *xcd_process_build_whitelist_regex(char *dump_all_threads_whitelist, size_t *re_cnt)
 {
     if(NULL == dump_all_threads_whitelist || 0 == strlen(dump_all_threads_whitelist)) return NULL;
@@ -395,52 +499,136 @@ int xcd_process_record(xcd_process_t *self,
                        int dump_map,
                        int dump_fds,
                        int dump_network_info,
+                       int dump_meminfo_detail,
                        int dump_all_threads,
                        unsigned int dump_all_threads_count_max,
                        char *dump_all_threads_whitelist,
+                       uintptr_t breadcrumb_addr,
+                       long time_zone,
+                       const char *log_pathname,
+                       uint64_t crash_time,
+                       unsigned int suppress_duplicates_window,
                        int api_level)
 {
     int                r = 0;
     xcd_thread_info_t *thd;
-    regex_t           *re = NULL;
-    size_t             re_cnt = 0;
-    unsigned int       thd_dumped = 0;
-    int                thd_matched_regex = 0;
-    int                thd_ignored_by_limit = 0;
+    int                frames_loaded;
+    uint64_t           signature = 0;
+    unsigned int       duplicates = 1;
+
+    //the sections which will not be recorded do not need time
+    if(!dump_elf_hash) xcd_deadline_exclude(XCD_DEADLINE_ELF_HASH);
+    if(!dump_map) xcd_deadline_exclude(XCD_DEADLINE_MAPS);
+    if(0 == breadcrumb_addr) xcd_deadline_exclude(XCD_DEADLINE_BREADCRUMBS);
+    if(0 == logcat_system_lines && 0 == logcat_events_lines && 0 == logcat_main_lines) xcd_deadline_exclude(XCD_DEADLINE_LOGCAT);
+    if(!dump_fds) xcd_deadline_exclude(XCD_DEADLINE_FDS);
+    if(!dump_network_info) xcd_deadline_exclude(XCD_DEADLINE_NETWORK);
+    if(!dump_all_threads) xcd_deadline_exclude(XCD_DEADLINE_THREADS);
     
     TAILQ_FOREACH(thd, &(self->thds), link)
     {
         if(thd->t.tid == self->crash_tid)
         {
             if(0 != (r = xcd_thread_record_info(&(thd->t), log_fd, self->pname))) return r;
-            if(0 != (r = xcd_process_record_signal_info(self, log_fd))) return r;
+            if(0 != (r = xcd_process_record_signal_info(self, log_fd, self->si))) return r;
             if(0 != (r = xcd_process_record_abort_message(self, log_fd, api_level))) return r;
+
+            //crash signature, and check for duplicates
+            if((frames_loaded = (0 == xcd_thread_load_frames(&(thd->t), self->maps, self->stack_scan))))
+            {
+                signature = xcd_frames_get_signature(thd->t.frames, XCD_PROCESS_SIGNATURE_FRAMES);
+                xcd_signature_check(log_pathname, signature, crash_time, suppress_duplicates_window, &duplicates);
+            }
+            if(0 != signature)
+                if(0 != (r = xcc_util_write_format(log_fd, "Crash signature: '%016"PRIx64"'\n", signature))) return r;
+            if(duplicates > 1)
+            {
+                //only a short reference record, skip all the expensive sections
+                if(0 != (r = xcc_util_write_format(log_fd, "Duplicate crashes: '%u'\n\n", duplicates))) return r;
+                return xcd_thread_record_backtrace(&(thd->t), log_fd);
+            }
+
             if(0 != (r = xcd_thread_record_regs(&(thd->t), log_fd))) return r;
-            if(0 == xcd_thread_load_frames(&(thd->t), self->maps))
+            if(frames_loaded)
             {
                 if(0 != (r = xcd_thread_record_backtrace(&(thd->t), log_fd))) return r;
-                if(0 != (r = xcd_thread_record_buildid(&(thd->t), log_fd, dump_elf_hash, xcc_util_signal_has_si_addr(self->si) ? (uintptr_t)self->si->si_addr : 0))) return r;
-                if(0 != (r = xcd_thread_record_stack(&(thd->t), log_fd))) return r;
-                if(0 != (r = xcd_thread_record_memory(&(thd->t), log_fd))) return r;
+                if(dump_elf_hash && !xcd_deadline_begin(XCD_DEADLINE_ELF_HASH)) dump_elf_hash = 0;
+                if(xcd_deadline_begin(XCD_DEADLINE_BUILDID))
+                    if(0 != (r = xcd_thread_record_buildid(&(thd->t), log_fd, dump_elf_hash, xcc_util_signal_has_si_addr(self->si) ? (uintptr_t)self->si->si_addr : 0))) return r;
+                if(xcd_deadline_begin(XCD_DEADLINE_STACK))
+                    if(0 != (r = xcd_thread_record_stack(&(thd->t), log_fd))) return r;
+                if(xcd_deadline_begin(XCD_DEADLINE_MEMORY))
+                    if(0 != (r = xcd_thread_record_memory(&(thd->t), log_fd))) return r;
             }
-            if(dump_map) if(0 != (r = xcd_maps_record(self->maps, log_fd))) return r;
-            if(0 != (r = xcc_util_record_logcat(log_fd, self->pid, api_level, logcat_system_lines, logcat_events_lines, logcat_main_lines))) return r;
-            if(dump_fds) if(0 != (r = xcc_util_record_fds(log_fd, self->pid))) return r;
-            if(dump_network_info) if(0 != (r = xcc_util_record_network_info(log_fd, self->pid, api_level))) return r;
-            if(0 != (r = xcc_meminfo_record(log_fd, self->pid))) return r;
+            if(dump_map && xcd_deadline_begin(XCD_DEADLINE_MAPS))
+                if(0 != (r = xcd_maps_record(self->maps, log_fd))) return r;
+            if(xcd_deadline_begin(XCD_DEADLINE_BREADCRUMBS))
+                if(0 != (r = xcd_process_record_breadcrumbs(self, log_fd, breadcrumb_addr, time_zone))) return r;
+            if(xcd_deadline_begin(XCD_DEADLINE_LOGCAT))
+                if(0 != (r = xcc_util_record_logcat(log_fd, self->pid, api_level, logcat_system_lines, logcat_events_lines, logcat_main_lines))) return r;
+            if(dump_fds && xcd_deadline_begin(XCD_DEADLINE_FDS))
+                if(0 != (r = xcc_util_record_fds(log_fd, self->pid))) return r;
+            if(dump_network_info && xcd_deadline_begin(XCD_DEADLINE_NETWORK))
+                if(0 != (r = xcc_util_record_network_info(log_fd, self->pid, api_level))) return r;
+            if(xcd_deadline_begin(XCD_DEADLINE_MEMINFO))
+                if(0 != (r = xcc_meminfo_record(log_fd, self->pid, dump_meminfo_detail))) return r;
 
             break;
         }
     }
-    if(!dump_all_threads) return 0;
+
+    return xcd_process_record_threads(self, log_fd, dump_all_threads, dump_all_threads_count_max, dump_all_threads_whitelist, 0);
+}
+
+int xcd_process_record_threads(xcd_process_t *self,
+                               int log_fd,
+                               int dump_all_threads,
+                               unsigned int dump_all_threads_count_max,
+                               char *dump_all_threads_whitelist,
+                               int nonfatal)
+{
+    int                r = 0;
+    xcd_thread_info_t *thd, *thd_prev, *thd_same;
+    xcc_spot_crash_t  *crash;
+    size_t             other_crashed = 0;
+    regex_t           *re = NULL;
+    size_t             re_cnt = 0;
+    unsigned int       thd_selected = 0;
+    int                thd_matched_regex = 0;
+    int                thd_ignored_by_limit = 0;
+    unsigned int       thd_identical = 0;
+    int                thd_ignored_by_deadline = 0;
+
+    TAILQ_FOREACH(thd, &(self->thds), link)
+        if(NULL != xcd_process_find_other_crash(self, thd->t.tid))
+            other_crashed++;
+    if(!dump_all_threads && 0 == other_crashed) return 0;
+
+    //the other crashed threads are recorded even if there is no time for all threads
+    if(dump_all_threads && !xcd_deadline_begin(XCD_DEADLINE_THREADS))
+    {
+        dump_all_threads = 0;
+        if(0 == other_crashed) return 0;
+    }
 
     //parse thread name whitelist regex
-    re = xcd_process_build_whitelist_regex(dump_all_threads_whitelist, &re_cnt);
+    if(dump_all_threads)
+        re = xcd_process_build_whitelist_regex(dump_all_threads_whitelist, &re_cnt);
 
+    //select threads, load frames and find the identical stacks
     TAILQ_FOREACH(thd, &(self->thds), link)
     {
-        if(thd->t.tid != self->crash_tid)
+        thd->selected = 0;
+        thd->frames_loaded = 0;
+        thd->same_as = NULL;
+        thd->identical = 0;
+        if(thd->t.tid == self->crash_tid) continue;
+
+        //the other crashed threads are always dumped
+        if(NULL == (crash = xcd_process_find_other_crash(self, thd->t.tid)))
         {
+            if(!dump_all_threads) continue;
+
             //check regex for thread name
             if(NULL != re && re_cnt > 0 && !xcd_process_if_need_dump(thd->t.tname, re, re_cnt))
             {
@@ -449,36 +637,96 @@ int xcd_process_record(xcd_process_t *self,
             thd_matched_regex++;
 
             //check dump count limit
-            if(dump_all_threads_count_max > 0 && thd_dumped >= dump_all_threads_count_max)
+            if(dump_all_threads_count_max > 0 && thd_selected >= dump_all_threads_count_max)
             {
                 thd_ignored_by_limit++;
                 continue;
             }
 
-            if(0 != (r = xcc_util_write_str(log_fd, XCC_UTIL_THREAD_SEP))) goto end;
-            if(0 != (r = xcd_thread_record_info(&(thd->t), log_fd, self->pname))) goto end;
-            if(0 != (r = xcd_thread_record_regs(&(thd->t), log_fd))) goto end;
-            if(0 == xcd_thread_load_frames(&(thd->t), self->maps))
+            //check the deadline
+            if(!xcd_deadline_check(XCD_DEADLINE_THREADS, "other threads"))
             {
-                if(0 != (r = xcd_thread_record_backtrace(&(thd->t), log_fd))) goto end;
-                if(0 != (r = xcd_thread_record_stack(&(thd->t), log_fd))) goto end;
+                thd_ignored_by_deadline++;
+                continue;
             }
-            thd_dumped++;
+        }
+
+        thd->selected = 1;
+        thd_selected++;
+        if(0 != xcd_thread_load_frames(&(thd->t), self->maps, self->stack_scan)) continue;
+        thd->frames_loaded = 1;
+        thd->stack_hash = xcd_frames_get_stack_hash(thd->t.frames);
+
+        //the other crashed threads are always recorded in full
+        if(NULL == crash)
+        {
+            for(thd_prev = TAILQ_FIRST(&(self->thds)); thd_prev != thd; thd_prev = TAILQ_NEXT(thd_prev, link))
+            {
+                if(thd_prev->selected && thd_prev->frames_loaded && NULL == thd_prev->same_as &&
+                   thd_prev->stack_hash == thd->stack_hash &&
+                   NULL == xcd_process_find_other_crash(self, thd_prev->t.tid) &&
+                   xcd_frames_is_same_stack(thd_prev->t.frames, thd->t.frames))
+                {
+                    thd->same_as = thd_prev;
+                    thd_prev->identical++;
+                    thd_identical++;
+                    break;
+                }
+            }
+        }
+
+        //symbolize the distinct stacks while the threads are still stopped (a live process is resumed below)
+        if(NULL == thd->same_as) xcd_frames_symbolize(thd->t.frames);
+    }
+
+    //a live process only needs to be frozen while unwinding, the stack memory is not recorded
+    if(nonfatal) xcd_process_resume_threads(self);
+
+    //record each distinct stack once
+    TAILQ_FOREACH(thd, &(self->thds), link)
+    {
+        if(!thd->selected || NULL != thd->same_as) continue;
+        crash = xcd_process_find_other_crash(self, thd->t.tid);
+
+        if(0 != (r = xcc_util_write_str(log_fd, XCC_UTIL_THREAD_SEP))) goto end;
+        if(0 != (r = xcd_thread_record_info(&(thd->t), log_fd, self->pname))) goto end;
+        if(NULL != crash)
+            if(0 != (r = xcd_process_record_signal_info(self, log_fd, &(crash->siginfo)))) goto end;
+        if(0 != (r = xcd_thread_record_regs(&(thd->t), log_fd))) goto end;
+        if(thd->frames_loaded)
+        {
+            if(0 != (r = xcd_thread_record_backtrace(&(thd->t), log_fd))) goto end;
+            if(thd->identical > 0)
+            {
+                if(0 != (r = xcc_util_write_format(log_fd, "identical threads: %zu\n", thd->identical))) goto end;
+                for(thd_same = TAILQ_NEXT(thd, link); NULL != thd_same; thd_same = TAILQ_NEXT(thd_same, link))
+                    if(thd_same->same_as == thd)
+                        if(0 != (r = xcc_util_write_format(log_fd, "    tid: %d, name: %s\n", thd_same->t.tid, thd_same->t.tname))) goto end;
+                if(0 != (r = xcc_util_write_str(log_fd, "\n"))) goto end;
+            }
+            if(!nonfatal && xcd_deadline_check(XCD_DEADLINE_THREADS, "other threads stack"))
+                if(0 != (r = xcd_thread_record_stack(&(thd->t), log_fd))) goto end;
         }
     }
 
  end:
     if(self->nthds > 1)
     {
-        if(0 == thd_dumped)
+        if(0 == thd_selected)
             if(0 != (r = xcc_util_write_str(log_fd, XCC_UTIL_THREAD_SEP))) goto ret;
 
         if(0 != (r = xcc_util_write_format(log_fd, "total threads (exclude the crashed thread): %zu\n", self->nthds - 1))) goto ret;
+        if(other_crashed > 0)
+            if(0 != (r = xcc_util_write_format(log_fd, "other crashed threads: %zu\n", other_crashed))) goto ret;
         if(NULL != re && re_cnt > 0)
             if(0 != (r = xcc_util_write_format(log_fd, "threads matched whitelist: %d\n", thd_matched_regex))) goto ret;
         if(dump_all_threads_count_max > 0)
             if(0 != (r = xcc_util_write_format(log_fd, "threads ignored by max count limit: %d\n", thd_ignored_by_limit))) goto ret;
-        if(0 != (r = xcc_util_write_format(log_fd, "dumped threads: %u\n", thd_dumped))) goto ret;
+        if(thd_ignored_by_deadline > 0)
+            if(0 != (r = xcc_util_write_format(log_fd, "threads ignored by dump budget: %d\n", thd_ignored_by_deadline))) goto ret;
+        if(thd_identical > 0)
+            if(0 != (r = xcc_util_write_format(log_fd, "threads with identical stacks: %u\n", thd_identical))) goto ret;
+        if(0 != (r = xcc_util_write_format(log_fd, "dumped threads: %u\n", thd_selected - thd_identical))) goto ret;
         
         if(0 != (r = xcc_util_write_str(log_fd, XCC_UTIL_THREAD_END))) goto ret;
     }
@@ -486,3 +734,44 @@ int xcd_process_record(xcd_process_t *self,
  ret:
     return r;
 }
+
+int xcd_process_record_minicore(xcd_process_t *self, const char *pathname)
+{
+    xcd_minicore_t    *minicore = NULL;
+    xcd_thread_info_t *thd;
+    uintptr_t          fault_addr;
+    int                r;
+
+    if(NULL == self->maps) return XCC_ERRNO_STATE;
+    if(0 != (r = xcd_minicore_create(&minicore, pathname, self->pid, self->crash_tid))) return r;
+
+    if(0 != (r = xcd_minicore_write_maps(minicore))) goto end;
+
+    //the crashed thread first, then the other threads which have been unwound
+    TAILQ_FOREACH(thd, &(self->thds), link)
+    {
+        if(thd->t.tid != self->crash_tid || XCD_THREAD_STATUS_OK != thd->t.status) continue;
+        if(0 != (r = xcd_minicore_write_thread(minicore, thd->t.tid, thd->t.tname, &(thd->t.regs), self->maps))) goto end;
+        break;
+    }
+    TAILQ_FOREACH(thd, &(self->thds), link)
+    {
+        if(thd->t.tid == self->crash_tid || !thd->selected || !thd->frames_loaded) continue;
+        if(!xcd_deadline_check(XCD_DEADLINE_MINICORE, "mini-core threads")) break;
+        if(0 != (r = xcd_minicore_write_thread(minicore, thd->t.tid, thd->t.tname, &(thd->t.regs), self->maps))) goto end;
+    }
+
+    //memory around the fault address
+    if(xcc_util_signal_has_si_addr(self->si))
+    {
+        fault_addr = (uintptr_t)self->si->si_addr & ~(sizeof(uintptr_t) - 1);
+        fault_addr = (fault_addr > XCD_PROCESS_MINICORE_FAULT_RANGE ? fault_addr - XCD_PROCESS_MINICORE_FAULT_RANGE : 0);
+        if(0 != (r = xcd_minicore_write_memory(minicore, fault_addr, XCD_PROCESS_MINICORE_FAULT_RANGE * 2))) goto end;
+    }
+
+    r = xcd_minicore_write_build_ids(minicore, self->maps);
+
+ end:
+    xcd_minicore_destroy(&minicore);
+    return r;
+}
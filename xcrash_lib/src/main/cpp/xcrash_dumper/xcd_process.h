@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include "xcc_spot.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,7 +34,9 @@ extern "C" {
 
 typedef struct xcd_process xcd_process_t;
 
-int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo_t *si, ucontext_t *uc);
+int xcd_process_create(xcd_process_t **self, pid_t pid, pid_t crash_tid, siginfo_t *si, ucontext_t *uc,
+                       uintptr_t other_crashes_addr, size_t other_crashes_cnt,
+                       int stack_scan);
 size_t xcd_process_get_number_of_threads(xcd_process_t *self);
 
 void xcd_process_suspend_threads(xcd_process_t *self);
@@ -50,11 +53,26 @@ int xcd_process_record(xcd_process_t *self,
                        int dump_map,
                        int dump_fds,
                        int dump_network_info,
+                       int dump_meminfo_detail,
                        int dump_all_threads,
                        unsigned int dump_all_threads_count_max,
                        char *dump_all_threads_whitelist,
+                       uintptr_t breadcrumb_addr,
+                       long time_zone,
+                       const char *log_pathname,
+                       uint64_t crash_time,
+                       unsigned int suppress_duplicates_window,
                        int api_level);
 
+int xcd_process_record_threads(xcd_process_t *self,
+                               int log_fd,
+                               int dump_all_threads,
+                               unsigned int dump_all_threads_count_max,
+                               char *dump_all_threads_whitelist,
+                               int nonfatal);
+
+int xcd_process_record_minicore(xcd_process_t *self, const char *pathname);
+
 #ifdef __cplusplus
 }
 #endif
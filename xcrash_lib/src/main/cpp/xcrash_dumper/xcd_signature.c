@@ -0,0 +1,141 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/file.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_signature.h"
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-statement-expression"
+
+#define XCD_SIGNATURE_INDEX_NAME  "xcrash_signature_index"
+#define XCD_SIGNATURE_INDEX_MAGIC 0x58435349 //"XCSI"
+#define XCD_SIGNATURE_INDEX_MAX   32
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    uint64_t signature;
+    uint64_t first_time; //the time of the last full dump
+    uint64_t last_time;
+    uint32_t count;      //crashes since the last full dump (including it)
+    uint32_t reserved;
+} xcd_signature_item_t;
+
+typedef struct
+{
+    uint32_t             magic;
+    uint32_t             reserved;
+    xcd_signature_item_t items[XCD_SIGNATURE_INDEX_MAX];
+} xcd_signature_index_t;
+#pragma clang diagnostic pop
+
+static int xcd_signature_get_index_pathname(const char *log_pathname, char *buf, size_t buf_len)
+{
+    const char *p;
+    size_t      dir_len;
+
+    if(NULL == (p = strrchr(log_pathname, '/'))) return XCC_ERRNO_INVAL;
+    dir_len = (size_t)(p - log_pathname) + 1;
+    if(dir_len + sizeof(XCD_SIGNATURE_INDEX_NAME) > buf_len) return XCC_ERRNO_NOSPACE;
+
+    memcpy(buf, log_pathname, dir_len);
+    memcpy(buf + dir_len, XCD_SIGNATURE_INDEX_NAME, sizeof(XCD_SIGNATURE_INDEX_NAME));
+    return 0;
+}
+
+//update the persistent signature index in the log dir, return the occurrence count in the window
+int xcd_signature_check(const char *log_pathname, uint64_t signature, uint64_t crash_time,
+                        unsigned int window, unsigned int *count)
+{
+    char                   pathname[1024];
+    xcd_signature_index_t  index;
+    xcd_signature_item_t  *item = NULL;
+    ssize_t                n;
+    size_t                 i;
+    int                    fd;
+    int                    r = 0;
+
+    *count = 1;
+    if(0 == signature || 0 == window) return 0;
+
+    if(0 != (r = xcd_signature_get_index_pathname(log_pathname, pathname, sizeof(pathname)))) return r;
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_RDWR | O_CREAT | O_CLOEXEC, 0644)))) return XCC_ERRNO_SYS;
+
+    //other processes of the APP may crash at the same time
+    if(0 != XCC_UTIL_TEMP_FAILURE_RETRY(flock(fd, LOCK_EX)))
+    {
+        r = XCC_ERRNO_SYS;
+        goto end;
+    }
+
+    memset(&index, 0, sizeof(index));
+    n = XCC_UTIL_TEMP_FAILURE_RETRY(pread(fd, &index, sizeof(index), 0));
+    if((ssize_t)sizeof(index) != n || XCD_SIGNATURE_INDEX_MAGIC != index.magic)
+    {
+        memset(&index, 0, sizeof(index));
+        index.magic = XCD_SIGNATURE_INDEX_MAGIC;
+    }
+
+    //find the signature, or the least recently crashed item
+    for(i = 0; i < XCD_SIGNATURE_INDEX_MAX; i++)
+    {
+        if(signature == index.items[i].signature)
+        {
+            item = &(index.items[i]);
+            break;
+        }
+        if(NULL == item || index.items[i].last_time < item->last_time)
+            item = &(index.items[i]);
+    }
+
+    if(signature == item->signature && crash_time >= item->first_time &&
+       crash_time - item->first_time <= (uint64_t)window * 1000 * 1000)
+    {
+        item->count++;
+    }
+    else
+    {
+        //a new window starts with a full dump
+        item->signature = signature;
+        item->first_time = crash_time;
+        item->count = 1;
+    }
+    item->last_time = crash_time;
+    *count = item->count;
+
+    if((ssize_t)sizeof(index) != XCC_UTIL_TEMP_FAILURE_RETRY(pwrite(fd, &index, sizeof(index), 0))) r = XCC_ERRNO_SYS;
+
+ end:
+    close(fd);
+    return r;
+}
+
+#pragma clang diagnostic pop
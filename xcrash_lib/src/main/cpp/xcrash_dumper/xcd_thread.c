@@ -127,7 +127,7 @@ void xcd_thread_load_regs_from_ucontext(xcd_thread_t *self, ucontext_t *uc)
     xcd_regs_load_from_ucontext(&(self->regs), uc);
 }
 
-int xcd_thread_load_frames(xcd_thread_t *self, xcd_maps_t *maps)
+int xcd_thread_load_frames(xcd_thread_t *self, xcd_maps_t *maps, int stack_scan)
 {
 #if XCD_THREAD_DEBUG
     XCD_LOG_DEBUG("THREAD: load frames, tid=%d, tname=%s", self->tid, self->tname);
@@ -135,7 +135,7 @@ int xcd_thread_load_frames(xcd_thread_t *self, xcd_maps_t *maps)
 
     if(XCD_THREAD_STATUS_OK != self->status) return XCC_ERRNO_STATE; //do NOT ignore
 
-    return xcd_frames_create(&(self->frames), &(self->regs), maps, self->pid);
+    return xcd_frames_create(&(self->frames), &(self->regs), maps, self->pid, stack_scan);
 }
 
 int xcd_thread_record_info(xcd_thread_t *self, int log_fd, const char *pname)
@@ -63,7 +63,7 @@ void xcd_thread_resume(xcd_thread_t *self);
 void xcd_thread_load_info(xcd_thread_t *self);
 void xcd_thread_load_regs(xcd_thread_t *self);
 void xcd_thread_load_regs_from_ucontext(xcd_thread_t *self, ucontext_t *uc);
-int xcd_thread_load_frames(xcd_thread_t *self, xcd_maps_t *maps);
+int xcd_thread_load_frames(xcd_thread_t *self, xcd_maps_t *maps, int stack_scan);
 
 int xcd_thread_record_info(xcd_thread_t *self, int log_fd, const char *pname);
 int xcd_thread_record_regs(xcd_thread_t *self, int log_fd);
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <signal.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <sys/ptrace.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -45,6 +46,14 @@
 #include "XzCrc64.h"
 #pragma clang diagnostic pop
 
+//set when replaying a mini-core offline or unwinding in-process
+static xcd_util_remote_read_t xcd_util_remote_read = NULL;
+
+void xcd_util_set_remote_read(xcd_util_remote_read_t remote_read)
+{
+    xcd_util_remote_read = remote_read;
+}
+
 extern __attribute((weak)) ssize_t process_vm_readv(pid_t, const struct iovec *, unsigned long, const struct iovec *, unsigned long, unsigned long);
 
 static size_t xcd_util_process_vm_readv(pid_t pid, uintptr_t remote_addr, void* dst, size_t dst_len)
@@ -143,7 +152,11 @@ size_t xcd_util_ptrace_read(pid_t pid, uintptr_t remote_addr, void *dst, size_t
 {
     static size_t (*ptrace_read)(pid_t, uintptr_t, void *, size_t) = NULL;
 
-    if(NULL != ptrace_read)
+    if(NULL != xcd_util_remote_read)
+    {
+        return xcd_util_remote_read(pid, remote_addr, dst, dst_len);
+    }
+    else if(NULL != ptrace_read)
     {
         return ptrace_read(pid, remote_addr, dst, dst_len);
     }
@@ -174,6 +187,9 @@ int xcd_util_ptrace_read_fully(pid_t pid, uintptr_t addr, void *dst, size_t byte
 
 int xcd_util_ptrace_read_long(pid_t pid, uintptr_t addr, long *value)
 {
+    if(NULL != xcd_util_remote_read)
+        return sizeof(long) == xcd_util_remote_read(pid, addr, value, sizeof(long)) ? 0 : XCC_ERRNO_MISSING;
+
     // ptrace() returns -1 and sets errno when the operation fails.
     // To disambiguate -1 from a valid result, we clear errno beforehand.
     errno = 0;
@@ -199,7 +215,177 @@ static void xcd_util_xz_free(ISzAllocPtr p, void* address)
     free(address);
 }
 
+//multi-threaded decoding of the multi-block xz stream (e.g. "xz --block-size=64k")
+#define XCD_UTIL_XZ_MT_THREADS_MAX  4
+#define XCD_UTIL_XZ_MT_SRC_SIZE_MIN (128 * 1024) //not worth the threads for the small ones
+#define XCD_UTIL_XZ_MT_BLOCKS_MAX   (64 * 1024)
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    size_t src_offset;
+    size_t src_size; //including the block padding
+    size_t dst_offset;
+    size_t dst_size;
+} xcd_util_xz_block_t;
+
+typedef struct
+{
+    uint8_t             *src;
+    uint8_t             *dst;
+    CXzStreamFlags       flags;
+    xcd_util_xz_block_t *blocks;
+    size_t               blocks_num;
+    size_t               blocks_next;
+    int                  failed;
+} xcd_util_xz_mt_t;
+#pragma clang diagnostic pop
+
 static int xcd_util_xz_crc_gen = 0;
+
+static uint32_t xcd_util_xz_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+//get the blocks from the index of a single xz stream
+static int xcd_util_xz_get_blocks(uint8_t *src, size_t src_size, CXzStreamFlags *flags,
+                                  xcd_util_xz_block_t **blocks, size_t *blocks_num, size_t *dst_size)
+{
+    uint8_t *footer = src + src_size - XZ_STREAM_FOOTER_SIZE;
+    uint8_t *index;
+    size_t   index_size, pos, num, i, src_offset = XZ_STREAM_HEADER_SIZE, dst_offset = 0;
+    UInt64   v, unpadded_size, unpack_size;
+    unsigned n;
+
+    if(src_size < XZ_STREAM_HEADER_SIZE + XZ_STREAM_FOOTER_SIZE) return XCC_ERRNO_FORMAT;
+    if(0 != memcmp(src, XZ_SIG, XZ_SIG_SIZE) || XZ_FOOTER_SIG_0 != footer[10] || XZ_FOOTER_SIG_1 != footer[11]) return XCC_ERRNO_FORMAT;
+    if(SZ_OK != Xz_ParseHeader(flags, src)) return XCC_ERRNO_FORMAT;
+    if(0 != memcmp(src + XZ_SIG_SIZE, footer + 8, XZ_STREAM_FLAGS_SIZE)) return XCC_ERRNO_FORMAT;
+    if(xcd_util_xz_get_le32(footer) != CrcCalc(footer + 4, 6)) return XCC_ERRNO_FORMAT;
+
+    //the index is right before the stream footer (no stream padding, no concatenated streams)
+    index_size = ((size_t)xcd_util_xz_get_le32(footer + 4) + 1) * 4;
+    if(index_size > src_size - (XZ_STREAM_HEADER_SIZE + XZ_STREAM_FOOTER_SIZE)) return XCC_ERRNO_FORMAT;
+    index = footer - index_size;
+    if(xcd_util_xz_get_le32(index + index_size - 4) != CrcCalc(index, index_size - 4)) return XCC_ERRNO_FORMAT;
+    if(0 != index[0]) return XCC_ERRNO_FORMAT;
+    pos = 1;
+    if(0 == (n = Xz_ReadVarInt(index + pos, index_size - pos, &v))) return XCC_ERRNO_FORMAT;
+    pos += n;
+    if(0 == v || v > XCD_UTIL_XZ_MT_BLOCKS_MAX) return XCC_ERRNO_RANGE;
+    num = (size_t)v;
+
+    if(NULL == (*blocks = malloc(sizeof(xcd_util_xz_block_t) * num))) return XCC_ERRNO_NOMEM;
+    for(i = 0; i < num; i++)
+    {
+        if(0 == (n = Xz_ReadVarInt(index + pos, index_size - pos, &unpadded_size))) goto err;
+        pos += n;
+        if(0 == (n = Xz_ReadVarInt(index + pos, index_size - pos, &unpack_size))) goto err;
+        pos += n;
+        if((UInt64)(size_t)(unpadded_size + 3) != unpadded_size + 3 || (UInt64)(size_t)unpack_size != unpack_size) goto err;
+
+        (*blocks)[i].src_offset = src_offset;
+        (*blocks)[i].src_size = (size_t)((unpadded_size + 3) & ~(UInt64)3);
+        (*blocks)[i].dst_offset = dst_offset;
+        (*blocks)[i].dst_size = (size_t)unpack_size;
+        if((*blocks)[i].src_size > (size_t)(index - src) - src_offset) goto err;
+        if((*blocks)[i].dst_size > SIZE_MAX - dst_offset) goto err;
+        src_offset += (*blocks)[i].src_size;
+        dst_offset += (*blocks)[i].dst_size;
+    }
+    if(src + src_offset != index) goto err;
+
+    *blocks_num = num;
+    *dst_size = dst_offset;
+    return 0;
+
+ err:
+    free(*blocks);
+    *blocks = NULL;
+    return XCC_ERRNO_FORMAT;
+}
+
+static void *xcd_util_xz_mt_worker(void *arg)
+{
+    xcd_util_xz_mt_t    *mt = (xcd_util_xz_mt_t *)arg;
+    xcd_util_xz_block_t *block;
+    ISzAlloc             alloc = {.Alloc = xcd_util_xz_alloc, .Free = xcd_util_xz_free};
+    CXzUnpacker          state;
+    ECoderStatus         status;
+    SizeT                src_len, dst_len;
+    size_t               i;
+
+    XzUnpacker_Construct(&state, &alloc);
+    while(!__atomic_load_n(&(mt->failed), __ATOMIC_RELAXED))
+    {
+        if((i = __atomic_fetch_add(&(mt->blocks_next), 1, __ATOMIC_RELAXED)) >= mt->blocks_num) break;
+        block = &(mt->blocks[i]);
+
+        //decode the block into its place in the output buffer directly (no dictionary buffer)
+        XzUnpacker_Init(&state);
+        XzUnpacker_SetOutBuf(&state, mt->dst + block->dst_offset, block->dst_size);
+        state.streamFlags = mt->flags;
+        XzUnpacker_PrepareToRandomBlockDecoding(&state);
+        src_len = block->src_size;
+        dst_len = block->dst_size;
+        if(SZ_OK != XzUnpacker_Code(&state, NULL, &dst_len, mt->src + block->src_offset, &src_len, 1, CODER_FINISH_END, &status) ||
+           CODER_STATUS_FINISHED_WITH_MARK != status || dst_len != block->dst_size)
+            __atomic_store_n(&(mt->failed), 1, __ATOMIC_RELAXED);
+    }
+    XzUnpacker_Free(&state);
+
+    return NULL;
+}
+
+//XCC_ERRNO_NOTSPT means falling back to the single-threaded decoding
+static int xcd_util_xz_decompress_mt(uint8_t *src, size_t src_size, uint8_t **dst, size_t *dst_size)
+{
+    xcd_util_xz_mt_t mt;
+    pthread_t        thds[XCD_UTIL_XZ_MT_THREADS_MAX - 1];
+    size_t           thds_num = 0, i;
+    long             cpus;
+    int              r;
+
+    if(src_size < XCD_UTIL_XZ_MT_SRC_SIZE_MIN) return XCC_ERRNO_NOTSPT;
+    if((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 2) return XCC_ERRNO_NOTSPT;
+
+    memset(&mt, 0, sizeof(mt));
+    mt.src = src;
+    if(0 != xcd_util_xz_get_blocks(src, src_size, &(mt.flags), &(mt.blocks), &(mt.blocks_num), dst_size)) return XCC_ERRNO_NOTSPT;
+    if(mt.blocks_num < 2)
+    {
+        r = XCC_ERRNO_NOTSPT;
+        goto end;
+    }
+    if(NULL == (mt.dst = malloc(0 == *dst_size ? 1 : *dst_size)))
+    {
+        r = XCC_ERRNO_NOMEM;
+        goto end;
+    }
+
+    //the current thread is one of the workers
+    for(i = 1; i < XCD_UTIL_XZ_MT_THREADS_MAX && i < (size_t)cpus && i < mt.blocks_num; i++)
+        if(0 == pthread_create(&(thds[thds_num]), NULL, xcd_util_xz_mt_worker, &mt)) thds_num++;
+    xcd_util_xz_mt_worker(&mt);
+    for(i = 0; i < thds_num; i++)
+        pthread_join(thds[i], NULL);
+
+    if(mt.failed)
+    {
+        free(mt.dst);
+        r = XCC_ERRNO_FORMAT;
+        goto end;
+    }
+    *dst = mt.dst;
+    r = 0;
+
+ end:
+    free(mt.blocks);
+    return r;
+}
+
 int xcd_util_xz_decompress(uint8_t* src, size_t src_size, uint8_t** dst, size_t* dst_size)
 {
     size_t       src_offset = 0;
@@ -209,6 +395,7 @@ int xcd_util_xz_decompress(uint8_t* src, size_t src_size, uint8_t** dst, size_t*
     ISzAlloc     alloc = {.Alloc = xcd_util_xz_alloc, .Free = xcd_util_xz_free};
     CXzUnpacker  state;
     ECoderStatus status;
+    int          r;
 
     if(!xcd_util_xz_crc_gen)
     {
@@ -219,6 +406,8 @@ int xcd_util_xz_decompress(uint8_t* src, size_t src_size, uint8_t** dst, size_t*
         Crc64GenerateTable();
     }
 
+    if(XCC_ERRNO_NOTSPT != (r = xcd_util_xz_decompress_mt(src, src_size, dst, dst_size))) return r;
+
     XzUnpacker_Construct(&state, &alloc);
     
     *dst_size = 2 * src_size;
@@ -32,6 +32,9 @@
 extern "C" {
 #endif
 
+typedef size_t (*xcd_util_remote_read_t)(pid_t pid, uintptr_t addr, void *dst, size_t bytes);
+void xcd_util_set_remote_read(xcd_util_remote_read_t remote_read);
+
 size_t xcd_util_ptrace_read(pid_t pid, uintptr_t addr, void *dst, size_t bytes);
 int xcd_util_ptrace_read_fully(pid_t pid, uintptr_t addr, void *dst, size_t bytes);
 int xcd_util_ptrace_read_long(pid_t pid, uintptr_t addr, long *value);
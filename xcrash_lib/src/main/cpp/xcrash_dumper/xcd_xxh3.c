@@ -0,0 +1,416 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define XCD_XXH3_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define XCD_XXH3_SSE2 1
+#endif
+#include "xcc_errno.h"
+#include "xcd_xxh3.h"
+
+//XXH3-64 of xxHash (https://github.com/Cyan4973/xxHash), only with the seed 0 and the default secret.
+
+#define XCD_XXH3_PRIME32_1 0x9E3779B1U
+#define XCD_XXH3_PRIME32_2 0x85EBCA77U
+#define XCD_XXH3_PRIME32_3 0xC2B2AE3DU
+#define XCD_XXH3_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XCD_XXH3_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XCD_XXH3_PRIME64_3 0x165667B19E3779F9ULL
+#define XCD_XXH3_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XCD_XXH3_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XCD_XXH3_PRIME_MX1 0x165667919E3779F9ULL
+#define XCD_XXH3_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XCD_XXH3_SECRET_SIZE       192
+#define XCD_XXH3_STRIPE_LEN        64
+#define XCD_XXH3_SECRET_CONSUME    8
+#define XCD_XXH3_STRIPES_PER_BLOCK ((XCD_XXH3_SECRET_SIZE - XCD_XXH3_STRIPE_LEN) / XCD_XXH3_SECRET_CONSUME)
+#define XCD_XXH3_BLOCK_LEN         (XCD_XXH3_STRIPE_LEN * XCD_XXH3_STRIPES_PER_BLOCK)
+
+static const uint8_t xcd_xxh3_secret[XCD_XXH3_SECRET_SIZE] __attribute__((aligned(16))) = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static uint32_t xcd_xxh3_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t xcd_xxh3_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t xcd_xxh3_rotl64(uint64_t v, unsigned int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static uint64_t xcd_xxh3_mul128_fold64(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wlanguage-extension-token"
+    __uint128_t product = (__uint128_t)a * (__uint128_t)b;
+#pragma clang diagnostic pop
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static uint64_t xcd_xxh3_xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= XCD_XXH3_PRIME64_2;
+    h ^= h >> 29;
+    h *= XCD_XXH3_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xcd_xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= XCD_XXH3_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xcd_xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= xcd_xxh3_rotl64(h, 49) ^ xcd_xxh3_rotl64(h, 24);
+    h *= XCD_XXH3_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XCD_XXH3_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t xcd_xxh3_mix16(const uint8_t *data, const uint8_t *secret)
+{
+    return xcd_xxh3_mul128_fold64(xcd_xxh3_read64(data) ^ xcd_xxh3_read64(secret),
+                                  xcd_xxh3_read64(data + 8) ^ xcd_xxh3_read64(secret + 8));
+}
+
+static uint64_t xcd_xxh3_len_0to16(const uint8_t *data, size_t len)
+{
+    const uint8_t *s = xcd_xxh3_secret;
+    uint64_t       v, lo, hi;
+
+    if(len > 8)
+    {
+        lo = xcd_xxh3_read64(data) ^ (xcd_xxh3_read64(s + 24) ^ xcd_xxh3_read64(s + 32));
+        hi = xcd_xxh3_read64(data + len - 8) ^ (xcd_xxh3_read64(s + 40) ^ xcd_xxh3_read64(s + 48));
+        return xcd_xxh3_avalanche((uint64_t)len + __builtin_bswap64(lo) + hi + xcd_xxh3_mul128_fold64(lo, hi));
+    }
+    else if(len >= 4)
+    {
+        v = (uint64_t)xcd_xxh3_read32(data + len - 4) + ((uint64_t)xcd_xxh3_read32(data) << 32);
+        return xcd_xxh3_rrmxmx(v ^ (xcd_xxh3_read64(s + 8) ^ xcd_xxh3_read64(s + 16)), (uint64_t)len);
+    }
+    else if(len > 0)
+    {
+        v = ((uint32_t)data[0] << 16) | ((uint32_t)data[len >> 1] << 24) | (uint32_t)data[len - 1] | ((uint32_t)len << 8);
+        return xcd_xxh3_xxh64_avalanche(v ^ (uint64_t)(xcd_xxh3_read32(s) ^ xcd_xxh3_read32(s + 4)));
+    }
+    else
+        return xcd_xxh3_xxh64_avalanche(xcd_xxh3_read64(s + 56) ^ xcd_xxh3_read64(s + 64));
+}
+
+static uint64_t xcd_xxh3_len_17to128(const uint8_t *data, size_t len)
+{
+    const uint8_t *s = xcd_xxh3_secret;
+    uint64_t       acc = (uint64_t)len * XCD_XXH3_PRIME64_1;
+
+    if(len > 32)
+    {
+        if(len > 64)
+        {
+            if(len > 96)
+            {
+                acc += xcd_xxh3_mix16(data + 48, s + 96);
+                acc += xcd_xxh3_mix16(data + len - 64, s + 112);
+            }
+            acc += xcd_xxh3_mix16(data + 32, s + 64);
+            acc += xcd_xxh3_mix16(data + len - 48, s + 80);
+        }
+        acc += xcd_xxh3_mix16(data + 16, s + 32);
+        acc += xcd_xxh3_mix16(data + len - 32, s + 48);
+    }
+    acc += xcd_xxh3_mix16(data, s);
+    acc += xcd_xxh3_mix16(data + len - 16, s + 16);
+
+    return xcd_xxh3_avalanche(acc);
+}
+
+static uint64_t xcd_xxh3_len_129to240(const uint8_t *data, size_t len)
+{
+    const uint8_t *s = xcd_xxh3_secret;
+    uint64_t       acc = (uint64_t)len * XCD_XXH3_PRIME64_1;
+    size_t         rounds = len / 16, i;
+
+    for(i = 0; i < 8; i++)
+        acc += xcd_xxh3_mix16(data + 16 * i, s + 16 * i);
+    acc = xcd_xxh3_avalanche(acc);
+    for(i = 8; i < rounds; i++)
+        acc += xcd_xxh3_mix16(data + 16 * i, s + 16 * (i - 8) + 3);
+    acc += xcd_xxh3_mix16(data + len - 16, s + 136 - 17);
+
+    return xcd_xxh3_avalanche(acc);
+}
+
+//accumulate the stripes (each stripe uses the secret at 8 bytes after the previous one)
+#if XCD_XXH3_NEON
+
+static void xcd_xxh3_accumulate(uint64_t *acc, const uint8_t *data, const uint8_t *secret, size_t stripes)
+{
+    uint64x2_t a[4], d, dk;
+    size_t     n, i;
+
+    for(i = 0; i < 4; i++)
+        a[i] = vld1q_u64(acc + 2 * i);
+    for(n = 0; n < stripes; n++, data += XCD_XXH3_STRIPE_LEN, secret += XCD_XXH3_SECRET_CONSUME)
+    {
+        for(i = 0; i < 4; i++)
+        {
+            d    = vreinterpretq_u64_u8(vld1q_u8(data + 16 * i));
+            dk   = veorq_u64(d, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+            a[i] = vaddq_u64(a[i], vextq_u64(d, d, 1));
+            a[i] = vmlal_u32(a[i], vmovn_u64(dk), vshrn_n_u64(dk, 32));
+        }
+    }
+    for(i = 0; i < 4; i++)
+        vst1q_u64(acc + 2 * i, a[i]);
+}
+
+static void xcd_xxh3_scramble(uint64_t *acc, const uint8_t *secret)
+{
+    uint32x2_t prime = vdup_n_u32(XCD_XXH3_PRIME32_1);
+    uint64x2_t a, hi;
+    size_t     i;
+
+    for(i = 0; i < 4; i++)
+    {
+        a  = vld1q_u64(acc + 2 * i);
+        a  = veorq_u64(a, vshrq_n_u64(a, 47));
+        a  = veorq_u64(a, vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i)));
+        hi = vshlq_n_u64(vmull_u32(vshrn_n_u64(a, 32), prime), 32);
+        vst1q_u64(acc + 2 * i, vmlal_u32(hi, vmovn_u64(a), prime));
+    }
+}
+
+#elif XCD_XXH3_SSE2
+
+static void xcd_xxh3_accumulate(uint64_t *acc, const uint8_t *data, const uint8_t *secret, size_t stripes)
+{
+    __m128i a[4], d, dk;
+    size_t  n, i;
+
+    for(i = 0; i < 4; i++)
+        a[i] = _mm_loadu_si128((const __m128i *)(const void *)(acc + 2 * i));
+    for(n = 0; n < stripes; n++, data += XCD_XXH3_STRIPE_LEN, secret += XCD_XXH3_SECRET_CONSUME)
+    {
+        for(i = 0; i < 4; i++)
+        {
+            d    = _mm_loadu_si128((const __m128i *)(const void *)(data + 16 * i));
+            dk   = _mm_xor_si128(d, _mm_loadu_si128((const __m128i *)(const void *)(secret + 16 * i)));
+            a[i] = _mm_add_epi64(a[i], _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+            a[i] = _mm_add_epi64(a[i], _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1))));
+        }
+    }
+    for(i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i *)(void *)(acc + 2 * i), a[i]);
+}
+
+static void xcd_xxh3_scramble(uint64_t *acc, const uint8_t *secret)
+{
+    __m128i prime = _mm_set1_epi32((int)XCD_XXH3_PRIME32_1);
+    __m128i a, lo, hi;
+    size_t  i;
+
+    for(i = 0; i < 4; i++)
+    {
+        a  = _mm_loadu_si128((const __m128i *)(const void *)(acc + 2 * i));
+        a  = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a  = _mm_xor_si128(a, _mm_loadu_si128((const __m128i *)(const void *)(secret + 16 * i)));
+        lo = _mm_mul_epu32(a, prime);
+        hi = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm_storeu_si128((__m128i *)(void *)(acc + 2 * i), _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+#else
+
+static void xcd_xxh3_accumulate(uint64_t *acc, const uint8_t *data, const uint8_t *secret, size_t stripes)
+{
+    uint64_t d, dk;
+    size_t   n, i;
+
+    for(n = 0; n < stripes; n++, data += XCD_XXH3_STRIPE_LEN, secret += XCD_XXH3_SECRET_CONSUME)
+    {
+        for(i = 0; i < 8; i++)
+        {
+            d = xcd_xxh3_read64(data + 8 * i);
+            dk = d ^ xcd_xxh3_read64(secret + 8 * i);
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32);
+        }
+    }
+}
+
+static void xcd_xxh3_scramble(uint64_t *acc, const uint8_t *secret)
+{
+    size_t i;
+
+    for(i = 0; i < 8; i++)
+    {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= xcd_xxh3_read64(secret + 8 * i);
+        acc[i] *= XCD_XXH3_PRIME32_1;
+    }
+}
+
+#endif
+
+static uint64_t xcd_xxh3_len_long(const uint8_t *data, size_t len)
+{
+    const uint8_t *s = xcd_xxh3_secret;
+    uint64_t       acc[8] __attribute__((aligned(16))) = {
+        XCD_XXH3_PRIME32_3, XCD_XXH3_PRIME64_1, XCD_XXH3_PRIME64_2, XCD_XXH3_PRIME64_3,
+        XCD_XXH3_PRIME64_4, XCD_XXH3_PRIME32_2, XCD_XXH3_PRIME64_5, XCD_XXH3_PRIME32_1};
+    size_t         blocks = (len - 1) / XCD_XXH3_BLOCK_LEN, n;
+    uint64_t       result = (uint64_t)len * XCD_XXH3_PRIME64_1;
+
+    for(n = 0; n < blocks; n++)
+    {
+        xcd_xxh3_accumulate(acc, data + n * XCD_XXH3_BLOCK_LEN, s, XCD_XXH3_STRIPES_PER_BLOCK);
+        xcd_xxh3_scramble(acc, s + XCD_XXH3_SECRET_SIZE - XCD_XXH3_STRIPE_LEN);
+    }
+
+    //the last partial block, and the last stripe
+    xcd_xxh3_accumulate(acc, data + blocks * XCD_XXH3_BLOCK_LEN, s,
+                        ((len - 1) - blocks * XCD_XXH3_BLOCK_LEN) / XCD_XXH3_STRIPE_LEN);
+    xcd_xxh3_accumulate(acc, data + len - XCD_XXH3_STRIPE_LEN, s + XCD_XXH3_SECRET_SIZE - XCD_XXH3_STRIPE_LEN - 7, 1);
+
+    //merge the accumulators
+    for(n = 0; n < 4; n++)
+        result += xcd_xxh3_mul128_fold64(acc[2 * n] ^ xcd_xxh3_read64(s + 11 + 16 * n),
+                                         acc[2 * n + 1] ^ xcd_xxh3_read64(s + 11 + 16 * n + 8));
+    return xcd_xxh3_avalanche(result);
+}
+
+uint64_t xcd_xxh3_64(const uint8_t *data, size_t len)
+{
+    if(len <= 16) return xcd_xxh3_len_0to16(data, len);
+    if(len <= 128) return xcd_xxh3_len_17to128(data, len);
+    if(len <= 240) return xcd_xxh3_len_129to240(data, len);
+    return xcd_xxh3_len_long(data, len);
+}
+
+//multi-threaded hashing of the chunks
+#define XCD_XXH3_TREE_THREADS_MAX   4
+#define XCD_XXH3_TREE_MT_SIZE_MIN   (8 * XCD_XXH3_TREE_CHUNK_SIZE) //not worth the threads for the small ones
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    const uint8_t *data;
+    size_t         len;
+    uint8_t       *leaves;
+    size_t         chunks_num;
+    size_t         chunks_next;
+} xcd_xxh3_tree_t;
+#pragma clang diagnostic pop
+
+static void *xcd_xxh3_tree_worker(void *arg)
+{
+    xcd_xxh3_tree_t *tree = (xcd_xxh3_tree_t *)arg;
+    size_t           i, offset;
+    uint64_t         leaf;
+
+    while((i = __atomic_fetch_add(&(tree->chunks_next), 1, __ATOMIC_RELAXED)) < tree->chunks_num)
+    {
+        offset = i * XCD_XXH3_TREE_CHUNK_SIZE;
+        leaf = xcd_xxh3_64(tree->data + offset,
+                           tree->len - offset < XCD_XXH3_TREE_CHUNK_SIZE ? tree->len - offset : XCD_XXH3_TREE_CHUNK_SIZE);
+        memcpy(tree->leaves + i * sizeof(leaf), &leaf, sizeof(leaf)); //little-endian
+    }
+
+    return NULL;
+}
+
+int xcd_xxh3_tree(const uint8_t *data, size_t len, uint64_t *hash)
+{
+    xcd_xxh3_tree_t tree;
+    pthread_t       thds[XCD_XXH3_TREE_THREADS_MAX - 1];
+    size_t          thds_num = 0, i;
+    long            cpus;
+
+    memset(&tree, 0, sizeof(tree));
+    tree.data = data;
+    tree.len = len;
+    tree.chunks_num = (0 == len ? 1 : (len - 1) / XCD_XXH3_TREE_CHUNK_SIZE + 1);
+    if(NULL == (tree.leaves = malloc(tree.chunks_num * sizeof(uint64_t)))) return XCC_ERRNO_NOMEM;
+
+    //the current thread is one of the workers
+    if(len >= XCD_XXH3_TREE_MT_SIZE_MIN && (cpus = sysconf(_SC_NPROCESSORS_ONLN)) > 1)
+        for(i = 1; i < XCD_XXH3_TREE_THREADS_MAX && i < (size_t)cpus; i++)
+            if(0 == pthread_create(&(thds[thds_num]), NULL, xcd_xxh3_tree_worker, &tree)) thds_num++;
+    xcd_xxh3_tree_worker(&tree);
+    for(i = 0; i < thds_num; i++)
+        pthread_join(thds[i], NULL);
+
+    *hash = xcd_xxh3_64(tree.leaves, tree.chunks_num * sizeof(uint64_t));
+    free(tree.leaves);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef XCD_XXH3_H
+#define XCD_XXH3_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//the chunk size of the tree hash
+#define XCD_XXH3_TREE_CHUNK_SIZE (1024 * 1024)
+
+//XXH3-64 (seed 0, the default secret) of xxHash
+uint64_t xcd_xxh3_64(const uint8_t *data, size_t len);
+
+//XXH3-64 of the concatenation of the little-endian XXH3-64 of every chunk (at least one chunk),
+//the chunks are hashed by several threads for the large data. (same as xcrash.Xxh3.hashFile() in Java)
+int xcd_xxh3_tree(const uint8_t *data, size_t len, uint64_t *hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+//Replacement of the NDK header for building on a Linux host.
+
+#ifndef XCR_ANDROID_LOG_H
+#define XCR_ANDROID_LOG_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ANDROID_LOG_DEBUG 3
+#define ANDROID_LOG_INFO  4
+#define ANDROID_LOG_WARN  5
+#define ANDROID_LOG_ERROR 6
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
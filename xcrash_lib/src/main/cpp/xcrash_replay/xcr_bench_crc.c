@@ -0,0 +1,193 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "xcd_crc.h"
+
+//Check the CRC32 and CRC64 implementations of xz against the bitwise references, then measure their
+//throughput. The hardware-accelerated ones are only checked and measured if the CPU supports them.
+//
+//  xcrash_bench_crc           check and benchmark
+//  xcrash_bench_crc --check   check only (run by ctest)
+
+#define XCR_BENCH_CRC32_POLY  0xEDB88320U
+#define XCR_BENCH_CRC64_POLY  0xC96C5795D7870F42ULL
+
+#define XCR_BENCH_CHECK_LEN   1024
+#define XCR_BENCH_CHECK_ALIGN 16
+#define XCR_BENCH_BUF_LEN     (1024 * 1024)
+#define XCR_BENCH_BYTES       (256 * 1024 * 1024)
+
+static uint32_t xcr_bench_crc32_bitwise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    int k;
+
+    for(; len > 0; len--, buf++)
+    {
+        crc ^= *buf;
+        for(k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (XCR_BENCH_CRC32_POLY & (0U - (crc & 1)));
+    }
+    return crc;
+}
+
+static uint64_t xcr_bench_crc64_bitwise(uint64_t crc, const uint8_t *buf, size_t len)
+{
+    int k;
+
+    for(; len > 0; len--, buf++)
+    {
+        crc ^= *buf;
+        for(k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (XCR_BENCH_CRC64_POLY & (0ULL - (crc & 1)));
+    }
+    return crc;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    const char         *name;
+    xcd_crc32_update_t  crc32;
+    xcd_crc64_update_t  crc64;
+} xcr_bench_impl_t;
+#pragma clang diagnostic pop
+
+static uint64_t xcr_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+//every length and alignment up to the limits, in one piece and in two
+static int xcr_bench_check(const xcr_bench_impl_t *impl, const uint8_t *buf)
+{
+    const uint8_t *p;
+    size_t         align, len, split;
+    uint32_t       c32;
+    uint64_t       c64;
+    int            failed = 0;
+
+    //the check values of "123456789"
+    if(0xCBF43926U != (impl->crc32(0xFFFFFFFFU, (const uint8_t *)"123456789", 9) ^ 0xFFFFFFFFU) ||
+       0x995DC9BBDF1939FAULL != (impl->crc64(~0ULL, (const uint8_t *)"123456789", 9) ^ ~0ULL))
+    {
+        fprintf(stderr, "%s: wrong check value\n", impl->name);
+        failed = 1;
+    }
+
+    for(align = 0; align < XCR_BENCH_CHECK_ALIGN; align++)
+    {
+        for(len = 0; len <= XCR_BENCH_CHECK_LEN; len++)
+        {
+            p = buf + align;
+            c32 = xcr_bench_crc32_bitwise(0xFFFFFFFFU, p, len);
+            c64 = xcr_bench_crc64_bitwise(~0ULL, p, len);
+            split = len / 3;
+
+            if(c32 != impl->crc32(0xFFFFFFFFU, p, len) ||
+               c32 != impl->crc32(impl->crc32(0xFFFFFFFFU, p, split), p + split, len - split))
+            {
+                fprintf(stderr, "%s: CRC32 mismatch, align=%zu, len=%zu\n", impl->name, align, len);
+                failed = 1;
+            }
+            if(c64 != impl->crc64(~0ULL, p, len) ||
+               c64 != impl->crc64(impl->crc64(~0ULL, p, split), p + split, len - split))
+            {
+                fprintf(stderr, "%s: CRC64 mismatch, align=%zu, len=%zu\n", impl->name, align, len);
+                failed = 1;
+            }
+        }
+    }
+
+    return failed;
+}
+
+static void xcr_bench_run(const xcr_bench_impl_t *impl, const uint8_t *buf, size_t total)
+{
+    volatile uint32_t c32 = 0xFFFFFFFFU;
+    volatile uint64_t c64 = ~0ULL;
+    uint64_t          t32, t64;
+    size_t            i, n = total / XCR_BENCH_BUF_LEN;
+
+    t32 = xcr_bench_now_ns();
+    for(i = 0; i < n; i++)
+        c32 = impl->crc32(c32, buf, XCR_BENCH_BUF_LEN);
+    t32 = xcr_bench_now_ns() - t32;
+
+    t64 = xcr_bench_now_ns();
+    for(i = 0; i < n; i++)
+        c64 = impl->crc64(c64, buf, XCR_BENCH_BUF_LEN);
+    t64 = xcr_bench_now_ns() - t64;
+
+    printf("%-10s CRC32 %8.1f MB/s, CRC64 %8.1f MB/s\n", impl->name,
+           (double)(n * XCR_BENCH_BUF_LEN) * 1000.0 / (double)t32,
+           (double)(n * XCR_BENCH_BUF_LEN) * 1000.0 / (double)t64);
+}
+
+int main(int argc, char **argv)
+{
+    xcr_bench_impl_t impls[3] = {
+        {"bitwise", xcr_bench_crc32_bitwise, xcr_bench_crc64_bitwise},
+        {"table", xcd_crc32_update_sw, xcd_crc64_update_sw},
+        {"hardware", xcd_crc32_update_sw, xcd_crc64_update_sw}
+    };
+    size_t   impls_num = 2, i;
+    uint8_t *buf;
+    uint32_t seed = 1;
+    int      check_only = (argc > 1 && 0 == strcmp(argv[1], "--check"));
+    int      failed = 0;
+
+    if(NULL == (buf = malloc(XCR_BENCH_BUF_LEN + XCR_BENCH_CHECK_ALIGN))) return 1;
+    for(i = 0; i < XCR_BENCH_BUF_LEN + XCR_BENCH_CHECK_ALIGN; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+
+    //each of the hardware-accelerated CRC32 and CRC64 is optional
+    xcd_crc_select_hw(&(impls[2].crc32), &(impls[2].crc64));
+    if(impls[2].crc32 != xcd_crc32_update_sw || impls[2].crc64 != xcd_crc64_update_sw) impls_num = 3;
+    printf("hardware-accelerated: CRC32 %s, CRC64 %s\n",
+           impls[2].crc32 != xcd_crc32_update_sw ? "yes" : "no",
+           impls[2].crc64 != xcd_crc64_update_sw ? "yes" : "no");
+
+    for(i = 1; i < impls_num; i++)
+        if(xcr_bench_check(&(impls[i]), buf)) failed = 1;
+    printf("check: %s\n", failed ? "FAILED" : "OK");
+
+    if(!check_only && !failed)
+    {
+        xcr_bench_run(&(impls[0]), buf, XCR_BENCH_BYTES / 64);
+        for(i = 1; i < impls_num; i++)
+            xcr_bench_run(&(impls[i]), buf, XCR_BENCH_BYTES);
+    }
+
+    free(buf);
+    return failed;
+}
@@ -0,0 +1,265 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <elf.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_arm_exidx.h"
+#include "xcd_memory.h"
+#include "xcd_regs.h"
+#include "xcd_util.h"
+
+//Replay the .ARM.exidx table of armeabi-v7a libraries: step once from (a point in) every function
+//of the table, in a shuffled order.
+//  cold: a new xcd_arm_exidx_t for each round, every entry is looked up and decoded for the first time
+//  warm: the same xcd_arm_exidx_t for all rounds, as when unwinding all the threads of a process
+
+#define XCR_BENCH_ROUNDS_DEFAULT 10
+
+//the fake stack which the unwind instructions pop the registers from
+#define XCR_BENCH_STACK_BASE     0x10000000
+#define XCR_BENCH_STACK_SIZE     (64 * 1024)
+
+static uint8_t xcr_bench_stack[XCR_BENCH_STACK_SIZE];
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    size_t ok;
+    size_t finished;
+    size_t failed;
+} xcr_bench_result_t;
+#pragma clang diagnostic pop
+
+static uint64_t xcr_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static size_t xcr_bench_read_stack(pid_t pid, uintptr_t addr, void *dst, size_t bytes)
+{
+    (void)pid;
+
+    if(addr < XCR_BENCH_STACK_BASE || addr >= XCR_BENCH_STACK_BASE + XCR_BENCH_STACK_SIZE) return 0;
+    if(bytes > XCR_BENCH_STACK_BASE + XCR_BENCH_STACK_SIZE - addr) bytes = XCR_BENCH_STACK_BASE + XCR_BENCH_STACK_SIZE - addr;
+    memcpy(dst, xcr_bench_stack + (addr - XCR_BENCH_STACK_BASE), bytes);
+    return bytes;
+}
+
+static int xcr_bench_load_file(const char *pathname, uint8_t **data, size_t *data_len)
+{
+    struct stat st;
+    ssize_t     n;
+    int         fd;
+
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
+    if(0 != fstat(fd, &st) || st.st_size <= 0) goto err;
+    *data_len = (size_t)st.st_size;
+    if(NULL == (*data = malloc(*data_len))) goto err;
+    if(0 > (n = XCC_UTIL_TEMP_FAILURE_RETRY(read(fd, *data, *data_len))) || (size_t)n != *data_len)
+    {
+        free(*data);
+        goto err;
+    }
+    close(fd);
+    return 0;
+
+ err:
+    close(fd);
+    return XCC_ERRNO_SYS;
+}
+
+//the file offset and size of the PT_ARM_EXIDX segment
+static int xcr_bench_find_exidx(const uint8_t *data, size_t data_len, size_t *offset, size_t *size)
+{
+    Elf32_Ehdr ehdr;
+    Elf32_Phdr phdr;
+    size_t     i;
+
+    if(data_len < sizeof(ehdr)) return XCC_ERRNO_FORMAT;
+    memcpy(&ehdr, data, sizeof(ehdr));
+    if(0 != memcmp(ehdr.e_ident, ELFMAG, SELFMAG) || ELFCLASS32 != ehdr.e_ident[EI_CLASS] || EM_ARM != ehdr.e_machine)
+        return XCC_ERRNO_FORMAT;
+
+    for(i = 0; i < ehdr.e_phnum; i++)
+    {
+        if(ehdr.e_phoff + (i + 1) * sizeof(phdr) > data_len) return XCC_ERRNO_FORMAT;
+        memcpy(&phdr, data + ehdr.e_phoff + i * sizeof(phdr), sizeof(phdr));
+        if(PT_ARM_EXIDX != phdr.p_type) continue;
+        if(0 == phdr.p_filesz || phdr.p_offset + phdr.p_filesz > data_len) return XCC_ERRNO_FORMAT;
+
+        *offset = phdr.p_offset;
+        *size = phdr.p_filesz;
+        return 0;
+    }
+
+    return XCC_ERRNO_NOTFND;
+}
+
+//a pc inside each function of the table (the same offset space as the table)
+static int xcr_bench_get_pcs(const uint8_t *data, size_t offset, size_t size, uintptr_t **pcs, size_t *pcs_num)
+{
+    size_t    num = size / 8, i, j;
+    uint32_t  value;
+    uint32_t  seed = 1;
+    uintptr_t pc;
+
+    if(0 == num) return XCC_ERRNO_NOTFND;
+    if(NULL == (*pcs = malloc(sizeof(uintptr_t) * num))) return XCC_ERRNO_NOMEM;
+    for(i = 0; i < num; i++)
+    {
+        memcpy(&value, data + offset + i * 8, sizeof(value));
+        (*pcs)[i] = (uintptr_t)(uint32_t)((int32_t)(offset + i * 8) + (((int32_t)value << 1) >> 1)) + 2;
+    }
+
+    //shuffle them with a fixed seed
+    for(i = num - 1; i > 0; i--)
+    {
+        seed = seed * 1103515245 + 12345;
+        j = (size_t)(seed >> 8) % (i + 1);
+        pc = (*pcs)[i];
+        (*pcs)[i] = (*pcs)[j];
+        (*pcs)[j] = pc;
+    }
+
+    *pcs_num = num;
+    return 0;
+}
+
+static void xcr_bench_step_all(xcd_arm_exidx_t *exidx, uintptr_t *pcs, size_t pcs_num, xcr_bench_result_t *result)
+{
+    xcd_regs_t regs;
+    size_t     i;
+    int        finished;
+
+    for(i = 0; i < pcs_num; i++)
+    {
+        memset(&regs, 0, sizeof(regs));
+        xcd_regs_set_sp(&regs, XCR_BENCH_STACK_BASE + XCR_BENCH_STACK_SIZE / 2);
+        xcd_regs_set_pc(&regs, pcs[i]);
+        regs.r[14] = 0x1000; //lr
+
+        finished = 0;
+        if(0 != xcd_arm_exidx_step(exidx, &regs, 0, pcs[i], &finished)) result->failed++;
+        else if(finished) result->finished++;
+        else result->ok++;
+    }
+}
+
+static int xcr_bench_run(const char *pathname, size_t rounds)
+{
+    uint8_t            *data;
+    size_t              data_len, offset, size, pcs_num, i;
+    uintptr_t          *pcs = NULL;
+    xcd_memory_t       *memory = NULL;
+    xcd_arm_exidx_t    *exidx = NULL;
+    xcr_bench_result_t  result;
+    uint64_t            t, cold = 0, warm = 0;
+    int                 r;
+
+    if(0 != (r = xcr_bench_load_file(pathname, &data, &data_len))) return r;
+    if(0 != (r = xcr_bench_find_exidx(data, data_len, &offset, &size)) ||
+       0 != (r = xcr_bench_get_pcs(data, offset, size, &pcs, &pcs_num)))
+    {
+        free(data);
+        return r;
+    }
+
+    //the memory object owns the data
+    if(0 != (r = xcd_memory_create_from_buf(&memory, data, data_len)))
+    {
+        free(data);
+        goto end;
+    }
+
+    for(i = 0; i < rounds; i++)
+    {
+        //exidx objects are never destroyed by the dumper, so this leaks one per round
+        memset(&result, 0, sizeof(result));
+        t = xcr_bench_now_ns();
+        if(0 != (r = xcd_arm_exidx_create(&exidx, memory, 0, offset, size))) goto end;
+        xcr_bench_step_all(exidx, pcs, pcs_num, &result);
+        cold += xcr_bench_now_ns() - t;
+    }
+
+    for(i = 0; i < rounds; i++)
+    {
+        memset(&result, 0, sizeof(result));
+        t = xcr_bench_now_ns();
+        xcr_bench_step_all(exidx, pcs, pcs_num, &result);
+        warm += xcr_bench_now_ns() - t;
+    }
+
+    printf("%s: %zu entries (ok %zu, finished %zu, failed %zu), cold %.1f ns/step, warm %.1f ns/step\n",
+           pathname, pcs_num, result.ok, result.finished, result.failed,
+           (double)cold / (double)(rounds * pcs_num), (double)warm / (double)(rounds * pcs_num));
+
+ end:
+    if(NULL != memory) xcd_memory_destroy(&memory);
+    free(pcs);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    size_t rounds = XCR_BENCH_ROUNDS_DEFAULT, i;
+    int    first = 1, ret = 0, r;
+
+    if(argc >= 3 && 0 == strcmp(argv[1], "-n"))
+    {
+        rounds = (size_t)strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+    if(first >= argc || 0 == rounds)
+    {
+        fprintf(stderr, "usage: %s [-n rounds] <armeabi-v7a .so>...\n", argv[0]);
+        return 1;
+    }
+
+    //every word on the fake stack is a non-zero address
+    for(i = 0; i + 4 <= sizeof(xcr_bench_stack); i += 4)
+        *(uint32_t *)(void *)(xcr_bench_stack + i) = (uint32_t)(0x2000 + i);
+    xcd_util_set_remote_read(xcr_bench_read_stack);
+
+    for(; first < argc; first++)
+    {
+        if(0 != (r = xcr_bench_run(argv[first], rounds)))
+        {
+            fprintf(stderr, "xcrash_bench_exidx: %s failed (%d)\n", argv[first], r);
+            ret = 2;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,257 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <elf.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_util.h"
+#include "Alloc.h"
+#include "7zCrc.h"
+#include "Xz.h"
+#include "XzCrc64.h"
+
+//Decompress the .gnu_debugdata of ELF files (or .xz files) with xcd_util_xz_decompress(), which decodes
+//the multi-block streams with parallel workers, and with a single-threaded XzUnpacker as the reference.
+//Both outputs MUST be the same. The best time of the rounds is reported for each.
+//
+//AOSP builds the mini debug info with "xz --block-size=64k", "xz -T0" also splits the stream into blocks.
+
+#define XCR_BENCH_ROUNDS_DEFAULT 7
+
+static uint64_t xcr_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static int xcr_bench_load_file(const char *pathname, uint8_t **data, size_t *data_len)
+{
+    struct stat st;
+    ssize_t     n;
+    int         fd;
+
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
+    if(0 != fstat(fd, &st) || st.st_size <= 0) goto err;
+    *data_len = (size_t)st.st_size;
+    if(NULL == (*data = malloc(*data_len))) goto err;
+    if(0 > (n = XCC_UTIL_TEMP_FAILURE_RETRY(read(fd, *data, *data_len))) || (size_t)n != *data_len)
+    {
+        free(*data);
+        goto err;
+    }
+    close(fd);
+    return 0;
+
+ err:
+    close(fd);
+    return XCC_ERRNO_SYS;
+}
+
+//the section header at idx, as 64-bit for both classes
+static int xcr_bench_get_shdr(const uint8_t *data, size_t data_len, size_t idx, Elf64_Shdr *shdr)
+{
+    Elf64_Ehdr ehdr64;
+    Elf32_Ehdr ehdr32;
+    Elf32_Shdr shdr32;
+    size_t     offset;
+
+    if(ELFCLASS64 == data[EI_CLASS])
+    {
+        memcpy(&ehdr64, data, sizeof(ehdr64));
+        if(idx >= ehdr64.e_shnum) return XCC_ERRNO_RANGE;
+        offset = (size_t)ehdr64.e_shoff + idx * sizeof(Elf64_Shdr);
+        if(offset + sizeof(Elf64_Shdr) > data_len) return XCC_ERRNO_FORMAT;
+        memcpy(shdr, data + offset, sizeof(Elf64_Shdr));
+    }
+    else
+    {
+        memcpy(&ehdr32, data, sizeof(ehdr32));
+        if(idx >= ehdr32.e_shnum) return XCC_ERRNO_RANGE;
+        offset = (size_t)ehdr32.e_shoff + idx * sizeof(Elf32_Shdr);
+        if(offset + sizeof(Elf32_Shdr) > data_len) return XCC_ERRNO_FORMAT;
+        memcpy(&shdr32, data + offset, sizeof(Elf32_Shdr));
+        shdr->sh_name = shdr32.sh_name;
+        shdr->sh_type = shdr32.sh_type;
+        shdr->sh_offset = shdr32.sh_offset;
+        shdr->sh_size = shdr32.sh_size;
+    }
+
+    if(SHT_NOBITS != shdr->sh_type && (shdr->sh_offset > data_len || shdr->sh_size > data_len - shdr->sh_offset))
+        return XCC_ERRNO_FORMAT;
+    return 0;
+}
+
+//the .gnu_debugdata section of an ELF file, or the whole file
+static int xcr_bench_get_xz(const uint8_t *data, size_t data_len, const uint8_t **xz, size_t *xz_size)
+{
+    Elf64_Shdr shdr, strtab;
+    size_t     shstrndx, i;
+    int        r;
+
+    if(data_len < sizeof(Elf64_Ehdr) || 0 != memcmp(data, ELFMAG, SELFMAG))
+    {
+        *xz = data;
+        *xz_size = data_len;
+        return 0;
+    }
+
+    shstrndx = (ELFCLASS64 == data[EI_CLASS] ? ((const Elf64_Ehdr *)(const void *)data)->e_shstrndx :
+                                                 ((const Elf32_Ehdr *)(const void *)data)->e_shstrndx);
+    if(0 != (r = xcr_bench_get_shdr(data, data_len, shstrndx, &strtab))) return r;
+    for(i = 0; 0 == xcr_bench_get_shdr(data, data_len, i, &shdr); i++)
+    {
+        if(shdr.sh_name >= strtab.sh_size || sizeof(".gnu_debugdata") > strtab.sh_size - shdr.sh_name) continue;
+        if(0 != memcmp(data + strtab.sh_offset + shdr.sh_name, ".gnu_debugdata", sizeof(".gnu_debugdata"))) continue;
+
+        *xz = data + shdr.sh_offset;
+        *xz_size = (size_t)shdr.sh_size;
+        return 0;
+    }
+
+    return XCC_ERRNO_NOTFND;
+}
+
+//the reference: the single-threaded streaming decoding of the lzma SDK
+static int xcr_bench_xz_decompress_st(const uint8_t *src, size_t src_size, uint8_t **dst, size_t *dst_size)
+{
+    CXzUnpacker  state;
+    ECoderStatus status;
+    SizeT        src_len, dst_len;
+    size_t       src_offset = 0, dst_offset = 0;
+    uint8_t     *p;
+
+    XzUnpacker_Construct(&state, &g_Alloc);
+
+    *dst = NULL;
+    *dst_size = 4 * src_size;
+    do
+    {
+        *dst_size *= 2;
+        if(NULL == (p = realloc(*dst, *dst_size))) goto err;
+        *dst = p;
+
+        src_len = src_size - src_offset;
+        dst_len = *dst_size - dst_offset;
+        if(SZ_OK != XzUnpacker_Code(&state, *dst + dst_offset, &dst_len, src + src_offset, &src_len,
+                                    1, CODER_FINISH_ANY, &status)) goto err;
+        src_offset += src_len;
+        dst_offset += dst_len;
+    } while(CODER_STATUS_NOT_FINISHED == status);
+
+    if(!XzUnpacker_IsStreamWasFinished(&state)) goto err;
+    XzUnpacker_Free(&state);
+    *dst_size = dst_offset;
+    return 0;
+
+ err:
+    XzUnpacker_Free(&state);
+    free(*dst);
+    *dst = NULL;
+    return XCC_ERRNO_FORMAT;
+}
+
+static int xcr_bench_run(const char *pathname, size_t rounds)
+{
+    uint8_t       *data, *dst = NULL, *ref = NULL;
+    const uint8_t *xz;
+    size_t         data_len, xz_size, dst_size = 0, ref_size = 0, i;
+    uint64_t       t, best = UINT64_MAX, best_ref = UINT64_MAX;
+    int            r;
+
+    if(0 != (r = xcr_bench_load_file(pathname, &data, &data_len))) return r;
+    if(0 != (r = xcr_bench_get_xz(data, data_len, &xz, &xz_size))) goto end;
+
+    for(i = 0; i < rounds; i++)
+    {
+        free(dst);
+        dst = NULL;
+        t = xcr_bench_now_ns();
+        if(0 != (r = xcd_util_xz_decompress((uint8_t *)xz, xz_size, &dst, &dst_size)))
+        {
+            dst = NULL; //freed by it
+            goto end;
+        }
+        if((t = xcr_bench_now_ns() - t) < best) best = t;
+
+        free(ref);
+        t = xcr_bench_now_ns();
+        if(0 != (r = xcr_bench_xz_decompress_st(xz, xz_size, &ref, &ref_size))) goto end;
+        if((t = xcr_bench_now_ns() - t) < best_ref) best_ref = t;
+    }
+
+    if(dst_size != ref_size || 0 != memcmp(dst, ref, dst_size))
+    {
+        fprintf(stderr, "xcrash_bench_xz: %s: output mismatch\n", pathname);
+        r = XCC_ERRNO_FORMAT;
+        goto end;
+    }
+    printf("%s: %zu -> %zu bytes, xcd_util_xz_decompress %.2f ms, single-threaded %.2f ms\n",
+           pathname, xz_size, dst_size, (double)best / 1000000.0, (double)best_ref / 1000000.0);
+
+ end:
+    free(dst);
+    free(ref);
+    free(data);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    size_t rounds = XCR_BENCH_ROUNDS_DEFAULT;
+    int    first = 1, ret = 0, r;
+
+    if(argc >= 3 && 0 == strcmp(argv[1], "-n"))
+    {
+        rounds = (size_t)strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+    if(first >= argc || 0 == rounds)
+    {
+        fprintf(stderr, "usage: %s [-n rounds] <ELF with .gnu_debugdata | .xz>...\n", argv[0]);
+        return 1;
+    }
+
+    printf("online CPUs: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    CrcGenerateTable();
+    Crc64GenerateTable();
+
+    for(; first < argc; first++)
+    {
+        if(0 != (r = xcr_bench_run(argv[first], rounds)))
+        {
+            fprintf(stderr, "xcrash_bench_xz: %s failed (%d)\n", argv[first], r);
+            ret = 2;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,377 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "xcc_errno.h"
+#include "xcc_util.h"
+#include "xcd_minicore.h"
+#include "xcd_maps.h"
+#include "xcd_frames.h"
+#include "xcd_regs.h"
+#include "xcd_elf.h"
+#include "xcd_util.h"
+
+//Replay the unwinding of a mini-core with the unstripped libraries in a symbol directory.
+//It should be built for the same ABI as the crashed process.
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+typedef struct
+{
+    uintptr_t      start;
+    size_t         size;
+    const uint8_t *data;
+} xcr_segment_t;
+
+typedef struct
+{
+    pid_t          tid;
+    const char    *tname;
+    xcd_regs_t     regs;
+} xcr_thread_t;
+
+typedef struct
+{
+    uintptr_t      start;
+    const uint8_t *build_id;
+    size_t         build_id_len;
+} xcr_build_id_t;
+#pragma clang diagnostic pop
+
+//the previous segments which may overlap the found one
+#define XCR_SEGMENTS_OVERLAP_CHECK 4
+
+static xcd_minicore_header_t  xcr_header;
+static uint8_t               *xcr_data = NULL;
+static size_t                 xcr_data_len = 0;
+static char                  *xcr_maps = NULL;
+static size_t                 xcr_maps_len = 0;
+static xcr_segment_t         *xcr_segments = NULL;
+static size_t                 xcr_segments_num = 0;
+static xcr_thread_t          *xcr_threads = NULL;
+static size_t                 xcr_threads_num = 0;
+static xcr_build_id_t        *xcr_build_ids = NULL;
+static size_t                 xcr_build_ids_num = 0;
+
+static int xcr_append(void **items, size_t *items_num, const void *item, size_t item_size)
+{
+    void *p;
+
+    if(NULL == (p = realloc(*items, (*items_num + 1) * item_size))) return XCC_ERRNO_NOMEM;
+    memcpy((uint8_t *)p + (*items_num) * item_size, item, item_size);
+    *items = p;
+    (*items_num)++;
+    return 0;
+}
+
+static int xcr_load_file(const char *pathname)
+{
+    struct stat st;
+    ssize_t     n;
+    int         fd;
+
+    if(0 > (fd = XCC_UTIL_TEMP_FAILURE_RETRY(open(pathname, O_RDONLY | O_CLOEXEC)))) return XCC_ERRNO_SYS;
+    if(0 != fstat(fd, &st) || st.st_size <= 0) goto err;
+    xcr_data_len = (size_t)st.st_size;
+    if(NULL == (xcr_data = malloc(xcr_data_len))) goto err;
+    if(0 > (n = XCC_UTIL_TEMP_FAILURE_RETRY(read(fd, xcr_data, xcr_data_len))) || (size_t)n != xcr_data_len) goto err;
+    close(fd);
+    return 0;
+
+ err:
+    close(fd);
+    return XCC_ERRNO_SYS;
+}
+
+static int xcr_segment_cmp(const void *a, const void *b)
+{
+    const xcr_segment_t *sa = (const xcr_segment_t *)a;
+    const xcr_segment_t *sb = (const xcr_segment_t *)b;
+
+    if(sa->start < sb->start) return -1;
+    if(sa->start > sb->start) return 1;
+    return 0;
+}
+
+static int xcr_parse(void)
+{
+    xcd_minicore_record_t record;
+    xcr_segment_t         segment;
+    xcr_thread_t          thread;
+    xcr_build_id_t        build_id;
+    const uint8_t        *data;
+    size_t                offset;
+    char                 *maps;
+    int                   r;
+
+    //header
+    if(xcr_data_len < sizeof(xcr_header)) return XCC_ERRNO_FORMAT;
+    memcpy(&xcr_header, xcr_data, sizeof(xcr_header));
+    if(XCD_MINICORE_MAGIC != xcr_header.magic) return XCC_ERRNO_FORMAT;
+    if(XCD_MINICORE_VERSION != xcr_header.version) return XCC_ERRNO_FORMAT;
+    if(XCD_MINICORE_MACHINE != xcr_header.machine ||
+       sizeof(uintptr_t) != xcr_header.ptr_size ||
+       XCD_REGS_USER_NUM != xcr_header.regs_num)
+    {
+        fprintf(stderr, "xcrash_replay: ABI mismatch (machine: %u, pointer size: %u), rebuild this tool for it\n",
+                (unsigned int)xcr_header.machine, xcr_header.ptr_size);
+        return XCC_ERRNO_NOTSPT;
+    }
+
+    //records
+    offset = sizeof(xcr_header);
+    while(offset + sizeof(record) <= xcr_data_len)
+    {
+        memcpy(&record, xcr_data + offset, sizeof(record));
+        offset += sizeof(record);
+        if(record.size > xcr_data_len - offset) break; //truncated
+        data = xcr_data + offset;
+        offset += (size_t)record.size;
+
+        switch(record.type)
+        {
+        case XCD_MINICORE_RECORD_MAPS:
+            if(NULL == (maps = realloc(xcr_maps, xcr_maps_len + (size_t)record.size + 1))) return XCC_ERRNO_NOMEM;
+            memcpy(maps + xcr_maps_len, data, (size_t)record.size);
+            xcr_maps = maps;
+            xcr_maps_len += (size_t)record.size;
+            xcr_maps[xcr_maps_len] = '\0';
+            break;
+        case XCD_MINICORE_RECORD_THREAD:
+            if(record.size <= sizeof(xcd_regs_t) || '\0' != data[record.size - 1]) return XCC_ERRNO_FORMAT;
+            thread.tid = (pid_t)record.addr;
+            memcpy(&(thread.regs), data, sizeof(xcd_regs_t));
+            thread.tname = (const char *)(data + sizeof(xcd_regs_t));
+            if(0 != (r = xcr_append((void **)&xcr_threads, &xcr_threads_num, &thread, sizeof(thread)))) return r;
+            break;
+        case XCD_MINICORE_RECORD_MEMORY:
+            segment.start = (uintptr_t)record.addr;
+            segment.size = (size_t)record.size;
+            segment.data = data;
+            if(0 != (r = xcr_append((void **)&xcr_segments, &xcr_segments_num, &segment, sizeof(segment)))) return r;
+            break;
+        case XCD_MINICORE_RECORD_BUILD_ID:
+            build_id.start = (uintptr_t)record.addr;
+            build_id.build_id = data;
+            build_id.build_id_len = (size_t)record.size;
+            if(0 != (r = xcr_append((void **)&xcr_build_ids, &xcr_build_ids_num, &build_id, sizeof(build_id)))) return r;
+            break;
+        default:
+            break; //ignore unknown records
+        }
+    }
+
+    if(NULL == xcr_maps || 0 == xcr_threads_num) return XCC_ERRNO_MISSING;
+
+    //for binary searching
+    if(xcr_segments_num > 1) qsort(xcr_segments, xcr_segments_num, sizeof(xcr_segment_t), xcr_segment_cmp);
+
+    return 0;
+}
+
+static xcr_segment_t *xcr_find_segment(uintptr_t addr)
+{
+    size_t lo = 0, hi = xcr_segments_num, mid, i;
+
+    //the last segment which starts at or before addr
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(xcr_segments[mid].start <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    //the segments are small, only check a few previous ones for overlapping
+    for(i = lo; i > 0 && lo - i < XCR_SEGMENTS_OVERLAP_CHECK; i--)
+        if(addr < xcr_segments[i - 1].start + xcr_segments[i - 1].size) return &(xcr_segments[i - 1]);
+
+    return NULL;
+}
+
+//all the remote reading of the dumper sources comes here
+static size_t xcr_replay_read(pid_t pid, uintptr_t addr, void *dst, size_t bytes)
+{
+    xcr_segment_t *segment;
+    size_t         nread = 0, n;
+
+    (void)pid;
+
+    while(nread < bytes && NULL != (segment = xcr_find_segment(addr)))
+    {
+        n = segment->start + segment->size - addr;
+        if(n > bytes - nread) n = bytes - nread;
+        memcpy((uint8_t *)dst + nread, segment->data + (addr - segment->start), n);
+        nread += n;
+        addr += n;
+    }
+
+    return nread;
+}
+
+//<symbol_dir><path>, or <symbol_dir>/<basename>
+static const char *xcr_find_symbol_file(const char *symbol_dir, const char *name, char *buf, size_t buf_len)
+{
+    const char *basename;
+
+    if('/' != name[0]) return name;
+
+    snprintf(buf, buf_len, "%s%s", symbol_dir, name);
+    if(0 == access(buf, R_OK)) return buf;
+
+    basename = strrchr(name, '/') + 1;
+    if('\0' != basename[0])
+    {
+        snprintf(buf, buf_len, "%s/%s", symbol_dir, basename);
+        if(0 == access(buf, R_OK)) return buf;
+    }
+
+    return name;
+}
+
+//rewrite the pathnames in maps to the files in the symbol directory
+static int xcr_write_maps(const char *symbol_dir, int fd)
+{
+    char       *line, *line_end, *name;
+    char        buf[512];
+    size_t      i;
+    int         r;
+
+    for(line = xcr_maps; '\0' != *line; line = line_end)
+    {
+        if(NULL == (line_end = strchr(line, '\n'))) line_end = line + strlen(line);
+        else line_end++;
+
+        //the pathname is after 5 fields
+        for(name = line, i = 0; i < 5 && name < line_end; i++)
+        {
+            while(name < line_end && ' ' != *name && '\n' != *name) name++;
+            while(name < line_end && ' ' == *name) name++;
+        }
+
+        if(name < line_end && '/' == *name)
+        {
+            *(line_end - ('\n' == *(line_end - 1) ? 1 : 0)) = '\0';
+            if(0 != (r = xcc_util_write(fd, line, (size_t)(name - line)))) return r;
+            if(0 != (r = xcc_util_write_str(fd, xcr_find_symbol_file(symbol_dir, name, buf, sizeof(buf))))) return r;
+            if(0 != (r = xcc_util_write_str(fd, "\n"))) return r;
+        }
+        else
+        {
+            if(0 != (r = xcc_util_write(fd, line, (size_t)(line_end - line)))) return r;
+        }
+    }
+
+    return 0;
+}
+
+static void xcr_check_build_ids(xcd_maps_t *maps)
+{
+    xcd_map_t *map;
+    xcd_elf_t *elf;
+    uint8_t    build_id[64];
+    size_t     build_id_len, i;
+
+    for(i = 0; i < xcr_build_ids_num; i++)
+    {
+        if(NULL == (map = xcd_maps_find_map(maps, xcr_build_ids[i].start))) continue;
+        if(NULL == (elf = xcd_map_get_elf(map, xcr_header.pid, (void *)maps))) continue;
+        if(0 != xcd_elf_get_build_id(elf, build_id, sizeof(build_id), &build_id_len)) build_id_len = 0;
+
+        if(build_id_len != xcr_build_ids[i].build_id_len ||
+           0 != memcmp(build_id, xcr_build_ids[i].build_id, build_id_len))
+            fprintf(stderr, "xcrash_replay: build-id mismatch: %s\n", NULL == map->name ? "" : map->name);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char          maps_pathname[1024];
+    const char   *tmp_dir = getenv("TMPDIR");
+    int           maps_fd;
+    xcd_maps_t   *maps = NULL;
+    xcd_frames_t *frames = NULL;
+    size_t        i;
+    int           r;
+
+    if(3 != argc)
+    {
+        fprintf(stderr, "usage: %s <minicore> <symbol_dir>\n", argv[0]);
+        return 1;
+    }
+
+    //load and parse the mini-core
+    if(0 != (r = xcr_load_file(argv[1])))
+    {
+        fprintf(stderr, "xcrash_replay: open %s failed\n", argv[1]);
+        return 2;
+    }
+    if(0 != (r = xcr_parse()))
+    {
+        fprintf(stderr, "xcrash_replay: parse %s failed (%d)\n", argv[1], r);
+        return 3;
+    }
+    xcd_util_set_remote_read(xcr_replay_read);
+
+    //create maps from the rewritten maps file
+    snprintf(maps_pathname, sizeof(maps_pathname), "%s/xcrash_replay_maps_XXXXXX", NULL == tmp_dir ? "/tmp" : tmp_dir);
+    if(0 > (maps_fd = mkstemp(maps_pathname))) return 4;
+    r = xcr_write_maps(argv[2], maps_fd);
+    close(maps_fd);
+    if(0 == r) r = xcd_maps_create_from_file(&maps, xcr_header.pid, maps_pathname);
+    unlink(maps_pathname);
+    if(0 != r)
+    {
+        fprintf(stderr, "xcrash_replay: load maps failed (%d)\n", r);
+        return 5;
+    }
+
+    xcr_check_build_ids(maps);
+
+    //unwind and symbolize each thread (the crashed thread is the first one)
+    for(i = 0; i < xcr_threads_num; i++)
+    {
+        xcc_util_write_format(STDOUT_FILENO, "%spid: %d, tid: %d, name: %s%s\n",
+                              0 == i ? "" : "\n", xcr_header.pid, xcr_threads[i].tid, xcr_threads[i].tname,
+                              xcr_threads[i].tid == xcr_header.crash_tid ? "  (crashed)" : "");
+        xcd_regs_record(&(xcr_threads[i].regs), STDOUT_FILENO);
+        if(0 != (r = xcd_frames_create(&frames, &(xcr_threads[i].regs), maps, xcr_header.pid, 0)))
+        {
+            fprintf(stderr, "xcrash_replay: unwind thread %d failed (%d)\n", xcr_threads[i].tid, r);
+            continue;
+        }
+        xcd_frames_record_backtrace(frames, STDOUT_FILENO);
+        xcd_frames_destroy(&frames);
+    }
+
+    xcd_maps_destroy(&maps);
+    return 0;
+}
@@ -55,6 +55,7 @@ class ActivityMonitor {
 
                 @Override
                 public void onActivityCreated(Activity activity, Bundle savedInstanceState) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity created: " + activity.getClass().getName());
                     activities.addFirst(activity);
                     if (activities.size() > MAX_ACTIVITY_NUM) {
                         activities.removeLast();
@@ -63,6 +64,7 @@ class ActivityMonitor {
 
                 @Override
                 public void onActivityStarted(Activity activity) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity started: " + activity.getClass().getName());
                     if (++activityReferences == 1 && !isActivityChangingConfigurations) {
                         isAppForeground = true;
                     }
@@ -70,14 +72,17 @@ class ActivityMonitor {
 
                 @Override
                 public void onActivityResumed(Activity activity) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity resumed: " + activity.getClass().getName());
                 }
 
                 @Override
                 public void onActivityPaused(Activity activity) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity paused: " + activity.getClass().getName());
                 }
 
                 @Override
                 public void onActivityStopped(Activity activity) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity stopped: " + activity.getClass().getName());
                     isActivityChangingConfigurations = activity.isChangingConfigurations();
                     if (--activityReferences == 0 && !isActivityChangingConfigurations) {
                         isAppForeground = false;
@@ -90,6 +95,7 @@ class ActivityMonitor {
 
                 @Override
                 public void onActivityDestroyed(Activity activity) {
+                    NativeHandler.getInstance().appendBreadcrumb("activity destroyed: " + activity.getClass().getName());
                     activities.remove(activity);
                 }
             }
@@ -25,12 +25,13 @@ package xcrash;
 import android.content.Context;
 import android.os.Build;
 import android.os.FileObserver;
+import android.os.ParcelFileDescriptor;
 import android.text.TextUtils;
 
 import java.io.BufferedReader;
 import java.io.File;
+import java.io.FileOutputStream;
 import java.io.FileReader;
-import java.io.RandomAccessFile;
 import java.text.SimpleDateFormat;
 import java.util.Date;
 import java.util.Locale;
@@ -61,6 +62,7 @@ class AnrHandler {
     private int logcatMainLines;
     private boolean dumpFds;
     private boolean dumpNetworkInfo;
+    private boolean dumpMemInfoDetail;
     private ICrashCallback callback;
     private ICrashCallback anrFastCallback;
     private long lastTime = 0;
@@ -76,7 +78,7 @@ class AnrHandler {
     @SuppressWarnings("deprecation")
     void initialize(Context ctx, int pid, String processName, String appId, String appVersion, String logDir,
                     boolean checkProcessState, int logcatSystemLines, int logcatEventsLines, int logcatMainLines,
-                    boolean dumpFds, boolean dumpNetworkInfo, ICrashCallback callback, ICrashCallback anrFastCallback) {
+                    boolean dumpFds, boolean dumpNetworkInfo, boolean dumpMemInfoDetail, ICrashCallback callback, ICrashCallback anrFastCallback) {
 
         //check API level
         if (Build.VERSION.SDK_INT >= 21) {
@@ -95,6 +97,7 @@ class AnrHandler {
         this.logcatMainLines = logcatMainLines;
         this.dumpFds = dumpFds;
         this.dumpNetworkInfo = dumpNetworkInfo;
+        this.dumpMemInfoDetail = dumpMemInfoDetail;
         this.callback = callback;
         this.anrFastCallback = anrFastCallback;
 
@@ -188,13 +191,17 @@ class AnrHandler {
 
         //write info to log file
         if (logFile != null) {
-            RandomAccessFile raf = null;
+            ParcelFileDescriptor pfd = null;
             try {
-                raf = new RandomAccessFile(logFile, "rws");
+                //the native lib streams the sections directly to this fd, only sync once at the end
+                pfd = ParcelFileDescriptor.open(logFile, ParcelFileDescriptor.MODE_WRITE_ONLY);
+                int fd = pfd.getFd();
+                FileOutputStream fos = new FileOutputStream(pfd.getFileDescriptor());
+                NativeHandler nativeHandler = NativeHandler.getInstance();
 
                 //write emergency info
                 if (emergency != null) {
-                    raf.write(emergency.getBytes("UTF-8"));
+                    fos.write(emergency.getBytes("UTF-8"));
                 }
 
                 //If we wrote the emergency info successfully, we don't need to return it from callback again.
@@ -202,27 +209,40 @@ class AnrHandler {
 
                 //write logcat
                 if (logcatMainLines > 0 || logcatSystemLines > 0 || logcatEventsLines > 0) {
-                    raf.write(Util.getLogcat(logcatMainLines, logcatSystemLines, logcatEventsLines).getBytes("UTF-8"));
+                    if (!nativeHandler.recordLogcat(fd, logcatSystemLines, logcatEventsLines, logcatMainLines)) {
+                        fos.write(Util.getLogcat(logcatMainLines, logcatSystemLines, logcatEventsLines).getBytes("UTF-8"));
+                    }
                 }
 
                 //write fds
                 if (dumpFds) {
-                    raf.write(Util.getFds().getBytes("UTF-8"));
+                    if (!nativeHandler.recordFds(fd)) {
+                        fos.write(Util.getFds().getBytes("UTF-8"));
+                    }
                 }
 
                 //write network info
                 if (dumpNetworkInfo) {
-                    raf.write(Util.getNetworkInfo().getBytes("UTF-8"));
+                    if (!nativeHandler.recordNetworkInfo(fd)) {
+                        fos.write(Util.getNetworkInfo().getBytes("UTF-8"));
+                    }
                 }
 
                 //write memory info
-                raf.write(Util.getMemoryInfo().getBytes("UTF-8"));
+                if (!nativeHandler.recordMemInfo(fd, dumpMemInfoDetail)) {
+                    fos.write(Util.getMemoryInfo().getBytes("UTF-8"));
+                }
+
+                //write main thread samples
+                nativeHandler.recordMainThreadSamples(fd);
+
+                pfd.getFileDescriptor().sync();
             } catch (Exception e) {
                 XCrash.getLogger().e(Util.TAG, "AnrHandler write log file failed", e);
             } finally {
-                if (raf != null) {
+                if (pfd != null) {
                     try {
-                        raf.close();
+                        pfd.close();
                     } catch (Exception ignored) {
                     }
                 }
@@ -28,20 +28,26 @@ import java.io.FilenameFilter;
 import java.io.RandomAccessFile;
 import java.nio.MappedByteBuffer;
 import java.nio.channels.FileChannel;
+import java.util.ArrayList;
 import java.util.Arrays;
-import java.util.Comparator;
+import java.util.Collections;
 import java.util.Date;
+import java.util.HashMap;
+import java.util.List;
 import java.util.Locale;
+import java.util.Map;
 import java.util.Timer;
 import java.util.TimerTask;
 import java.util.concurrent.atomic.AtomicInteger;
 
 class FileManager {
 
+    private String placeholderDirName = "placeholder";
     private String placeholderPrefix = "placeholder";
     private String placeholderCleanSuffix = ".clean.xcrash";
     private String placeholderDirtySuffix = ".dirty.xcrash";
     private String logDir = null;
+    private String placeholderDir = null;
     private int javaLogCountMax = 0;
     private int nativeLogCountMax = 0;
     private int anrLogCountMax = 0;
@@ -50,6 +56,9 @@ class FileManager {
     private int placeholderSizeKb = 0;
     private int delayMs = 0;
     private AtomicInteger unique = new AtomicInteger();
+    private final Map<String, List<File>> logIndex = new HashMap<String, List<File>>();
+    private long logIndexDirLastModified = 0;
+    private long logIndexScanTime = 0;
     private static final FileManager instance = new FileManager();
 
     private FileManager() {
@@ -61,6 +70,7 @@ class FileManager {
 
     void initialize(String logDir, int javaLogCountMax, int nativeLogCountMax, int anrLogCountMax, int placeholderCountMax, int placeholderSizeKb, int delayMs) {
         this.logDir = logDir;
+        this.placeholderDir = logDir + "/" + placeholderDirName;
         this.javaLogCountMax = javaLogCountMax;
         this.nativeLogCountMax = nativeLogCountMax;
         this.anrLogCountMax = anrLogCountMax;
@@ -73,31 +83,22 @@ class FileManager {
             if (!dir.exists() || !dir.isDirectory()) {
                 return;
             }
-            File[] files = dir.listFiles();
-            if (files == null) {
-                return;
-            }
 
-            int javaLogCount = 0;
-            int nativeLogCount = 0;
-            int anrLogCount = 0;
-            int traceLogCount = 0;
+            //scan the log directory once, the index is reused by the following maintenance
+            Map<String, List<File>> index = getLogIndex(dir);
+            int javaLogCount = index.get(Util.javaLogSuffix).size();
+            int nativeLogCount = index.get(Util.nativeLogSuffix).size();
+            int anrLogCount = index.get(Util.anrLogSuffix).size();
+            int traceLogCount = index.get(Util.traceLogSuffix).size();
+
+            //placeholder files are kept in a sub-directory
             int placeholderCleanCount = 0;
             int placeholderDirtyCount = 0;
-            for (final File file : files) {
-                if (file.isFile()) {
+            File[] files = new File(placeholderDir).listFiles();
+            if (files != null) {
+                for (final File file : files) {
                     String name = file.getName();
-                    if (name.startsWith(Util.logPrefix + "_")) {
-                        if (name.endsWith(Util.javaLogSuffix)) {
-                            javaLogCount++;
-                        } else if (name.endsWith(Util.nativeLogSuffix)) {
-                            nativeLogCount++;
-                        } else if (name.endsWith(Util.anrLogSuffix)) {
-                            anrLogCount++;
-                        } else if (name.endsWith(Util.traceLogSuffix)) {
-                            traceLogCount++;
-                        }
-                    } else if (name.startsWith(placeholderPrefix + "_")) {
+                    if (name.startsWith(placeholderPrefix + "_")) {
                         if (name.endsWith(placeholderCleanSuffix)) {
                             placeholderCleanCount++;
                         } else if (name.endsWith(placeholderDirtySuffix)) {
@@ -106,6 +107,7 @@ class FileManager {
                     }
                 }
             }
+            placeholderDirtyCount += index.get(placeholderPrefix).size();
 
             if (javaLogCount <= this.javaLogCountMax
                 && nativeLogCount <= this.nativeLogCountMax
@@ -167,6 +169,25 @@ class FileManager {
         }
     }
 
+    // Keep only the latest trace log file.
+    void maintainTrace(String latestLogPath) {
+        if (!Util.checkAndCreateDir(logDir)) {
+            return;
+        }
+        File dir = new File(logDir);
+        String latestName = new File(latestLogPath).getName();
+
+        try {
+            for (File file : getLogIndex(dir).get(Util.traceLogSuffix)) {
+                if (!file.getName().equals(latestName)) {
+                    recycleLogFile(file);
+                }
+            }
+        } catch (Exception e) {
+            XCrash.getLogger().e(Util.TAG, "FileManager maintainTrace failed", e);
+        }
+    }
+
     boolean maintainAnr() {
         if (!Util.checkAndCreateDir(logDir)) {
             return false;
@@ -174,7 +195,7 @@ class FileManager {
         File dir = new File(logDir);
 
         try {
-            return doMaintainTombstoneType(dir, Util.anrLogSuffix, anrLogCountMax);
+            return doMaintainTombstoneType(getLogIndex(dir).get(Util.anrLogSuffix), anrLogCountMax);
         } catch (Exception e) {
             XCrash.getLogger().e(Util.TAG, "FileManager maintainAnr failed", e);
             return false;
@@ -194,7 +215,7 @@ class FileManager {
         File newFile = new File(filePath);
 
         //clean placeholder files
-        File dir = new File(logDir);
+        File dir = new File(placeholderDir);
         File[] cleanFiles = dir.listFiles(new FilenameFilter() {
             @Override
             public boolean accept(File dir, String name) {
@@ -275,6 +296,15 @@ class FileManager {
             return false;
         }
 
+        //the mini-core written along with the native tombstone
+        try {
+            File miniCoreFile = new File(logFile.getPath() + Util.miniCoreSuffix);
+            if (miniCoreFile.exists()) {
+                miniCoreFile.delete();
+            }
+        } catch (Exception ignored) {
+        }
+
         if (this.logDir == null || this.placeholderCountMax <= 0) {
             try {
                 return logFile.delete();
@@ -284,7 +314,7 @@ class FileManager {
         }
 
         try {
-            File dir = new File(logDir);
+            File dir = new File(placeholderDir);
             File[] cleanFiles = dir.listFiles(new FilenameFilter() {
                 @Override
                 public boolean accept(File dir, String name) {
@@ -300,7 +330,10 @@ class FileManager {
             }
 
             //rename to dirty file
-            String dirtyFilePath = String.format(Locale.US, "%s/%s_%020d%s", logDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderDirtySuffix);
+            if (!Util.checkAndCreateDir(placeholderDir)) {
+                return logFile.delete();
+            }
+            String dirtyFilePath = String.format(Locale.US, "%s/%s_%020d%s", placeholderDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderDirtySuffix);
             File dirtyFile = new File(dirtyFilePath);
             if (!logFile.renameTo(dirtyFile)) {
                 try {
@@ -335,39 +368,38 @@ class FileManager {
         }
 
         try {
-            doMaintainPlaceholder(dir);
+            if (Util.checkAndCreateDir(placeholderDir)) {
+                doMaintainPlaceholder(new File(placeholderDir));
+            }
         } catch (Exception e) {
             XCrash.getLogger().e(Util.TAG, "FileManager doMaintainPlaceholder failed", e);
         }
+
+        //let the native crash handler open a clean placeholder file in advance
+        if (this.placeholderCountMax > 0) {
+            NativeHandler.getInstance().preparePlaceholder();
+        }
     }
 
     private void doMaintainTombstone(File dir) {
-        doMaintainTombstoneType(dir, Util.nativeLogSuffix, nativeLogCountMax);
-        doMaintainTombstoneType(dir, Util.javaLogSuffix, javaLogCountMax);
-        doMaintainTombstoneType(dir, Util.anrLogSuffix, anrLogCountMax);
-        doMaintainTombstoneType(dir, Util.traceLogSuffix, traceLogCountMax);
-    }
+        Map<String, List<File>> index = getLogIndex(dir);
 
-    private boolean doMaintainTombstoneType(File dir, final String logSuffix, int logCountMax) {
-        File[] files = dir.listFiles(new FilenameFilter() {
-            @Override
-            public boolean accept(File dir, String name) {
-                return name.startsWith(Util.logPrefix + "_") && name.endsWith(logSuffix);
-            }
-        });
+        //placeholder files left by the old version in the log directory
+        for (File file : index.get(placeholderPrefix)) {
+            recycleLogFile(file);
+        }
 
+        doMaintainTombstoneType(index.get(Util.nativeLogSuffix), nativeLogCountMax);
+        doMaintainTombstoneType(index.get(Util.javaLogSuffix), javaLogCountMax);
+        doMaintainTombstoneType(index.get(Util.anrLogSuffix), anrLogCountMax);
+        doMaintainTombstoneType(index.get(Util.traceLogSuffix), traceLogCountMax);
+    }
+
+    private boolean doMaintainTombstoneType(List<File> files, int logCountMax) {
         boolean result = true;
-        if (files != null && files.length > logCountMax) {
-            if (logCountMax > 0) {
-                Arrays.sort(files, new Comparator<File>() {
-                    @Override
-                    public int compare(File f1, File f2) {
-                        return f1.getName().compareTo(f2.getName());
-                    }
-                });
-            }
-            for (int i = 0; i < files.length - logCountMax; i++) {
-                if (!recycleLogFile(files[i])) {
+        if (files.size() > logCountMax) {
+            for (int i = 0; i < files.size() - logCountMax; i++) {
+                if (!recycleLogFile(files.get(i))) {
                     result = false;
                 }
             }
@@ -410,7 +442,7 @@ class FileManager {
                 dirtyFilesCount--;
             } else {
                 try {
-                    File dirtyFile = new File(String.format(Locale.US, "%s/%s_%020d%s", logDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderDirtySuffix));
+                    File dirtyFile = new File(String.format(Locale.US, "%s/%s_%020d%s", placeholderDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderDirtySuffix));
                     if (dirtyFile.createNewFile()) {
                         if (cleanTheDirtyFile(dirtyFile)) {
                             cleanFilesCount++;
@@ -476,20 +508,23 @@ class FileManager {
                 }
             }
 
-            //clean the dirty file
-            stream = new FileOutputStream(dirtyFile.getAbsoluteFile(), false);
-            for (int i = 0; i < blockCount; i++) {
-                if (i + 1 == blockCount && dirtyFileSize % 1024 != 0) {
-                    //the last block
-                    stream.write(block, 0, (int) (dirtyFileSize % 1024));
-                } else {
-                    stream.write(block);
+            //clean the dirty file by truncating and reserving the space natively, or by writing zeros
+            long size = Math.max(dirtyFileSize, (long) placeholderSizeKb * 1024);
+            if (!NativeHandler.getInstance().fillPlaceholder(dirtyFile.getAbsolutePath(), size)) {
+                stream = new FileOutputStream(dirtyFile.getAbsoluteFile(), false);
+                for (int i = 0; i < blockCount; i++) {
+                    if (i + 1 == blockCount && dirtyFileSize % 1024 != 0) {
+                        //the last block
+                        stream.write(block, 0, (int) (dirtyFileSize % 1024));
+                    } else {
+                        stream.write(block);
+                    }
                 }
+                stream.flush();
             }
-            stream.flush();
 
             //rename the dirty file to clean file
-            String newCleanFilePath = String.format(Locale.US, "%s/%s_%020d%s", logDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderCleanSuffix);
+            String newCleanFilePath = String.format(Locale.US, "%s/%s_%020d%s", placeholderDir, placeholderPrefix, new Date().getTime() * 1000 + getNextUnique(), placeholderCleanSuffix);
             succeeded = dirtyFile.renameTo(new File(newCleanFilePath));
         } catch (Exception e) {
             XCrash.getLogger().e(Util.TAG, "FileManager cleanTheDirtyFile failed", e);
@@ -512,6 +547,63 @@ class FileManager {
         return succeeded;
     }
 
+    //Get the log files of each type (sorted by name, the oldest first) in the log directory.
+    //The directory is scanned again only if it has been changed since the last scan.
+    private synchronized Map<String, List<File>> getLogIndex(File dir) {
+        long lastModified = dir.lastModified();
+
+        //the modification time may have a coarse granularity
+        if (!logIndex.isEmpty()
+            && lastModified == logIndexDirLastModified
+            && lastModified < logIndexScanTime - 1000) {
+            return new HashMap<String, List<File>>(logIndex);
+        }
+
+        logIndexScanTime = System.currentTimeMillis();
+        logIndexDirLastModified = lastModified;
+
+        List<String> javaLogs = new ArrayList<String>();
+        List<String> nativeLogs = new ArrayList<String>();
+        List<String> anrLogs = new ArrayList<String>();
+        List<String> traceLogs = new ArrayList<String>();
+        List<String> placeholders = new ArrayList<String>();
+
+        String[] names = dir.list();
+        if (names != null) {
+            for (String name : names) {
+                if (name.startsWith(Util.logPrefix + "_")) {
+                    if (name.endsWith(Util.javaLogSuffix)) {
+                        javaLogs.add(name);
+                    } else if (name.endsWith(Util.nativeLogSuffix)) {
+                        nativeLogs.add(name);
+                    } else if (name.endsWith(Util.anrLogSuffix)) {
+                        anrLogs.add(name);
+                    } else if (name.endsWith(Util.traceLogSuffix)) {
+                        traceLogs.add(name);
+                    }
+                } else if (name.startsWith(placeholderPrefix + "_")) {
+                    placeholders.add(name);
+                }
+            }
+        }
+
+        logIndex.put(Util.javaLogSuffix, toSortedFiles(dir, javaLogs));
+        logIndex.put(Util.nativeLogSuffix, toSortedFiles(dir, nativeLogs));
+        logIndex.put(Util.anrLogSuffix, toSortedFiles(dir, anrLogs));
+        logIndex.put(Util.traceLogSuffix, toSortedFiles(dir, traceLogs));
+        logIndex.put(placeholderPrefix, toSortedFiles(dir, placeholders));
+        return new HashMap<String, List<File>>(logIndex);
+    }
+
+    private static List<File> toSortedFiles(File dir, List<String> names) {
+        Collections.sort(names);
+        List<File> files = new ArrayList<File>(names.size());
+        for (String name : names) {
+            files.add(new File(dir, name));
+        }
+        return files;
+    }
+
     private int getNextUnique() {
         int i = unique.incrementAndGet();
         if (i >= 999) {
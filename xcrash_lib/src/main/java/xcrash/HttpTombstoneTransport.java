@@ -0,0 +1,116 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.HttpURLConnection;
+import java.net.URL;
+
+/**
+ * The default {@link xcrash.ITombstoneTransport} implementation, which posts the batch to an HTTP(S) URL.
+ *
+ * <p>The request has the headers "Content-Type: application/json", "Content-Encoding: gzip" and
+ * "X-XCrash-Batch-Id: batch ID". The body is sent in the chunked streaming mode. Any 2xx response code means
+ * the batch is accepted.
+ */
+@SuppressWarnings("unused")
+public class HttpTombstoneTransport implements ITombstoneTransport {
+
+    private final String url;
+    private final int connectTimeoutMs;
+    private final int readTimeoutMs;
+
+    /**
+     * Create a transport posting to the URL, with 15 seconds connect and read timeout.
+     *
+     * @param url The URL of the upload server.
+     */
+    @SuppressWarnings("unused")
+    public HttpTombstoneTransport(String url) {
+        this(url, 15000, 15000);
+    }
+
+    /**
+     * Create a transport posting to the URL.
+     *
+     * @param url The URL of the upload server.
+     * @param connectTimeoutMs Connect timeout in milliseconds.
+     * @param readTimeoutMs Read timeout in milliseconds.
+     */
+    @SuppressWarnings({"unused", "WeakerAccess"})
+    public HttpTombstoneTransport(String url, int connectTimeoutMs, int readTimeoutMs) {
+        this.url = url;
+        this.connectTimeoutMs = connectTimeoutMs;
+        this.readTimeoutMs = readTimeoutMs;
+    }
+
+    @Override
+    public boolean send(String batchId, Body body) throws IOException {
+        OutputStream os = null;
+        InputStream is = null;
+
+        try {
+            HttpURLConnection conn = (HttpURLConnection) new URL(url).openConnection();
+            conn.setConnectTimeout(connectTimeoutMs);
+            conn.setReadTimeout(readTimeoutMs);
+            conn.setRequestMethod("POST");
+            conn.setDoOutput(true);
+            conn.setUseCaches(false);
+            conn.setChunkedStreamingMode(0);
+            conn.setRequestProperty("Content-Type", "application/json");
+            conn.setRequestProperty("Content-Encoding", "gzip");
+            conn.setRequestProperty("X-XCrash-Batch-Id", batchId);
+
+            os = conn.getOutputStream();
+            body.writeTo(os);
+            os.flush();
+
+            int code = conn.getResponseCode();
+
+            //drain the response, so that the connection can be reused
+            is = (code >= 400 ? conn.getErrorStream() : conn.getInputStream());
+            if (is != null) {
+                byte[] buf = new byte[1024];
+                //noinspection StatementWithEmptyBody
+                while (is.read(buf) != -1) {
+                }
+            }
+
+            return code >= 200 && code < 300;
+        } finally {
+            if (os != null) {
+                try {
+                    os.close();
+                } catch (Exception ignored) {
+                }
+            }
+            if (is != null) {
+                try {
+                    is.close();
+                } catch (Exception ignored) {
+                }
+            }
+        }
+    }
+}
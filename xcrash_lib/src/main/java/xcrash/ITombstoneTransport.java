@@ -0,0 +1,63 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import java.io.IOException;
+import java.io.OutputStream;
+
+/**
+ * Define the transport interface used by {@link xcrash.TombstoneUploader} to post a batch of crash reports.
+ *
+ * <p>The body is a gzip compressed JSON object:
+ * {"batch": "batch ID", "reports": [{"signature": "...", "count": N, "tombstone": {key: value, ...}}, ...]}
+ *
+ * <p>The same batch (with the same batch ID) may be sent more than once, if the process was killed
+ * or the previous sending failed before it was confirmed. The server should dedupe by the batch ID.
+ */
+public interface ITombstoneTransport {
+
+    /**
+     * The body of a batch, streamed one tombstone at a time, so the batch is never built in memory.
+     */
+    interface Body {
+
+        /**
+         * Write the gzip compressed JSON body to the stream. The stream is not closed.
+         * It may be called more than once (e.g. for retrying), the same body is written each time.
+         *
+         * @param out The stream of the request body.
+         * @throws IOException Reading the tombstones or writing the stream failed.
+         */
+        void writeTo(OutputStream out) throws IOException;
+    }
+
+    /**
+     * Post a batch of crash reports.
+     *
+     * @param batchId The batch ID.
+     * @param body The gzip compressed JSON body, which should be written to the request by {@link Body#writeTo}.
+     * @return Return true if the batch is accepted by the server, false otherwise.
+     * @throws IOException xCrash will treat the exception as a failed sending.
+     */
+    @SuppressWarnings("unused")
+    boolean send(String batchId, Body body) throws IOException;
+}
@@ -23,8 +23,8 @@
 package xcrash;
 
 import java.io.File;
+import java.io.FileOutputStream;
 import java.io.PrintWriter;
-import java.io.RandomAccessFile;
 import java.io.StringWriter;
 import java.lang.Thread.UncaughtExceptionHandler;
 import java.text.DateFormat;
@@ -38,6 +38,7 @@ import java.util.regex.Pattern;
 
 import android.annotation.SuppressLint;
 import android.text.TextUtils;
+import android.os.ParcelFileDescriptor;
 import android.os.Process;
 
 @SuppressLint("StaticFieldLeak")
@@ -58,9 +59,12 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
     private int logcatMainLines;
     private boolean dumpFds;
     private boolean dumpNetworkInfo;
+    private boolean dumpMemInfoDetail;
     private boolean dumpAllThreads;
     private int dumpAllThreadsCountMax;
     private String[] dumpAllThreadsWhiteList;
+    private boolean dumpAllThreadsNative;
+    private int elfHashAlgorithm;
     private ICrashCallback callback;
     private UncaughtExceptionHandler defaultHandler = null;
 
@@ -73,8 +77,8 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
 
     void initialize(int pid, String processName, String appId, String appVersion, String logDir, boolean rethrow,
                     int logcatSystemLines, int logcatEventsLines, int logcatMainLines,
-                    boolean dumpFds, boolean dumpNetworkInfo, boolean dumpAllThreads, int dumpAllThreadsCountMax, String[] dumpAllThreadsWhiteList,
-                    ICrashCallback callback) {
+                    boolean dumpFds, boolean dumpNetworkInfo, boolean dumpMemInfoDetail, boolean dumpAllThreads, int dumpAllThreadsCountMax, String[] dumpAllThreadsWhiteList,
+                    boolean dumpAllThreadsNative, int elfHashAlgorithm, ICrashCallback callback) {
         this.pid = pid;
         this.processName = (TextUtils.isEmpty(processName) ? "unknown" : processName);
         this.appId = appId;
@@ -86,9 +90,12 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
         this.logcatMainLines = logcatMainLines;
         this.dumpFds = dumpFds;
         this.dumpNetworkInfo = dumpNetworkInfo;
+        this.dumpMemInfoDetail = dumpMemInfoDetail;
         this.dumpAllThreads = dumpAllThreads;
         this.dumpAllThreadsCountMax = dumpAllThreadsCountMax;
         this.dumpAllThreadsWhiteList = dumpAllThreadsWhiteList;
+        this.dumpAllThreadsNative = dumpAllThreadsNative;
+        this.elfHashAlgorithm = elfHashAlgorithm;
         this.callback = callback;
         this.defaultHandler = Thread.getDefaultUncaughtExceptionHandler();
 
@@ -148,13 +155,17 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
 
         //write info to log file
         if (logFile != null) {
-            RandomAccessFile raf = null;
+            ParcelFileDescriptor pfd = null;
             try {
-                raf = new RandomAccessFile(logFile, "rws");
+                //the native lib streams the sections directly to this fd, only sync once at the end
+                pfd = ParcelFileDescriptor.open(logFile, ParcelFileDescriptor.MODE_WRITE_ONLY);
+                int fd = pfd.getFd();
+                FileOutputStream fos = new FileOutputStream(pfd.getFileDescriptor());
+                NativeHandler nativeHandler = NativeHandler.getInstance();
 
                 //write emergency info
                 if (emergency != null) {
-                    raf.write(emergency.getBytes("UTF-8"));
+                    fos.write(emergency.getBytes("UTF-8"));
                 }
 
                 //If we wrote the emergency info successfully, we don't need to return it from callback again.
@@ -162,35 +173,47 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
 
                 //write logcat
                 if (logcatMainLines > 0 || logcatSystemLines > 0 || logcatEventsLines > 0) {
-                    raf.write(Util.getLogcat(logcatMainLines, logcatSystemLines, logcatEventsLines).getBytes("UTF-8"));
+                    if (!nativeHandler.recordLogcat(fd, logcatSystemLines, logcatEventsLines, logcatMainLines)) {
+                        fos.write(Util.getLogcat(logcatMainLines, logcatSystemLines, logcatEventsLines).getBytes("UTF-8"));
+                    }
                 }
 
                 //write fds
                 if (dumpFds) {
-                    raf.write(Util.getFds().getBytes("UTF-8"));
+                    if (!nativeHandler.recordFds(fd)) {
+                        fos.write(Util.getFds().getBytes("UTF-8"));
+                    }
                 }
 
                 //write network info
                 if (dumpNetworkInfo) {
-                    raf.write(Util.getNetworkInfo().getBytes("UTF-8"));
+                    if (!nativeHandler.recordNetworkInfo(fd)) {
+                        fos.write(Util.getNetworkInfo().getBytes("UTF-8"));
+                    }
                 }
 
                 //write memory info
-                raf.write(Util.getMemoryInfo().getBytes("UTF-8"));
+                if (!nativeHandler.recordMemInfo(fd, dumpMemInfoDetail)) {
+                    fos.write(Util.getMemoryInfo().getBytes("UTF-8"));
+                }
 
                 //write background / foreground
-                raf.write(("foreground:\n" + (ActivityMonitor.getInstance().isApplicationForeground() ? "yes" : "no") + "\n\n").getBytes("UTF-8"));
+                fos.write(("foreground:\n" + (ActivityMonitor.getInstance().isApplicationForeground() ? "yes" : "no") + "\n\n").getBytes("UTF-8"));
 
-                //write other threads info
+                //write other threads info (native backtraces by the native dumper, or java stacktraces)
                 if (dumpAllThreads) {
-                    raf.write(getOtherThreadsInfo(thread).getBytes("UTF-8"));
+                    if (!dumpAllThreadsNative || !nativeHandler.dumpOtherThreads(fd, dumpAllThreadsCountMax, dumpAllThreadsWhiteList)) {
+                        fos.write(getOtherThreadsInfo(thread).getBytes("UTF-8"));
+                    }
                 }
+
+                pfd.getFileDescriptor().sync();
             } catch (Exception e) {
                 XCrash.getLogger().e(Util.TAG, "JavaCrashHandler write log file failed", e);
             } finally {
-                if (raf != null) {
+                if (pfd != null) {
                     try {
-                        raf.close();
+                        pfd.close();
                     } catch (Exception ignored) {
                     }
                 }
@@ -211,13 +234,18 @@ class JavaCrashHandler implements UncaughtExceptionHandler {
         for (String libPath : libPathList) {
             File libFile = new File(libPath);
             if (libFile.exists() && libFile.isFile()) {
-                String md5 = Util.getFileMD5(libFile);
+                String hash;
+                if (elfHashAlgorithm == XCrash.ELF_HASH_XXH3) {
+                    hash = ". XXH3: " + Xxh3.hashFile(libFile);
+                } else {
+                    hash = ". MD5: " + Util.getFileMD5(libFile);
+                }
 
                 DateFormat timeFormatter = new SimpleDateFormat(Util.timeFormatterStr, Locale.US);
                 Date lastTime = new Date(libFile.lastModified());
 
                 sb.append("    ").append(libPath).append("(BuildId: unknown. FileSize: ").append(libFile.length()).append(". LastModified: ")
-                        .append(timeFormatter.format(lastTime)).append(". MD5: ").append(md5).append(")\n");
+                        .append(timeFormatter.format(lastTime)).append(hash).append(")\n");
             } else {
                 sb.append("    ").append(libPath).append(" (Not found)\n");
             }
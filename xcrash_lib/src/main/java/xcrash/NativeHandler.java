@@ -25,10 +25,14 @@ package xcrash;
 import android.annotation.SuppressLint;
 import android.content.Context;
 import android.os.Build;
+import android.os.Handler;
+import android.os.Looper;
+import android.os.SystemClock;
 import android.text.TextUtils;
 import android.util.Log;
 
 import java.io.File;
+import java.io.IOException;
 import java.util.Map;
 
 @SuppressLint("StaticFieldLeak")
@@ -66,12 +70,18 @@ class NativeHandler {
                    int crashLogcatEventsLines,
                    int crashLogcatMainLines,
                    boolean crashDumpElfHash,
+                   int elfHashAlgorithm,
                    boolean crashDumpMap,
                    boolean crashDumpFds,
                    boolean crashDumpNetworkInfo,
+                   boolean crashDumpMemInfoDetail,
                    boolean crashDumpAllThreads,
                    int crashDumpAllThreadsCountMax,
                    String[] crashDumpAllThreadsWhiteList,
+                   int crashSuppressDuplicatesWindow,
+                   boolean crashStackScan,
+                   int crashDumpBudget,
+                   boolean crashDumpMiniCore,
                    ICrashCallback crashCallback,
                    boolean anrEnable,
                    boolean anrRethrow,
@@ -81,8 +91,12 @@ class NativeHandler {
                    int anrLogcatMainLines,
                    boolean anrDumpFds,
                    boolean anrDumpNetworkInfo,
+                   boolean anrDumpMemInfoDetail,
+                   int anrMainThreadSamplingThreshold,
+                   int anrMainThreadSamplingInterval,
                    ICrashCallback anrCallback,
-                   ICrashCallback anrFastCallback) {
+                   ICrashCallback anrFastCallback,
+                   boolean warmUpAsync) {
         //load lib
         if (libLoader == null) {
             try {
@@ -129,24 +143,40 @@ class NativeHandler {
                 crashLogcatEventsLines,
                 crashLogcatMainLines,
                 crashDumpElfHash,
+                elfHashAlgorithm,
                 crashDumpMap,
                 crashDumpFds,
                 crashDumpNetworkInfo,
+                crashDumpMemInfoDetail,
                 crashDumpAllThreads,
                 crashDumpAllThreadsCountMax,
                 crashDumpAllThreadsWhiteList,
+                crashSuppressDuplicatesWindow,
+                crashStackScan,
+                crashDumpBudget,
+                crashDumpMiniCore,
                 anrEnable,
                 anrRethrow,
                 anrLogcatSystemLines,
                 anrLogcatEventsLines,
                 anrLogcatMainLines,
                 anrDumpFds,
-                anrDumpNetworkInfo);
+                anrDumpNetworkInfo,
+                anrDumpMemInfoDetail,
+                warmUpAsync);
             if (r != 0) {
                 XCrash.getLogger().e(Util.TAG, "NativeHandler init failed");
                 return Errno.INIT_LIBRARY_FAILED;
             }
             initNativeLibOk = true;
+
+            if (warmUpAsync) {
+                //only the signal handlers are registered now, warm up the others in background
+                warmUp(anrMainThreadSamplingThreshold, anrMainThreadSamplingInterval);
+            } else if (anrMainThreadSamplingThreshold > 0) {
+                //sample the main thread when it stalls
+                startMainThreadWatchdog(anrMainThreadSamplingThreshold, anrMainThreadSamplingInterval);
+            }
             return 0; //OK
         } catch (Throwable e) {
             XCrash.getLogger().e(Util.TAG, "NativeHandler init failed", e);
@@ -160,6 +190,272 @@ class NativeHandler {
         }
     }
 
+    void appendBreadcrumb(String message) {
+        if (initNativeLibOk && message != null) {
+            NativeHandler.nativeAppendBreadcrumb(message);
+        }
+    }
+
+    // The following writers stream the sections directly to the log file's fd from the native lib,
+    // without building them as Java strings. They return false if the native lib is not available,
+    // and throw IOException if the native lib failed to write the log file.
+
+    boolean recordLogcat(int fd, int logcatSystemLines, int logcatEventsLines, int logcatMainLines) throws IOException {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        int r;
+        try {
+            r = NativeHandler.nativeRecordLogcat(fd, logcatSystemLines, logcatEventsLines, logcatMainLines);
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeRecordLogcat failed", e);
+            return false;
+        }
+        if (r != 0) {
+            throw new IOException("NativeHandler nativeRecordLogcat failed, errno: " + r);
+        }
+        return true;
+    }
+
+    boolean recordFds(int fd) throws IOException {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        int r;
+        try {
+            r = NativeHandler.nativeRecordFds(fd);
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeRecordFds failed", e);
+            return false;
+        }
+        if (r != 0) {
+            throw new IOException("NativeHandler nativeRecordFds failed, errno: " + r);
+        }
+        return true;
+    }
+
+    boolean recordNetworkInfo(int fd) throws IOException {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        int r;
+        try {
+            r = NativeHandler.nativeRecordNetworkInfo(fd);
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeRecordNetworkInfo failed", e);
+            return false;
+        }
+        if (r != 0) {
+            throw new IOException("NativeHandler nativeRecordNetworkInfo failed, errno: " + r);
+        }
+        return true;
+    }
+
+    boolean recordMemInfo(int fd, boolean dumpDetail) throws IOException {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        int r;
+        try {
+            r = NativeHandler.nativeRecordMemInfo(fd, dumpDetail);
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeRecordMemInfo failed", e);
+            return false;
+        }
+        if (r != 0) {
+            throw new IOException("NativeHandler nativeRecordMemInfo failed, errno: " + r);
+        }
+        return true;
+    }
+
+    boolean recordMainThreadSamples(int fd) throws IOException {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        int r;
+        try {
+            r = NativeHandler.nativeRecordMainThreadSamples(fd);
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeRecordMainThreadSamples failed", e);
+            return false;
+        }
+        if (r != 0) {
+            throw new IOException("NativeHandler nativeRecordMainThreadSamples failed, errno: " + r);
+        }
+        return true;
+    }
+
+    // Dump the other threads (for java crash) by the native dumper, directly to the log file's fd.
+    boolean dumpOtherThreads(int fd, int countMax, String[] whiteList) {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        try {
+            return NativeHandler.nativeDumpOtherThreads(fd, countMax, whiteList) == 0;
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeDumpOtherThreads failed", e);
+            return false;
+        }
+    }
+
+    // Dump all the other threads of this live process by the native dumper, return the trace log path.
+    String dumpThreads() {
+        if (!initNativeLibOk) {
+            return null;
+        }
+        try {
+            return NativeHandler.nativeDumpThreads();
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeDumpThreads failed", e);
+            return null;
+        }
+    }
+
+    // Start the in-process sampling profiler on the given thread (0 means the main thread).
+    boolean startProfiler(int tid, int intervalMs) {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        try {
+            return NativeHandler.nativeStartProfiler(tid, intervalMs) == 0;
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeStartProfiler failed", e);
+            return false;
+        }
+    }
+
+    // Stop the profiler, and wait for the folded stacks to be flushed.
+    void stopProfiler() {
+        if (!initNativeLibOk) {
+            return;
+        }
+        try {
+            NativeHandler.nativeStopProfiler();
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeStopProfiler failed", e);
+        }
+    }
+
+    // Reserve the space of a placeholder file by fallocate() instead of writing zeros.
+    boolean fillPlaceholder(String path, long size) {
+        if (!initNativeLibOk) {
+            return false;
+        }
+        try {
+            return NativeHandler.nativeFillPlaceholder(path, size) == 0;
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativeFillPlaceholder failed", e);
+            return false;
+        }
+    }
+
+    // Open a clean placeholder file in advance for the native crash handler.
+    void preparePlaceholder() {
+        if (!initNativeLibOk) {
+            return;
+        }
+        try {
+            NativeHandler.nativePreparePlaceholder();
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler nativePreparePlaceholder failed", e);
+        }
+    }
+
+    private void warmUp(final int anrMainThreadSamplingThreshold, final int anrMainThreadSamplingInterval) {
+        try {
+            new Thread(new Runnable() {
+                @Override
+                public void run() {
+                    try {
+                        NativeHandler.nativeWarmUp();
+                    } catch (Throwable e) {
+                        XCrash.getLogger().e(Util.TAG, "NativeHandler nativeWarmUp failed", e);
+                    }
+
+                    //sample the main thread when it stalls
+                    if (anrMainThreadSamplingThreshold > 0) {
+                        startMainThreadWatchdog(anrMainThreadSamplingThreshold, anrMainThreadSamplingInterval);
+                    }
+                }
+            }, "xcrash_warm_up").start();
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler start warm-up thread failed", e);
+        }
+    }
+
+    private void startMainThreadWatchdog(int thresholdMs, int intervalMs) {
+        try {
+            if (nativeStartMainThreadWatchdog(thresholdMs, intervalMs) != 0) {
+                XCrash.getLogger().e(Util.TAG, "NativeHandler start main thread watchdog failed");
+                return;
+            }
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler start main thread watchdog failed", e);
+            return;
+        }
+
+        //detect the stalls by a heartbeat posted to the main looper, nothing is added to the other messages
+        try {
+            Thread thread = new Thread(new MainThreadHeartbeat(thresholdMs), "xcrash_heartbeat");
+            thread.setDaemon(true);
+            thread.start();
+        } catch (Throwable e) {
+            XCrash.getLogger().e(Util.TAG, "NativeHandler start main thread heartbeat failed", e);
+        }
+    }
+
+    private static class MainThreadHeartbeat implements Runnable {
+        private final Handler handler = new Handler(Looper.getMainLooper());
+        private final int thresholdMs;
+        private long beats = 0;
+
+        private final Runnable beat = new Runnable() {
+            @Override
+            public void run() {
+                synchronized (MainThreadHeartbeat.this) {
+                    beats++;
+                    MainThreadHeartbeat.this.notifyAll();
+                }
+            }
+        };
+
+        MainThreadHeartbeat(int thresholdMs) {
+            this.thresholdMs = thresholdMs;
+        }
+
+        @Override
+        public void run() {
+            long expected, posted;
+
+            while (true) {
+                synchronized (this) {
+                    expected = beats + 1;
+                }
+                posted = SystemClock.uptimeMillis();
+                handler.post(beat);
+                SystemClock.sleep(thresholdMs);
+
+                synchronized (this) {
+                    if (beats >= expected) {
+                        continue;
+                    }
+                }
+
+                //the main looper has not run the heartbeat within the threshold, sample until it does
+                nativeMainThreadStalled((int) (SystemClock.uptimeMillis() - posted));
+                synchronized (this) {
+                    while (beats < expected) {
+                        try {
+                            wait();
+                        } catch (InterruptedException ignored) {
+                        }
+                    }
+                }
+                nativeMainThreadRecovered();
+            }
+        }
+    }
+
     void testNativeCrash(boolean runInNewThread) {
         if (initNativeLibOk) {
             NativeHandler.nativeTestCrash(runInNewThread ? 1 : 0);
@@ -298,21 +594,61 @@ class NativeHandler {
             int crashLogcatEventsLines,
             int crashLogcatMainLines,
             boolean crashDumpElfHash,
+            int elfHashAlgorithm,
             boolean crashDumpMap,
             boolean crashDumpFds,
             boolean crashDumpNetworkInfo,
+            boolean crashDumpMemInfoDetail,
             boolean crashDumpAllThreads,
             int crashDumpAllThreadsCountMax,
             String[] crashDumpAllThreadsWhiteList,
+            int crashSuppressDuplicatesWindow,
+            boolean crashStackScan,
+            int crashDumpBudget,
+            boolean crashDumpMiniCore,
             boolean traceEnable,
             boolean traceRethrow,
             int traceLogcatSystemLines,
             int traceLogcatEventsLines,
             int traceLogcatMainLines,
             boolean traceDumpFds,
-            boolean traceDumpNetworkInfo);
+            boolean traceDumpNetworkInfo,
+            boolean traceDumpMemInfoDetail,
+            boolean warmUpAsync);
+
+    private static native void nativeWarmUp();
 
     private static native void nativeNotifyJavaCrashed();
 
+    private static native void nativeAppendBreadcrumb(String message);
+
+    private static native int nativeRecordLogcat(int fd, int logcatSystemLines, int logcatEventsLines, int logcatMainLines);
+
+    private static native int nativeRecordFds(int fd);
+
+    private static native int nativeRecordNetworkInfo(int fd);
+
+    private static native int nativeRecordMemInfo(int fd, boolean dumpDetail);
+
+    private static native int nativeStartMainThreadWatchdog(int thresholdMs, int intervalMs);
+
+    private static native void nativeMainThreadStalled(int stalledMs);
+
+    private static native void nativeMainThreadRecovered();
+
+    private static native int nativeRecordMainThreadSamples(int fd);
+
+    private static native int nativeDumpOtherThreads(int fd, int countMax, String[] whiteList);
+
+    private static native String nativeDumpThreads();
+
+    private static native int nativeStartProfiler(int tid, int intervalMs);
+
+    private static native void nativeStopProfiler();
+
+    private static native int nativeFillPlaceholder(String path, long size);
+
+    private static native void nativePreparePlaceholder();
+
     private static native void nativeTestCrash(int runInNewThread);
 }
@@ -0,0 +1,449 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import java.io.ByteArrayInputStream;
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.LinkedHashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * Indexed and lazy tombstone (crash) log file parser.
+ *
+ * <p>The log file is memory-mapped and scanned only once to find the boundaries of all sections.
+ * Only the head items are decoded while scanning, the content of a section is decoded when it is
+ * requested by {@link #get(String)}, or streamed by {@link #openSection(String)}.
+ *
+ * <p>Keys are the same as {@link xcrash.TombstoneParser}. This class is not thread-safe.
+ */
+@SuppressWarnings("unused")
+public final class TombstoneIndex implements Closeable {
+
+    private static final Charset charset = Charset.forName("UTF-8");
+    private static final byte[] sepHead = Util.sepHead.getBytes(charset);
+    private static final byte[] sepOtherThreads = Util.sepOtherThreads.getBytes(charset);
+
+    private ByteBuffer buffer;
+    private int limit;
+    private final Map<String, String> heads = new HashMap<String, String>();
+    private final Map<String, Entry> sections = new LinkedHashMap<String, Entry>();
+
+    private static final class Span {
+        final int start;
+        final int end;
+        final boolean outdent;
+        final boolean trim;
+
+        Span(int start, int end, boolean outdent, boolean trim) {
+            this.start = start;
+            this.end = end;
+            this.outdent = outdent;
+            this.trim = trim;
+        }
+    }
+
+    private static final class Entry {
+        final boolean append;
+        final boolean singleLine;
+        final List<Span> spans = new ArrayList<Span>(1);
+
+        Entry(boolean append, boolean singleLine) {
+            this.append = append;
+            this.singleLine = singleLine;
+        }
+    }
+
+    private enum Status {
+        UNKNOWN,
+        HEAD,
+        SECTION
+    }
+
+    private TombstoneIndex(ByteBuffer buffer) {
+        this.buffer = buffer;
+        this.limit = buffer.limit();
+        scan();
+    }
+
+    /**
+     * Build the section index of a crash log file.
+     *
+     * @param log Object of the crash log file.
+     * @return The index, which should be closed after use.
+     * @throws IOException If an I/O error occurs.
+     */
+    public static TombstoneIndex open(File log) throws IOException {
+        return open(log.getAbsolutePath());
+    }
+
+    /**
+     * Build the section index of a crash log file.
+     *
+     * @param logPath Absolute path of the crash log file.
+     * @return The index, which should be closed after use.
+     * @throws IOException If an I/O error occurs.
+     */
+    public static TombstoneIndex open(String logPath) throws IOException {
+        RandomAccessFile raf = new RandomAccessFile(logPath, "r");
+        try {
+            FileChannel channel = raf.getChannel();
+            long size = channel.size();
+            if (size > Integer.MAX_VALUE) {
+                throw new IOException("log file too large: " + logPath);
+            }
+
+            //the mapping stays valid after the channel is closed
+            return new TombstoneIndex(channel.map(FileChannel.MapMode.READ_ONLY, 0, size));
+        } finally {
+            raf.close();
+        }
+    }
+
+    /**
+     * Get all keys (head items and sections) found in the log file.
+     *
+     * @return Keys in the order they appear.
+     */
+    public Set<String> keys() {
+        Set<String> keys = new LinkedHashSet<String>(heads.keySet());
+        keys.addAll(sections.keySet());
+        return Collections.unmodifiableSet(keys);
+    }
+
+    /**
+     * Check if the log file contains a head item or a section.
+     *
+     * @param key Key defined in {@link xcrash.TombstoneParser}.
+     * @return True if the key is found.
+     */
+    public boolean contains(String key) {
+        return heads.containsKey(key) || sections.containsKey(key);
+    }
+
+    /**
+     * Get the value of a head item, or decode the content of a section.
+     *
+     * <p>The section content is the same as the value in the map returned by
+     * {@link xcrash.TombstoneParser#parse(String)}. It is not cached.
+     *
+     * @param key Key defined in {@link xcrash.TombstoneParser}.
+     * @return The value, or null if the key is not found.
+     */
+    public String get(String key) {
+        String value = heads.get(key);
+        if (value != null) {
+            return value;
+        }
+
+        Entry entry = sections.get(key);
+        if (entry == null || buffer == null) {
+            return null;
+        }
+
+        if (entry.append) {
+            StringBuilder sb = new StringBuilder();
+            for (Span span : entry.spans) {
+                sb.append(decode(span, entry.singleLine));
+            }
+            return sb.toString();
+        } else {
+            //the first non-empty one wins
+            value = "";
+            for (Span span : entry.spans) {
+                value = decode(span, entry.singleLine);
+                if (!value.isEmpty()) {
+                    break;
+                }
+            }
+            return value;
+        }
+    }
+
+    /**
+     * Open a stream of a section for uploading, without decoding it.
+     *
+     * <p>The stream returns the raw bytes in the log file, the indent of lines is not removed.
+     * For a head item, the stream returns the value in UTF-8.
+     *
+     * @param key Key defined in {@link xcrash.TombstoneParser}.
+     * @return The stream, or null if the key is not found.
+     */
+    public InputStream openSection(String key) {
+        String value = heads.get(key);
+        if (value != null) {
+            return new ByteArrayInputStream(value.getBytes(charset));
+        }
+
+        Entry entry = sections.get(key);
+        if (entry == null || buffer == null) {
+            return null;
+        }
+
+        if (entry.append) {
+            return new SectionInputStream(buffer, entry.spans);
+        } else {
+            for (Span span : entry.spans) {
+                if (span.end > span.start) {
+                    return new SectionInputStream(buffer, Collections.singletonList(span));
+                }
+            }
+            return new ByteArrayInputStream(new byte[0]);
+        }
+    }
+
+    /**
+     * Decode all head items and sections into an instance of {@link java.util.Map}.
+     *
+     * @return The map.
+     */
+    public Map<String, String> toMap() {
+        Map<String, String> map = new HashMap<String, String>();
+        copyTo(map);
+        return map;
+    }
+
+    /**
+     * Release the memory-mapped log file.
+     */
+    @Override
+    public void close() {
+        buffer = null;
+    }
+
+    void copyTo(Map<String, String> map) {
+        for (Map.Entry<String, String> head : heads.entrySet()) {
+            TombstoneParser.putKeyValue(map, head.getKey(), head.getValue());
+        }
+        for (String key : sections.keySet()) {
+            String value = get(key);
+            if (value != null) {
+                TombstoneParser.putKeyValue(map, key, value, sections.get(key).append);
+            }
+        }
+    }
+
+    //the log file may be padded with NUL bytes by the placeholder file
+    private boolean isEnd(int pos) {
+        return pos >= limit || (buffer.get(pos) == 0 && (pos + 1 >= limit || buffer.get(pos + 1) == 0));
+    }
+
+    private int findLineEnd(int pos) {
+        while (pos < limit && buffer.get(pos) != '\n') {
+            pos++;
+        }
+        return pos;
+    }
+
+    private boolean lineEquals(int start, int end, byte[] bytes) {
+        if (end - start != bytes.length) {
+            return false;
+        }
+        for (int i = 0; i < bytes.length; i++) {
+            if (buffer.get(start + i) != bytes[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private String lineToString(int start, int end) {
+        byte[] bytes = new byte[end - start];
+        ByteBuffer dup = buffer.duplicate();
+        dup.position(start);
+        dup.get(bytes);
+        return new String(bytes, charset);
+    }
+
+    private void addSpan(TombstoneParser.Section section, int start, int end) {
+        Entry entry = sections.get(section.title);
+        if (entry == null) {
+            entry = new Entry(section.append, section.singleLine);
+            sections.put(section.title, entry);
+        }
+        entry.spans.add(new Span(start, end, section.outdent, section.outdent && section.title.equals(TombstoneParser.keyJavaStacktrace)));
+    }
+
+    private void scan() {
+        TombstoneParser.Section section = null;
+        int sectionStart = 0;
+        byte[] sectionEnding = null;
+        Status status = Status.UNKNOWN;
+
+        if (isEnd(0)) {
+            return;
+        }
+
+        int lineStart = 0;
+        int lineEnd = findLineEnd(lineStart);
+        for (boolean last = false; !last; ) {
+            int nextStart = lineEnd + 1;
+            last = (lineEnd >= limit || isEnd(nextStart));
+            int nextEnd = (last ? nextStart : findLineEnd(nextStart));
+
+            switch (status) {
+                case UNKNOWN:
+                    if (lineEquals(lineStart, lineEnd, sepHead)) {
+                        status = Status.HEAD;
+                    } else if (lineEnd - lineStart > 1
+                        && (buffer.get(lineEnd - 1) == ':' || lineEquals(lineStart, lineEnd, sepOtherThreads))) {
+                        //only decode the title line
+                        section = TombstoneParser.getSection(lineToString(lineStart, lineEnd));
+                        if (section != null) {
+                            status = Status.SECTION;
+                            sectionStart = (section.withTitleLine ? lineStart : nextStart);
+                            sectionEnding = section.ending.getBytes(charset);
+                        }
+                    }
+                    break;
+                case HEAD:
+                    TombstoneParser.parseHeadLine(heads, lineToString(lineStart, lineEnd));
+
+                    //special case
+                    if (!last && TombstoneParser.isRegistersLine(lineToString(nextStart, nextEnd))) {
+                        status = Status.SECTION;
+                        section = TombstoneParser.sectionRegisters;
+                        sectionStart = nextStart;
+                        sectionEnding = new byte[0];
+                    }
+
+                    if (last || nextEnd == nextStart) {
+                        //the end of head
+                        status = Status.UNKNOWN;
+                    }
+                    break;
+                case SECTION:
+                    if (last || lineEquals(lineStart, lineEnd, sectionEnding)) {
+                        addSpan(section, sectionStart, lineStart);
+                        status = Status.UNKNOWN;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            lineStart = nextStart;
+            lineEnd = nextEnd;
+        }
+    }
+
+    private String decode(Span span, boolean singleLine) {
+        byte[] bytes = new byte[span.end - span.start];
+        int len = 0;
+        ByteBuffer dup = buffer.duplicate();
+
+        for (int pos = span.start; pos < span.end; ) {
+            int end = Math.min(findLineEnd(pos), span.end);
+            int start = pos;
+            pos = end + 1;
+
+            if (span.outdent) {
+                if (span.trim && start < end && buffer.get(start) == ' ') {
+                    //java stacktrace in native crash
+                    while (start < end && (buffer.get(start) & 0xff) <= ' ') start++;
+                    while (end > start && (buffer.get(end - 1) & 0xff) <= ' ') end--;
+                } else if (end - start >= 4 && buffer.get(start) == ' ' && buffer.get(start + 1) == ' '
+                    && buffer.get(start + 2) == ' ' && buffer.get(start + 3) == ' ') {
+                    //other sections
+                    start += 4;
+                }
+            }
+
+            dup.position(start);
+            dup.get(bytes, len, end - start);
+            len += (end - start);
+            bytes[len++] = '\n';
+        }
+
+        if (singleLine && len > 0) {
+            //If there is only one line in the content, then delete the newline character at the end.
+            len--;
+        }
+
+        return new String(bytes, 0, len, charset);
+    }
+
+    private static final class SectionInputStream extends InputStream {
+        private final ByteBuffer buffer;
+        private final List<Span> spans;
+        private int index = 0;
+
+        SectionInputStream(ByteBuffer buffer, List<Span> spans) {
+            this.buffer = buffer.duplicate();
+            this.spans = spans;
+            if (!spans.isEmpty()) {
+                select(0);
+            }
+        }
+
+        private void select(int i) {
+            index = i;
+            buffer.limit(spans.get(i).end);
+            buffer.position(spans.get(i).start);
+        }
+
+        private boolean available0() {
+            while (!buffer.hasRemaining()) {
+                if (index + 1 >= spans.size()) {
+                    return false;
+                }
+                select(index + 1);
+            }
+            return true;
+        }
+
+        @Override
+        public int read() {
+            return available0() ? (buffer.get() & 0xff) : -1;
+        }
+
+        @Override
+        public int read(byte[] b, int off, int len) {
+            if (len == 0) {
+                return 0;
+            }
+            if (!available0()) {
+                return -1;
+            }
+            int n = Math.min(len, buffer.remaining());
+            buffer.get(b, off, n);
+            return n;
+        }
+
+        @Override
+        public int available() {
+            return buffer.remaining();
+        }
+    }
+}
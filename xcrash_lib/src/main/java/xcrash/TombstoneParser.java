@@ -27,7 +27,6 @@ import android.text.TextUtils;
 
 import java.io.BufferedReader;
 import java.io.File;
-import java.io.FileReader;
 import java.io.IOException;
 import java.io.StringReader;
 import java.text.DateFormat;
@@ -44,6 +43,9 @@ import java.util.regex.Pattern;
 
 /**
  * Tombstone (crash) log file parser.
+ *
+ * <p>If only a few sections are needed (e.g. head items, backtrace and build id), use
+ * {@link xcrash.TombstoneIndex} to avoid decoding the whole log file.
  */
 @SuppressWarnings("unused")
 public class TombstoneParser {
@@ -55,7 +57,7 @@ public class TombstoneParser {
     public static final String keyTombstoneMaker = "Tombstone maker";
 
     /**
-     * Crash type. ("java" or "native" or "anr")
+     * Crash type. ("java" or "native" or "anr" or "trace")
      */
     @SuppressWarnings("WeakerAccess")
     public static final String keyCrashType = "Crash type";
@@ -193,6 +195,19 @@ public class TombstoneParser {
     @SuppressWarnings("WeakerAccess")
     public static final String keyAbortMessage = "Abort message";
 
+    /**
+     * Native crash signature computed from the crashed thread's top frames.
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyCrashSignature = "Crash signature";
+
+    /**
+     * Number of the native crashes with the same signature within the suppression window.
+     * (Only exists in the short reference record of a duplicate native crash)
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyDuplicateCrashes = "Duplicate crashes";
+
     /**
      * Native crash registers values.
      */
@@ -229,6 +244,18 @@ public class TombstoneParser {
     @SuppressWarnings("WeakerAccess")
     public static final String keyMemoryMap = "memory map";
 
+    /**
+     * Breadcrumbs appended by the APP before the native crash.
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyBreadcrumbs = "breadcrumbs";
+
+    /**
+     * Main thread samples (folded stacks with counts) taken during the main looper stall before the ANR.
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyMainThreadSamples = "main thread samples";
+
     /**
      * Logcat.
      */
@@ -277,6 +304,18 @@ public class TombstoneParser {
     @SuppressWarnings("WeakerAccess")
     public static final String keyForeground = "foreground";
 
+    /**
+     * The unwinder used for the native crash backtrace, only when the dumper failed.
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyUnwinder = "unwinder";
+
+    /**
+     * The sections skipped or degraded by the native dumper because of the time budget.
+     */
+    @SuppressWarnings("WeakerAccess")
+    public static final String keyDumpBudget = "dump budget";
+
     /**
      * Error message from xCrash itself.
      */
@@ -306,7 +345,9 @@ public class TombstoneParser {
         keyModel,
         keyBuildFingerprint,
         keyAbi,
-        keyAbortMessage
+        keyAbortMessage,
+        keyCrashSignature,
+        keyDuplicateCrashes
     ));
 
     private static final Set<String> keySections = new HashSet<String>(Arrays.asList(
@@ -314,15 +355,19 @@ public class TombstoneParser {
         keyBuildId,
         keyStack,
         keyMemoryMap,
+        keyBreadcrumbs,
+        keyMainThreadSamples,
         keyLogcat,
         keyOpenFiles,
         keyJavaStacktrace,
+        keyDumpBudget,
         keyXCrashError,
         keyXCrashErrorDebug
     ));
 
     private static final Set<String> keySingleLineSections = new HashSet<String>(Arrays.asList(
-        keyForeground
+        keyForeground,
+        keyUnwinder
     ));
 
     private enum Status {
@@ -376,20 +421,41 @@ public class TombstoneParser {
 
         Map<String, String> map = new HashMap<String, String>();
 
-        //parse content from log file
+        //parse content from log file (through the section index)
         if (logPath != null) {
-            BufferedReader br = new BufferedReader(new FileReader(logPath));
-            parseFromReader(map, br, true);
-            br.close();
+            TombstoneIndex index = TombstoneIndex.open(logPath);
+            try {
+                index.copyTo(map);
+            } finally {
+                index.close();
+            }
         }
 
         //parse content from emergency buffer
         if (emergency != null) {
             BufferedReader br = new BufferedReader(new StringReader(emergency));
-            parseFromReader(map, br, false);
+            parseFromReader(map, br);
             br.close();
         }
 
+        addMissingInfo(map, logPath);
+
+        return map;
+    }
+
+    //the same as parse(logPath, null), but decoded from an opened index, so the log file is not scanned again
+    static Map<String, String> parse(TombstoneIndex index, String logPath) {
+
+        Map<String, String> map = new HashMap<String, String>();
+
+        index.copyTo(map);
+        addMissingInfo(map, logPath);
+
+        return map;
+    }
+
+    private static void addMissingInfo(Map<String, String> map, String logPath) {
+
         //try to parse APP version, process name, crash type, start time and crash time from log path
         parseFromLogPath(map, logPath);
 
@@ -402,8 +468,6 @@ public class TombstoneParser {
 
         //add system info if there were missing
         addSystemInfo(map);
-
-        return map;
     }
 
     private static void parseFromLogPath(Map<String, String> map, String logPath) {
@@ -451,6 +515,11 @@ public class TombstoneParser {
                     map.put(keyCrashType, Util.anrCrashType);
                 }
                 filename = filename.substring(0, filename.length() - Util.anrLogSuffix.length());
+            } else if (filename.endsWith(Util.traceLogSuffix)) {
+                if (TextUtils.isEmpty(crashType)) {
+                    map.put(keyCrashType, Util.traceCrashType);
+                }
+                filename = filename.substring(0, filename.length() - Util.traceLogSuffix.length());
             } else {
                 return;
             }
@@ -518,134 +587,33 @@ public class TombstoneParser {
         }
     }
 
-    private static String readLineInBinary(BufferedReader br) throws IOException {
-
-        // Peek the next 2 characters to determine if there is still valid text.
-
-        try {
-            br.mark(2);
-        } catch (Exception ignored) {
-            return br.readLine();
-        }
-
-        try {
-            for (int i = 0; i < 2; i++) {
-                int c = br.read();
-                if (c == -1) {
-                    br.reset();
-                    return null;
-                } else if (c > 0) {
-                    br.reset();
-                    return br.readLine();
-                }
-            }
-            br.reset();
-            return null;
-        } catch (Exception ignored) {
-            br.reset();
-            return br.readLine();
-        }
-    }
-
-    private static void parseFromReader(Map<String, String> map, BufferedReader br, boolean binary) throws IOException {
+    private static void parseFromReader(Map<String, String> map, BufferedReader br) throws IOException {
         String next, line;
-        String sectionTitle = null;
+        Section section = null;
         StringBuilder sectionContent = new StringBuilder();
-        String sectionContentEnding = "";
-        boolean sectionContentOutdent = false;
-        boolean sectionContentAppend = false;
-        Matcher matcher;
         Status status = Status.UNKNOWN;
 
-        line = (binary ? readLineInBinary(br) : br.readLine());
+        line = br.readLine();
         for (boolean last = (line == null); !last; line = next) {
-            last = ((next = (binary ? readLineInBinary(br) : br.readLine())) == null);
+            last = ((next = br.readLine()) == null);
             switch (status) {
                 case UNKNOWN:
                     if (line.equals(Util.sepHead)) {
                         status = Status.HEAD;
-                    } else if (line.equals(Util.sepOtherThreads)) {
-                        //special case
+                    } else if ((section = getSection(line)) != null) {
                         status = Status.SECTION;
-                        sectionTitle = keyOtherThreads;
-                        sectionContentEnding = Util.sepOtherThreadsEnding;
-                        sectionContentOutdent = false;
-                        sectionContentAppend = false;
-                        sectionContent.append(line).append('\n');
-                    } else if (line.length() > 1 && line.endsWith(":")) {
-                        status = Status.SECTION;
-                        sectionTitle = line.substring(0, line.length() - 1);
-                        sectionContentEnding = "";
-                        if (keySections.contains(sectionTitle)) {
-                            sectionContentOutdent = (sectionTitle.equals(keyBacktrace)
-                                || sectionTitle.equals(keyBuildId)
-                                || sectionTitle.equals(keyStack)
-                                || sectionTitle.equals(keyMemoryMap)
-                                || sectionTitle.equals(keyOpenFiles)
-                                || sectionTitle.equals(keyJavaStacktrace)
-                                || sectionTitle.equals(keyXCrashErrorDebug));
-                            sectionContentAppend = sectionTitle.equals(keyXCrashError);
-                        } else if (sectionTitle.equals(keyMemoryInfo)) {
-                            sectionContentOutdent = false;
-                            sectionContentAppend = true;
-                        } else if (sectionTitle.startsWith("memory near ")) {
-                            //special case
-                            sectionTitle = keyMemoryNear;
-                            sectionContentOutdent = false;
-                            sectionContentAppend = true;
+                        if (section.withTitleLine) {
                             sectionContent.append(line).append('\n');
-                        } else {
-                            //additional information section attached by users
-                            sectionContentOutdent = false;
-                            sectionContentAppend = false;
                         }
                     }
                     break;
                 case HEAD:
-                    if (line.startsWith("pid: ")) {
-                        //try parse for native/java crash
-                        matcher = patProcessThread.matcher(line);
-                        if (matcher.find() && matcher.groupCount() == 4) {
-                            //pid, process name, tid, thread name
-                            putKeyValue(map, keyProcessId, matcher.group(1));
-                            putKeyValue(map, keyThreadId, matcher.group(2));
-                            putKeyValue(map, keyThreadName, matcher.group(3));
-                            putKeyValue(map, keyProcessName, matcher.group(4));
-                        } else {
-                            //try parse for ANR
-                            matcher = patProcess.matcher(line);
-                            if (matcher.find() && matcher.groupCount() == 2) {
-                                //pid, process name
-                                putKeyValue(map, keyProcessId, matcher.group(1));
-                                putKeyValue(map, keyProcessName, matcher.group(2));
-                            }
-                        }
-                    } else if (line.startsWith("signal ")) {
-                        matcher = patSignalCode.matcher(line);
-                        if (matcher.find() && matcher.groupCount() == 3) {
-                            //signal, code, fault address
-                            putKeyValue(map, keySignal, matcher.group(1));
-                            putKeyValue(map, keyCode, matcher.group(2));
-                            putKeyValue(map, keyFaultAddr, matcher.group(3));
-                        }
-                    } else {
-                        //other items in head section
-                        matcher = patHeadItem.matcher(line);
-                        if (matcher.find() && matcher.groupCount() == 2) {
-                            if (keyHeadItems.contains(matcher.group(1))) {
-                                putKeyValue(map, matcher.group(1), matcher.group(2));
-                            }
-                        }
-                    }
+                    parseHeadLine(map, line);
 
                     //special case
-                    if (next != null && (next.startsWith("    r0 ") || next.startsWith("    x0 ") || next.startsWith("    eax ") || next.startsWith("    rax "))) {
-                        //registers
+                    if (next != null && isRegistersLine(next)) {
                         status = Status.SECTION;
-                        sectionTitle = keyRegisters;
-                        sectionContentEnding = "";
-                        sectionContentOutdent = true;
-                        sectionContentAppend = false;
+                        section = sectionRegisters;
                     }
 
                     if (next == null || next.isEmpty()) {
@@ -654,19 +622,19 @@ public class TombstoneParser {
                     }
                     break;
                 case SECTION:
-                    if (line.equals(sectionContentEnding) || last) {
-                        if (keySingleLineSections.contains(sectionTitle)) {
+                    if (line.equals(section.ending) || last) {
+                        if (section.singleLine) {
                             if (sectionContent.length() > 0 && sectionContent.charAt(sectionContent.length() - 1) == '\n') {
                                 //If there is only one line in the content, then delete the newline character at the end.
                                 sectionContent.deleteCharAt(sectionContent.length() - 1);
                             }
                         }
-                        putKeyValue(map, sectionTitle, sectionContent.toString(), sectionContentAppend);
+                        putKeyValue(map, section.title, sectionContent.toString(), section.append);
                         sectionContent.setLength(0);
                         status = Status.UNKNOWN;
                     } else {
-                        if (sectionContentOutdent) {
-                            if (sectionTitle.equals(keyJavaStacktrace) && line.startsWith(" ")) {
+                        if (section.outdent) {
+                            if (section.title.equals(keyJavaStacktrace) && line.startsWith(" ")) {
                                 //java stacktrace in native crash
                                 line = line.trim();
                             } else if (line.startsWith("    ")) {
@@ -683,11 +651,106 @@ public class TombstoneParser {
         }
     }
 
-    private static void putKeyValue(Map<String, String> map, String k, String v) {
+    static final class Section {
+        final String title;
+        final String ending;
+        final boolean outdent;
+        final boolean append;
+        final boolean singleLine;
+        final boolean withTitleLine;
+
+        Section(String title, String ending, boolean outdent, boolean append, boolean withTitleLine) {
+            this.title = title;
+            this.ending = ending;
+            this.outdent = outdent;
+            this.append = append;
+            this.singleLine = keySingleLineSections.contains(title);
+            this.withTitleLine = withTitleLine;
+        }
+    }
+
+    static final Section sectionRegisters = new Section(keyRegisters, "", true, false, false);
+
+    static Section getSection(String line) {
+        if (line.equals(Util.sepOtherThreads)) {
+            //special case
+            return new Section(keyOtherThreads, Util.sepOtherThreadsEnding, false, false, true);
+        } else if (line.length() > 1 && line.endsWith(":")) {
+            String title = line.substring(0, line.length() - 1);
+            if (keySections.contains(title)) {
+                boolean outdent = (title.equals(keyBacktrace)
+                    || title.equals(keyBuildId)
+                    || title.equals(keyStack)
+                    || title.equals(keyMemoryMap)
+                    || title.equals(keyBreadcrumbs)
+                    || title.equals(keyMainThreadSamples)
+                    || title.equals(keyOpenFiles)
+                    || title.equals(keyJavaStacktrace)
+                    || title.equals(keyDumpBudget)
+                    || title.equals(keyXCrashErrorDebug));
+                return new Section(title, "", outdent, title.equals(keyXCrashError), false);
+            } else if (title.equals(keyMemoryInfo)) {
+                return new Section(title, "", false, true, false);
+            } else if (title.startsWith("memory near ")) {
+                //special case
+                return new Section(keyMemoryNear, "", false, true, true);
+            } else {
+                //additional information section attached by users
+                return new Section(title, "", false, false, false);
+            }
+        }
+        return null;
+    }
+
+    static boolean isRegistersLine(String line) {
+        return line.startsWith("    r0 ") || line.startsWith("    x0 ") || line.startsWith("    eax ") || line.startsWith("    rax ");
+    }
+
+    static void parseHeadLine(Map<String, String> map, String line) {
+        Matcher matcher;
+
+        if (line.startsWith("pid: ")) {
+            //try parse for native/java crash
+            matcher = patProcessThread.matcher(line);
+            if (matcher.find() && matcher.groupCount() == 4) {
+                //pid, process name, tid, thread name
+                putKeyValue(map, keyProcessId, matcher.group(1));
+                putKeyValue(map, keyThreadId, matcher.group(2));
+                putKeyValue(map, keyThreadName, matcher.group(3));
+                putKeyValue(map, keyProcessName, matcher.group(4));
+            } else {
+                //try parse for ANR
+                matcher = patProcess.matcher(line);
+                if (matcher.find() && matcher.groupCount() == 2) {
+                    //pid, process name
+                    putKeyValue(map, keyProcessId, matcher.group(1));
+                    putKeyValue(map, keyProcessName, matcher.group(2));
+                }
+            }
+        } else if (line.startsWith("signal ")) {
+            matcher = patSignalCode.matcher(line);
+            if (matcher.find() && matcher.groupCount() == 3) {
+                //signal, code, fault address
+                putKeyValue(map, keySignal, matcher.group(1));
+                putKeyValue(map, keyCode, matcher.group(2));
+                putKeyValue(map, keyFaultAddr, matcher.group(3));
+            }
+        } else {
+            //other items in head section
+            matcher = patHeadItem.matcher(line);
+            if (matcher.find() && matcher.groupCount() == 2) {
+                if (keyHeadItems.contains(matcher.group(1))) {
+                    putKeyValue(map, matcher.group(1), matcher.group(2));
+                }
+            }
+        }
+    }
+
+    static void putKeyValue(Map<String, String> map, String k, String v) {
         putKeyValue(map, k, v, false);
     }
 
-    private static void putKeyValue(Map<String, String> map, String k, String v, boolean append) {
+    static void putKeyValue(Map<String, String> map, String k, String v, boolean append) {
         if (k == null || k.isEmpty() || v == null) return;
 
         String oldValue = map.get(k);
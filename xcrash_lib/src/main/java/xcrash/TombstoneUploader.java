@@ -0,0 +1,556 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import android.text.TextUtils;
+
+import org.json.JSONObject;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.FilterOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.OutputStreamWriter;
+import java.io.Writer;
+import java.math.BigInteger;
+import java.security.MessageDigest;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Properties;
+import java.util.Set;
+import java.util.UUID;
+import java.util.zip.GZIPOutputStream;
+
+/**
+ * Batched uploader of the tombstone (crash) log files.
+ *
+ * <p>Each call of {@link #upload()} packs the pending tombstones into one batch, dedupes them by crash signature,
+ * and posts it by the {@link xcrash.ITombstoneTransport}. The batch is compressed with gzip while it is streamed
+ * to the transport, one tombstone at a time. The tombstones are
+ * deleted after the batch is accepted. A small journal in the log directory records the in-flight batch,
+ * the byte budget, the last upload time and the recently uploaded signatures, so the batch is resent
+ * with the same batch ID after the process is killed.
+ *
+ * <p>Note: {@link #upload()} does network and disk IO, please call it in a background thread.
+ */
+@SuppressWarnings("unused")
+public final class TombstoneUploader {
+
+    /**
+     * The rate budget does not allow uploading now.
+     */
+    public static final int RATE_LIMITED = -1;
+
+    /**
+     * The byte budget of the current window is exhausted.
+     */
+    public static final int BUDGET_EXHAUSTED = -2;
+
+    /**
+     * The transport failed, the batch will be resent next time.
+     */
+    public static final int SEND_FAILED = -3;
+
+    /**
+     * Reading or writing the journal failed.
+     */
+    public static final int IO_FAILED = -4;
+
+    private static final String journalDirName = "upload";
+    private static final String journalFileName = "journal";
+    private static final String keyBatchId = "batch.id";
+    private static final String keyBatchFiles = "batch.files";
+    private static final String keyWindowStart = "window.start";
+    private static final String keyWindowBytes = "window.bytes";
+    private static final String keyLastUpload = "last.upload";
+    private static final String keySignaturePrefix = "sig.";
+    private static final String fileSeparator = "|";
+    private static final long budgetWindowMs = 24 * 60 * 60 * 1000L;
+    private static final int signatureFramesMax = 8;
+
+    private final ITombstoneTransport transport;
+    private final Parameters params;
+    private final File journalFile;
+
+    /**
+     * Create an uploader for the log directory of xCrash.
+     *
+     * <p>Note: Please call this after {@link xcrash.XCrash#init(android.content.Context, XCrash.InitParameters)}.
+     *
+     * @param transport The transport to post the batches, such as {@link xcrash.HttpTombstoneTransport}.
+     * @param params The uploader parameters, or null for the defaults.
+     */
+    public TombstoneUploader(ITombstoneTransport transport, Parameters params) {
+        this.transport = transport;
+        this.params = (params == null ? new Parameters() : params);
+        this.journalFile = new File(new File(XCrash.getLogDir(), journalDirName), journalFileName);
+    }
+
+    /**
+     * Upload one batch of the pending tombstones.
+     *
+     * @return The number of the tombstones uploaded (including the deduped ones), or a negative error code:
+     * {@link #RATE_LIMITED}, {@link #BUDGET_EXHAUSTED}, {@link #SEND_FAILED}, {@link #IO_FAILED}.
+     */
+    public synchronized int upload() {
+        long now = System.currentTimeMillis();
+        Properties journal = loadJournal();
+
+        //rate budget
+        long lastUpload = getLong(journal, keyLastUpload);
+        if (lastUpload > 0 && now >= lastUpload && now - lastUpload < params.minIntervalMs) {
+            return RATE_LIMITED;
+        }
+
+        //byte budget
+        if (now - getLong(journal, keyWindowStart) >= budgetWindowMs || now < getLong(journal, keyWindowStart)) {
+            journal.setProperty(keyWindowStart, String.valueOf(now));
+            journal.setProperty(keyWindowBytes, "0");
+        }
+        long windowBytes = getLong(journal, keyWindowBytes);
+        if (windowBytes >= params.maxBytesPerDay) {
+            return BUDGET_EXHAUSTED;
+        }
+
+        //forget the signatures out of the dedupe window
+        for (String key : journal.stringPropertyNames()) {
+            if (key.startsWith(keySignaturePrefix) && now - getLong(journal, key) >= params.dedupeWindowMs) {
+                journal.remove(key);
+            }
+        }
+
+        //resend the in-flight batch first, or start a new one
+        String batchId = journal.getProperty(keyBatchId);
+        List<File> candidates = new ArrayList<File>();
+        if (!TextUtils.isEmpty(batchId)) {
+            for (String path : TextUtils.split(journal.getProperty(keyBatchFiles, ""), "\\" + fileSeparator)) {
+                File file = new File(path);
+                if (!TextUtils.isEmpty(path) && file.exists()) {
+                    candidates.add(file);
+                }
+            }
+        }
+        if (candidates.isEmpty()) {
+            batchId = UUID.randomUUID().toString();
+            File[] files = TombstoneManager.getAllTombstones();
+            candidates.addAll(Arrays.asList(files));
+        }
+
+        //select and dedupe the tombstones of the batch
+        Batch batch;
+        try {
+            batch = buildBatch(batchId, candidates, journal);
+        } catch (Exception e) {
+            XCrash.getLogger().w(Util.TAG, "TombstoneUploader build batch failed", e);
+            return IO_FAILED;
+        }
+
+        //the tombstones deduped by the journal
+        for (File file : batch.skippedFiles) {
+            TombstoneManager.deleteTombstone(file);
+        }
+        if (batch.files.isEmpty()) {
+            journal.remove(keyBatchId);
+            journal.remove(keyBatchFiles);
+            return saveJournal(journal) ? batch.skippedFiles.size() : IO_FAILED;
+        }
+
+        //record the in-flight batch before sending it
+        journal.setProperty(keyBatchId, batchId);
+        journal.setProperty(keyBatchFiles, joinPaths(batch.files));
+        journal.setProperty(keyLastUpload, String.valueOf(now));
+        if (!saveJournal(journal)) {
+            batch.close();
+            return IO_FAILED;
+        }
+
+        boolean ok;
+        try {
+            ok = transport.send(batchId, batch);
+        } catch (Exception e) {
+            XCrash.getLogger().w(Util.TAG, "TombstoneUploader send failed", e);
+            ok = false;
+        } finally {
+            batch.close();
+        }
+        if (!ok) {
+            return SEND_FAILED;
+        }
+
+        //confirmed
+        for (File file : batch.files) {
+            TombstoneManager.deleteTombstone(file);
+        }
+        for (String signature : batch.signatures) {
+            journal.setProperty(keySignaturePrefix + signature, String.valueOf(now));
+        }
+        journal.setProperty(keyWindowBytes, String.valueOf(windowBytes + batch.bodyBytes));
+        journal.remove(keyBatchId);
+        journal.remove(keyBatchFiles);
+        saveJournal(journal);
+
+        return batch.files.size() + batch.skippedFiles.size();
+    }
+
+    private static class Report {
+        final String signature;
+        final File file; //the first tombstone with the signature
+        final TombstoneIndex index; //built once by buildBatch(), closed with the batch
+        int count = 1;
+
+        Report(String signature, File file, TombstoneIndex index) {
+            this.signature = signature;
+            this.file = file;
+            this.index = index;
+        }
+    }
+
+    private static class Batch implements ITombstoneTransport.Body {
+        final String batchId;
+        final List<File> files = new ArrayList<File>();
+        final List<File> skippedFiles = new ArrayList<File>();
+        final Set<String> signatures = new HashSet<String>();
+        final Map<String, Report> reports = new LinkedHashMap<String, Report>();
+        long bodyBytes = 0; //compressed bytes written by the last writeTo()
+
+        Batch(String batchId) {
+            this.batchId = batchId;
+        }
+
+        @Override
+        public void writeTo(OutputStream out) throws IOException {
+            CountingOutputStream counter = new CountingOutputStream(out);
+            Writer writer = new OutputStreamWriter(new GZIPOutputStream(counter), "UTF-8");
+            try {
+                writer.write("{\"batch\":");
+                writer.write(JSONObject.quote(batchId));
+                writer.write(",\"reports\":[");
+                boolean first = true;
+                for (Report report : reports.values()) {
+                    //only one tombstone is decoded and held in memory at a time
+                    Map<String, String> tombstone = TombstoneParser.parse(report.index, report.file.getAbsolutePath());
+
+                    if (!first) {
+                        writer.write(',');
+                    }
+                    first = false;
+                    writer.write("{\"signature\":");
+                    writer.write(JSONObject.quote(report.signature));
+                    writer.write(",\"count\":");
+                    writer.write(String.valueOf(report.count));
+                    writer.write(",\"tombstone\":");
+                    writer.write(new JSONObject(tombstone).toString());
+                    writer.write('}');
+                }
+                writer.write("]}");
+            } finally {
+                //finish the gzip stream, the transport's stream is not closed
+                writer.close();
+            }
+            bodyBytes = counter.count;
+        }
+
+        void close() {
+            for (Report report : reports.values()) {
+                report.index.close();
+            }
+        }
+    }
+
+    //count the bytes written to the transport, and keep the transport's stream open
+    private static class CountingOutputStream extends FilterOutputStream {
+        long count = 0;
+
+        CountingOutputStream(OutputStream out) {
+            super(out);
+        }
+
+        @Override
+        public void write(int b) throws IOException {
+            out.write(b);
+            count++;
+        }
+
+        @Override
+        public void write(byte[] b, int off, int len) throws IOException {
+            out.write(b, off, len);
+            count += len;
+        }
+
+        @Override
+        public void close() throws IOException {
+            flush();
+        }
+    }
+
+    private Batch buildBatch(String batchId, List<File> candidates, Properties journal) {
+        Batch batch = new Batch(batchId);
+        Map<String, Report> reports = batch.reports;
+        long rawBytes = 0;
+
+        for (File file : candidates) {
+            if (batch.files.size() >= params.maxBatchFiles) {
+                break;
+            }
+
+            //only the keys of the signature are decoded here
+            TombstoneIndex index;
+            try {
+                index = TombstoneIndex.open(file);
+            } catch (Exception e) {
+                XCrash.getLogger().w(Util.TAG, "TombstoneUploader open failed", e);
+                continue;
+            }
+            String signature = getSignature(index);
+
+            //uploaded within the dedupe window
+            if (journal.getProperty(keySignaturePrefix + signature) != null) {
+                index.close();
+                batch.skippedFiles.add(file);
+                continue;
+            }
+
+            //duplicated in this batch
+            Report report = reports.get(signature);
+            if (report != null) {
+                index.close();
+                report.count++;
+                batch.files.add(file);
+                continue;
+            }
+
+            //the raw byte budget of one batch, but always keep at least one
+            long size = file.length();
+            if (!batch.files.isEmpty() && rawBytes + size > params.maxBatchBytes) {
+                index.close();
+                break;
+            }
+            rawBytes += size;
+
+            reports.put(signature, new Report(signature, file, index));
+            batch.files.add(file);
+            batch.signatures.add(signature);
+        }
+
+        return batch;
+    }
+
+    private static String getSignature(TombstoneIndex tombstone) {
+        //computed by the native dumper
+        String signature = tombstone.get(TombstoneParser.keyCrashSignature);
+        if (!TextUtils.isEmpty(signature)) {
+            return signature.replace("'", "");
+        }
+
+        //crash type + signal / exception + top frames
+        StringBuilder sb = new StringBuilder();
+        sb.append(tombstone.get(TombstoneParser.keyCrashType)).append('\n');
+        String backtrace = tombstone.get(TombstoneParser.keyBacktrace);
+        if (!TextUtils.isEmpty(backtrace)) {
+            sb.append(tombstone.get(TombstoneParser.keySignal)).append('\n');
+            appendTopLines(sb, backtrace, false);
+        } else {
+            String stacktrace = tombstone.get(TombstoneParser.keyJavaStacktrace);
+            if (!TextUtils.isEmpty(stacktrace)) {
+                appendTopLines(sb, stacktrace, true);
+            }
+        }
+
+        try {
+            MessageDigest md = MessageDigest.getInstance("MD5");
+            BigInteger bigInt = new BigInteger(1, md.digest(sb.toString().getBytes("UTF-8")));
+            return String.format("%032x", bigInt);
+        } catch (Exception e) {
+            return String.format("%08x", sb.toString().hashCode());
+        }
+    }
+
+    private static void appendTopLines(StringBuilder sb, String content, boolean javaStacktrace) {
+        int frames = 0;
+        for (String line : content.split("\n")) {
+            line = line.trim();
+            if (javaStacktrace && !line.startsWith("at ")) {
+                //the exception class without the message
+                if (frames == 0 && !line.isEmpty()) {
+                    int i = line.indexOf(':');
+                    sb.append(i > 0 ? line.substring(0, i) : line).append('\n');
+                }
+                continue;
+            }
+            sb.append(line).append('\n');
+            if (++frames >= signatureFramesMax) {
+                break;
+            }
+        }
+    }
+
+    private static String joinPaths(List<File> files) {
+        StringBuilder sb = new StringBuilder();
+        for (File file : files) {
+            if (sb.length() > 0) {
+                sb.append(fileSeparator);
+            }
+            sb.append(file.getAbsolutePath());
+        }
+        return sb.toString();
+    }
+
+    private static long getLong(Properties journal, String key) {
+        try {
+            return Long.parseLong(journal.getProperty(key, "0"));
+        } catch (NumberFormatException e) {
+            return 0;
+        }
+    }
+
+    private Properties loadJournal() {
+        Properties journal = new Properties();
+        if (!journalFile.exists()) {
+            return journal;
+        }
+
+        FileInputStream in = null;
+        try {
+            in = new FileInputStream(journalFile);
+            journal.load(in);
+        } catch (Exception e) {
+            XCrash.getLogger().w(Util.TAG, "TombstoneUploader load journal failed", e);
+            journal.clear();
+        } finally {
+            if (in != null) {
+                try {
+                    in.close();
+                } catch (Exception ignored) {
+                }
+            }
+        }
+        return journal;
+    }
+
+    private boolean saveJournal(Properties journal) {
+        File dir = journalFile.getParentFile();
+        if (dir == null || !Util.checkAndCreateDir(dir.getAbsolutePath())) {
+            return false;
+        }
+
+        //write a temporary file and rename it, so the journal is never half written
+        File tmp = new File(dir, journalFileName + ".tmp");
+        FileOutputStream out = null;
+        try {
+            out = new FileOutputStream(tmp);
+            journal.store(out, null);
+            out.getFD().sync();
+            out.close();
+            out = null;
+            return tmp.renameTo(journalFile);
+        } catch (Exception e) {
+            XCrash.getLogger().w(Util.TAG, "TombstoneUploader save journal failed", e);
+            return false;
+        } finally {
+            if (out != null) {
+                try {
+                    out.close();
+                } catch (Exception ignored) {
+                }
+            }
+        }
+    }
+
+    /**
+     * The uploader parameter set.
+     */
+    public static class Parameters {
+        int  maxBatchFiles  = 10;
+        long maxBatchBytes  = 512 * 1024;
+        long maxBytesPerDay = 2 * 1024 * 1024;
+        long minIntervalMs  = 60 * 1000;
+        long dedupeWindowMs = 24 * 60 * 60 * 1000L;
+
+        /**
+         * Set the maximum number of the tombstones in one batch. (Default: 10)
+         *
+         * @param maxBatchFiles The maximum number of the tombstones in one batch.
+         * @return The Parameters object.
+         */
+        @SuppressWarnings("unused")
+        public Parameters setMaxBatchFiles(int maxBatchFiles) {
+            this.maxBatchFiles = (maxBatchFiles < 1 ? 1 : maxBatchFiles);
+            return this;
+        }
+
+        /**
+         * Set the maximum total size in bytes of the tombstone files in one batch, before compression.
+         * At least one tombstone is always sent. (Default: 512KB)
+         *
+         * @param maxBatchBytes The maximum total size in bytes.
+         * @return The Parameters object.
+         */
+        @SuppressWarnings("unused")
+        public Parameters setMaxBatchBytes(long maxBatchBytes) {
+            this.maxBatchBytes = (maxBatchBytes < 0 ? 0 : maxBatchBytes);
+            return this;
+        }
+
+        /**
+         * Set the maximum compressed bytes sent in 24 hours. (Default: 2MB)
+         *
+         * @param maxBytesPerDay The maximum compressed bytes sent in 24 hours.
+         * @return The Parameters object.
+         */
+        @SuppressWarnings("unused")
+        public Parameters setMaxBytesPerDay(long maxBytesPerDay) {
+            this.maxBytesPerDay = (maxBytesPerDay < 0 ? 0 : maxBytesPerDay);
+            return this;
+        }
+
+        /**
+         * Set the minimum interval in milliseconds between two sending, successful or not. (Default: 60000)
+         *
+         * @param minIntervalMs The minimum interval in milliseconds.
+         * @return The Parameters object.
+         */
+        @SuppressWarnings("unused")
+        public Parameters setMinIntervalMs(long minIntervalMs) {
+            this.minIntervalMs = (minIntervalMs < 0 ? 0 : minIntervalMs);
+            return this;
+        }
+
+        /**
+         * Set the window in milliseconds, within which the tombstones with an uploaded crash signature
+         * are deleted without sending. (Default: 86400000)
+         *
+         * @param dedupeWindowMs The dedupe window in milliseconds.
+         * @return The Parameters object.
+         */
+        @SuppressWarnings("unused")
+        public Parameters setDedupeWindowMs(long dedupeWindowMs) {
+            this.dedupeWindowMs = (dedupeWindowMs < 0 ? 0 : dedupeWindowMs);
+            return this;
+        }
+    }
+}
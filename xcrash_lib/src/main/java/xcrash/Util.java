@@ -67,12 +67,14 @@ class Util {
     static final String javaCrashType = "java";
     static final String nativeCrashType = "native";
     static final String anrCrashType = "anr";
+    static final String traceCrashType = "trace";
 
     static final String logPrefix = "tombstone";
     static final String javaLogSuffix = ".java.xcrash";
     static final String nativeLogSuffix = ".native.xcrash";
     static final String anrLogSuffix = ".anr.xcrash";
     static final String traceLogSuffix = ".trace.xcrash";
+    static final String miniCoreSuffix = ".minicore";
 
     static String getProcessName(Context ctx, int pid) {
 
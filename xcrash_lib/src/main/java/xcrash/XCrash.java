@@ -33,6 +33,17 @@ import android.text.TextUtils;
 @SuppressWarnings("unused")
 public final class XCrash {
 
+    /**
+     * The MD5 of the ELF file in the build id section. (Used by {@link InitParameters#setElfHashAlgorithm(int)})
+     */
+    public static final int ELF_HASH_MD5 = 1;
+
+    /**
+     * The XXH3 tree hash of the ELF file in the build id section: the XXH3-64 of the concatenated little-endian
+     * XXH3-64 of every 1MB chunk. (Used by {@link InitParameters#setElfHashAlgorithm(int)})
+     */
+    public static final int ELF_HASH_XXH3 = 2;
+
     private static boolean initialized = false;
     private static String appId = null;
     private static String appVersion = null;
@@ -158,9 +169,12 @@ public final class XCrash {
                 params.javaLogcatMainLines,
                 params.javaDumpFds,
                 params.javaDumpNetworkInfo,
+                params.javaDumpMemInfoDetail,
                 params.javaDumpAllThreads,
                 params.javaDumpAllThreadsCountMax,
                 params.javaDumpAllThreadsWhiteList,
+                params.javaDumpAllThreadsNative,
+                params.elfHashAlgorithm,
                 params.javaCallback);
         }
 
@@ -179,6 +193,7 @@ public final class XCrash {
                 params.anrLogcatMainLines,
                 params.anrDumpFds,
                 params.anrDumpNetworkInfo,
+                params.anrDumpMemInfoDetail,
                 params.anrCallback,
                 params.anrFastCallback);
         }
@@ -198,12 +213,18 @@ public final class XCrash {
                 params.nativeLogcatEventsLines,
                 params.nativeLogcatMainLines,
                 params.nativeDumpElfHash,
+                params.elfHashAlgorithm,
                 params.nativeDumpMap,
                 params.nativeDumpFds,
                 params.nativeDumpNetworkInfo,
+                params.nativeDumpMemInfoDetail,
                 params.nativeDumpAllThreads,
                 params.nativeDumpAllThreadsCountMax,
                 params.nativeDumpAllThreadsWhiteList,
+                params.nativeSuppressDuplicatesWindow,
+                params.nativeStackScan,
+                params.nativeDumpBudget,
+                params.nativeDumpMiniCore,
                 params.nativeCallback,
                 params.enableAnrHandler && Build.VERSION.SDK_INT >= 21,
                 params.anrRethrow,
@@ -213,8 +234,12 @@ public final class XCrash {
                 params.anrLogcatMainLines,
                 params.anrDumpFds,
                 params.anrDumpNetworkInfo,
+                params.anrDumpMemInfoDetail,
+                params.anrMainThreadSamplingThreshold,
+                params.anrMainThreadSamplingInterval,
                 params.anrCallback,
-                params.anrFastCallback);
+                params.anrFastCallback,
+                params.warmUpAsync);
         }
 
         //maintain tombstone and placeholder files in a background thread with some delay
@@ -234,6 +259,8 @@ public final class XCrash {
         int        logFileMaintainDelayMs = 5000;
         ILogger    logger                 = null;
         ILibLoader libLoader              = null;
+        boolean    warmUpAsync            = false;
+        int        elfHashAlgorithm       = ELF_HASH_MD5;
 
         /**
          * Set App version. You can use this method to set an internal test/gray version number.
@@ -295,6 +322,40 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set if the native initialization should be warmed up asynchronously. (Default: false)
+         *
+         * <p>If true, {@link xcrash.XCrash#init(Context, InitParameters)} only loads the native library and registers
+         * the signal handlers (and creates the log directory). The others (the fallback unwinder, the placeholder
+         * file, the dumper check, the ANR trace thread and the main thread watchdog) are done in a background thread.
+         * A native crash before the warm-up finished is still captured, and falls back to the in-process
+         * unwinder when the dumper can not be used.
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setWarmUpAsync(boolean flag) {
+            this.warmUpAsync = flag;
+            return this;
+        }
+
+        /**
+         * Set the algorithm of the ELF file's hash in the build id section of the native and Java crashes.
+         * (Default: {@link xcrash.XCrash#ELF_HASH_MD5})
+         *
+         * <p>{@link xcrash.XCrash#ELF_HASH_XXH3} is about 10 times faster than MD5, and the large files are
+         * hashed by several threads in the native dumper. The hash is labelled with "MD5: " or "XXH3: ".
+         *
+         * @param algorithm {@link xcrash.XCrash#ELF_HASH_MD5} or {@link xcrash.XCrash#ELF_HASH_XXH3}.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setElfHashAlgorithm(int algorithm) {
+            this.elfHashAlgorithm = (algorithm == ELF_HASH_XXH3 ? ELF_HASH_XXH3 : ELF_HASH_MD5);
+            return this;
+        }
+
         //placeholder
         int placeholderCountMax = 0;
         int placeholderSizeKb   = 128;
@@ -334,9 +395,11 @@ public final class XCrash {
         int            javaLogcatMainLines         = 200;
         boolean        javaDumpFds                 = true;
         boolean        javaDumpNetworkInfo         = true;
+        boolean        javaDumpMemInfoDetail       = true;
         boolean        javaDumpAllThreads          = true;
         int            javaDumpAllThreadsCountMax  = 0;
         String[]       javaDumpAllThreadsWhiteList = null;
+        boolean        javaDumpAllThreadsNative    = false;
         ICrashCallback javaCallback                = null;
 
         /**
@@ -446,6 +509,19 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set if dumping memory info details (per category, from "/proc/PID/smaps") when a java crash occurred.
+         * If disabled, only the memory summary is dumped, read from "/proc/PID/smaps_rollup" when it is available. (Default: enable)
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setJavaDumpMemInfoDetail(boolean flag) {
+            this.javaDumpMemInfoDetail = flag;
+            return this;
+        }
+
         /**
          * Set if dumping threads info (stacktrace) for all threads (not just the thread that has crashed)
          * when a Java exception occurred. (Default: enable)
@@ -489,6 +565,25 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set if dumping other threads by the native dumper when a Java exception occurred. (Default: disable)
+         *
+         * <p>The native dumper suspends and unwinds all threads, and writes their native backtraces to the
+         * log file directly, which is much faster than building the Java stacktraces of all threads.
+         * If the native crash handler is not available, the Java stacktraces are dumped as before.
+         *
+         * <p>Note: This option is only useful when "JavaDumpAllThreads" is enabled by calling {@link InitParameters#setJavaDumpAllThreads(boolean)}.
+         * The thread count limit and the whitelist are applied by the native dumper (POSIX extended regular expressions).
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setJavaDumpAllThreadsNative(boolean flag) {
+            this.javaDumpAllThreadsNative = flag;
+            return this;
+        }
+
         /**
          * Set a callback to be executed when a Java exception occurred. (If not set, nothing will be happened.)
          *
@@ -512,11 +607,18 @@ public final class XCrash {
         boolean        nativeDumpMap                 = true;
         boolean        nativeDumpFds                 = true;
         boolean        nativeDumpNetworkInfo         = true;
+        boolean        nativeDumpMemInfoDetail       = true;
         boolean        nativeDumpAllThreads          = true;
         int            nativeDumpAllThreadsCountMax  = 0;
         String[]       nativeDumpAllThreadsWhiteList = null;
+        boolean        nativeStackScan               = false;
+        int            nativeDumpBudget              = 25000;
+        boolean        nativeDumpMiniCore            = false;
         ICrashCallback nativeCallback                = null;
 
+        //native crash: suppressing the duplicates
+        int            nativeSuppressDuplicatesWindow = 0;
+
         /**
          * Enable the native crash capture feature. (Default: enable)
          *
@@ -648,6 +750,19 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set if dumping memory info details (per category, from "/proc/PID/smaps") when a native crash occurred.
+         * If disabled, only the memory summary is dumped, read from "/proc/PID/smaps_rollup" when it is available. (Default: enable)
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setNativeDumpMemInfoDetail(boolean flag) {
+            this.nativeDumpMemInfoDetail = flag;
+            return this;
+        }
+
         /**
          * Set if dumping threads info (registers, backtrace and stack) for all threads (not just the thread that has crashed)
          * when a native crash occurred. (Default: enable)
@@ -695,6 +810,71 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set a time window (in seconds) for suppressing duplicate native crash tombstones. (Default: 0, no suppression)
+         *
+         * <p>A signature is computed from the crashed thread's top frames (build-id, relative PC and function name).
+         * If the same signature occurs again within the time window after a full dump, only a short reference record
+         * with the occurrence count and the backtrace will be written into the tombstone file.
+         *
+         * @param seconds The time window in seconds. "0" means disabled.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setNativeSuppressDuplicatesWindow(int seconds) {
+            this.nativeSuppressDuplicatesWindow = (seconds < 0 ? 0 : seconds);
+            return this;
+        }
+
+        /**
+         * Set if scanning the stack for return addresses when the native unwinding stopped early. (Default: disable)
+         *
+         * <p>When both the unwind tables and the link register failed, the stack words above SP are scanned for
+         * a return address which points right after a call instruction in an executable mapping. The frames found
+         * in this way are marked with "[scanned]" in the backtrace, they may be inaccurate.
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setNativeStackScan(boolean flag) {
+            this.nativeStackScan = flag;
+            return this;
+        }
+
+        /**
+         * Set the time budget (in milliseconds) of the native crash dumper. (Default: 25000)
+         *
+         * <p>The optional sections (e.g. logcat, other threads, ELF hash) are scheduled by their priorities and
+         * estimated costs. When the budget is running out, the lower priority sections are skipped or truncated,
+         * and listed in the "dump budget" section of the tombstone. The dumper is always killed after 30 seconds.
+         *
+         * @param milliseconds The time budget in milliseconds. "0" means no budget.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setNativeDumpBudget(int milliseconds) {
+            this.nativeDumpBudget = (milliseconds < 0 ? 0 : milliseconds);
+            return this;
+        }
+
+        /**
+         * Set if writing a mini-core next to the native crash tombstone. (Default: disable)
+         *
+         * <p>The mini-core (with the suffix ".minicore") contains the memory maps, the registers and stacks of
+         * the unwound threads, the memory near the fault address and the build-ids of the loaded ELFs. It can be
+         * unwound again offline by the xcrash_replay tool, with the unstripped libraries. It is usually smaller
+         * than 1MB, and at most about 4MB.
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setNativeDumpMiniCore(boolean flag) {
+            this.nativeDumpMiniCore = flag;
+            return this;
+        }
+
         /**
          * Set a callback to be executed when a native crash occurred. (If not set, nothing will be happened.)
          *
@@ -717,9 +897,14 @@ public final class XCrash {
         int            anrLogcatMainLines   = 200;
         boolean        anrDumpFds           = true;
         boolean        anrDumpNetworkInfo   = true;
+        boolean        anrDumpMemInfoDetail = true;
         ICrashCallback anrCallback          = null;
         ICrashCallback anrFastCallback      = null;
 
+        //anr: main thread sampling
+        int            anrMainThreadSamplingThreshold = 0;
+        int            anrMainThreadSamplingInterval  = 100;
+
         /**
          * Enable the ANR capture feature. (Default: enable)
          *
@@ -845,6 +1030,52 @@ public final class XCrash {
             return this;
         }
 
+        /**
+         * Set if dumping memory info details (per category, from "/proc/PID/smaps") when an ANR occurred.
+         * If disabled, only the memory summary is dumped, read from "/proc/PID/smaps_rollup" when it is available. (Default: enable)
+         *
+         * @param flag True or false.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setAnrDumpMemInfoDetail(boolean flag) {
+            this.anrDumpMemInfoDetail = flag;
+            return this;
+        }
+
+        /**
+         * Set the threshold (in milliseconds) of the main looper stall, after which the main thread's native stack
+         * will be sampled periodically. The samples of the last stall will be dumped as folded stacks with counts
+         * in the "main thread samples" section when an ANR occurred. (Default: 0, disabled)
+         *
+         * <p>Note: The samples are taken by frame pointers, so the frames of code compiled without frame pointers
+         * (e.g. the Java code compiled by ART) may be missing. The stall is detected by a heartbeat message which is
+         * posted to the main looper once per threshold, so the main thread wakes up once per threshold even when it
+         * is idle, and a stall is noticed between one and two thresholds after it started.
+         *
+         * @param thresholdMs The stall threshold in milliseconds. "0" means disabled.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setAnrMainThreadSamplingThreshold(int thresholdMs) {
+            this.anrMainThreadSamplingThreshold = (thresholdMs < 0 ? 0 : thresholdMs);
+            return this;
+        }
+
+        /**
+         * Set the main thread sampling interval (in milliseconds) during a main looper stall. (Default: 100)
+         *
+         * <p>Note: The minimum value is 10. Sampling also stops when it has taken 2% of the stall time.
+         *
+         * @param intervalMs The sampling interval in milliseconds.
+         * @return The InitParameters object.
+         */
+        @SuppressWarnings("unused")
+        public InitParameters setAnrMainThreadSamplingInterval(int intervalMs) {
+            this.anrMainThreadSamplingInterval = (intervalMs < 10 ? 10 : intervalMs);
+            return this;
+        }
+
         /**
          * Set a callback to be executed when an ANR occurred. (If not set, nothing will be happened.)
          *
@@ -888,6 +1119,66 @@ public final class XCrash {
         return logger;
     }
 
+    /**
+     * Append a breadcrumb to the in-process ring buffer.
+     *
+     * <p>The most recent 64 breadcrumbs will be recorded in the "breadcrumbs" section of the native crash log.
+     * This method is lock-free and does not allocate native memory, so it can be called frequently.
+     * Messages longer than 111 bytes (in UTF-8) will be truncated.
+     *
+     * @param message The breadcrumb message.
+     */
+    @SuppressWarnings("unused")
+    public static void appendBreadcrumb(String message) {
+        NativeHandler.getInstance().appendBreadcrumb(message);
+    }
+
+    /**
+     * Dump the native backtraces of all the other threads, without crashing.
+     *
+     * <p>This is for the janks and hangs which never become ANRs. The threads are only frozen while being
+     * unwound by the native dumper. The dumps are rate-limited to one per 10 seconds. The trace log file
+     * (with the suffix ".trace.xcrash") will be removed by the next dump or ANR, so it should be consumed
+     * (e.g. uploaded) at once. The native crash capturing must be enabled.
+     *
+     * @return The absolute path of the trace log file, or null if failed or rate-limited.
+     */
+    @SuppressWarnings("unused")
+    public static String dumpNativeThreads() {
+        String logPath = NativeHandler.getInstance().dumpThreads();
+        if (logPath != null) {
+            FileManager.getInstance().maintainTrace(logPath);
+        }
+        return logPath;
+    }
+
+    /**
+     * Start the in-process native sampling profiler.
+     *
+     * <p>The target thread is sampled by a signal at the given interval (at least 5 ms), and the samples are
+     * unwound by a background thread. At most 3% of the wall time is spent on sampling and unwinding, the
+     * samples over the budget are skipped. Every 10 seconds (and when stopped), the folded stacks are appended
+     * to "native_profile.folded" in the log directory, each window begins with a "#" line which reports
+     * the number of samples, the skipped and dropped ones, and the overhead. The file is rotated to
+     * "native_profile.folded.1" when it is larger than 512KB. The native crash capturing must be enabled.
+     *
+     * @param tid The thread ID of the target thread, 0 means the main thread.
+     * @param intervalMs Sampling interval in milliseconds.
+     * @return true if the profiler is started, false if failed or it is already running.
+     */
+    @SuppressWarnings("unused")
+    public static boolean startNativeProfiler(int tid, int intervalMs) {
+        return NativeHandler.getInstance().startProfiler(tid, intervalMs);
+    }
+
+    /**
+     * Stop the in-process native sampling profiler, and wait for the last folded stacks to be written.
+     */
+    @SuppressWarnings("unused")
+    public static void stopNativeProfiler() {
+        NativeHandler.getInstance().stopProfiler();
+    }
+
     /**
      * Force a java exception.
      *
@@ -0,0 +1,289 @@
+// Copyright (c) 2019-present, iQIYI, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+package xcrash;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.FileChannel;
+
+/**
+ * XXH3-64 of xxHash (seed 0, the default secret), and the tree hash of a file which is the same
+ * as xcd_xxh3_tree() in the native dumper.
+ */
+final class Xxh3 {
+
+    private Xxh3() {
+    }
+
+    static final int treeChunkSize = 1024 * 1024;
+
+    private static final long PRIME32_1 = 0x9E3779B1L;
+    private static final long PRIME32_2 = 0x85EBCA77L;
+    private static final long PRIME32_3 = 0xC2B2AE3DL;
+    private static final long PRIME64_1 = 0x9E3779B185EBCA87L;
+    private static final long PRIME64_2 = 0xC2B2AE3D27D4EB4FL;
+    private static final long PRIME64_3 = 0x165667B19E3779F9L;
+    private static final long PRIME64_4 = 0x85EBCA77C2B2AE63L;
+    private static final long PRIME64_5 = 0x27D4EB2F165667C5L;
+    private static final long PRIME_MX1 = 0x165667919E3779F9L;
+    private static final long PRIME_MX2 = 0x9FB21C651E98DF25L;
+
+    private static final int secretSize = 192;
+    private static final int stripeLen = 64;
+    private static final int secretConsume = 8;
+    private static final int stripesPerBlock = (secretSize - stripeLen) / secretConsume;
+    private static final int blockLen = stripeLen * stripesPerBlock;
+
+    private static final ByteBuffer secret = ByteBuffer.wrap(new byte[]{
+        (byte) 0xb8, (byte) 0xfe, (byte) 0x6c, (byte) 0x39, (byte) 0x23, (byte) 0xa4, (byte) 0x4b, (byte) 0xbe,
+        (byte) 0x7c, (byte) 0x01, (byte) 0x81, (byte) 0x2c, (byte) 0xf7, (byte) 0x21, (byte) 0xad, (byte) 0x1c,
+        (byte) 0xde, (byte) 0xd4, (byte) 0x6d, (byte) 0xe9, (byte) 0x83, (byte) 0x90, (byte) 0x97, (byte) 0xdb,
+        (byte) 0x72, (byte) 0x40, (byte) 0xa4, (byte) 0xa4, (byte) 0xb7, (byte) 0xb3, (byte) 0x67, (byte) 0x1f,
+        (byte) 0xcb, (byte) 0x79, (byte) 0xe6, (byte) 0x4e, (byte) 0xcc, (byte) 0xc0, (byte) 0xe5, (byte) 0x78,
+        (byte) 0x82, (byte) 0x5a, (byte) 0xd0, (byte) 0x7d, (byte) 0xcc, (byte) 0xff, (byte) 0x72, (byte) 0x21,
+        (byte) 0xb8, (byte) 0x08, (byte) 0x46, (byte) 0x74, (byte) 0xf7, (byte) 0x43, (byte) 0x24, (byte) 0x8e,
+        (byte) 0xe0, (byte) 0x35, (byte) 0x90, (byte) 0xe6, (byte) 0x81, (byte) 0x3a, (byte) 0x26, (byte) 0x4c,
+        (byte) 0x3c, (byte) 0x28, (byte) 0x52, (byte) 0xbb, (byte) 0x91, (byte) 0xc3, (byte) 0x00, (byte) 0xcb,
+        (byte) 0x88, (byte) 0xd0, (byte) 0x65, (byte) 0x8b, (byte) 0x1b, (byte) 0x53, (byte) 0x2e, (byte) 0xa3,
+        (byte) 0x71, (byte) 0x64, (byte) 0x48, (byte) 0x97, (byte) 0xa2, (byte) 0x0d, (byte) 0xf9, (byte) 0x4e,
+        (byte) 0x38, (byte) 0x19, (byte) 0xef, (byte) 0x46, (byte) 0xa9, (byte) 0xde, (byte) 0xac, (byte) 0xd8,
+        (byte) 0xa8, (byte) 0xfa, (byte) 0x76, (byte) 0x3f, (byte) 0xe3, (byte) 0x9c, (byte) 0x34, (byte) 0x3f,
+        (byte) 0xf9, (byte) 0xdc, (byte) 0xbb, (byte) 0xc7, (byte) 0xc7, (byte) 0x0b, (byte) 0x4f, (byte) 0x1d,
+        (byte) 0x8a, (byte) 0x51, (byte) 0xe0, (byte) 0x4b, (byte) 0xcd, (byte) 0xb4, (byte) 0x59, (byte) 0x31,
+        (byte) 0xc8, (byte) 0x9f, (byte) 0x7e, (byte) 0xc9, (byte) 0xd9, (byte) 0x78, (byte) 0x73, (byte) 0x64,
+        (byte) 0xea, (byte) 0xc5, (byte) 0xac, (byte) 0x83, (byte) 0x34, (byte) 0xd3, (byte) 0xeb, (byte) 0xc3,
+        (byte) 0xc5, (byte) 0x81, (byte) 0xa0, (byte) 0xff, (byte) 0xfa, (byte) 0x13, (byte) 0x63, (byte) 0xeb,
+        (byte) 0x17, (byte) 0x0d, (byte) 0xdd, (byte) 0x51, (byte) 0xb7, (byte) 0xf0, (byte) 0xda, (byte) 0x49,
+        (byte) 0xd3, (byte) 0x16, (byte) 0x55, (byte) 0x26, (byte) 0x29, (byte) 0xd4, (byte) 0x68, (byte) 0x9e,
+        (byte) 0x2b, (byte) 0x16, (byte) 0xbe, (byte) 0x58, (byte) 0x7d, (byte) 0x47, (byte) 0xa1, (byte) 0xfc,
+        (byte) 0x8f, (byte) 0xf8, (byte) 0xb8, (byte) 0xd1, (byte) 0x7a, (byte) 0xd0, (byte) 0x31, (byte) 0xce,
+        (byte) 0x45, (byte) 0xcb, (byte) 0x3a, (byte) 0x8f, (byte) 0x95, (byte) 0x16, (byte) 0x04, (byte) 0x28,
+        (byte) 0xaf, (byte) 0xd7, (byte) 0xfb, (byte) 0xca, (byte) 0xbb, (byte) 0x4b, (byte) 0x40, (byte) 0x7e,
+    }).order(ByteOrder.LITTLE_ENDIAN);
+
+    /**
+     * The tree hash of a file: the XXH3-64 of the concatenated little-endian XXH3-64 of every 1MB chunk
+     * (at least one chunk).
+     *
+     * @param file The file.
+     * @return The hash in 16 hex digits, or null if failed.
+     */
+    static String hashFile(File file) {
+        FileInputStream in = null;
+
+        try {
+            in = new FileInputStream(file);
+            FileChannel channel = in.getChannel();
+            long size = channel.size();
+            long chunks = (size == 0 ? 1 : (size - 1) / treeChunkSize + 1);
+
+            ByteBuffer chunk = ByteBuffer.allocate(treeChunkSize).order(ByteOrder.LITTLE_ENDIAN);
+            ByteBuffer leaves = ByteBuffer.allocate((int) chunks * 8).order(ByteOrder.LITTLE_ENDIAN);
+            for (long i = 0; i < chunks; i++) {
+                chunk.clear();
+                while (chunk.hasRemaining()) {
+                    if (channel.read(chunk) < 0) {
+                        break;
+                    }
+                }
+                leaves.putLong(hash(chunk, 0, chunk.position()));
+            }
+
+            return String.format("%016x", hash(leaves, 0, leaves.capacity()));
+        } catch (Exception e) {
+            e.printStackTrace();
+            return null;
+        } finally {
+            if (in != null) {
+                try {
+                    in.close();
+                } catch (Exception ignored) {
+                }
+            }
+        }
+    }
+
+    /**
+     * XXH3-64 with the seed 0.
+     *
+     * @param b The little-endian buffer.
+     * @param p The offset in the buffer.
+     * @param len The length of the data.
+     * @return The hash.
+     */
+    static long hash(ByteBuffer b, int p, int len) {
+        if (len <= 16) {
+            return len0To16(b, p, len);
+        } else if (len <= 128) {
+            return len17To128(b, p, len);
+        } else if (len <= 240) {
+            return len129To240(b, p, len);
+        } else {
+            return lenLong(b, p, len);
+        }
+    }
+
+    private static long read32(ByteBuffer b, int p) {
+        return b.getInt(p) & 0xFFFFFFFFL;
+    }
+
+    private static long read64(ByteBuffer b, int p) {
+        return b.getLong(p);
+    }
+
+    //the 64-bit xor-fold of the 128-bit unsigned product
+    private static long mul128Fold64(long a, long b) {
+        long loLo = (a & 0xFFFFFFFFL) * (b & 0xFFFFFFFFL);
+        long hiLo = (a >>> 32) * (b & 0xFFFFFFFFL);
+        long loHi = (a & 0xFFFFFFFFL) * (b >>> 32);
+        long hiHi = (a >>> 32) * (b >>> 32);
+        long cross = (loLo >>> 32) + (hiLo & 0xFFFFFFFFL) + loHi;
+        long upper = (hiLo >>> 32) + (cross >>> 32) + hiHi;
+        long lower = (cross << 32) | (loLo & 0xFFFFFFFFL);
+        return lower ^ upper;
+    }
+
+    private static long xxh64Avalanche(long h) {
+        h ^= h >>> 33;
+        h *= PRIME64_2;
+        h ^= h >>> 29;
+        h *= PRIME64_3;
+        h ^= h >>> 32;
+        return h;
+    }
+
+    private static long avalanche(long h) {
+        h ^= h >>> 37;
+        h *= PRIME_MX1;
+        h ^= h >>> 32;
+        return h;
+    }
+
+    private static long rrmxmx(long h, long len) {
+        h ^= Long.rotateLeft(h, 49) ^ Long.rotateLeft(h, 24);
+        h *= PRIME_MX2;
+        h ^= (h >>> 35) + len;
+        h *= PRIME_MX2;
+        return h ^ (h >>> 28);
+    }
+
+    private static long mix16(ByteBuffer b, int p, int s) {
+        return mul128Fold64(read64(b, p) ^ read64(secret, s), read64(b, p + 8) ^ read64(secret, s + 8));
+    }
+
+    private static long len0To16(ByteBuffer b, int p, int len) {
+        if (len > 8) {
+            long lo = read64(b, p) ^ (read64(secret, 24) ^ read64(secret, 32));
+            long hi = read64(b, p + len - 8) ^ (read64(secret, 40) ^ read64(secret, 48));
+            return avalanche(len + Long.reverseBytes(lo) + hi + mul128Fold64(lo, hi));
+        } else if (len >= 4) {
+            long v = read32(b, p + len - 4) + (read32(b, p) << 32);
+            return rrmxmx(v ^ (read64(secret, 8) ^ read64(secret, 16)), len);
+        } else if (len > 0) {
+            long v = ((b.get(p) & 0xFFL) << 16) | ((b.get(p + (len >> 1)) & 0xFFL) << 24)
+                | (b.get(p + len - 1) & 0xFFL) | ((long) len << 8);
+            return xxh64Avalanche(v ^ (read32(secret, 0) ^ read32(secret, 4)));
+        } else {
+            return xxh64Avalanche(read64(secret, 56) ^ read64(secret, 64));
+        }
+    }
+
+    private static long len17To128(ByteBuffer b, int p, int len) {
+        long acc = len * PRIME64_1;
+
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc += mix16(b, p + 48, 96);
+                    acc += mix16(b, p + len - 64, 112);
+                }
+                acc += mix16(b, p + 32, 64);
+                acc += mix16(b, p + len - 48, 80);
+            }
+            acc += mix16(b, p + 16, 32);
+            acc += mix16(b, p + len - 32, 48);
+        }
+        acc += mix16(b, p, 0);
+        acc += mix16(b, p + len - 16, 16);
+
+        return avalanche(acc);
+    }
+
+    private static long len129To240(ByteBuffer b, int p, int len) {
+        long acc = len * PRIME64_1;
+        int rounds = len / 16;
+
+        for (int i = 0; i < 8; i++) {
+            acc += mix16(b, p + 16 * i, 16 * i);
+        }
+        acc = avalanche(acc);
+        for (int i = 8; i < rounds; i++) {
+            acc += mix16(b, p + 16 * i, 16 * (i - 8) + 3);
+        }
+        acc += mix16(b, p + len - 16, 136 - 17);
+
+        return avalanche(acc);
+    }
+
+    //accumulate the stripes (each stripe uses the secret at 8 bytes after the previous one)
+    private static void accumulate(long[] acc, ByteBuffer b, int p, int s, int stripes) {
+        for (int n = 0; n < stripes; n++, p += stripeLen, s += secretConsume) {
+            for (int i = 0; i < 8; i++) {
+                long d = read64(b, p + 8 * i);
+                long dk = d ^ read64(secret, s + 8 * i);
+                acc[i ^ 1] += d;
+                acc[i] += (dk & 0xFFFFFFFFL) * (dk >>> 32);
+            }
+        }
+    }
+
+    private static void scramble(long[] acc, int s) {
+        for (int i = 0; i < 8; i++) {
+            acc[i] ^= acc[i] >>> 47;
+            acc[i] ^= read64(secret, s + 8 * i);
+            acc[i] *= PRIME32_1;
+        }
+    }
+
+    private static long lenLong(ByteBuffer b, int p, int len) {
+        long[] acc = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+        int blocks = (len - 1) / blockLen;
+        long result = len * PRIME64_1;
+
+        for (int n = 0; n < blocks; n++) {
+            accumulate(acc, b, p + n * blockLen, 0, stripesPerBlock);
+            scramble(acc, secretSize - stripeLen);
+        }
+
+        //the last partial block, and the last stripe
+        accumulate(acc, b, p + blocks * blockLen, 0, ((len - 1) - blocks * blockLen) / stripeLen);
+        accumulate(acc, b, p + len - stripeLen, secretSize - stripeLen - 7, 1);
+
+        //merge the accumulators
+        for (int n = 0; n < 4; n++) {
+            result += mul128Fold64(acc[2 * n] ^ read64(secret, 11 + 16 * n), acc[2 * n + 1] ^ read64(secret, 11 + 16 * n + 8));
+        }
+        return avalanche(result);
+    }
+}